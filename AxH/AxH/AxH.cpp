@@ -9,6 +9,7 @@
 #include "errhndl.h"
 #include "utils.h"
 #include "input.h"
+#include "cpu.h"
 
 #ifdef _ENV_WIN
 LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
@@ -167,6 +168,7 @@ int APIENTRY WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 
 	bool _Compat() {
 		bool flag = true;
+		Util::Cpu::init();
 #ifdef _ENV_LINUX
 		flag &= glfwInit();
 		flag &= glfwVulkanSupported();
@@ -0,0 +1,169 @@
+#include "alloc.h"
+#include <cstdlib>
+#include <cstddef>
+#include <algorithm>
+
+using namespace Util;
+
+static thread_local arena* _currentArena = nullptr;
+
+static size_t _align_up(size_t v, size_t align) {
+	return (v + align - 1) & ~(align - 1);
+}
+
+arena::arena(size_t chunkSize) : _chunkSize(chunkSize) {
+	ASSERT(chunkSize > 0, "the chunk size of an arena has to be positive", CHANNEL_MEMORY);
+}
+
+arena::~arena() {
+	release();
+}
+
+void* arena::allocate(size_t size, size_t align) {
+	ROBUST_ASSERT(align != 0 && (align & (align - 1)) == 0, "arena alignment has to be a power of two", CHANNEL_MEMORY);
+	char* p = reinterpret_cast<char*>(_align_up(reinterpret_cast<size_t>(_cur), align));
+	if (!_cur || p + size > _end) {
+		_grow(size, align);
+		p = reinterpret_cast<char*>(_align_up(reinterpret_cast<size_t>(_cur), align));
+	}
+	_used += size_t(p + size - _cur);
+	_cur = p + size;
+	return p;
+}
+
+void arena::_grow(size_t size, size_t align) {
+	//the header is followed by the data, room for the alignment is added on top of the request
+	const size_t header = _align_up(sizeof(_chunk), alignof(std::max_align_t));
+	const size_t need = size + (align > alignof(std::max_align_t) ? align : 0);
+	const size_t bytes = std::max(_chunkSize, need);
+	_chunk* c = static_cast<_chunk*>(std::malloc(header + bytes));
+	if (!c) {
+		PRINT_ERR("arena chunk allocation failed", PRIORITY_HALT, CHANNEL_MEMORY);
+		throw std::bad_alloc();
+	}
+	c->next = _head;
+	c->size = bytes;
+	_head = c;
+	_capacity += bytes;
+	//the rest of the previous chunk is abandoned and counted as used
+	_used += size_t(_end - _cur);
+	_cur = reinterpret_cast<char*>(c) + header;
+	_end = _cur + bytes;
+}
+
+void arena::reset() {
+	_highWater = std::max(_highWater, _used);
+	if (_head && _head->next) {
+		//several chunks, replace them by one of the combined size
+		const size_t total = _capacity;
+		release();
+		_chunkSize = std::max(_chunkSize, total);
+		_grow(0, 1);
+	}
+	else if (_head) {
+		_cur = reinterpret_cast<char*>(_head) + _align_up(sizeof(_chunk), alignof(std::max_align_t));
+		_end = _cur + _head->size;
+	}
+	_used = 0;
+}
+
+void arena::release() {
+	_highWater = std::max(_highWater, _used);
+	while (_head) {
+		_chunk* next = _head->next;
+		std::free(_head);
+		_head = next;
+	}
+	_cur = nullptr;
+	_end = nullptr;
+	_used = 0;
+	_capacity = 0;
+}
+
+arena::scope::scope(arena& a) : _previous(_currentArena) {
+	_currentArena = &a;
+}
+
+arena::scope::~scope() {
+	_currentArena = _previous;
+}
+
+arena* arena::current() {
+	return _currentArena;
+}
+
+frame_arena::frame_arena(size_t buffers, size_t chunkSize) :
+	_arenas{ arena(chunkSize), arena(chunkSize), arena(chunkSize) }, _count(buffers) {
+	ASSERT(buffers >= 2 && buffers <= MAX_BUFFERS, "a frame_arena has 2 or 3 buffers", CHANNEL_MEMORY);
+}
+
+void frame_arena::next_frame() {
+	_frameHighWater = _arenas[_current].used();
+	_highWater = std::max(_highWater, _frameHighWater);
+	_current = (_current + 1) % _count;
+	_arenas[_current].reset();
+	++_frame;
+}
+
+size_t frame_arena::capacity() const {
+	size_t total = 0;
+	for (size_t i = 0; i < _count; ++i) {
+		total += _arenas[i].capacity();
+	}
+	return total;
+}
+
+fixed_pool::fixed_pool(size_t blockSize, size_t align, size_t blocksPerChunk) : _blocksPerChunk(blocksPerChunk) {
+	ASSERT(blocksPerChunk > 0, "a fixed_pool chunk has to hold blocks", CHANNEL_MEMORY);
+	//every block has to hold the free list link
+	_align = std::max(align, alignof(_free));
+	_blockSize = _align_up(std::max(blockSize, sizeof(_free)), _align);
+}
+
+fixed_pool::~fixed_pool() {
+	if (_live != 0) {
+		//blocks are still owned (e.g. by statics destroyed after the pool), the chunks are left to the operating system
+		return;
+	}
+	while (_chunks) {
+		void* next = *static_cast<void**>(_chunks);
+		std::free(_chunks);
+		_chunks = next;
+	}
+}
+
+void* fixed_pool::allocate() {
+	if (!_freeList) {
+		_grow();
+	}
+	_free* b = _freeList;
+	_freeList = b->next;
+	++_live;
+	return b;
+}
+
+void fixed_pool::deallocate(void* p) {
+	_free* b = static_cast<_free*>(p);
+	b->next = _freeList;
+	_freeList = b;
+	--_live;
+}
+
+void fixed_pool::_grow() {
+	//the link to the next chunk sits in front of the first block
+	const size_t header = _align_up(sizeof(void*), _align);
+	char* mem = static_cast<char*>(std::malloc(header + _blockSize * _blocksPerChunk + _align));
+	if (!mem) {
+		PRINT_ERR("fixed_pool chunk allocation failed", PRIORITY_HALT, CHANNEL_MEMORY);
+		throw std::bad_alloc();
+	}
+	*reinterpret_cast<void**>(mem) = _chunks;
+	_chunks = mem;
+	char* first = reinterpret_cast<char*>(_align_up(reinterpret_cast<size_t>(mem) + header, _align));
+	//link the blocks so the lowest address is handed out first
+	for (size_t i = _blocksPerChunk; i-- > 0;) {
+		_free* b = reinterpret_cast<_free*>(first + i * _blockSize);
+		b->next = _freeList;
+		_freeList = b;
+	}
+}
@@ -0,0 +1,316 @@
+#ifndef __H_ALLOC
+#define __H_ALLOC
+
+#include <new>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include "inc_settings.h"
+#include "errhndl.h"
+
+namespace Util {
+
+	/// <summary>
+	/// Bump allocator over a list of chunks. Allocating moves a pointer, memory is only given back all at once by reset() or release().
+	/// Destructors are not run by the arena, objects with non trivial destructors have to be destroyed by their owners (see arena_alloc).
+	/// reset() merges the chunks into one chunk large enough for everything allocated before, so a workload that repeats
+	/// (a frame, a level load) allocates from a single chunk after the first round.
+	/// An arena must only be used by one thread at a time.
+	/// </summary>
+	class arena {
+	public:
+		///<param name='chunkSize'>Size of the first chunk, later chunks grow to fit larger requests</param>
+		explicit arena(size_t chunkSize = 1 << 16);
+		~arena();
+		arena(const arena&) = delete;
+		arena& operator=(const arena&) = delete;
+
+		///<returns>size bytes aligned to align (a power of two), never nullptr</returns>
+		void* allocate(size_t size, size_t align);
+
+		template<typename T, typename... Args>
+		///<returns>A T constructed in the arena</returns>
+		T* create(Args&&... args) {
+			return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+
+		///<summary>Makes all memory available again, everything allocated before is invalidated</summary>
+		void reset();
+		///<summary>Frees all chunks</summary>
+		void release();
+
+		///<returns>The bytes allocated since the last reset, including alignment padding</returns>
+		size_t used() const { return _used; }
+		///<returns>The largest used() seen since construction</returns>
+		size_t high_water() const { return _used > _highWater ? _used : _highWater; }
+		///<returns>The total size of the chunks</returns>
+		size_t capacity() const { return _capacity; }
+
+		/// <summary>
+		/// Makes an arena the target of arena_alloc on the calling thread for its lifetime, scopes nest.
+		/// </summary>
+		struct scope {
+			explicit scope(arena& a);
+			~scope();
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+		private:
+			arena* _previous;
+		};
+
+		///<returns>The arena of the innermost scope on the calling thread, nullptr outside of scopes</returns>
+		static arena* current();
+
+	private:
+		struct _chunk {
+			_chunk* next;
+			size_t size;
+		};
+
+		size_t _chunkSize;
+		_chunk* _head = nullptr;
+		char* _cur = nullptr;
+		char* _end = nullptr;
+		size_t _used = 0;
+		size_t _highWater = 0;
+		size_t _capacity = 0;
+
+		void _grow(size_t size, size_t align);
+	};
+
+	/// <summary>
+	/// A ring of 2 or 3 arenas for memory that lives for a frame. next_frame() moves on to the next arena and resets it,
+	/// so memory allocated during frame n stays valid until next_frame() is called for frame n + buffers.
+	/// With two buffers the data of the previous frame can still be read while the current one is built.
+	/// </summary>
+	class frame_arena {
+	public:
+		static constexpr size_t MAX_BUFFERS = 3;
+
+		///<param name='buffers'>Number of frames a block of memory survives, 2 or 3</param>
+		///<param name='chunkSize'>Size of the first chunk of every buffer</param>
+		explicit frame_arena(size_t buffers = 2, size_t chunkSize = 1 << 20);
+		frame_arena(const frame_arena&) = delete;
+		frame_arena& operator=(const frame_arena&) = delete;
+
+		///<summary>Starts a new frame, invalidates the memory of the frame buffers() frames ago</summary>
+		void next_frame();
+
+		///<returns>The arena of the current frame</returns>
+		arena& get() { return _arenas[_current]; }
+		void* allocate(size_t size, size_t align) { return get().allocate(size, align); }
+		template<typename T, typename... Args>
+		///<returns>A T living until the buffer is reused, its destructor is never called</returns>
+		T* create(Args&&... args) { return get().template create<T>(std::forward<Args>(args)...); }
+
+		size_t buffers() const { return _count; }
+		///<returns>The number of next_frame() calls</returns>
+		uint64 frame() const { return _frame; }
+		///<returns>The bytes allocated during the last finished frame</returns>
+		size_t frame_high_water() const { return _frameHighWater; }
+		///<returns>The largest frame_high_water() seen</returns>
+		size_t high_water() const { return _highWater; }
+		///<returns>The total size of the chunks of all buffers</returns>
+		size_t capacity() const;
+
+	private:
+		arena _arenas[MAX_BUFFERS];
+		size_t _count;
+		size_t _current = 0;
+		uint64 _frame = 0;
+		size_t _frameHighWater = 0;
+		size_t _highWater = 0;
+	};
+
+	template<typename T>
+	/// <summary>
+	/// Standard library allocator over an arena, deallocate does nothing.
+	/// Containers using it must not outlive the memory of the arena, for a frame_arena the frame they were filled in.
+	/// </summary>
+	class arena_allocator {
+	public:
+		using value_type = T;
+
+		arena_allocator(arena& a) noexcept : _arena(&a) {}
+		arena_allocator(frame_arena& a) noexcept : _arena(&a.get()) {}
+		template<typename U>
+		arena_allocator(const arena_allocator<U>& o) noexcept : _arena(o.get_arena()) {}
+
+		T* allocate(size_t n) {
+			return static_cast<T*>(_arena->allocate(sizeof(T) * n, alignof(T)));
+		}
+		void deallocate(T*, size_t) noexcept {}
+
+		arena* get_arena() const { return _arena; }
+
+		template<typename U>
+		bool operator==(const arena_allocator<U>& o) const { return _arena == o.get_arena(); }
+		template<typename U>
+		bool operator!=(const arena_allocator<U>& o) const { return _arena != o.get_arena(); }
+
+	private:
+		arena* _arena;
+	};
+
+	template<typename T>
+	using arena_vector = std::vector<T, arena_allocator<T>>;
+	using arena_string = std::basic_string<char, std::char_traits<char>, arena_allocator<char>>;
+
+	/// <summary>
+	/// Allocator of blocks of one size. Free blocks form a list through their own memory, so allocate and deallocate are O(1).
+	/// The memory is taken from the heap in chunks of blocksPerChunk blocks and only returned when the pool is destroyed without live blocks.
+	/// </summary>
+	class fixed_pool {
+	public:
+		fixed_pool(size_t blockSize, size_t align, size_t blocksPerChunk = 256);
+		~fixed_pool();
+		fixed_pool(const fixed_pool&) = delete;
+		fixed_pool& operator=(const fixed_pool&) = delete;
+
+		void* allocate();
+		///<summary>p has to come from allocate() of this pool</summary>
+		void deallocate(void* p);
+
+		size_t block_size() const { return _blockSize; }
+		///<returns>The amount of blocks currently allocated</returns>
+		size_t live() const { return _live; }
+
+	private:
+		struct _free {
+			_free* next;
+		};
+
+		size_t _blockSize;
+		size_t _align;
+		size_t _blocksPerChunk;
+		_free* _freeList = nullptr;
+		///<summary>The chunks are linked through their first pointer</summary>
+		void* _chunks = nullptr;
+		size_t _live = 0;
+
+		void _grow();
+	};
+
+	/*
+	* Allocation policies of the owning wrappers in ptr.h. A policy provides
+	*	template<typename T, typename... Args> static T* create(Args&&...);
+	*	template<typename T> static void destroy(T*);
+	* and optionally create_array<T>(size_t) / destroy_array<T>(T*, size_t).
+	* An object has to be destroyed through the policy it was created with.
+	*/
+
+	/// <summary>
+	/// new and delete, the default of the wrappers
+	/// </summary>
+	struct heap_alloc {
+		template<typename T, typename... Args>
+		static T* create(Args&&... args) { return new T(std::forward<Args>(args)...); }
+		template<typename T>
+		static void destroy(T* p) { delete p; }
+		template<typename T>
+		static T* create_array(size_t n) { return new T[n]; }
+		template<typename T>
+		static void destroy_array(T* p, size_t) { delete[] p; }
+	};
+
+	/// <summary>
+	/// Allocates from the arena of the innermost arena::scope of the calling thread, destroy only runs the destructor.
+	/// A whole graph of objects is freed by resetting its arena once the owners are gone.
+	/// </summary>
+	struct arena_alloc {
+		template<typename T, typename... Args>
+		static T* create(Args&&... args) {
+			return _arena().template create<T>(std::forward<Args>(args)...);
+		}
+		template<typename T>
+		static void destroy(T* p) { p->~T(); }
+		template<typename T>
+		static T* create_array(size_t n) {
+			T* p = static_cast<T*>(_arena().allocate(sizeof(T) * (n == 0 ? 1 : n), alignof(T)));
+			for (size_t i = 0; i < n; ++i) {
+				new (p + i) T();
+			}
+			return p;
+		}
+		template<typename T>
+		static void destroy_array(T* p, size_t n) {
+			for (size_t i = n; i-- > 0;) {
+				p[i].~T();
+			}
+		}
+
+	private:
+		static arena& _arena() {
+			arena* a = arena::current();
+			ASSERT(a, "arena_alloc used outside of an arena::scope", CHANNEL_MEMORY);
+			return *a;
+		}
+	};
+
+	/// <summary>
+	/// Allocates from one process wide fixed_pool per object size, guarded by a mutex.
+	/// The pool is chosen by the static type, so objects may not be destroyed through a base of different size.
+	/// </summary>
+	struct pool_alloc {
+		template<typename T, typename... Args>
+		static T* create(Args&&... args) {
+			void* mem;
+			{
+				std::lock_guard<std::mutex> lock(_shared<T>().mutex);
+				mem = _shared<T>().pool.allocate();
+			}
+			return new (mem) T(std::forward<Args>(args)...);
+		}
+		template<typename T>
+		static void destroy(T* p) {
+			p->~T();
+			std::lock_guard<std::mutex> lock(_shared<T>().mutex);
+			_shared<T>().pool.deallocate(p);
+		}
+
+	private:
+		struct _guarded {
+			std::mutex mutex;
+			fixed_pool pool;
+		};
+
+		template<typename T>
+		static _guarded& _shared() {
+			//one pool per size and alignment, not per type
+			return _instance<sizeof(T), alignof(T)>();
+		}
+		template<size_t S, size_t A>
+		static _guarded& _instance() {
+			static _guarded g{ {}, fixed_pool(S, A) };
+			return g;
+		}
+	};
+
+	/// <summary>
+	/// Allocates from a fixed_pool per object size and thread, without locking.
+	/// Objects have to be destroyed on the thread that created them, the pools of a thread are freed when it exits.
+	/// The pool is chosen by the static type, so objects may not be destroyed through a base of different size.
+	/// </summary>
+	struct thread_pool_alloc {
+		template<typename T, typename... Args>
+		static T* create(Args&&... args) {
+			return new (_instance<sizeof(T), alignof(T)>().allocate()) T(std::forward<Args>(args)...);
+		}
+		template<typename T>
+		static void destroy(T* p) {
+			p->~T();
+			_instance<sizeof(T), alignof(T)>().deallocate(p);
+		}
+
+	private:
+		template<size_t S, size_t A>
+		static fixed_pool& _instance() {
+			thread_local fixed_pool pool(S, A);
+			return pool;
+		}
+	};
+}
+
+#endif
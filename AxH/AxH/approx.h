@@ -0,0 +1,257 @@
+#ifndef __H_APPROX
+#define __H_APPROX
+
+#include <limits>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "simd.h"
+#include "batch.h"
+#include "elementwise.h"
+
+namespace math {
+
+	/// <summary>
+	/// Approximate single precision math for code that trades accuracy for throughput (lighting, particles, procedural content).
+	/// Every function exists for simd::float_pack, for single floats (the same kernel on one lane, so results match exactly)
+	/// and for whole arrays, which run through array_math and are split over the threads like its other operations.
+	/// The error bounds were measured against double precision over the stated ranges, outside of them the results are unspecified.
+	/// </summary>
+	struct approx_math {
+		using pack = simd::float_pack;
+
+		///<summary>1 / sqrt(x) for positive normal x, relative error below 2^-21 (one Newton step on the hardware estimate)</summary>
+		static pack rsqrt(pack x);
+		///<summary>sqrt(x) as x * rsqrt(x) for positive normal x, relative error below 2^-21, 0 for 0</summary>
+		static pack sqrt(pack x);
+		///<summary>Absolute error below 2^-22 for |x| &lt;= 8192, the argument reduction loses precision beyond</summary>
+		static pack sin(pack x);
+		///<summary>Absolute error below 2^-22 for |x| &lt;= 8192, the argument reduction loses precision beyond</summary>
+		static pack cos(pack x);
+		///<summary>Angle of (x, y) in [-pi, pi], absolute error below 2^-18 (about 4e-6 radians), 0 for (0, 0)</summary>
+		static pack atan2(pack y, pack x);
+		///<summary>Relative error below 2^-22 for x in [-87, 88], the input is clamped to that range</summary>
+		static pack exp(pack x);
+		///<summary>Natural logarithm of positive normal x, absolute error below 2^-22 for x in [0.5, 2], relative error below 2^-22 elsewhere</summary>
+		static pack log(pack x);
+
+		static float rsqrt(float x) { return _first(rsqrt(pack::set1(x))); }
+		static float sqrt(float x) { return _first(sqrt(pack::set1(x))); }
+		static float sin(float x) { return _first(sin(pack::set1(x))); }
+		static float cos(float x) { return _first(cos(pack::set1(x))); }
+		static float atan2(float y, float x) { return _first(atan2(pack::set1(y), pack::set1(x))); }
+		static float exp(float x) { return _first(exp(pack::set1(x))); }
+		static float log(float x) { return _first(log(pack::set1(x))); }
+
+		///<summary>dst[i] = rsqrt(src[i])</summary>
+		static void rsqrt(float* dst, const float* src, size_t count) { array_math::map(dst, src, count, [](pack x) { return rsqrt(x); }); }
+		static void sqrt(float* dst, const float* src, size_t count) { array_math::map(dst, src, count, [](pack x) { return sqrt(x); }); }
+		static void sin(float* dst, const float* src, size_t count) { array_math::map(dst, src, count, [](pack x) { return sin(x); }); }
+		static void cos(float* dst, const float* src, size_t count) { array_math::map(dst, src, count, [](pack x) { return cos(x); }); }
+		///<summary>dst[i] = atan2(y[i], x[i])</summary>
+		static void atan2(float* dst, const float* y, const float* x, size_t count) { array_math::zip(dst, y, x, count, [](pack a, pack b) { return atan2(a, b); }); }
+		static void exp(float* dst, const float* src, size_t count) { array_math::map(dst, src, count, [](pack x) { return exp(x); }); }
+		static void log(float* dst, const float* src, size_t count) { array_math::map(dst, src, count, [](pack x) { return log(x); }); }
+
+		template<size_t A>
+		///<returns>The length of a, relative error below 2^-21</returns>
+		static float length(const vector<float, A>& a);
+		template<size_t A>
+		///<returns>a scaled to unit length (within 2^-21), the zero vector stays zero</returns>
+		static vector<float, A> normalize(const vector<float, A>& a);
+
+		template<size_t A>
+		///<summary>out has to hold a.size() elements</summary>
+		static void length(float* out, const vector_batch<float, A>& a);
+		template<size_t A>
+		///<summary>Zero vectors stay zero</summary>
+		static void normalize(vector_batch<float, A>& dst, const vector_batch<float, A>& a);
+
+	private:
+		static float _first(pack a) {
+			alignas(simd::batch_alignment) float res[pack::width];
+			a.store(res);
+			return res[0];
+		}
+
+		///<summary>x reduced to [-pi / 4, pi / 4] and the quadrant of x (x = r + quadrant * pi / 2) modulo 4</summary>
+		static void _reduce(pack x, pack& r, pack& quadrant);
+		///<summary>sin(x) for quadrant 0, cos(x) for quadrant 1, -sin(x) for 2 and -cos(x) for 3</summary>
+		static pack _sincos(pack r, pack quadrant);
+	};
+
+//#######################################################################################################################
+
+	inline approx_math::pack approx_math::rsqrt(pack x) {
+		//y' = y * (1.5 - 0.5 * x * y^2)
+		const pack y = pack::rsqrt_estimate(x);
+		const pack hx = x * pack::set1(0.5f);
+		return y * pack::fmadd(hx * y, pack::set1(0.f) - y, pack::set1(1.5f));
+	}
+
+	inline approx_math::pack approx_math::sqrt(pack x) {
+		//the clamp keeps rsqrt finite for 0 and x * rsqrt(x) 0
+		return x * rsqrt(pack::max(x, pack::set1(std::numeric_limits<float>::min())));
+	}
+
+	inline void approx_math::_reduce(pack x, pack& r, pack& quadrant) {
+		const pack k = pack::floor(pack::fmadd(x, pack::set1(0.636619772f), pack::set1(0.5f)));
+		//Cody-Waite, pi / 2 split into parts whose products with k are exact
+		r = pack::fmadd(k, pack::set1(-1.5703125f), x);
+		r = pack::fmadd(k, pack::set1(-4.837512969970703125e-4f), r);
+		r = pack::fmadd(k, pack::set1(-7.549789948768648e-8f), r);
+		quadrant = k - pack::set1(4.f) * pack::floor(k * pack::set1(0.25f));
+	}
+
+	inline approx_math::pack approx_math::_sincos(pack r, pack quadrant) {
+		const pack z = r * r;
+		//minimax polynomials on [-pi / 4, pi / 4]
+		pack s = pack::fmadd(z, pack::set1(-1.9515295891e-4f), pack::set1(8.3321608736e-3f));
+		s = pack::fmadd(s, z, pack::set1(-1.6666654611e-1f));
+		s = pack::fmadd(s * z, r, r);
+		pack c = pack::fmadd(z, pack::set1(2.443315711809948e-5f), pack::set1(-1.388731625493765e-3f));
+		c = pack::fmadd(c, z, pack::set1(4.166664568298827e-2f));
+		c = pack::fmadd(c * z, z, pack::fmadd(z, pack::set1(-0.5f), pack::set1(1.f)));
+		const pack odd = quadrant - pack::set1(2.f) * pack::floor(quadrant * pack::set1(0.5f));
+		const pack res = pack::select_lt(odd, pack::set1(0.5f), s, c);
+		return pack::select_lt(quadrant, pack::set1(1.5f), res, pack::set1(0.f) - res);
+	}
+
+	inline approx_math::pack approx_math::sin(pack x) {
+		pack r, q;
+		_reduce(x, r, q);
+		return _sincos(r, q);
+	}
+
+	inline approx_math::pack approx_math::cos(pack x) {
+		pack r, q;
+		_reduce(x, r, q);
+		//cos(x) = sin(x + pi / 2), one quadrant further
+		q = q + pack::set1(1.f);
+		return _sincos(r, pack::select_lt(q, pack::set1(3.5f), q, pack::set1(0.f)));
+	}
+
+	inline approx_math::pack approx_math::atan2(pack y, pack x) {
+		const pack ax = pack::abs(x);
+		const pack ay = pack::abs(y);
+		const pack hi = pack::max(ax, ay);
+		const pack lo = pack::min(ax, ay);
+		//the ratio is in [0, 1], (0, 0) gives 0
+		const pack a = lo / pack::max(hi, pack::set1(std::numeric_limits<float>::min()));
+		const pack z = a * a;
+		pack p = pack::fmadd(z, pack::set1(-0.0117212f), pack::set1(0.05265332f));
+		p = pack::fmadd(p, z, pack::set1(-0.11643287f));
+		p = pack::fmadd(p, z, pack::set1(0.19354346f));
+		p = pack::fmadd(p, z, pack::set1(-0.33262347f));
+		p = pack::fmadd(p, z, pack::set1(0.99997726f));
+		pack r = p * a;
+		r = pack::select_lt(ax, ay, pack::set1(1.57079637f) - r, r);
+		r = pack::select_lt(x, pack::set1(0.f), pack::set1(3.14159274f) - r, r);
+		return pack::copysign(r, y);
+	}
+
+	inline approx_math::pack approx_math::exp(pack x) {
+		x = pack::min(pack::max(x, pack::set1(-87.f)), pack::set1(88.f));
+		//e^x = 2^k * e^r with |r| <= ln(2) / 2
+		const pack k = pack::floor(pack::fmadd(x, pack::set1(1.44269504f), pack::set1(0.5f)));
+		pack r = pack::fmadd(k, pack::set1(-0.693359375f), x);
+		r = pack::fmadd(k, pack::set1(2.12194440e-4f), r);
+		const pack z = r * r;
+		pack p = pack::fmadd(r, pack::set1(1.9875691500e-4f), pack::set1(1.3981999507e-3f));
+		p = pack::fmadd(p, r, pack::set1(8.3334519073e-3f));
+		p = pack::fmadd(p, r, pack::set1(4.1665795894e-2f));
+		p = pack::fmadd(p, r, pack::set1(1.6666665459e-1f));
+		p = pack::fmadd(p, r, pack::set1(5.0000001201e-1f));
+		p = pack::fmadd(p, z, r + pack::set1(1.f));
+		//2^k assembled in the exponent bits
+		const simd::int_pack e = simd::int_pack::floor(k + pack::set1(127.f));
+		return p * simd::int_pack::as_float(simd::int_pack::shl<23>(e));
+	}
+
+	inline approx_math::pack approx_math::log(pack x) {
+		using ipack = simd::int_pack;
+		//x = m * 2^e with m in [sqrt(0.5), sqrt(2))
+		const ipack bits = ipack::bits(x);
+		pack e = ipack::to_float(ipack::shr<23>(bits)) - pack::set1(126.f);
+		pack m = ipack::as_float((bits & ipack::set1(0x007fffffu)) | ipack::set1(0x3f000000u));
+		const pack small = pack::select_lt(m, pack::set1(0.707106781f), pack::set1(1.f), pack::set1(0.f));
+		e = e - small;
+		m = pack::fmadd(m, small, m) - pack::set1(1.f);
+		const pack z = m * m;
+		pack p = pack::fmadd(m, pack::set1(7.0376836292e-2f), pack::set1(-1.1514610310e-1f));
+		p = pack::fmadd(p, m, pack::set1(1.1676998740e-1f));
+		p = pack::fmadd(p, m, pack::set1(-1.2420140846e-1f));
+		p = pack::fmadd(p, m, pack::set1(1.4249322787e-1f));
+		p = pack::fmadd(p, m, pack::set1(-1.6668057665e-1f));
+		p = pack::fmadd(p, m, pack::set1(2.0000714765e-1f));
+		p = pack::fmadd(p, m, pack::set1(-2.4999993993e-1f));
+		p = pack::fmadd(p, m, pack::set1(3.3333331174e-1f));
+		pack res = p * m * z;
+		res = pack::fmadd(e, pack::set1(-2.12194440e-4f), res);
+		res = pack::fmadd(z, pack::set1(-0.5f), res);
+		return pack::fmadd(e, pack::set1(0.693359375f), m + res);
+	}
+
+	template<size_t A>
+	float approx_math::length(const vector<float, A>& a) {
+		return sqrt(float(a * a));
+	}
+
+	template<size_t A>
+	vector<float, A> approx_math::normalize(const vector<float, A>& a) {
+		const float sq = a * a;
+		return a * (sq > 0.f ? rsqrt(sq) : 0.f);
+	}
+
+	template<size_t A>
+	void approx_math::length(float* out, const vector_batch<float, A>& a) {
+		const size_t n = a.size();
+		const float* src[A];
+		for (size_t c = 0; c < A; ++c) {
+			src[c] = a.component(c);
+		}
+		for (size_t i = 0; i < n; i += pack::width) {
+			pack sq = pack::set1(0.f);
+			for (size_t c = 0; c < A; ++c) {
+				const pack v = pack::load(src[c] + i);
+				sq = pack::fmadd(v, v, sq);
+			}
+			if (i + pack::width <= n) {
+				sqrt(sq).storeu(out + i);
+			}
+			else {
+				alignas(simd::batch_alignment) float tail[pack::width];
+				sqrt(sq).store(tail);
+				std::copy(tail, tail + (n - i), out + i);
+			}
+		}
+	}
+
+	template<size_t A>
+	void approx_math::normalize(vector_batch<float, A>& dst, const vector_batch<float, A>& a) {
+		dst.resize(a.size());
+		const size_t n = a.size();
+		const float* src[A];
+		float* res[A];
+		for (size_t c = 0; c < A; ++c) {
+			src[c] = a.component(c);
+			res[c] = dst.component(c);
+		}
+		for (size_t i = 0; i < n; i += pack::width) {
+			//the planes are padded to whole packs
+			pack v[A];
+			pack sq = pack::set1(0.f);
+			for (size_t c = 0; c < A; ++c) {
+				v[c] = pack::load(src[c] + i);
+				sq = pack::fmadd(v[c], v[c], sq);
+			}
+			//zero vectors (and the padding) get a factor of 0 instead of nan
+			const pack inv = pack::select_lt(pack::set1(0.f), sq, rsqrt(sq), pack::set1(0.f));
+			for (size_t c = 0; c < A; ++c) {
+				(v[c] * inv).store(res[c] + i);
+			}
+		}
+	}
+}
+
+#endif
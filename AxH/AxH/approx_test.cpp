@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <vector>
+#include <iostream>
+#include "approx.h"
+
+using namespace math;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		std::cout << "approx_test failed: " << what << std::endl;
+		++failures;
+	}
+}
+
+static constexpr size_t SAMPLES = 1 << 18;
+
+///<summary>An even sweep over [lo, hi] followed by as many uniformly random values of the range</summary>
+static std::vector<float> linear(double lo, double hi) {
+	std::vector<float> x(2 * SAMPLES);
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<double> dist(lo, hi);
+	for (size_t i = 0; i < SAMPLES; ++i) {
+		x[i] = float(lo + (hi - lo) * double(i) / double(SAMPLES - 1));
+		x[SAMPLES + i] = float(dist(rng));
+	}
+	return x;
+}
+
+///<summary>Values spread evenly over the exponents 2^lo to 2^hi</summary>
+static std::vector<float> logarithmic(double lo, double hi) {
+	std::vector<float> x(SAMPLES);
+	for (size_t i = 0; i < SAMPLES; ++i) {
+		x[i] = float(std::exp2(lo + (hi - lo) * double(i) / double(SAMPLES - 1)));
+	}
+	return x;
+}
+
+template<typename R>
+///<returns>The largest error of approx against the double precision ref, relative to ref if relative is set</returns>
+static double max_error(const std::vector<float>& approx, R&& ref, bool relative) {
+	double res = 0.0;
+	for (size_t i = 0; i < approx.size(); ++i) {
+		const double r = ref(i);
+		double e = std::fabs(double(approx[i]) - r);
+		if (relative) {
+			e /= std::fabs(r);
+		}
+		res = std::max(res, e);
+	}
+	return res;
+}
+
+int main() {
+	{
+		const std::vector<float> x = logarithmic(-120.0, 120.0);
+		std::vector<float> out(x.size());
+		approx_math::rsqrt(out.data(), x.data(), x.size());
+		check(max_error(out, [&](size_t i) { return 1.0 / std::sqrt(double(x[i])); }, true) <= std::exp2(-21.0), "rsqrt relative error below 2^-21");
+		approx_math::sqrt(out.data(), x.data(), x.size());
+		check(max_error(out, [&](size_t i) { return std::sqrt(double(x[i])); }, true) <= std::exp2(-21.0), "sqrt relative error below 2^-21");
+		check(approx_math::sqrt(0.f) == 0.f, "sqrt of 0 is 0");
+	}
+	{
+		const std::vector<float> x = linear(-8192.0, 8192.0);
+		std::vector<float> out(x.size());
+		approx_math::sin(out.data(), x.data(), x.size());
+		check(max_error(out, [&](size_t i) { return std::sin(double(x[i])); }, false) <= std::exp2(-22.0), "sin absolute error below 2^-22 for |x| <= 8192");
+		approx_math::cos(out.data(), x.data(), x.size());
+		check(max_error(out, [&](size_t i) { return std::cos(double(x[i])); }, false) <= std::exp2(-22.0), "cos absolute error below 2^-22 for |x| <= 8192");
+	}
+	{
+		//all angles at radii from 2^-40 to 2^40
+		std::vector<float> y(SAMPLES), x(SAMPLES), out(SAMPLES);
+		for (size_t i = 0; i < SAMPLES; ++i) {
+			const double angle = -std::numbers::pi + 2.0 * std::numbers::pi * double(i) / double(SAMPLES - 1);
+			const double radius = std::exp2(-40.0 + 80.0 * double((i * 7919) % SAMPLES) / double(SAMPLES));
+			x[i] = float(radius * std::cos(angle));
+			y[i] = float(radius * std::sin(angle));
+		}
+		approx_math::atan2(out.data(), y.data(), x.data(), SAMPLES);
+		check(max_error(out, [&](size_t i) { return std::atan2(double(y[i]), double(x[i])); }, false) <= std::exp2(-18.0), "atan2 absolute error below 2^-18");
+		check(approx_math::atan2(0.f, 0.f) == 0.f, "atan2 of (0, 0) is 0");
+	}
+	{
+		const std::vector<float> x = linear(-87.0, 88.0);
+		std::vector<float> out(x.size());
+		approx_math::exp(out.data(), x.data(), x.size());
+		check(max_error(out, [&](size_t i) { return std::exp(double(x[i])); }, true) <= std::exp2(-22.0), "exp relative error below 2^-22 on [-87, 88]");
+	}
+	{
+		const std::vector<float> x = linear(0.5, 2.0);
+		std::vector<float> out(x.size());
+		approx_math::log(out.data(), x.data(), x.size());
+		check(max_error(out, [&](size_t i) { return std::log(double(x[i])); }, false) <= std::exp2(-22.0), "log absolute error below 2^-22 on [0.5, 2]");
+
+		//the normal floats outside of [0.5, 2]
+		std::vector<float> outside;
+		for (float v : logarithmic(-126.0, 127.9)) {
+			if (v < 0.5f || v > 2.f) {
+				outside.push_back(v);
+			}
+		}
+		out.resize(outside.size());
+		approx_math::log(out.data(), outside.data(), outside.size());
+		check(max_error(out, [&](size_t i) { return std::log(double(outside[i])); }, true) <= std::exp2(-22.0), "log relative error below 2^-22 outside of [0.5, 2]");
+	}
+	{
+		//the single float overloads run the pack kernel on one lane
+		const std::vector<float> x = linear(-80.0, 80.0);
+		std::vector<float> out(x.size());
+		approx_math::exp(out.data(), x.data(), x.size());
+		bool same = true;
+		for (size_t i = 0; i < x.size(); i += 97) {
+			same = same && approx_math::exp(x[i]) == out[i];
+		}
+		check(same, "single floats match the array results");
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,573 @@
+#ifndef __H_BATCH
+#define __H_BATCH
+
+#include <new>
+#include <cstring>
+#include <utility>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "simd.h"
+#include "cpu.h"
+
+namespace math {
+
+	template<typename T, size_t P>
+	/// <summary>
+	/// Structure of arrays storage of P planes with elements of type T.
+	/// All planes live in one allocation, each plane starts at a simd::batch_alignment boundary and holds capacity() elements.
+	/// The capacity is a multiple of the widest pack, so kernels may process whole packs up to padded_size(). The content of the padding is unspecified but initialized.
+	/// </summary>
+	class soa_storage {
+	public:
+		static constexpr size_t planes = P;
+		///<summary>
+		/// The capacity of the planes is rounded up to a multiple of this
+		///</summary>
+		static constexpr size_t lanes = simd::batch_alignment / sizeof(T) > 0 ? simd::batch_alignment / sizeof(T) : 1;
+
+		soa_storage() { }
+		explicit soa_storage(size_t size);
+		soa_storage(const soa_storage& ref);
+		soa_storage(soa_storage&& ref) noexcept;
+		~soa_storage();
+
+		soa_storage& operator=(const soa_storage& ref);
+		soa_storage& operator=(soa_storage&& ref) noexcept;
+
+		size_t size() const { return _size; }
+		size_t capacity() const { return _capacity; }
+		bool empty() const { return _size == 0; }
+
+		///<returns>size() rounded up to a multiple of lanes, the kernels may read and write up to this element</returns>
+		size_t padded_size() const { return _round(_size); }
+
+		///<summary>
+		/// Grows the planes to hold at least cap elements, the content is preserved
+		///</summary>
+		void reserve(size_t cap);
+		///<summary>
+		/// Changes the number of elements, new elements are zero
+		///</summary>
+		void resize(size_t size);
+		void clear();
+
+		///<returns>The first element of plane k</returns>
+		T* plane(size_t k) {
+			MATH_BOUNDS_CHECK(k < P);
+			return buf + k * _capacity;
+		}
+		const T* plane(size_t k) const {
+			MATH_BOUNDS_CHECK(k < P);
+			return buf + k * _capacity;
+		}
+
+	protected:
+		T* buf = nullptr;
+		size_t _size = 0;
+		size_t _capacity = 0;
+
+		static constexpr size_t _round(size_t n) {
+			return (n + lanes - 1) / lanes * lanes;
+		}
+
+	private:
+		static_assert(std::is_trivially_copyable<T>::value, "soa_storage requires trivially copyable elements");
+
+		static T* _allocate(size_t cap);
+		static void _free(T* ptr);
+	};
+
+	template<math_type T, size_t A>
+	/// <summary>
+	/// A batch of vectors stored as structure of arrays, component c of all vectors is stored contiguously in plane c.
+	/// Bulk operations are in batch_math, single vectors are accessed through proxies which take part in the vector expressions.
+	/// </summary>
+	class vector_batch : public soa_storage<T, A> {
+		using base = soa_storage<T, A>;
+	public:
+		template<typename R>
+		/// <summary>
+		/// Proxy to the vector at one index of the batch, only valid until the batch is reallocated
+		/// </summary>
+		class basic_reference {
+		public:
+			using value_type = T;
+			static constexpr size_t extent = A;
+			static constexpr bool is_vector_expression = true;
+
+			basic_reference(R* first, size_t stride) : first(first), stride(stride) { }
+			basic_reference(const basic_reference&) = default;
+
+			R& operator[](size_t ind) const {
+				MATH_BOUNDS_CHECK(ind < A);
+				return first[ind * stride];
+			}
+
+			operator vector<T, A>() const {
+				vector<T, A> val;
+				for (size_t t = 0; t < A; ++t) {
+					val[t] = first[t * stride];
+				}
+				return val;
+			}
+
+			template<vector_expression E>
+				requires (E::extent == A) && std::is_convertible<typename E::value_type, T>::value && (!std::is_const<R>::value)
+			const basic_reference& operator=(const E& expr) const {
+				//evaluate first, the expression may refer to this element
+				vector<T, A> val(expr);
+				for (size_t t = 0; t < A; ++t) {
+					first[t * stride] = val[t];
+				}
+				return *this;
+			}
+
+			const basic_reference& operator=(const basic_reference& ref) const requires (!std::is_const<R>::value) {
+				return *this = vector<T, A>(ref);
+			}
+
+		private:
+			R* first;
+			size_t stride;
+		};
+
+		using reference = basic_reference<T>;
+		using const_reference = basic_reference<const T>;
+
+		using base::base;
+
+		reference operator[](size_t ind) {
+			MATH_BOUNDS_CHECK(ind < this->_size);
+			return reference(this->buf + ind, this->_capacity);
+		}
+		const_reference operator[](size_t ind) const {
+			MATH_BOUNDS_CHECK(ind < this->_size);
+			return const_reference(this->buf + ind, this->_capacity);
+		}
+
+		vector<T, A> get(size_t ind) const {
+			return (*this)[ind];
+		}
+		void set(size_t ind, const vector<T, A>& val) {
+			(*this)[ind] = val;
+		}
+
+		void push_back(const vector<T, A>& val);
+
+		///<returns>The plane holding component c of every vector</returns>
+		T* component(size_t c) { return this->plane(c); }
+		const T* component(size_t c) const { return this->plane(c); }
+	};
+
+	template<math_type T, size_t A, size_t B>
+	/// <summary>
+	/// A batch of matrices stored as structure of arrays, element (r, c) of all matrices is stored contiguously in plane r * B + c.
+	/// </summary>
+	class matrix_batch : public soa_storage<T, A * B> {
+		using base = soa_storage<T, A * B>;
+	public:
+		template<typename R>
+		/// <summary>
+		/// Proxy to the matrix at one index of the batch, only valid until the batch is reallocated
+		/// </summary>
+		class basic_reference {
+		public:
+			basic_reference(R* first, size_t stride) : first(first), stride(stride) { }
+			basic_reference(const basic_reference&) = default;
+
+			R& operator()(size_t r, size_t c) const {
+				MATH_BOUNDS_CHECK(r < A && c < B);
+				return first[(r * B + c) * stride];
+			}
+
+			operator matrix<T, A, B>() const {
+				matrix<T, A, B> val;
+				T* dst = val.data();
+				for (size_t t = 0; t < A * B; ++t) {
+					dst[t] = first[t * stride];
+				}
+				return val;
+			}
+
+			const basic_reference& operator=(const matrix<T, A, B>& val) const requires (!std::is_const<R>::value) {
+				const T* src = val.data();
+				for (size_t t = 0; t < A * B; ++t) {
+					first[t * stride] = src[t];
+				}
+				return *this;
+			}
+
+		private:
+			R* first;
+			size_t stride;
+		};
+
+		using reference = basic_reference<T>;
+		using const_reference = basic_reference<const T>;
+
+		using base::base;
+
+		reference operator[](size_t ind) {
+			MATH_BOUNDS_CHECK(ind < this->_size);
+			return reference(this->buf + ind, this->_capacity);
+		}
+		const_reference operator[](size_t ind) const {
+			MATH_BOUNDS_CHECK(ind < this->_size);
+			return const_reference(this->buf + ind, this->_capacity);
+		}
+
+		matrix<T, A, B> get(size_t ind) const {
+			return (*this)[ind];
+		}
+		void set(size_t ind, const matrix<T, A, B>& val) {
+			(*this)[ind] = val;
+		}
+
+		void push_back(const matrix<T, A, B>& val);
+
+		///<returns>The plane holding element (r, c) of every matrix</returns>
+		T* element(size_t r, size_t c) { return this->plane(r * B + c); }
+		const T* element(size_t r, size_t c) const { return this->plane(r * B + c); }
+	};
+
+	/// <summary>
+	/// Bulk operations on batches. The float versions process simd::float_pack::width elements per step (4 SSE, 8 AVX, 16 AVX-512).
+	/// The destination is resized to the size of the source and may be the same batch as a source.
+	/// </summary>
+	struct batch_math {
+		template<math_type T, size_t A>
+		static void add(vector_batch<T, A>& dst, const vector_batch<T, A>& a, const vector_batch<T, A>& b);
+
+		template<math_type T, size_t A>
+		static void sub(vector_batch<T, A>& dst, const vector_batch<T, A>& a, const vector_batch<T, A>& b);
+
+		template<math_type T, size_t A>
+		static void scale(vector_batch<T, A>& dst, const vector_batch<T, A>& a, T s);
+
+		template<math_type T, size_t A>
+		///<summary>
+		/// Writes the dot products of a and b to out, out has to hold a.size() elements
+		///</summary>
+		static void dot(T* out, const vector_batch<T, A>& a, const vector_batch<T, A>& b);
+
+		template<std::floating_point T, size_t A>
+		///<summary>
+		/// Writes the lengths of the vectors to out, out has to hold a.size() elements
+		///</summary>
+		static void length(T* out, const vector_batch<T, A>& a);
+
+		template<std::floating_point T, size_t A>
+		static void normalize(vector_batch<T, A>& dst, const vector_batch<T, A>& a);
+
+		template<math_type T, size_t A, size_t C>
+		///<summary>
+		/// dst[i] = m * src[i]
+		///</summary>
+		static void transform(vector_batch<T, C>& dst, const matrix<T, C, A>& m, const vector_batch<T, A>& src);
+
+		template<math_type T>
+		///<summary>
+		/// Transforms the points by an affine matrix, the w component is taken to be 1 and the projective row is ignored
+		///</summary>
+		static void transform_point(vector_batch<T, 3>& dst, const matrix<T, 4, 4>& m, const vector_batch<T, 3>& src);
+
+		template<math_type T, size_t A, size_t C>
+		///<summary>
+		/// dst[i] = m[i] * src[i]
+		///</summary>
+		static void transform(vector_batch<T, C>& dst, const matrix_batch<T, C, A>& m, const vector_batch<T, A>& src);
+
+	private:
+		template<typename T>
+		using pack = typename simd::pack_of<T>::type;
+
+		template<typename T, size_t A>
+		static pack<T> _dot(const vector_batch<T, A>& a, const vector_batch<T, A>& b, size_t i);
+
+		template<typename T, typename F>
+		static void _write(T* out, size_t size, F&& fn);
+	};
+
+//#######################################################################################################################
+
+	template<typename T, size_t P>
+	soa_storage<T, P>::soa_storage(size_t size) {
+		resize(size);
+	}
+
+	template<typename T, size_t P>
+	soa_storage<T, P>::soa_storage(const soa_storage& ref) : buf(_allocate(ref._capacity)), _size(ref._size), _capacity(ref._capacity) {
+		if (buf) {
+			std::memcpy(buf, ref.buf, sizeof(T) * P * _capacity);
+		}
+	}
+
+	template<typename T, size_t P>
+	soa_storage<T, P>::soa_storage(soa_storage&& ref) noexcept : buf(ref.buf), _size(ref._size), _capacity(ref._capacity) {
+		ref.buf = nullptr;
+		ref._size = 0;
+		ref._capacity = 0;
+	}
+
+	template<typename T, size_t P>
+	soa_storage<T, P>::~soa_storage() {
+		_free(buf);
+	}
+
+	template<typename T, size_t P>
+	soa_storage<T, P>& soa_storage<T, P>::operator=(const soa_storage& ref) {
+		if (this != &ref) {
+			soa_storage cpy(ref);
+			*this = std::move(cpy);
+		}
+		return *this;
+	}
+
+	template<typename T, size_t P>
+	soa_storage<T, P>& soa_storage<T, P>::operator=(soa_storage&& ref) noexcept {
+		std::swap(buf, ref.buf);
+		std::swap(_size, ref._size);
+		std::swap(_capacity, ref._capacity);
+		return *this;
+	}
+
+	template<typename T, size_t P>
+	void soa_storage<T, P>::reserve(size_t cap) {
+		if (cap <= _capacity) {
+			return;
+		}
+		cap = _round(cap);
+		T* nbuf = _allocate(cap);
+		std::memset(nbuf, 0, sizeof(T) * P * cap);
+		for (size_t k = 0; k < P && _size > 0; ++k) {
+			std::memcpy(nbuf + k * cap, buf + k * _capacity, sizeof(T) * _size);
+		}
+		_free(buf);
+		buf = nbuf;
+		_capacity = cap;
+	}
+
+	template<typename T, size_t P>
+	void soa_storage<T, P>::resize(size_t size) {
+		if (size > _capacity) {
+			reserve(size > 2 * _capacity ? size : 2 * _capacity);
+		}
+		if (size > _size) {
+			//the kernels write to the padding, clear it
+			for (size_t k = 0; k < P; ++k) {
+				std::memset(buf + k * _capacity + _size, 0, sizeof(T) * (size - _size));
+			}
+		}
+		_size = size;
+	}
+
+	template<typename T, size_t P>
+	void soa_storage<T, P>::clear() {
+		resize(0);
+	}
+
+	template<typename T, size_t P>
+	T* soa_storage<T, P>::_allocate(size_t cap) {
+		if (cap == 0) {
+			return nullptr;
+		}
+		return static_cast<T*>(::operator new(sizeof(T) * P * cap, std::align_val_t(simd::batch_alignment)));
+	}
+
+	template<typename T, size_t P>
+	void soa_storage<T, P>::_free(T* ptr) {
+		if (ptr) {
+			::operator delete(ptr, std::align_val_t(simd::batch_alignment));
+		}
+	}
+
+	template<math_type T, size_t A>
+	void vector_batch<T, A>::push_back(const vector<T, A>& val) {
+		this->resize(this->_size + 1);
+		(*this)[this->_size - 1] = val;
+	}
+
+	template<math_type T, size_t A, size_t B>
+	void matrix_batch<T, A, B>::push_back(const matrix<T, A, B>& val) {
+		this->resize(this->_size + 1);
+		(*this)[this->_size - 1] = val;
+	}
+
+	template<math_type T, size_t A>
+	void batch_math::add(vector_batch<T, A>& dst, const vector_batch<T, A>& a, const vector_batch<T, A>& b) {
+		ROBUST_ASSERT(a.size() == b.size(), "batch sizes do not match", CHANNEL_MATH);
+		using P = pack<T>;
+		dst.resize(a.size());
+		const size_t n = a.padded_size();
+		for (size_t c = 0; c < A; ++c) {
+			const T* pa = a.plane(c);
+			const T* pb = b.plane(c);
+			T* pd = dst.plane(c);
+			for (size_t i = 0; i < n; i += P::width) {
+				(P::load(pa + i) + P::load(pb + i)).store(pd + i);
+			}
+		}
+	}
+
+	template<math_type T, size_t A>
+	void batch_math::sub(vector_batch<T, A>& dst, const vector_batch<T, A>& a, const vector_batch<T, A>& b) {
+		ROBUST_ASSERT(a.size() == b.size(), "batch sizes do not match", CHANNEL_MATH);
+		using P = pack<T>;
+		dst.resize(a.size());
+		const size_t n = a.padded_size();
+		for (size_t c = 0; c < A; ++c) {
+			const T* pa = a.plane(c);
+			const T* pb = b.plane(c);
+			T* pd = dst.plane(c);
+			for (size_t i = 0; i < n; i += P::width) {
+				(P::load(pa + i) - P::load(pb + i)).store(pd + i);
+			}
+		}
+	}
+
+	template<math_type T, size_t A>
+	void batch_math::scale(vector_batch<T, A>& dst, const vector_batch<T, A>& a, T s) {
+		using P = pack<T>;
+		dst.resize(a.size());
+		const size_t n = a.padded_size();
+		const P ps = P::set1(s);
+		for (size_t c = 0; c < A; ++c) {
+			const T* pa = a.plane(c);
+			T* pd = dst.plane(c);
+			for (size_t i = 0; i < n; i += P::width) {
+				(P::load(pa + i) * ps).store(pd + i);
+			}
+		}
+	}
+
+	template<typename T, size_t A>
+	typename simd::pack_of<T>::type batch_math::_dot(const vector_batch<T, A>& a, const vector_batch<T, A>& b, size_t i) {
+		using P = pack<T>;
+		P sum = P::load(a.plane(0) + i) * P::load(b.plane(0) + i);
+		for (size_t c = 1; c < A; ++c) {
+			sum = P::fmadd(P::load(a.plane(c) + i), P::load(b.plane(c) + i), sum);
+		}
+		return sum;
+	}
+
+	template<typename T, typename F>
+	void batch_math::_write(T* out, size_t size, F&& fn) {
+		using P = pack<T>;
+		size_t i = 0;
+		for (; i + P::width <= size; i += P::width) {
+			fn(i).storeu(out + i);
+		}
+		if (i < size) {
+			alignas(simd::batch_alignment) T tail[P::width];
+			fn(i).store(tail);
+			std::memcpy(out + i, tail, sizeof(T) * (size - i));
+		}
+	}
+
+	template<math_type T, size_t A>
+	void batch_math::dot(T* out, const vector_batch<T, A>& a, const vector_batch<T, A>& b) {
+		ROBUST_ASSERT(a.size() == b.size(), "batch sizes do not match", CHANNEL_MATH);
+		_write(out, a.size(), [&](size_t i) { return _dot(a, b, i); });
+	}
+
+	template<std::floating_point T, size_t A>
+	void batch_math::length(T* out, const vector_batch<T, A>& a) {
+		using P = pack<T>;
+		_write(out, a.size(), [&](size_t i) { return P::sqrt(_dot(a, a, i)); });
+	}
+
+	template<std::floating_point T, size_t A>
+	void batch_math::normalize(vector_batch<T, A>& dst, const vector_batch<T, A>& a) {
+		using P = pack<T>;
+		dst.resize(a.size());
+		const size_t n = a.size();
+		const P one = P::set1(T(1));
+		for (size_t i = 0; i < n; i += P::width) {
+			P len = P::sqrt(_dot(a, a, i));
+			//clamp the length, zero vectors (and the padding) stay zero instead of nan
+			P inv = one / P::max(len, P::set1(std::numeric_limits<T>::min()));
+			for (size_t c = 0; c < A; ++c) {
+				(P::load(a.plane(c) + i) * inv).store(dst.plane(c) + i);
+			}
+		}
+	}
+
+	template<math_type T, size_t A, size_t C>
+	void batch_math::transform(vector_batch<T, C>& dst, const matrix<T, C, A>& m, const vector_batch<T, A>& src) {
+		using P = pack<T>;
+		dst.resize(src.size());
+		const size_t n = src.size();
+		P mat[C * A];
+		for (size_t t = 0; t < C * A; ++t) {
+			mat[t] = P::set1(m.data()[t]);
+		}
+		P in[A];
+		for (size_t i = 0; i < n; i += P::width) {
+			//load all components first, dst may be src
+			for (size_t k = 0; k < A; ++k) {
+				in[k] = P::load(src.plane(k) + i);
+			}
+			for (size_t r = 0; r < C; ++r) {
+				P sum = mat[r * A] * in[0];
+				for (size_t k = 1; k < A; ++k) {
+					sum = P::fmadd(mat[r * A + k], in[k], sum);
+				}
+				sum.store(dst.plane(r) + i);
+			}
+		}
+	}
+
+	template<math_type T>
+	void batch_math::transform_point(vector_batch<T, 3>& dst, const matrix<T, 4, 4>& m, const vector_batch<T, 3>& src) {
+		dst.resize(src.size());
+		const size_t n = src.size();
+		if constexpr (std::is_same<T, float>::value) {
+			//hot path, dispatched to the best instruction set of the running cpu
+			float* const dplanes[3] = { dst.plane(0), dst.plane(1), dst.plane(2) };
+			const float* const splanes[3] = { src.plane(0), src.plane(1), src.plane(2) };
+			Util::Cpu::kernels.transform_points(dplanes, m.data(), splanes, n);
+		}
+		else {
+			using P = pack<T>;
+			P mat[12];
+			for (size_t t = 0; t < 12; ++t) {
+				mat[t] = P::set1(m.data()[t]);
+			}
+			for (size_t i = 0; i < n; i += P::width) {
+				P x = P::load(src.plane(0) + i);
+				P y = P::load(src.plane(1) + i);
+				P z = P::load(src.plane(2) + i);
+				for (size_t r = 0; r < 3; ++r) {
+					P sum = P::fmadd(mat[r * 4], x, mat[r * 4 + 3]);
+					sum = P::fmadd(mat[r * 4 + 1], y, sum);
+					sum = P::fmadd(mat[r * 4 + 2], z, sum);
+					sum.store(dst.plane(r) + i);
+				}
+			}
+		}
+	}
+
+	template<math_type T, size_t A, size_t C>
+	void batch_math::transform(vector_batch<T, C>& dst, const matrix_batch<T, C, A>& m, const vector_batch<T, A>& src) {
+		ROBUST_ASSERT(m.size() == src.size(), "batch sizes do not match", CHANNEL_MATH);
+		using P = pack<T>;
+		dst.resize(src.size());
+		const size_t n = src.size();
+		P in[A];
+		for (size_t i = 0; i < n; i += P::width) {
+			for (size_t k = 0; k < A; ++k) {
+				in[k] = P::load(src.plane(k) + i);
+			}
+			for (size_t r = 0; r < C; ++r) {
+				P sum = P::load(m.element(r, 0) + i) * in[0];
+				for (size_t k = 1; k < A; ++k) {
+					sum = P::fmadd(P::load(m.element(r, k) + i), in[k], sum);
+				}
+				sum.store(dst.plane(r) + i);
+			}
+		}
+	}
+}
+
+#endif
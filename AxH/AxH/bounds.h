@@ -0,0 +1,462 @@
+#ifndef __H_BOUNDS
+#define __H_BOUNDS
+
+#include <bit>
+#include <limits>
+#include <array>
+#include <type_traits>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "simd.h"
+#include "batch.h"
+#include "cpu.h"
+
+namespace math {
+
+	template<std::floating_point T, size_t N>
+	/// <summary>
+	/// Axis aligned bounding box given by its smallest and largest corner. A default constructed box is empty (lo > hi)
+	/// and becomes the bounds of the first point or box it is expanded by.
+	/// </summary>
+	class aabb {
+	public:
+		vector<T, N> lo;
+		vector<T, N> hi;
+
+		constexpr aabb();
+		constexpr aabb(const vector<T, N>& lo, const vector<T, N>& hi) : lo(lo), hi(hi) { }
+
+		///<param name='extent'>Half of the size in each dimension</param>
+		static constexpr aabb from_center_extent(const vector<T, N>& center, const vector<T, N>& extent);
+
+		///<returns>Whether the box contains no point</returns>
+		constexpr bool empty() const;
+		constexpr vector<T, N> center() const;
+		///<returns>Half of the size in each dimension</returns>
+		constexpr vector<T, N> extent() const;
+		constexpr vector<T, N> size() const;
+		///<returns>The surface area of a 3 dimensional box, the cost measure of the surface area heuristic</returns>
+		constexpr T surface_area() const requires (N == 3);
+
+		constexpr aabb& expand(const vector<T, N>& p);
+		constexpr aabb& expand(const aabb& box);
+
+		constexpr bool contains(const vector<T, N>& p) const;
+		///<returns>Whether the boxes share at least one point (touching counts)</returns>
+		constexpr bool overlaps(const aabb& box) const;
+
+		///<returns>The bounds of the box transformed by the affine matrix m</returns>
+		constexpr aabb transform(const matrix<T, 4, 4>& m) const requires (N == 3);
+	};
+
+	template<std::floating_point T>
+	/// <summary>
+	/// Bounding sphere
+	/// </summary>
+	class sphere {
+	public:
+		vector<T, 3> center;
+		T radius = T(0);
+
+		constexpr sphere() { }
+		constexpr sphere(const vector<T, 3>& center, T radius) : center(center), radius(radius) { }
+
+		constexpr bool contains(const vector<T, 3>& p) const;
+		constexpr bool overlaps(const sphere& s) const;
+		constexpr bool overlaps(const aabb<T, 3>& box) const;
+	};
+
+	template<std::floating_point T>
+	/// <summary>
+	/// Half line origin + t * direction (t &gt;= 0), distances along the ray are measured in multiples of direction
+	/// </summary>
+	class ray {
+	public:
+		vector<T, 3> origin;
+		vector<T, 3> direction;
+
+		constexpr ray() { }
+		constexpr ray(const vector<T, 3>& origin, const vector<T, 3>& direction) : origin(origin), direction(direction) { }
+
+		constexpr vector<T, 3> at(T t) const { return origin + direction * t; }
+	};
+
+	template<std::floating_point T>
+	/// <summary>
+	/// The six planes of a view frustum, extracted from a (view) projection matrix that maps to OpenGL clip space
+	/// (x, y, z in [-w, w], column vectors: p' = M * p).
+	/// The planes are normalized and point inwards, plane(i) * (x, y, z, 1) is the signed distance of a point.
+	/// The tests are conservative, bounds near the corners outside of the frustum may be reported as visible.
+	/// </summary>
+	class frustum {
+	public:
+		enum plane_index { LEFT = 0, RIGHT = 1, BOTTOM = 2, TOP = 3, NEAR_PLANE = 4, FAR_PLANE = 5 };
+
+		constexpr frustum() { }
+		constexpr explicit frustum(const matrix<T, 4, 4>& viewProjection);
+
+		constexpr const vector<T, 4>& plane(size_t i) const { return planes[i]; }
+
+		constexpr bool contains(const vector<T, 3>& p) const;
+		constexpr bool intersects(const aabb<T, 3>& box) const;
+		constexpr bool intersects(const sphere<T>& s) const;
+
+	private:
+		std::array<vector<T, 4>, 6> planes;
+	};
+
+	/// <summary>
+	/// Batch visibility tests against a frustum. The bounds are stored as structure of arrays,
+	/// boxes as vector_batch&lt;T, 6&gt; (center x, y, z, half extent x, y, z) and spheres as vector_batch&lt;T, 4&gt; (center x, y, z, radius).
+	/// The indices of the visible bounds are written in ascending order. Float bounds are tested by the runtime dispatched
+	/// Cpu::kernels.cull_boxes / cull_spheres (4, 8 or 16 at once depending on the cpu), double bounds one at a time.
+	/// </summary>
+	struct cull_math {
+		template<std::floating_point T>
+		static void push_back(vector_batch<T, 6>& boxes, const aabb<T, 3>& box);
+		template<std::floating_point T>
+		static void push_back(vector_batch<T, 4>& spheres, const sphere<T>& s);
+
+		template<std::floating_point T>
+		///<summary>Writes the indices of the boxes intersecting the frustum to visible, which has to hold boxes.size() elements</summary>
+		///<returns>The amount of visible boxes</returns>
+		static size_t cull(uint32* visible, const frustum<T>& f, const vector_batch<T, 6>& boxes);
+
+		template<std::floating_point T>
+		///<summary>Writes the indices of the spheres intersecting the frustum to visible, which has to hold spheres.size() elements</summary>
+		///<returns>The amount of visible spheres</returns>
+		static size_t cull(uint32* visible, const frustum<T>& f, const vector_batch<T, 4>& spheres);
+
+	private:
+		template<typename T>
+		using pack = typename simd::pack_of<T>::type;
+
+		///<summary>Appends the indices of the lanes set in mask</summary>
+		static size_t _compact(uint32* visible, size_t count, uint32 base, uint32 mask);
+
+		///<summary>The planes of f as the 24 floats the cull kernels take</summary>
+		static void _planes(float* dst, const frustum<float>& f);
+	};
+
+//#######################################################################################################################
+
+	template<std::floating_point T, size_t N>
+	constexpr aabb<T, N>::aabb() {
+		for (size_t t = 0; t < N; ++t) {
+			lo[t] = std::numeric_limits<T>::infinity();
+			hi[t] = -std::numeric_limits<T>::infinity();
+		}
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr aabb<T, N> aabb<T, N>::from_center_extent(const vector<T, N>& center, const vector<T, N>& extent) {
+		aabb res;
+		for (size_t t = 0; t < N; ++t) {
+			res.lo[t] = center[t] - extent[t];
+			res.hi[t] = center[t] + extent[t];
+		}
+		return res;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr bool aabb<T, N>::empty() const {
+		for (size_t t = 0; t < N; ++t) {
+			if (!(lo[t] <= hi[t])) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr vector<T, N> aabb<T, N>::center() const {
+		vector<T, N> res;
+		for (size_t t = 0; t < N; ++t) {
+			res[t] = (lo[t] + hi[t]) * T(0.5);
+		}
+		return res;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr vector<T, N> aabb<T, N>::extent() const {
+		vector<T, N> res;
+		for (size_t t = 0; t < N; ++t) {
+			res[t] = (hi[t] - lo[t]) * T(0.5);
+		}
+		return res;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr vector<T, N> aabb<T, N>::size() const {
+		vector<T, N> res;
+		for (size_t t = 0; t < N; ++t) {
+			res[t] = hi[t] - lo[t];
+		}
+		return res;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr T aabb<T, N>::surface_area() const requires (N == 3) {
+		if (empty()) {
+			return T(0);
+		}
+		const T x = hi[0] - lo[0];
+		const T y = hi[1] - lo[1];
+		const T z = hi[2] - lo[2];
+		return T(2) * (x * y + y * z + z * x);
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr aabb<T, N>& aabb<T, N>::expand(const vector<T, N>& p) {
+		for (size_t t = 0; t < N; ++t) {
+			lo[t] = p[t] < lo[t] ? p[t] : lo[t];
+			hi[t] = p[t] > hi[t] ? p[t] : hi[t];
+		}
+		return *this;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr aabb<T, N>& aabb<T, N>::expand(const aabb& box) {
+		for (size_t t = 0; t < N; ++t) {
+			lo[t] = box.lo[t] < lo[t] ? box.lo[t] : lo[t];
+			hi[t] = box.hi[t] > hi[t] ? box.hi[t] : hi[t];
+		}
+		return *this;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr bool aabb<T, N>::contains(const vector<T, N>& p) const {
+		for (size_t t = 0; t < N; ++t) {
+			if (!(p[t] >= lo[t] && p[t] <= hi[t])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr bool aabb<T, N>::overlaps(const aabb& box) const {
+		for (size_t t = 0; t < N; ++t) {
+			if (!(box.lo[t] <= hi[t] && box.hi[t] >= lo[t])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr aabb<T, N> aabb<T, N>::transform(const matrix<T, 4, 4>& m) const requires (N == 3) {
+		//the center is transformed, the extent is the sum of the absolute rotated axes (Arvo)
+		const vector<T, 3> c = center();
+		const vector<T, 3> e = extent();
+		const T* a = m.data();
+		vector<T, 3> nc, ne;
+		for (size_t r = 0; r < 3; ++r) {
+			nc[r] = a[r * 4] * c[0] + a[r * 4 + 1] * c[1] + a[r * 4 + 2] * c[2] + a[r * 4 + 3];
+			ne[r] = std::fabs(a[r * 4]) * e[0] + std::fabs(a[r * 4 + 1]) * e[1] + std::fabs(a[r * 4 + 2]) * e[2];
+		}
+		return from_center_extent(nc, ne);
+	}
+
+	template<std::floating_point T>
+	constexpr bool sphere<T>::contains(const vector<T, 3>& p) const {
+		const vector<T, 3> d = p - center;
+		return d * d <= radius * radius;
+	}
+
+	template<std::floating_point T>
+	constexpr bool sphere<T>::overlaps(const sphere& s) const {
+		const vector<T, 3> d = s.center - center;
+		const T r = radius + s.radius;
+		return d * d <= r * r;
+	}
+
+	template<std::floating_point T>
+	constexpr bool sphere<T>::overlaps(const aabb<T, 3>& box) const {
+		T dist = T(0);
+		for (size_t t = 0; t < 3; ++t) {
+			const T c = center[t] < box.lo[t] ? box.lo[t] : (center[t] > box.hi[t] ? box.hi[t] : center[t]);
+			dist += (center[t] - c) * (center[t] - c);
+		}
+		return dist <= radius * radius;
+	}
+
+	template<std::floating_point T>
+	constexpr frustum<T>::frustum(const matrix<T, 4, 4>& viewProjection) {
+		const T* m = viewProjection.data();
+		//Gribb and Hartmann: row 3 +- row 0, 1 and 2
+		for (size_t p = 0; p < 6; ++p) {
+			const size_t row = p / 2;
+			const T sign = (p & 1) ? T(-1) : T(1);
+			T len = T(0);
+			for (size_t c = 0; c < 4; ++c) {
+				planes[p][c] = m[12 + c] + sign * m[row * 4 + c];
+				if (c < 3) {
+					len += planes[p][c] * planes[p][c];
+				}
+			}
+			const T inv = T(1) / math::sqrt(len);
+			for (size_t c = 0; c < 4; ++c) {
+				planes[p][c] *= inv;
+			}
+		}
+	}
+
+	template<std::floating_point T>
+	constexpr bool frustum<T>::contains(const vector<T, 3>& p) const {
+		for (const vector<T, 4>& pl : planes) {
+			if (pl[0] * p[0] + pl[1] * p[1] + pl[2] * p[2] + pl[3] < T(0)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<std::floating_point T>
+	constexpr bool frustum<T>::intersects(const aabb<T, 3>& box) const {
+		const vector<T, 3> c = box.center();
+		const vector<T, 3> e = box.extent();
+		for (const vector<T, 4>& pl : planes) {
+			const T dist = pl[0] * c[0] + pl[1] * c[1] + pl[2] * c[2] + pl[3];
+			const T r = std::fabs(pl[0]) * e[0] + std::fabs(pl[1]) * e[1] + std::fabs(pl[2]) * e[2];
+			if (dist + r < T(0)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<std::floating_point T>
+	constexpr bool frustum<T>::intersects(const sphere<T>& s) const {
+		for (const vector<T, 4>& pl : planes) {
+			if (pl[0] * s.center[0] + pl[1] * s.center[1] + pl[2] * s.center[2] + pl[3] + s.radius < T(0)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<std::floating_point T>
+	void cull_math::push_back(vector_batch<T, 6>& boxes, const aabb<T, 3>& box) {
+		const vector<T, 3> c = box.center();
+		const vector<T, 3> e = box.extent();
+		vector<T, 6> v;
+		for (size_t t = 0; t < 3; ++t) {
+			v[t] = c[t];
+			v[t + 3] = e[t];
+		}
+		boxes.push_back(v);
+	}
+
+	template<std::floating_point T>
+	void cull_math::push_back(vector_batch<T, 4>& spheres, const sphere<T>& s) {
+		vector<T, 4> v;
+		for (size_t t = 0; t < 3; ++t) {
+			v[t] = s.center[t];
+		}
+		v[3] = s.radius;
+		spheres.push_back(v);
+	}
+
+	inline size_t cull_math::_compact(uint32* visible, size_t count, uint32 base, uint32 mask) {
+		while (mask) {
+			visible[count++] = base + uint32(std::countr_zero(mask));
+			mask &= mask - 1;
+		}
+		return count;
+	}
+
+	inline void cull_math::_planes(float* dst, const frustum<float>& f) {
+		for (size_t p = 0; p < 6; ++p) {
+			for (size_t c = 0; c < 4; ++c) {
+				dst[p * 4 + c] = f.plane(p)[c];
+			}
+		}
+	}
+
+	template<std::floating_point T>
+	size_t cull_math::cull(uint32* visible, const frustum<T>& f, const vector_batch<T, 6>& boxes) {
+		if constexpr (std::is_same<T, float>::value) {
+			float planes[24];
+			_planes(planes, f);
+			const float* const comps[6] = { boxes.component(0), boxes.component(1), boxes.component(2),
+				boxes.component(3), boxes.component(4), boxes.component(5) };
+			return Util::Cpu::kernels.cull_boxes(visible, planes, comps, boxes.size());
+		} else {
+			using P = pack<T>;
+			constexpr uint32 full = P::width == 32 ? ~0u : (1u << P::width) - 1;
+			P n[6][3], a[6][3], d[6];
+			for (size_t p = 0; p < 6; ++p) {
+				for (size_t c = 0; c < 3; ++c) {
+					n[p][c] = P::set1(f.plane(p)[c]);
+					a[p][c] = P::abs(n[p][c]);
+				}
+				d[p] = P::set1(f.plane(p)[3]);
+			}
+			const size_t size = boxes.size();
+			size_t count = 0;
+			for (size_t i = 0; i < size; i += P::width) {
+				P c[3], e[3];
+				for (size_t k = 0; k < 3; ++k) {
+					c[k] = P::load(boxes.component(k) + i);
+					e[k] = P::load(boxes.component(k + 3) + i);
+				}
+				//the smallest distance of the box to any plane, negative if the box is completely outside of one
+				P m = P::set1(std::numeric_limits<T>::infinity());
+				for (size_t p = 0; p < 6; ++p) {
+					P dist = P::fmadd(n[p][0], c[0], d[p]);
+					dist = P::fmadd(n[p][1], c[1], dist);
+					dist = P::fmadd(n[p][2], c[2], dist);
+					dist = P::fmadd(a[p][0], e[0], dist);
+					dist = P::fmadd(a[p][1], e[1], dist);
+					dist = P::fmadd(a[p][2], e[2], dist);
+					m = P::min(m, dist);
+				}
+				const uint32 valid = size - i >= P::width ? full : (1u << (size - i)) - 1;
+				count = _compact(visible, count, uint32(i), ~P::sign_mask(m) & valid);
+			}
+			return count;
+		}
+	}
+
+	template<std::floating_point T>
+	size_t cull_math::cull(uint32* visible, const frustum<T>& f, const vector_batch<T, 4>& spheres) {
+		if constexpr (std::is_same<T, float>::value) {
+			float planes[24];
+			_planes(planes, f);
+			const float* const comps[4] = { spheres.component(0), spheres.component(1), spheres.component(2), spheres.component(3) };
+			return Util::Cpu::kernels.cull_spheres(visible, planes, comps, spheres.size());
+		} else {
+			using P = pack<T>;
+			constexpr uint32 full = P::width == 32 ? ~0u : (1u << P::width) - 1;
+			P n[6][3], d[6];
+			for (size_t p = 0; p < 6; ++p) {
+				for (size_t c = 0; c < 3; ++c) {
+					n[p][c] = P::set1(f.plane(p)[c]);
+				}
+				d[p] = P::set1(f.plane(p)[3]);
+			}
+			const size_t size = spheres.size();
+			size_t count = 0;
+			for (size_t i = 0; i < size; i += P::width) {
+				const P x = P::load(spheres.component(0) + i);
+				const P y = P::load(spheres.component(1) + i);
+				const P z = P::load(spheres.component(2) + i);
+				const P r = P::load(spheres.component(3) + i);
+				P m = P::set1(std::numeric_limits<T>::infinity());
+				for (size_t p = 0; p < 6; ++p) {
+					P dist = P::fmadd(n[p][0], x, d[p] + r);
+					dist = P::fmadd(n[p][1], y, dist);
+					dist = P::fmadd(n[p][2], z, dist);
+					m = P::min(m, dist);
+				}
+				const uint32 valid = size - i >= P::width ? full : (1u << (size - i)) - 1;
+				count = _compact(visible, count, uint32(i), ~P::sign_mask(m) & valid);
+			}
+			return count;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,348 @@
+#include "bvh.h"
+#include "parallel.h"
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+
+using namespace math;
+
+struct bvh::_build_state {
+	///<summary>The bounds of every primitive in input order</summary>
+	std::vector<aabb<float, 3>> bounds;
+	std::vector<vector<float, 3>> centroids;
+	///<summary>The next free node, children are allocated in pairs</summary>
+	std::atomic<uint32> next = 1;
+};
+
+static void _node_bounds(bvh_node& node, const aabb<float, 3>& box) {
+	for (size_t c = 0; c < 3; ++c) {
+		node.lo[c] = box.lo[c];
+		node.hi[c] = box.hi[c];
+	}
+}
+
+static void _expand(aabb<float, 3>& box, const bvh_node& node) {
+	for (size_t c = 0; c < 3; ++c) {
+		box.lo[c] = std::min(box.lo[c], node.lo[c]);
+		box.hi[c] = std::max(box.hi[c], node.hi[c]);
+	}
+}
+
+void bvh::build(const vector<float, 3>* vertices, size_t triangleCount) {
+	_vertices = vertices;
+	_indices = nullptr;
+	_boxes = nullptr;
+	_build(triangleCount);
+}
+
+void bvh::build(const vector<float, 3>* vertices, const uint32* indices, size_t triangleCount) {
+	_vertices = vertices;
+	_indices = indices;
+	_boxes = nullptr;
+	_build(triangleCount);
+}
+
+void bvh::build(const aabb<float, 3>* boxes, size_t count) {
+	_vertices = nullptr;
+	_indices = nullptr;
+	_boxes = boxes;
+	_build(count);
+}
+
+aabb<float, 3> bvh::_primitive_bounds(uint32 prim) const {
+	if (_boxes) {
+		return _boxes[prim];
+	}
+	aabb<float, 3> res;
+	for (size_t k = 0; k < 3; ++k) {
+		res.expand(_vertex(3 * size_t(prim) + k));
+	}
+	return res;
+}
+
+void bvh::_build(size_t count) {
+	ROBUST_ASSERT(count < size_t(~uint32(0)) / 2, "too many primitives for a bvh", CHANNEL_MATH);
+	_nodes.clear();
+	_prims.resize(count);
+	_bounds.resize(count);
+	if (count == 0) {
+		return;
+	}
+	_build_state state;
+	state.bounds.resize(count);
+	state.centroids.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		state.bounds[i] = _primitive_bounds(uint32(i));
+		state.centroids[i] = state.bounds[i].center();
+	}
+
+	std::iota(_prims.begin(), _prims.end(), uint32(0));
+	_nodes.resize(2 * count - 1);
+	_split(state, 0, 0, count, 0);
+	_nodes.resize(state.next);
+
+	for (size_t i = 0; i < count; ++i) {
+		_bounds[i] = state.bounds[_prims[i]];
+	}
+}
+
+void bvh::_split(_build_state& state, uint32 index, size_t begin, size_t end, size_t depth) {
+	aabb<float, 3> box, cbox;
+	for (size_t i = begin; i < end; ++i) {
+		box.expand(state.bounds[_prims[i]]);
+		cbox.expand(state.centroids[_prims[i]]);
+	}
+	bvh_node& node = _nodes[index];
+	_node_bounds(node, box);
+	const size_t count = end - begin;
+	if (count == 1) {
+		node.index = uint32(begin);
+		node.count = 1;
+		return;
+	}
+
+	//binned SAH, the cost of a split is area(left) * count(left) + area(right) * count(right)
+	size_t bestAxis = 3;
+	size_t bestBin = 0;
+	float bestCost = std::numeric_limits<float>::infinity();
+	const auto bin = [&](uint32 prim, size_t axis, float lo, float scale) {
+		return std::min(BINS - 1, size_t((state.centroids[prim][axis] - lo) * scale));
+	};
+	for (size_t axis = 0; axis < 3; ++axis) {
+		const float lo = cbox.lo[axis];
+		const float ext = cbox.hi[axis] - lo;
+		if (!(ext > 0.f)) {
+			continue;
+		}
+		const float scale = float(BINS) / ext;
+		aabb<float, 3> bins[BINS];
+		size_t counts[BINS] = {};
+		for (size_t i = begin; i < end; ++i) {
+			const size_t b = bin(_prims[i], axis, lo, scale);
+			bins[b].expand(state.bounds[_prims[i]]);
+			++counts[b];
+		}
+		float leftArea[BINS - 1];
+		size_t leftCount[BINS - 1];
+		aabb<float, 3> acc;
+		size_t n = 0;
+		for (size_t b = 0; b < BINS - 1; ++b) {
+			acc.expand(bins[b]);
+			n += counts[b];
+			leftArea[b] = acc.surface_area();
+			leftCount[b] = n;
+		}
+		acc = aabb<float, 3>();
+		n = 0;
+		for (size_t b = BINS - 1; b > 0; --b) {
+			acc.expand(bins[b]);
+			n += counts[b];
+			if (n == 0 || leftCount[b - 1] == 0) {
+				continue;
+			}
+			const float cost = leftArea[b - 1] * float(leftCount[b - 1]) + acc.surface_area() * float(n);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	//a traversal step costs as much as one primitive test
+	const float area = box.surface_area();
+	if (count <= MAX_LEAF && (bestAxis == 3 || area + bestCost >= area * float(count))) {
+		node.index = uint32(begin);
+		node.count = uint32(count);
+		return;
+	}
+
+	size_t mid = begin;
+	if (bestAxis != 3 && depth < MAX_SAH_DEPTH) {
+		const float lo = cbox.lo[bestAxis];
+		const float scale = float(BINS) / (cbox.hi[bestAxis] - lo);
+		mid = size_t(std::partition(_prims.data() + begin, _prims.data() + end, [&](uint32 prim) {
+			return bin(prim, bestAxis, lo, scale) < bestBin;
+		}) - _prims.data());
+	}
+	if (mid == begin || mid == end) {
+		//median split along the widest centroid extent, also taken if all centroids coincide
+		size_t axis = 0;
+		for (size_t c = 1; c < 3; ++c) {
+			if (cbox.hi[c] - cbox.lo[c] > cbox.hi[axis] - cbox.lo[axis]) {
+				axis = c;
+			}
+		}
+		mid = begin + count / 2;
+		std::nth_element(_prims.data() + begin, _prims.data() + mid, _prims.data() + end, [&](uint32 a, uint32 b) {
+			return state.centroids[a][axis] < state.centroids[b][axis];
+		});
+	}
+
+	const uint32 left = state.next.fetch_add(2);
+	node.index = left;
+	node.count = 0;
+
+	if (count >= PARALLEL_THRESHOLD) {
+		Util::parallel::invoke([&]() {
+			_split(state, left, begin, mid, depth + 1);
+		}, [&]() {
+			_split(state, left + 1, mid, end, depth + 1);
+		});
+	}
+	else {
+		_split(state, left, begin, mid, depth + 1);
+		_split(state, left + 1, mid, end, depth + 1);
+	}
+}
+
+void bvh::refit() {
+	for (size_t i = 0; i < _prims.size(); ++i) {
+		_bounds[i] = _primitive_bounds(_prims[i]);
+	}
+	//children are stored after their parents
+	for (size_t n = _nodes.size(); n-- > 0;) {
+		bvh_node& node = _nodes[n];
+		aabb<float, 3> box;
+		if (node.leaf()) {
+			for (size_t i = node.index; i < size_t(node.index) + node.count; ++i) {
+				box.expand(_bounds[i]);
+			}
+		}
+		else {
+			_expand(box, _nodes[node.index]);
+			_expand(box, _nodes[node.index + 1]);
+		}
+		_node_bounds(node, box);
+	}
+}
+
+aabb<float, 3> bvh::bounds() const {
+	aabb<float, 3> res;
+	if (!_nodes.empty()) {
+		_expand(res, _nodes[0]);
+	}
+	return res;
+}
+
+bool bvh::_intersect(size_t i, const ray<float>& r, ray_hit& hit) const {
+	const uint32 prim = _prims[i];
+	if (_boxes) {
+		float origin[3], inv[3];
+		for (size_t c = 0; c < 3; ++c) {
+			origin[c] = r.origin[c];
+			inv[c] = 1.f / r.direction[c];
+		}
+		const float t = intersect_math::ray_box(origin, inv, &_bounds[i].lo[0], &_bounds[i].hi[0], hit.t);
+		if (!(t < hit.t)) {
+			return false;
+		}
+		hit.t = t;
+		hit.prim = prim;
+		hit.u = 0.f;
+		hit.v = 0.f;
+		return true;
+	}
+	const size_t base = 3 * size_t(prim);
+	if (!intersect_math::ray_triangle(r, _vertex(base), _vertex(base + 1), _vertex(base + 2), hit)) {
+		return false;
+	}
+	hit.prim = prim;
+	return true;
+}
+
+bool bvh::intersect(const ray<float>& r, ray_hit& hit) const {
+	if (_nodes.empty()) {
+		return false;
+	}
+	//plain copies, the subscripts of vector are bounds checked in robust builds
+	float origin[3], inv[3];
+	for (size_t c = 0; c < 3; ++c) {
+		origin[c] = r.origin[c];
+		inv[c] = 1.f / r.direction[c];
+	}
+	if (intersect_math::ray_box(origin, inv, _nodes[0].lo, _nodes[0].hi, hit.t) == std::numeric_limits<float>::infinity()) {
+		return false;
+	}
+	struct entry {
+		uint32 node;
+		float t;
+	};
+	entry stack[STACK_SIZE];
+	size_t sp = 0;
+	uint32 current = 0;
+	bool found = false;
+	for (;;) {
+		const bvh_node& node = _nodes[current];
+		if (node.leaf()) {
+			for (size_t i = node.index; i < size_t(node.index) + node.count; ++i) {
+				found |= _intersect(i, r, hit);
+			}
+		}
+		else {
+			//visit the closer child first, the farther one is skipped later if a hit in front of it was found
+			const bvh_node& l = _nodes[node.index];
+			const bvh_node& h = _nodes[node.index + 1];
+			float tl = intersect_math::ray_box(origin, inv, l.lo, l.hi, hit.t);
+			float th = intersect_math::ray_box(origin, inv, h.lo, h.hi, hit.t);
+			uint32 near_child = node.index;
+			uint32 far_child = node.index + 1;
+			if (th < tl) {
+				std::swap(tl, th);
+				std::swap(near_child, far_child);
+			}
+			if (tl != std::numeric_limits<float>::infinity()) {
+				if (th != std::numeric_limits<float>::infinity()) {
+					stack[sp++] = { far_child, th };
+				}
+				current = near_child;
+				continue;
+			}
+		}
+		for (;;) {
+			if (sp == 0) {
+				return found;
+			}
+			const entry e = stack[--sp];
+			if (e.t <= hit.t) {
+				current = e.node;
+				break;
+			}
+		}
+	}
+}
+
+bool bvh::occluded(const ray<float>& r, float tmax) const {
+	if (_nodes.empty()) {
+		return false;
+	}
+	//plain copies, the subscripts of vector are bounds checked in robust builds
+	float origin[3], inv[3];
+	for (size_t c = 0; c < 3; ++c) {
+		origin[c] = r.origin[c];
+		inv[c] = 1.f / r.direction[c];
+	}
+	ray_hit hit;
+	hit.t = tmax;
+	uint32 stack[STACK_SIZE];
+	size_t sp = 0;
+	stack[sp++] = 0;
+	while (sp != 0) {
+		const bvh_node& node = _nodes[stack[--sp]];
+		if (intersect_math::ray_box(origin, inv, node.lo, node.hi, tmax) == std::numeric_limits<float>::infinity()) {
+			continue;
+		}
+		if (node.leaf()) {
+			for (size_t i = node.index; i < size_t(node.index) + node.count; ++i) {
+				if (_intersect(i, r, hit)) {
+					return true;
+				}
+			}
+		}
+		else {
+			stack[sp++] = node.index + 1;
+			stack[sp++] = node.index;
+		}
+	}
+	return false;
+}
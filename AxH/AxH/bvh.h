@@ -0,0 +1,197 @@
+#ifndef __H_BVH
+#define __H_BVH
+
+#include <bit>
+#include <vector>
+#include <limits>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "simd.h"
+#include "bounds.h"
+#include "intersect.h"
+
+namespace math {
+
+	/// <summary>
+	/// Node of a bvh, 32 bytes so two siblings share a cache line.
+	/// Leaves reference count primitives starting at index, interior nodes (count == 0) have their children at index and index + 1.
+	/// </summary>
+	struct bvh_node {
+		float lo[3];
+		uint32 index;
+		float hi[3];
+		uint32 count;
+
+		bool leaf() const { return count != 0; }
+	};
+	static_assert(sizeof(bvh_node) == 32, "bvh nodes have to stay packed");
+
+	/// <summary>
+	/// Bounding volume hierarchy over a triangle mesh or a set of boxes, built with the binned surface area heuristic.
+	/// The nodes are stored in one flat array, children are always stored after their parent.
+	/// The bvh references the geometry it was built from: it has to stay valid, refit() reads its current content
+	/// so animated geometry only has to update the node bounds instead of rebuilding the tree.
+	/// </summary>
+	class bvh {
+	public:
+		bvh() { }
+
+		///<summary>Builds over a triangle soup, triangle i is made of vertices[3 * i] ... vertices[3 * i + 2]</summary>
+		void build(const vector<float, 3>* vertices, size_t triangleCount);
+		///<summary>Builds over an indexed triangle mesh, triangle i is made of the vertices indices[3 * i] ... indices[3 * i + 2]</summary>
+		void build(const vector<float, 3>* vertices, const uint32* indices, size_t triangleCount);
+		///<summary>Builds over a set of boxes, ray queries hit the boxes themselves</summary>
+		void build(const aabb<float, 3>* boxes, size_t count);
+
+		///<summary>Recomputes the bounds of all nodes from the current content of the geometry, the topology is kept</summary>
+		void refit();
+
+		///<summary>Finds the closest intersection closer than hit.t</summary>
+		///<returns>Whether hit was updated</returns>
+		bool intersect(const ray<float>& r, ray_hit& hit) const;
+		///<summary>Finds the closest intersections of ray_packet::width rays, the nodes are tested against all rays at once</summary>
+		void intersect(const ray_packet& rays, ray_hit* hits) const;
+		///<returns>Whether any primitive intersects the ray closer than tmax (line of sight test)</returns>
+		bool occluded(const ray<float>& r, float tmax) const;
+
+		template<typename F>
+		///<summary>Calls fn(prim) for every primitive with bounds overlapping box</summary>
+		void query(const aabb<float, 3>& box, F&& fn) const;
+
+		///<returns>The amount of primitives</returns>
+		size_t size() const { return _prims.size(); }
+		const std::vector<bvh_node>& nodes() const { return _nodes; }
+		///<returns>The bounds of all primitives</returns>
+		aabb<float, 3> bounds() const;
+
+		///<summary>Subtrees with at least this many primitives are built on a helper thread while one is free (see Util::parallel)</summary>
+		static constexpr size_t PARALLEL_THRESHOLD = 1 << 12;
+		///<summary>Amount of bins the split candidates are evaluated on</summary>
+		static constexpr size_t BINS = 16;
+		///<summary>Largest leaf, larger nodes are split even if the heuristic prefers a leaf</summary>
+		static constexpr size_t MAX_LEAF = 8;
+		///<summary>Beyond this depth nodes are split at the median instead, this bounds the depth of the tree</summary>
+		static constexpr size_t MAX_SAH_DEPTH = 64;
+		///<summary>Traversal stack size, covers MAX_SAH_DEPTH and a median split of 2^32 primitives</summary>
+		static constexpr size_t STACK_SIZE = 128;
+
+	private:
+		struct _build_state;
+
+		std::vector<bvh_node> _nodes;
+		///<summary>The primitive of every leaf slot</summary>
+		std::vector<uint32> _prims;
+		///<summary>The bounds of the primitive of every leaf slot</summary>
+		std::vector<aabb<float, 3>> _bounds;
+
+		const vector<float, 3>* _vertices = nullptr;
+		const uint32* _indices = nullptr;
+		const aabb<float, 3>* _boxes = nullptr;
+
+		void _build(size_t count);
+		void _split(_build_state& state, uint32 node, size_t begin, size_t end, size_t depth);
+		aabb<float, 3> _primitive_bounds(uint32 prim) const;
+		///<summary>Vertex k of the triangle soup or indexed mesh</summary>
+		const vector<float, 3>& _vertex(size_t k) const { return _vertices[_indices ? _indices[k] : k]; }
+		///<summary>Tests the primitive in leaf slot i, updates hit if it is closer</summary>
+		bool _intersect(size_t i, const ray<float>& r, ray_hit& hit) const;
+	};
+
+//#######################################################################################################################
+
+	template<typename F>
+	void bvh::query(const aabb<float, 3>& box, F&& fn) const {
+		if (_nodes.empty()) {
+			return;
+		}
+		uint32 stack[STACK_SIZE];
+		size_t sp = 0;
+		stack[sp++] = 0;
+		while (sp != 0) {
+			const bvh_node& node = _nodes[stack[--sp]];
+			if (!(node.lo[0] <= box.hi[0] && node.hi[0] >= box.lo[0] &&
+				node.lo[1] <= box.hi[1] && node.hi[1] >= box.lo[1] &&
+				node.lo[2] <= box.hi[2] && node.hi[2] >= box.lo[2])) {
+				continue;
+			}
+			if (node.leaf()) {
+				for (size_t i = node.index; i < size_t(node.index) + node.count; ++i) {
+					if (_bounds[i].overlaps(box)) {
+						fn(_prims[i]);
+					}
+				}
+			}
+			else {
+				stack[sp++] = node.index + 1;
+				stack[sp++] = node.index;
+			}
+		}
+	}
+
+	inline void bvh::intersect(const ray_packet& rays, ray_hit* hits) const {
+		constexpr size_t W = ray_packet::width;
+		if (_nodes.empty()) {
+			return;
+		}
+		//the closest hits so far, hits.t doubles as the distance limit of the node tests
+		hit_pack closest;
+		uint32 prims[W];
+		for (size_t l = 0; l < W; ++l) {
+			closest.t[l] = hits[l].t;
+			closest.u[l] = hits[l].u;
+			closest.v[l] = hits[l].v;
+			prims[l] = hits[l].prim;
+		}
+
+		uint32 stack[STACK_SIZE];
+		size_t sp = 0;
+		stack[sp++] = 0;
+		while (sp != 0) {
+			const bvh_node& node = _nodes[stack[--sp]];
+			uint32 active = intersect_math::rays_box(rays, node.lo, node.hi, closest.t);
+			if (active == 0) {
+				continue;
+			}
+			if (!node.leaf()) {
+				stack[sp++] = node.index + 1;
+				stack[sp++] = node.index;
+				continue;
+			}
+			for (size_t i = node.index; i < size_t(node.index) + node.count; ++i) {
+				if (_boxes) {
+					for (uint32 m = active; m; m &= m - 1) {
+						const size_t l = size_t(std::countr_zero(m));
+						float origin[3], inv[3];
+						for (size_t c = 0; c < 3; ++c) {
+							origin[c] = rays.origin[c][l];
+							inv[c] = rays.inv_direction[c][l];
+						}
+						const float t = intersect_math::ray_box(origin, inv, &_bounds[i].lo[0], &_bounds[i].hi[0], closest.t[l]);
+						if (t < closest.t[l]) {
+							closest.t[l] = t;
+							closest.u[l] = 0.f;
+							closest.v[l] = 0.f;
+							prims[l] = _prims[i];
+						}
+					}
+				}
+				else {
+					const size_t base = 3 * size_t(_prims[i]);
+					uint32 mask = intersect_math::rays_triangle(rays, _vertex(base), _vertex(base + 1), _vertex(base + 2), closest);
+					for (; mask; mask &= mask - 1) {
+						prims[std::countr_zero(mask)] = _prims[i];
+					}
+				}
+			}
+		}
+		for (size_t l = 0; l < W; ++l) {
+			hits[l].t = closest.t[l];
+			hits[l].u = closest.u[l];
+			hits[l].v = closest.v[l];
+			hits[l].prim = prims[l];
+		}
+	}
+}
+
+#endif
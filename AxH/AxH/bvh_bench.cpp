@@ -0,0 +1,97 @@
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "bvh.h"
+
+/*
+* Times bvh builds over random triangle soups and reports the ray throughput of single rays and ray packets,
+* for rays in random directions and for coherent rays of a pinhole camera looking at the soup.
+*/
+using namespace math;
+
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point start) {
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+static void report(const char* what, size_t rays, size_t hits, double seconds) {
+	std::cout << "  " << what << ": " << rays / seconds / 1e6 << " Mrays/s (" << hits << " hits)" << std::endl;
+}
+
+static void trace(const bvh& b, const std::vector<ray<float>>& rays, const char* what) {
+	size_t hits = 0;
+	clock_type::time_point start = clock_type::now();
+	for (const ray<float>& r : rays) {
+		ray_hit hit;
+		hits += b.intersect(r, hit) ? 1 : 0;
+	}
+	report((std::string(what) + " single").c_str(), rays.size(), hits, seconds_since(start));
+
+	hits = 0;
+	ray_hit packet[ray_packet::width];
+	start = clock_type::now();
+	for (size_t i = 0; i + ray_packet::width <= rays.size(); i += ray_packet::width) {
+		ray_packet p;
+		for (size_t l = 0; l < ray_packet::width; ++l) {
+			p.set(l, rays[i + l]);
+			packet[l] = ray_hit();
+		}
+		b.intersect(p, packet);
+		for (const ray_hit& hit : packet) {
+			hits += hit.hit() ? 1 : 0;
+		}
+	}
+	report((std::string(what) + " packet").c_str(), rays.size() / ray_packet::width * ray_packet::width, hits, seconds_since(start));
+}
+
+int main() {
+	constexpr size_t RAYS = 1 << 18;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> pos(-100.f, 100.f);
+	std::uniform_real_distribution<float> offset(-1.f, 1.f);
+
+	for (size_t triangles : { size_t(10000), size_t(100000), size_t(1000000) }) {
+		std::vector<vector<float, 3>> vertices(3 * triangles);
+		for (size_t t = 0; t < triangles; ++t) {
+			vector<float, 3> center;
+			for (size_t k = 0; k < 3; ++k) {
+				center[k] = pos(rng);
+			}
+			for (size_t v = 0; v < 3; ++v) {
+				for (size_t k = 0; k < 3; ++k) {
+					vertices[3 * t + v][k] = center[k] + offset(rng);
+				}
+			}
+		}
+
+		bvh b;
+		const clock_type::time_point start = clock_type::now();
+		b.build(vertices.data(), triangles);
+		std::cout << triangles << " triangles: build " << seconds_since(start) * 1e3 << " ms, " << b.nodes().size() << " nodes" << std::endl;
+
+		std::vector<ray<float>> incoherent(RAYS);
+		for (ray<float>& r : incoherent) {
+			for (size_t k = 0; k < 3; ++k) {
+				r.origin[k] = pos(rng);
+				r.direction[k] = offset(rng);
+			}
+		}
+		trace(b, incoherent, "incoherent");
+
+		//a 512 x 512 camera in front of the soup, neighbouring rays form the packets
+		std::vector<ray<float>> coherent(RAYS);
+		for (size_t i = 0; i < RAYS; ++i) {
+			coherent[i].origin[0] = 0.f;
+			coherent[i].origin[1] = 0.f;
+			coherent[i].origin[2] = -200.f;
+			coherent[i].direction[0] = (float(i % 512) / 256.f - 1.f) * 0.5f;
+			coherent[i].direction[1] = (float(i / 512) / 256.f - 1.f) * 0.5f;
+			coherent[i].direction[2] = 1.f;
+		}
+		trace(b, coherent, "coherent");
+	}
+	return 0;
+}
@@ -0,0 +1,409 @@
+#include "cpu.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "errhndl.h"
+#include "quantized.h"
+
+#ifdef __CPU_DISPATCH
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace Util;
+
+CpuKernels Cpu::kernels = {
+	cpu_scalar::mat4_mul,
+	cpu_scalar::mat4_mul_array,
+	cpu_scalar::mat4_mul_left,
+	cpu_scalar::mat4_hierarchy,
+	cpu_scalar::transform_points,
+	cpu_scalar::bswap16,
+	cpu_scalar::bswap32,
+	cpu_scalar::bswap64,
+	cpu_scalar::half_to_float,
+	cpu_scalar::float_to_half,
+	cpu_scalar::unorm8_to_float,
+	cpu_scalar::float_to_unorm8,
+	cpu_scalar::unorm16_to_float,
+	cpu_scalar::float_to_unorm16,
+	cpu_scalar::snorm16_to_float,
+	cpu_scalar::float_to_snorm16,
+	cpu_scalar::fixed_to_float,
+	cpu_scalar::float_to_fixed,
+	cpu_scalar::cull_boxes,
+	cpu_scalar::cull_spheres,
+	Isa::SCALAR
+};
+
+#ifdef __CPU_DISPATCH
+namespace Util {
+	static void _cpuid(uint32 out[4], uint32 leaf, uint32 sub) {
+#ifdef _MSC_VER
+		int reg[4];
+		__cpuidex(reg, int(leaf), int(sub));
+		for (int t = 0; t < 4; ++t) {
+			out[t] = uint32(reg[t]);
+		}
+#else
+		__cpuid_count(leaf, sub, out[0], out[1], out[2], out[3]);
+#endif
+	}
+
+	///<summary>Reads XCR0, the register states saved by the OS</summary>
+	static uint64 _xcr0() {
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		uint32 eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (uint64(edx) << 32) | eax;
+#endif
+	}
+}
+#endif
+
+static CpuFeatures _detect() {
+	CpuFeatures res;
+#ifdef __CPU_DISPATCH
+	uint32 reg[4];
+	_cpuid(reg, 0, 0);
+	uint32 maxLeaf = reg[0];
+	char vendor[13] = {};
+	std::memcpy(vendor, &reg[1], 4);
+	std::memcpy(vendor + 4, &reg[3], 4);
+	std::memcpy(vendor + 8, &reg[2], 4);
+	res.vendor = vendor;
+
+	if (maxLeaf < 1) {
+		return res;
+	}
+	_cpuid(reg, 1, 0);
+	const uint32 ecx1 = reg[2];
+	res.ssse3 = ecx1 & (1u << 9);
+	res.sse41 = ecx1 & (1u << 19);
+	res.sse42 = ecx1 & (1u << 20);
+
+	//the AVX registers are only usable if the OS saves them on context switches
+	const bool osxsave = ecx1 & (1u << 27);
+	const uint64 xcr0 = osxsave ? _xcr0() : 0;
+	const bool ymm = (xcr0 & 0x6) == 0x6;
+	const bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+	res.avx = ymm && (ecx1 & (1u << 28));
+	res.fma = res.avx && (ecx1 & (1u << 12));
+	res.f16c = res.avx && (ecx1 & (1u << 29));
+
+	if (maxLeaf >= 7) {
+		_cpuid(reg, 7, 0);
+		const uint32 ebx7 = reg[1];
+		res.avx2 = res.avx && (ebx7 & (1u << 5));
+		res.avx512f = zmm && (ebx7 & (1u << 16));
+		res.avx512dq = res.avx512f && (ebx7 & (1u << 17));
+		res.avx512bw = res.avx512f && (ebx7 & (1u << 30));
+		res.avx512vl = res.avx512f && (ebx7 & (1u << 31));
+	}
+#endif
+	return res;
+}
+
+const CpuFeatures& Cpu::getFeatures() {
+	static const CpuFeatures features = _detect();
+	return features;
+}
+
+Isa Cpu::getSupportedIsa() {
+#ifdef __CPU_DISPATCH
+	const CpuFeatures& f = getFeatures();
+	if (!(f.ssse3 && f.sse42)) {
+		return Isa::SCALAR;
+	}
+	if (!(f.avx2 && f.fma && f.f16c)) {
+		return Isa::SSE42;
+	}
+	if (!(f.avx512f && f.avx512bw && f.avx512dq && f.avx512vl)) {
+		return Isa::AVX2;
+	}
+	return Isa::AVX512;
+#else
+	return Isa::SCALAR;
+#endif
+}
+
+const char* Cpu::getIsaName(Isa isa) {
+	switch (isa) {
+	case Isa::SSE42:
+		return "sse42";
+	case Isa::AVX2:
+		return "avx2";
+	case Isa::AVX512:
+		return "avx512";
+	default:
+		return "scalar";
+	}
+}
+
+void Cpu::init() {
+	Isa isa = getSupportedIsa();
+
+	const char* forced = std::getenv("AXH_ISA");
+	if (forced) {
+		Isa cap = Isa::AVX512;
+		while (cap != Isa::SCALAR && std::strcmp(getIsaName(cap), forced) != 0) {
+			cap = Isa(uint8(cap) - 1);
+		}
+		if (std::strcmp(getIsaName(cap), forced) != 0) {
+			PRINT_ERR(std::string("Unknown instruction set in AXH_ISA: ") + forced, PRIORITY_MESSAGE, CHANNEL_GENERAL_DEBUG);
+		}
+		else if (cap < isa) {
+			isa = cap;
+		}
+	}
+
+	_bind(isa);
+
+	const CpuFeatures& f = getFeatures();
+	PRINT(std::string("CPU ") + f.vendor
+		+ (f.sse42 ? " sse4.2" : "") + (f.avx ? " avx" : "") + (f.avx2 ? " avx2" : "") + (f.fma ? " fma" : "")
+		+ (f.f16c ? " f16c" : "") + (f.avx512f ? " avx512f" : "") + (f.avx512bw ? " avx512bw" : "")
+		+ (f.avx512dq ? " avx512dq" : "") + (f.avx512vl ? " avx512vl" : ""), CHANNEL_GENERAL_DEBUG);
+	PRINT(std::string("Kernels bound to ") + getIsaName(kernels.isa)
+		+ " (supported: " + getIsaName(getSupportedIsa()) + ")", CHANNEL_GENERAL_DEBUG);
+}
+
+bool Cpu::forceIsa(Isa isa) {
+	if (isa > getSupportedIsa()) {
+		PRINT_ERR(std::string("The cpu does not support ") + getIsaName(isa), PRIORITY_MESSAGE, CHANNEL_GENERAL_DEBUG);
+		return false;
+	}
+	_bind(isa);
+	PRINT(std::string("Kernels forced to ") + getIsaName(isa), CHANNEL_GENERAL_DEBUG);
+	return true;
+}
+
+#define __CPU_BIND(NS) \
+	kernels.mat4_mul = NS::mat4_mul; \
+	kernels.mat4_mul_array = NS::mat4_mul_array; \
+	kernels.mat4_mul_left = NS::mat4_mul_left; \
+	kernels.mat4_hierarchy = NS::mat4_hierarchy; \
+	kernels.transform_points = NS::transform_points; \
+	kernels.bswap16 = NS::bswap16; \
+	kernels.bswap32 = NS::bswap32; \
+	kernels.bswap64 = NS::bswap64; \
+	kernels.half_to_float = NS::half_to_float; \
+	kernels.float_to_half = NS::float_to_half; \
+	kernels.unorm8_to_float = NS::unorm8_to_float; \
+	kernels.float_to_unorm8 = NS::float_to_unorm8; \
+	kernels.unorm16_to_float = NS::unorm16_to_float; \
+	kernels.float_to_unorm16 = NS::float_to_unorm16; \
+	kernels.snorm16_to_float = NS::snorm16_to_float; \
+	kernels.float_to_snorm16 = NS::float_to_snorm16; \
+	kernels.fixed_to_float = NS::fixed_to_float; \
+	kernels.float_to_fixed = NS::float_to_fixed; \
+	kernels.cull_boxes = NS::cull_boxes; \
+	kernels.cull_spheres = NS::cull_spheres;
+
+void Cpu::_bind(Isa isa) {
+	switch (isa) {
+#ifdef __CPU_DISPATCH
+	case Isa::AVX512:
+		__CPU_BIND(cpu_avx512);
+		break;
+	case Isa::AVX2:
+		__CPU_BIND(cpu_avx2);
+		break;
+	case Isa::SSE42:
+		__CPU_BIND(cpu_sse42);
+		break;
+#endif
+	default:
+		__CPU_BIND(cpu_scalar);
+		isa = Isa::SCALAR;
+		break;
+	}
+	kernels.isa = isa;
+}
+
+#undef __CPU_BIND
+
+//#######################################################################################################################
+//scalar kernels
+
+void cpu_scalar::mat4_mul(float* dst, const float* a, const float* b) {
+	float res[16];
+	for (size_t r = 0; r < 4; ++r) {
+		for (size_t c = 0; c < 4; ++c) {
+			res[r * 4 + c] = a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c] + a[r * 4 + 2] * b[8 + c] + a[r * 4 + 3] * b[12 + c];
+		}
+	}
+	std::memcpy(dst, res, sizeof(res));
+}
+
+void cpu_scalar::mat4_mul_array(float* dst, const float* a, const float* b, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		mat4_mul(dst + 16 * i, a + 16 * i, b + 16 * i);
+	}
+}
+
+void cpu_scalar::mat4_mul_left(float* dst, const float* a, const float* b, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		mat4_mul(dst + 16 * i, a, b + 16 * i);
+	}
+}
+
+void cpu_scalar::mat4_hierarchy(float* world, const float* local, const int32* parent, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		if (parent[i] < 0) {
+			std::memmove(world + 16 * i, local + 16 * i, 16 * sizeof(float));
+		}
+		else {
+			mat4_mul(world + 16 * i, world + 16 * size_t(parent[i]), local + 16 * i);
+		}
+	}
+}
+
+void cpu_scalar::transform_points(float* const* dst, const float* m, const float* const* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		const float x = src[0][i];
+		const float y = src[1][i];
+		const float z = src[2][i];
+		for (size_t r = 0; r < 3; ++r) {
+			dst[r][i] = m[r * 4] * x + m[r * 4 + 1] * y + m[r * 4 + 2] * z + m[r * 4 + 3];
+		}
+	}
+}
+
+void cpu_scalar::bswap16(void* dst, const void* src, size_t count) {
+	const uint8* s = static_cast<const uint8*>(src);
+	uint8* d = static_cast<uint8*>(dst);
+	for (size_t i = 0; i < count; ++i, s += 2, d += 2) {
+		uint8 b0 = s[0];
+		d[0] = s[1];
+		d[1] = b0;
+	}
+}
+
+void cpu_scalar::bswap32(void* dst, const void* src, size_t count) {
+	const uint8* s = static_cast<const uint8*>(src);
+	uint8* d = static_cast<uint8*>(dst);
+	for (size_t i = 0; i < count; ++i, s += 4, d += 4) {
+		uint8 tmp[4] = { s[3], s[2], s[1], s[0] };
+		std::memcpy(d, tmp, 4);
+	}
+}
+
+void cpu_scalar::bswap64(void* dst, const void* src, size_t count) {
+	const uint8* s = static_cast<const uint8*>(src);
+	uint8* d = static_cast<uint8*>(dst);
+	for (size_t i = 0; i < count; ++i, s += 8, d += 8) {
+		uint8 tmp[8] = { s[7], s[6], s[5], s[4], s[3], s[2], s[1], s[0] };
+		std::memcpy(d, tmp, 8);
+	}
+}
+
+void cpu_scalar::half_to_float(float* dst, const uint16* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::half::decode(src[i]);
+	}
+}
+
+void cpu_scalar::float_to_half(uint16* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::half::encode(src[i]);
+	}
+}
+
+void cpu_scalar::unorm8_to_float(float* dst, const uint8* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::unorm8::decode(src[i]);
+	}
+}
+
+void cpu_scalar::float_to_unorm8(uint8* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::unorm8::encode(src[i]);
+	}
+}
+
+void cpu_scalar::unorm16_to_float(float* dst, const uint16* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::unorm16::decode(src[i]);
+	}
+}
+
+void cpu_scalar::float_to_unorm16(uint16* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::unorm16::encode(src[i]);
+	}
+}
+
+void cpu_scalar::snorm16_to_float(float* dst, const int16* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::snorm16::decode(src[i]);
+	}
+}
+
+void cpu_scalar::float_to_snorm16(int16* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::snorm16::encode(src[i]);
+	}
+}
+
+void cpu_scalar::fixed_to_float(float* dst, const int32* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::fixed16_16::decode(src[i]);
+	}
+}
+
+void cpu_scalar::float_to_fixed(int32* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = math::fixed16_16::encode(src[i]);
+	}
+}
+
+size_t cpu_scalar::cull_boxes(uint32* visible, const float* planes, const float* const* boxes, size_t count) {
+	size_t res = 0;
+	for (size_t i = 0; i < count; ++i) {
+		//the smallest distance of the box to any plane, negative if the box is completely outside of one
+		float m = std::numeric_limits<float>::infinity();
+		for (size_t p = 0; p < 6; ++p) {
+			const float* n = planes + p * 4;
+			float dist = n[3] + n[0] * boxes[0][i];
+			dist += n[1] * boxes[1][i];
+			dist += n[2] * boxes[2][i];
+			dist += std::fabs(n[0]) * boxes[3][i];
+			dist += std::fabs(n[1]) * boxes[4][i];
+			dist += std::fabs(n[2]) * boxes[5][i];
+			m = m < dist ? m : dist;
+		}
+		//the sign bit like the simd variants, -0 counts as outside
+		if (!std::signbit(m)) {
+			visible[res++] = uint32(i);
+		}
+	}
+	return res;
+}
+
+size_t cpu_scalar::cull_spheres(uint32* visible, const float* planes, const float* const* spheres, size_t count) {
+	size_t res = 0;
+	for (size_t i = 0; i < count; ++i) {
+		float m = std::numeric_limits<float>::infinity();
+		for (size_t p = 0; p < 6; ++p) {
+			const float* n = planes + p * 4;
+			float dist = (n[3] + spheres[3][i]) + n[0] * spheres[0][i];
+			dist += n[1] * spheres[1][i];
+			dist += n[2] * spheres[2][i];
+			m = m < dist ? m : dist;
+		}
+		if (!std::signbit(m)) {
+			visible[res++] = uint32(i);
+		}
+	}
+	return res;
+}
@@ -0,0 +1,162 @@
+#ifndef __H_CPU
+#define __H_CPU
+
+#include <cstddef>
+#include <string>
+
+#include "inc_settings.h"
+#include "dtypes.h"
+
+//The per instruction set kernels are only built for x86 targets
+#if !defined(__NO_SIMD) && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+#define __CPU_DISPATCH
+#endif
+
+namespace Util {
+
+	///<summary>
+	/// The instruction set levels kernels are built for, each level includes the previous ones
+	///</summary>
+	enum class Isa : uint8 {
+		SCALAR = 0,
+		///<summary>SSE4.2 (and SSSE3)</summary>
+		SSE42 = 1,
+		///<summary>AVX2, FMA and F16C</summary>
+		AVX2 = 2,
+		///<summary>AVX-512 F, BW, DQ and VL</summary>
+		AVX512 = 3
+	};
+
+	///<summary>
+	/// The features reported by cpuid, the AVX flags are only set if the OS saves the according registers
+	///</summary>
+	struct CpuFeatures {
+		bool ssse3 = false;
+		bool sse41 = false;
+		bool sse42 = false;
+		bool avx = false;
+		bool avx2 = false;
+		bool fma = false;
+		bool f16c = false;
+		bool avx512f = false;
+		bool avx512bw = false;
+		bool avx512dq = false;
+		bool avx512vl = false;
+		std::string vendor;
+	};
+
+	///<summary>
+	/// Table of the runtime dispatched kernels. All matrices are 4x4 row major, the arrays may not overlap unless noted
+	///</summary>
+	struct CpuKernels {
+		///<summary>dst = a * b, dst may be a or b</summary>
+		void (*mat4_mul)(float* dst, const float* a, const float* b);
+		///<summary>dst[i] = a[i] * b[i] for count consecutive matrices</summary>
+		void (*mat4_mul_array)(float* dst, const float* a, const float* b, size_t count);
+		///<summary>dst[i] = a * b[i], dst may be b</summary>
+		void (*mat4_mul_left)(float* dst, const float* a, const float* b, size_t count);
+		///<summary>
+		/// Accumulates a transform hierarchy: world[i] = world[parent[i]] * local[i], or local[i] for parent[i] &lt; 0.
+		/// The nodes have to be in topological order (parent[i] &lt; i), world may be local.
+		///</summary>
+		void (*mat4_hierarchy)(float* world, const float* local, const int32* parent, size_t count);
+		///<summary>
+		/// Transforms count points given as three planes (x, y, z) by an affine matrix, w is taken to be 1.
+		/// dst may be src.
+		///</summary>
+		void (*transform_points)(float* const* dst, const float* m, const float* const* src, size_t count);
+		///<summary>Reverses the byte order of count 16/32/64 bit values, dst may be src</summary>
+		void (*bswap16)(void* dst, const void* src, size_t count);
+		void (*bswap32)(void* dst, const void* src, size_t count);
+		void (*bswap64)(void* dst, const void* src, size_t count);
+		///<summary>
+		/// Conversions of the compact types of quantized.h (half, unorm8, unorm16, snorm16, 16.16 fixed point) from and to float.
+		/// Rounding is to nearest even, out of range values saturate.
+		///</summary>
+		void (*half_to_float)(float* dst, const uint16* src, size_t count);
+		void (*float_to_half)(uint16* dst, const float* src, size_t count);
+		void (*unorm8_to_float)(float* dst, const uint8* src, size_t count);
+		void (*float_to_unorm8)(uint8* dst, const float* src, size_t count);
+		void (*unorm16_to_float)(float* dst, const uint16* src, size_t count);
+		void (*float_to_unorm16)(uint16* dst, const float* src, size_t count);
+		void (*snorm16_to_float)(float* dst, const int16* src, size_t count);
+		void (*float_to_snorm16)(int16* dst, const float* src, size_t count);
+		void (*fixed_to_float)(float* dst, const int32* src, size_t count);
+		void (*float_to_fixed)(int32* dst, const float* src, size_t count);
+		///<summary>
+		/// Frustum culling of count boxes given as six planes (center x, y, z, half extent x, y, z) against six planes
+		/// (a, b, c, d, 24 floats, normals pointing inwards). Writes the indices of the boxes not entirely outside of a plane
+		/// to visible in ascending order and returns their amount.
+		///</summary>
+		size_t (*cull_boxes)(uint32* visible, const float* planes, const float* const* boxes, size_t count);
+		///<summary>As cull_boxes for spheres given as four planes (center x, y, z, radius)</summary>
+		size_t (*cull_spheres)(uint32* visible, const float* planes, const float* const* spheres, size_t count);
+
+		///<summary>The instruction set the kernels were bound for</summary>
+		Isa isa;
+	};
+
+	struct Cpu {
+		///<summary>
+		/// The active kernels. They are bound to the scalar variants until init() is called, therefore they may be used at any time.
+		///</summary>
+		static CpuKernels kernels;
+
+		///<summary>
+		/// Detects the cpu features and binds the kernels to the best supported instruction set.
+		/// The environment variable AXH_ISA (scalar, sse42, avx2, avx512) caps the instruction set for benchmarking.
+		/// The chosen variants are reported on CHANNEL_GENERAL_DEBUG.
+		///</summary>
+		static void init();
+
+		///<summary>
+		/// Binds the kernels to the given instruction set, meant for benchmarking.
+		/// Returns false and keeps the current binding if the cpu does not support it.
+		///</summary>
+		static bool forceIsa(Isa isa);
+
+		///<summary>Returns the features of the cpu the program is running on</summary>
+		static const CpuFeatures& getFeatures();
+
+		///<summary>Returns the best instruction set supported by the cpu (and this build)</summary>
+		static Isa getSupportedIsa();
+
+		static const char* getIsaName(Isa isa);
+
+	private:
+		static void _bind(Isa isa);
+	};
+
+	//Declarations of the kernel variants, each namespace is implemented in its own translation unit compiled for the instruction set
+#define __CPU_KERNEL_DECLARATIONS \
+		void mat4_mul(float* dst, const float* a, const float* b); \
+		void mat4_mul_array(float* dst, const float* a, const float* b, size_t count); \
+		void mat4_mul_left(float* dst, const float* a, const float* b, size_t count); \
+		void mat4_hierarchy(float* world, const float* local, const int32* parent, size_t count); \
+		void transform_points(float* const* dst, const float* m, const float* const* src, size_t count); \
+		void bswap16(void* dst, const void* src, size_t count); \
+		void bswap32(void* dst, const void* src, size_t count); \
+		void bswap64(void* dst, const void* src, size_t count); \
+		void half_to_float(float* dst, const uint16* src, size_t count); \
+		void float_to_half(uint16* dst, const float* src, size_t count); \
+		void unorm8_to_float(float* dst, const uint8* src, size_t count); \
+		void float_to_unorm8(uint8* dst, const float* src, size_t count); \
+		void unorm16_to_float(float* dst, const uint16* src, size_t count); \
+		void float_to_unorm16(uint16* dst, const float* src, size_t count); \
+		void snorm16_to_float(float* dst, const int16* src, size_t count); \
+		void float_to_snorm16(int16* dst, const float* src, size_t count); \
+		void fixed_to_float(float* dst, const int32* src, size_t count); \
+		void float_to_fixed(int32* dst, const float* src, size_t count); \
+		size_t cull_boxes(uint32* visible, const float* planes, const float* const* boxes, size_t count); \
+		size_t cull_spheres(uint32* visible, const float* planes, const float* const* spheres, size_t count);
+
+	namespace cpu_scalar { __CPU_KERNEL_DECLARATIONS }
+#ifdef __CPU_DISPATCH
+	namespace cpu_sse42 { __CPU_KERNEL_DECLARATIONS }
+	namespace cpu_avx2 { __CPU_KERNEL_DECLARATIONS }
+	namespace cpu_avx512 { __CPU_KERNEL_DECLARATIONS }
+#endif
+#undef __CPU_KERNEL_DECLARATIONS
+}
+
+#endif
@@ -0,0 +1,325 @@
+#include "cpu.h"
+
+#ifdef __CPU_DISPATCH
+#include <immintrin.h>
+#include <cstring>
+#include <bit>
+#include <limits>
+
+//This translation unit is compiled with AVX2, FMA and F16C enabled, its functions may only be called through Cpu::kernels
+
+using namespace Util;
+
+namespace {
+	///<summary>Computes two rows of a * b at once, each 128 bit lane holds one row</summary>
+	inline __m256 _mat4_rows(__m256 rows, const __m256* b) {
+		__m256 res = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x00), b[0]);
+		res = _mm256_fmadd_ps(_mm256_shuffle_ps(rows, rows, 0x55), b[1], res);
+		res = _mm256_fmadd_ps(_mm256_shuffle_ps(rows, rows, 0xAA), b[2], res);
+		return _mm256_fmadd_ps(_mm256_shuffle_ps(rows, rows, 0xFF), b[3], res);
+	}
+
+	inline void _mat4_mul(float* dst, const float* a, const float* b) {
+		const __m256 rb[4] = {
+			_mm256_broadcast_ps(reinterpret_cast<const __m128*>(b)),
+			_mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 4)),
+			_mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 8)),
+			_mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 12))
+		};
+		const __m256 r01 = _mat4_rows(_mm256_loadu_ps(a), rb);
+		const __m256 r23 = _mat4_rows(_mm256_loadu_ps(a + 8), rb);
+		_mm256_storeu_ps(dst, r01);
+		_mm256_storeu_ps(dst + 8, r23);
+	}
+
+	///<summary>Clamps eight floats to [lo, 1], scales them and rounds to the nearest integer (ties to even)</summary>
+	inline __m256i _quantize(const float* src, float lo, float scale) {
+		const __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src), _mm256_set1_ps(lo)), _mm256_set1_ps(1.f));
+		return _mm256_cvtps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(scale)));
+	}
+
+	///<summary>Packs eight 32 bit integers to 16 bit with signed or unsigned saturation</summary>
+	inline __m128i _pack(__m256i v, bool sign) {
+		const __m128i lo = _mm256_castsi256_si128(v);
+		const __m128i hi = _mm256_extracti128_si256(v, 1);
+		return sign ? _mm_packs_epi32(lo, hi) : _mm_packus_epi32(lo, hi);
+	}
+
+	inline void _swapBytes(void* dst, const void* src, size_t bytes, __m256i mask) {
+		const uint8* s = static_cast<const uint8*>(src);
+		uint8* d = static_cast<uint8*>(dst);
+		for (size_t i = 0; i + 32 <= bytes; i += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), _mm256_shuffle_epi8(v, mask));
+		}
+	}
+
+	///<summary>Appends the indices of the lanes set in mask</summary>
+	inline size_t _compact(uint32* visible, size_t count, uint32 base, uint32 mask) {
+		while (mask) {
+			visible[count++] = base + uint32(std::countr_zero(mask));
+			mask &= mask - 1;
+		}
+		return count;
+	}
+
+	///<summary>Adds base to the count indices a kernel wrote for the elements after the vector loop</summary>
+	inline size_t _rebase(uint32* visible, size_t count, uint32 base) {
+		for (size_t t = 0; t < count; ++t) {
+			visible[t] += base;
+		}
+		return count;
+	}
+}
+
+void cpu_avx2::mat4_mul(float* dst, const float* a, const float* b) {
+	_mat4_mul(dst, a, b);
+}
+
+void cpu_avx2::mat4_mul_array(float* dst, const float* a, const float* b, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		_mat4_mul(dst + 16 * i, a + 16 * i, b + 16 * i);
+	}
+}
+
+void cpu_avx2::mat4_mul_left(float* dst, const float* a, const float* b, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		_mat4_mul(dst + 16 * i, a, b + 16 * i);
+	}
+}
+
+void cpu_avx2::mat4_hierarchy(float* world, const float* local, const int32* parent, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		if (parent[i] < 0) {
+			std::memmove(world + 16 * i, local + 16 * i, 16 * sizeof(float));
+		}
+		else {
+			_mat4_mul(world + 16 * i, world + 16 * size_t(parent[i]), local + 16 * i);
+		}
+	}
+}
+
+void cpu_avx2::transform_points(float* const* dst, const float* m, const float* const* src, size_t count) {
+	__m256 mat[12];
+	for (size_t t = 0; t < 12; ++t) {
+		mat[t] = _mm256_set1_ps(m[t]);
+	}
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256 x = _mm256_loadu_ps(src[0] + i);
+		const __m256 y = _mm256_loadu_ps(src[1] + i);
+		const __m256 z = _mm256_loadu_ps(src[2] + i);
+		__m256 res[3];
+		for (size_t r = 0; r < 3; ++r) {
+			res[r] = _mm256_fmadd_ps(mat[r * 4], x, mat[r * 4 + 3]);
+			res[r] = _mm256_fmadd_ps(mat[r * 4 + 1], y, res[r]);
+			res[r] = _mm256_fmadd_ps(mat[r * 4 + 2], z, res[r]);
+		}
+		for (size_t r = 0; r < 3; ++r) {
+			_mm256_storeu_ps(dst[r] + i, res[r]);
+		}
+	}
+	if (i < count) {
+		float* const dtail[3] = { dst[0] + i, dst[1] + i, dst[2] + i };
+		const float* const stail[3] = { src[0] + i, src[1] + i, src[2] + i };
+		cpu_sse42::transform_points(dtail, m, stail, count - i);
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx2::bswap16(void* dst, const void* src, size_t count) {
+	const size_t vec = count / 16 * 16;
+	_swapBytes(dst, src, vec * 2, _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+	_mm256_zeroupper();
+	cpu_sse42::bswap16(static_cast<uint8*>(dst) + vec * 2, static_cast<const uint8*>(src) + vec * 2, count - vec);
+}
+
+void cpu_avx2::bswap32(void* dst, const void* src, size_t count) {
+	const size_t vec = count / 8 * 8;
+	_swapBytes(dst, src, vec * 4, _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+	_mm256_zeroupper();
+	cpu_sse42::bswap32(static_cast<uint8*>(dst) + vec * 4, static_cast<const uint8*>(src) + vec * 4, count - vec);
+}
+
+void cpu_avx2::bswap64(void* dst, const void* src, size_t count) {
+	const size_t vec = count / 4 * 4;
+	_swapBytes(dst, src, vec * 8, _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+	_mm256_zeroupper();
+	cpu_sse42::bswap64(static_cast<uint8*>(dst) + vec * 8, static_cast<const uint8*>(src) + vec * 8, count - vec);
+}
+
+void cpu_avx2::half_to_float(float* dst, const uint16* src, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+	}
+	_mm256_zeroupper();
+	cpu_scalar::half_to_float(dst + i, src + i, count - i);
+}
+
+void cpu_avx2::float_to_half(uint16* dst, const float* src, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m128i v = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+	}
+	_mm256_zeroupper();
+	cpu_scalar::float_to_half(dst + i, src + i, count - i);
+}
+
+void cpu_avx2::unorm8_to_float(float* dst, const uint8* src, size_t count) {
+	const __m256 scale = _mm256_set1_ps(255.f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+		_mm256_storeu_ps(dst + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), scale));
+	}
+	_mm256_zeroupper();
+	cpu_sse42::unorm8_to_float(dst + i, src + i, count - i);
+}
+
+void cpu_avx2::float_to_unorm8(uint8* dst, const float* src, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m128i v = _pack(_quantize(src + i, 0.f, 255.f), false);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(v, v));
+	}
+	_mm256_zeroupper();
+	cpu_sse42::float_to_unorm8(dst + i, src + i, count - i);
+}
+
+void cpu_avx2::unorm16_to_float(float* dst, const uint16* src, size_t count) {
+	const __m256 scale = _mm256_set1_ps(65535.f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+		_mm256_storeu_ps(dst + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), scale));
+	}
+	_mm256_zeroupper();
+	cpu_sse42::unorm16_to_float(dst + i, src + i, count - i);
+}
+
+void cpu_avx2::float_to_unorm16(uint16* dst, const float* src, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _pack(_quantize(src + i, 0.f, 65535.f), false));
+	}
+	_mm256_zeroupper();
+	cpu_sse42::float_to_unorm16(dst + i, src + i, count - i);
+}
+
+void cpu_avx2::snorm16_to_float(float* dst, const int16* src, size_t count) {
+	const __m256 scale = _mm256_set1_ps(32767.f);
+	const __m256 lowest = _mm256_set1_ps(-1.f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+		_mm256_storeu_ps(dst + i, _mm256_max_ps(_mm256_div_ps(_mm256_cvtepi32_ps(v), scale), lowest));
+	}
+	_mm256_zeroupper();
+	cpu_sse42::snorm16_to_float(dst + i, src + i, count - i);
+}
+
+void cpu_avx2::float_to_snorm16(int16* dst, const float* src, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _pack(_quantize(src + i, -1.f, 32767.f), true));
+	}
+	_mm256_zeroupper();
+	cpu_sse42::float_to_snorm16(dst + i, src + i, count - i);
+}
+
+void cpu_avx2::fixed_to_float(float* dst, const int32* src, size_t count) {
+	const __m256 scale = _mm256_set1_ps(1.f / 65536.f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+	}
+	_mm256_zeroupper();
+	cpu_sse42::fixed_to_float(dst + i, src + i, count - i);
+}
+
+void cpu_avx2::float_to_fixed(int32* dst, const float* src, size_t count) {
+	const __m256 scale = _mm256_set1_ps(65536.f);
+	const __m256 lo = _mm256_set1_ps(-2147483648.f);
+	const __m256 hi = _mm256_set1_ps(2147483520.f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), lo), hi);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtps_epi32(v));
+	}
+	_mm256_zeroupper();
+	cpu_sse42::float_to_fixed(dst + i, src + i, count - i);
+}
+
+size_t cpu_avx2::cull_boxes(uint32* visible, const float* planes, const float* const* boxes, size_t count) {
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256 n[6][4], a[6][3];
+	for (size_t p = 0; p < 6; ++p) {
+		for (size_t c = 0; c < 4; ++c) {
+			n[p][c] = _mm256_set1_ps(planes[p * 4 + c]);
+		}
+		for (size_t c = 0; c < 3; ++c) {
+			a[p][c] = _mm256_and_ps(n[p][c], absMask);
+		}
+	}
+	size_t res = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 b[6];
+		for (size_t k = 0; k < 6; ++k) {
+			b[k] = _mm256_loadu_ps(boxes[k] + i);
+		}
+		__m256 m = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+		for (size_t p = 0; p < 6; ++p) {
+			__m256 dist = _mm256_fmadd_ps(n[p][0], b[0], n[p][3]);
+			dist = _mm256_fmadd_ps(n[p][1], b[1], dist);
+			dist = _mm256_fmadd_ps(n[p][2], b[2], dist);
+			dist = _mm256_fmadd_ps(a[p][0], b[3], dist);
+			dist = _mm256_fmadd_ps(a[p][1], b[4], dist);
+			dist = _mm256_fmadd_ps(a[p][2], b[5], dist);
+			m = _mm256_min_ps(m, dist);
+		}
+		res = _compact(visible, res, uint32(i), ~uint32(_mm256_movemask_ps(m)) & 0xFFu);
+	}
+	if (i < count) {
+		const float* const tail[6] = { boxes[0] + i, boxes[1] + i, boxes[2] + i, boxes[3] + i, boxes[4] + i, boxes[5] + i };
+		res += _rebase(visible + res, cpu_sse42::cull_boxes(visible + res, planes, tail, count - i), uint32(i));
+	}
+	_mm256_zeroupper();
+	return res;
+}
+
+size_t cpu_avx2::cull_spheres(uint32* visible, const float* planes, const float* const* spheres, size_t count) {
+	__m256 n[6][4];
+	for (size_t p = 0; p < 6; ++p) {
+		for (size_t c = 0; c < 4; ++c) {
+			n[p][c] = _mm256_set1_ps(planes[p * 4 + c]);
+		}
+	}
+	size_t res = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256 x = _mm256_loadu_ps(spheres[0] + i);
+		const __m256 y = _mm256_loadu_ps(spheres[1] + i);
+		const __m256 z = _mm256_loadu_ps(spheres[2] + i);
+		const __m256 r = _mm256_loadu_ps(spheres[3] + i);
+		__m256 m = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+		for (size_t p = 0; p < 6; ++p) {
+			__m256 dist = _mm256_fmadd_ps(n[p][0], x, _mm256_add_ps(n[p][3], r));
+			dist = _mm256_fmadd_ps(n[p][1], y, dist);
+			dist = _mm256_fmadd_ps(n[p][2], z, dist);
+			m = _mm256_min_ps(m, dist);
+		}
+		res = _compact(visible, res, uint32(i), ~uint32(_mm256_movemask_ps(m)) & 0xFFu);
+	}
+	if (i < count) {
+		const float* const tail[4] = { spheres[0] + i, spheres[1] + i, spheres[2] + i, spheres[3] + i };
+		res += _rebase(visible + res, cpu_sse42::cull_spheres(visible + res, planes, tail, count - i), uint32(i));
+	}
+	_mm256_zeroupper();
+	return res;
+}
+
+#endif
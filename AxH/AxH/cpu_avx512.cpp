@@ -0,0 +1,285 @@
+#include "cpu.h"
+
+#ifdef __CPU_DISPATCH
+#include <immintrin.h>
+#include <cstring>
+#include <bit>
+#include <limits>
+
+//This translation unit is compiled with AVX-512 (F, BW, DQ, VL) enabled, its functions may only be called through Cpu::kernels
+
+using namespace Util;
+
+namespace {
+	///<summary>Computes all four rows of a * b at once, each 128 bit lane holds one row</summary>
+	inline void _mat4_mul(float* dst, const float* a, const float* b) {
+		const __m512 rows = _mm512_loadu_ps(a);
+		__m512 res = _mm512_mul_ps(_mm512_permute_ps(rows, 0x00), _mm512_broadcast_f32x4(_mm_loadu_ps(b)));
+		res = _mm512_fmadd_ps(_mm512_permute_ps(rows, 0x55), _mm512_broadcast_f32x4(_mm_loadu_ps(b + 4)), res);
+		res = _mm512_fmadd_ps(_mm512_permute_ps(rows, 0xAA), _mm512_broadcast_f32x4(_mm_loadu_ps(b + 8)), res);
+		res = _mm512_fmadd_ps(_mm512_permute_ps(rows, 0xFF), _mm512_broadcast_f32x4(_mm_loadu_ps(b + 12)), res);
+		_mm512_storeu_ps(dst, res);
+	}
+
+	///<summary>The tail is handled with masked loads and stores</summary>
+	inline void _swapBytes(void* dst, const void* src, size_t bytes, __m512i mask) {
+		const uint8* s = static_cast<const uint8*>(src);
+		uint8* d = static_cast<uint8*>(dst);
+		size_t i = 0;
+		for (; i + 64 <= bytes; i += 64) {
+			__m512i v = _mm512_loadu_si512(s + i);
+			_mm512_storeu_si512(d + i, _mm512_shuffle_epi8(v, mask));
+		}
+		if (i < bytes) {
+			const __mmask64 m = _cvtu64_mask64((~uint64(0)) >> (64 - (bytes - i)));
+			__m512i v = _mm512_maskz_loadu_epi8(m, s + i);
+			_mm512_mask_storeu_epi8(d + i, m, _mm512_shuffle_epi8(v, mask));
+		}
+		_mm256_zeroupper();
+	}
+
+	inline __m512i _lanes(__m128i mask) {
+		return _mm512_broadcast_i32x4(mask);
+	}
+
+	///<returns>The mask of the lanes of a 16 element step with remaining elements left</returns>
+	inline __mmask16 _tail(size_t remaining) {
+		return remaining >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << remaining) - 1);
+	}
+
+	///<summary>Clamps the floats to [lo, 1], scales them and rounds to the nearest integer (ties to even)</summary>
+	inline __m512i _quantize(__mmask16 mask, const float* src, float lo, float scale) {
+		const __m512 v = _mm512_min_ps(_mm512_max_ps(_mm512_maskz_loadu_ps(mask, src), _mm512_set1_ps(lo)), _mm512_set1_ps(1.f));
+		return _mm512_cvtps_epi32(_mm512_mul_ps(v, _mm512_set1_ps(scale)));
+	}
+
+	///<summary>Appends the indices of the lanes set in mask</summary>
+	inline size_t _compact(uint32* visible, size_t count, uint32 base, uint32 mask) {
+		while (mask) {
+			visible[count++] = base + uint32(std::countr_zero(mask));
+			mask &= mask - 1;
+		}
+		return count;
+	}
+}
+
+void cpu_avx512::mat4_mul(float* dst, const float* a, const float* b) {
+	_mat4_mul(dst, a, b);
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::mat4_mul_array(float* dst, const float* a, const float* b, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		_mat4_mul(dst + 16 * i, a + 16 * i, b + 16 * i);
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::mat4_mul_left(float* dst, const float* a, const float* b, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		_mat4_mul(dst + 16 * i, a, b + 16 * i);
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::mat4_hierarchy(float* world, const float* local, const int32* parent, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		if (parent[i] < 0) {
+			std::memmove(world + 16 * i, local + 16 * i, 16 * sizeof(float));
+		}
+		else {
+			_mat4_mul(world + 16 * i, world + 16 * size_t(parent[i]), local + 16 * i);
+		}
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::transform_points(float* const* dst, const float* m, const float* const* src, size_t count) {
+	__m512 mat[12];
+	for (size_t t = 0; t < 12; ++t) {
+		mat[t] = _mm512_set1_ps(m[t]);
+	}
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = count - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (count - i)) - 1);
+		const __m512 x = _mm512_maskz_loadu_ps(mask, src[0] + i);
+		const __m512 y = _mm512_maskz_loadu_ps(mask, src[1] + i);
+		const __m512 z = _mm512_maskz_loadu_ps(mask, src[2] + i);
+		__m512 res[3];
+		for (size_t r = 0; r < 3; ++r) {
+			res[r] = _mm512_fmadd_ps(mat[r * 4], x, mat[r * 4 + 3]);
+			res[r] = _mm512_fmadd_ps(mat[r * 4 + 1], y, res[r]);
+			res[r] = _mm512_fmadd_ps(mat[r * 4 + 2], z, res[r]);
+		}
+		for (size_t r = 0; r < 3; ++r) {
+			_mm512_mask_storeu_ps(dst[r] + i, mask, res[r]);
+		}
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::bswap16(void* dst, const void* src, size_t count) {
+	_swapBytes(dst, src, count * 2, _lanes(_mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)));
+}
+
+void cpu_avx512::bswap32(void* dst, const void* src, size_t count) {
+	_swapBytes(dst, src, count * 4, _lanes(_mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)));
+}
+
+void cpu_avx512::bswap64(void* dst, const void* src, size_t count) {
+	_swapBytes(dst, src, count * 8, _lanes(_mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8)));
+}
+
+void cpu_avx512::half_to_float(float* dst, const uint16* src, size_t count) {
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		_mm512_mask_storeu_ps(dst + i, mask, _mm512_cvtph_ps(_mm256_maskz_loadu_epi16(mask, src + i)));
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::float_to_half(uint16* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		const __m256i v = _mm512_cvtps_ph(_mm512_maskz_loadu_ps(mask, src + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm256_mask_storeu_epi16(dst + i, mask, v);
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::unorm8_to_float(float* dst, const uint8* src, size_t count) {
+	const __m512 scale = _mm512_set1_ps(255.f);
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		const __m512i v = _mm512_cvtepu8_epi32(_mm_maskz_loadu_epi8(mask, src + i));
+		_mm512_mask_storeu_ps(dst + i, mask, _mm512_div_ps(_mm512_cvtepi32_ps(v), scale));
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::float_to_unorm8(uint8* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		_mm512_mask_cvtusepi32_storeu_epi8(dst + i, mask, _quantize(mask, src + i, 0.f, 255.f));
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::unorm16_to_float(float* dst, const uint16* src, size_t count) {
+	const __m512 scale = _mm512_set1_ps(65535.f);
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		const __m512i v = _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(mask, src + i));
+		_mm512_mask_storeu_ps(dst + i, mask, _mm512_div_ps(_mm512_cvtepi32_ps(v), scale));
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::float_to_unorm16(uint16* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		_mm512_mask_cvtusepi32_storeu_epi16(dst + i, mask, _quantize(mask, src + i, 0.f, 65535.f));
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::snorm16_to_float(float* dst, const int16* src, size_t count) {
+	const __m512 scale = _mm512_set1_ps(32767.f);
+	const __m512 lowest = _mm512_set1_ps(-1.f);
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		const __m512i v = _mm512_cvtepi16_epi32(_mm256_maskz_loadu_epi16(mask, src + i));
+		_mm512_mask_storeu_ps(dst + i, mask, _mm512_max_ps(_mm512_div_ps(_mm512_cvtepi32_ps(v), scale), lowest));
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::float_to_snorm16(int16* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		_mm512_mask_cvtsepi32_storeu_epi16(dst + i, mask, _quantize(mask, src + i, -1.f, 32767.f));
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::fixed_to_float(float* dst, const int32* src, size_t count) {
+	const __m512 scale = _mm512_set1_ps(1.f / 65536.f);
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		_mm512_mask_storeu_ps(dst + i, mask, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_maskz_loadu_epi32(mask, src + i)), scale));
+	}
+	_mm256_zeroupper();
+}
+
+void cpu_avx512::float_to_fixed(int32* dst, const float* src, size_t count) {
+	const __m512 scale = _mm512_set1_ps(65536.f);
+	const __m512 lo = _mm512_set1_ps(-2147483648.f);
+	const __m512 hi = _mm512_set1_ps(2147483520.f);
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		const __m512 v = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(_mm512_maskz_loadu_ps(mask, src + i), scale), lo), hi);
+		_mm512_mask_storeu_epi32(dst + i, mask, _mm512_cvtps_epi32(v));
+	}
+	_mm256_zeroupper();
+}
+
+size_t cpu_avx512::cull_boxes(uint32* visible, const float* planes, const float* const* boxes, size_t count) {
+	__m512 n[6][4], a[6][3];
+	for (size_t p = 0; p < 6; ++p) {
+		for (size_t c = 0; c < 4; ++c) {
+			n[p][c] = _mm512_set1_ps(planes[p * 4 + c]);
+		}
+		for (size_t c = 0; c < 3; ++c) {
+			a[p][c] = _mm512_abs_ps(n[p][c]);
+		}
+	}
+	size_t res = 0;
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		__m512 b[6];
+		for (size_t k = 0; k < 6; ++k) {
+			b[k] = _mm512_maskz_loadu_ps(mask, boxes[k] + i);
+		}
+		__m512 m = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+		for (size_t p = 0; p < 6; ++p) {
+			__m512 dist = _mm512_fmadd_ps(n[p][0], b[0], n[p][3]);
+			dist = _mm512_fmadd_ps(n[p][1], b[1], dist);
+			dist = _mm512_fmadd_ps(n[p][2], b[2], dist);
+			dist = _mm512_fmadd_ps(a[p][0], b[3], dist);
+			dist = _mm512_fmadd_ps(a[p][1], b[4], dist);
+			dist = _mm512_fmadd_ps(a[p][2], b[5], dist);
+			m = _mm512_min_ps(m, dist);
+		}
+		res = _compact(visible, res, uint32(i), uint32(mask) & ~uint32(_mm512_movepi32_mask(_mm512_castps_si512(m))));
+	}
+	_mm256_zeroupper();
+	return res;
+}
+
+size_t cpu_avx512::cull_spheres(uint32* visible, const float* planes, const float* const* spheres, size_t count) {
+	__m512 n[6][4];
+	for (size_t p = 0; p < 6; ++p) {
+		for (size_t c = 0; c < 4; ++c) {
+			n[p][c] = _mm512_set1_ps(planes[p * 4 + c]);
+		}
+	}
+	size_t res = 0;
+	for (size_t i = 0; i < count; i += 16) {
+		const __mmask16 mask = _tail(count - i);
+		const __m512 x = _mm512_maskz_loadu_ps(mask, spheres[0] + i);
+		const __m512 y = _mm512_maskz_loadu_ps(mask, spheres[1] + i);
+		const __m512 z = _mm512_maskz_loadu_ps(mask, spheres[2] + i);
+		const __m512 r = _mm512_maskz_loadu_ps(mask, spheres[3] + i);
+		__m512 m = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+		for (size_t p = 0; p < 6; ++p) {
+			__m512 dist = _mm512_fmadd_ps(n[p][0], x, _mm512_add_ps(n[p][3], r));
+			dist = _mm512_fmadd_ps(n[p][1], y, dist);
+			dist = _mm512_fmadd_ps(n[p][2], z, dist);
+			m = _mm512_min_ps(m, dist);
+		}
+		res = _compact(visible, res, uint32(i), uint32(mask) & ~uint32(_mm512_movepi32_mask(_mm512_castps_si512(m))));
+	}
+	_mm256_zeroupper();
+	return res;
+}
+
+#endif
@@ -0,0 +1,475 @@
+#ifndef __H_DMATRIX
+#define __H_DMATRIX
+
+#include <new>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "simd.h"
+#include "parallel.h"
+
+namespace math {
+
+	enum class matrix_layout {
+		row_major,
+		col_major
+	};
+
+	template<typename T>
+	/// <summary>
+	/// Reference to a runtime sized, strided one dimensional array, e.g. a row or column of a dmatrix
+	/// </summary>
+	class dvector_ref {
+	public:
+		dvector_ref(T* base, size_t size, ptrdiff_t stride = 1) : ptr(base), _size(size), _stride(stride) { }
+
+		operator dvector_ref<const T>() const {
+			return dvector_ref<const T>(ptr, _size, _stride);
+		}
+
+		T& operator[](size_t ind) const {
+			MATH_BOUNDS_CHECK(ind < _size);
+			return ptr[ptrdiff_t(ind) * _stride];
+		}
+
+		size_t size() const { return _size; }
+		ptrdiff_t stride() const { return _stride; }
+		T* data() const { return ptr; }
+
+	private:
+		T* ptr;
+		size_t _size;
+		ptrdiff_t _stride;
+	};
+
+	template<typename T>
+	/// <summary>
+	/// Reference to a runtime sized two dimensional array with arbitrary row and column strides.
+	/// Row major, column major, transposed and sub block views are all expressed by the strides, the reference does not own the elements.
+	/// </summary>
+	class dmatrix_ref {
+	public:
+		dmatrix_ref(T* base, size_t rows, size_t cols, ptrdiff_t rowStride, ptrdiff_t colStride)
+			: ptr(base), _rows(rows), _cols(cols), rs(rowStride), cs(colStride) { }
+
+		operator dmatrix_ref<const T>() const {
+			return dmatrix_ref<const T>(ptr, _rows, _cols, rs, cs);
+		}
+
+		T& operator()(size_t r, size_t c) const {
+			MATH_BOUNDS_CHECK(r < _rows && c < _cols);
+			return ptr[ptrdiff_t(r) * rs + ptrdiff_t(c) * cs];
+		}
+
+		///<returns>The row with the given index, analogous to comp_ref::operator[]</returns>
+		dvector_ref<T> operator[](size_t r) const {
+			return row(r);
+		}
+
+		dvector_ref<T> row(size_t r) const {
+			MATH_BOUNDS_CHECK(r < _rows);
+			return dvector_ref<T>(ptr + ptrdiff_t(r) * rs, _cols, cs);
+		}
+		dvector_ref<T> col(size_t c) const {
+			MATH_BOUNDS_CHECK(c < _cols);
+			return dvector_ref<T>(ptr + ptrdiff_t(c) * cs, _rows, rs);
+		}
+
+		///<returns>A view of the rows x cols block starting at (r, c)</returns>
+		dmatrix_ref block(size_t r, size_t c, size_t rows, size_t cols) const {
+			MATH_BOUNDS_CHECK(r + rows <= _rows && c + cols <= _cols);
+			return dmatrix_ref(ptr + ptrdiff_t(r) * rs + ptrdiff_t(c) * cs, rows, cols, rs, cs);
+		}
+
+		///<returns>A transposed view of the same elements</returns>
+		dmatrix_ref transpose() const {
+			return dmatrix_ref(ptr, _cols, _rows, cs, rs);
+		}
+
+		size_t rows() const { return _rows; }
+		size_t cols() const { return _cols; }
+		ptrdiff_t row_stride() const { return rs; }
+		ptrdiff_t col_stride() const { return cs; }
+		T* data() const { return ptr; }
+
+	private:
+		T* ptr;
+		size_t _rows;
+		size_t _cols;
+		ptrdiff_t rs;
+		ptrdiff_t cs;
+	};
+
+	template<math_type T>
+	/// <summary>
+	/// Heap allocated matrix with runtime extents. The storage is aligned to simd::batch_alignment and
+	/// the leading dimension is padded to a multiple of it, so every row (row major) or column (column major) starts aligned.
+	/// The kernels take the elements through ref(), a dmatrix_ref which does not own them; the matrix itself is not a dmatrix_ref,
+	/// so nothing can replace its storage through one.
+	/// </summary>
+	class dmatrix {
+	public:
+		dmatrix() : _ref(nullptr, 0, 0, 0, 1) { }
+		///<summary>
+		/// Creates a rows x cols matrix, the elements are zero
+		///</summary>
+		dmatrix(size_t rows, size_t cols, matrix_layout layout = matrix_layout::row_major);
+		dmatrix(const dmatrix& ref);
+		dmatrix(dmatrix&& ref) noexcept;
+		~dmatrix();
+
+		dmatrix& operator=(const dmatrix& ref);
+		dmatrix& operator=(dmatrix&& ref) noexcept;
+
+		///<returns>A view of the elements, valid until the matrix is assigned to, moved from or destroyed</returns>
+		dmatrix_ref<T> ref() { return _ref; }
+		dmatrix_ref<const T> ref() const { return _ref; }
+		operator dmatrix_ref<T>() { return _ref; }
+		operator dmatrix_ref<const T>() const { return _ref; }
+
+		T& operator()(size_t r, size_t c) { return _ref(r, c); }
+		const T& operator()(size_t r, size_t c) const { return _ref(r, c); }
+		dvector_ref<T> operator[](size_t r) { return _ref.row(r); }
+		dvector_ref<const T> operator[](size_t r) const { return ref().row(r); }
+		dvector_ref<T> row(size_t r) { return _ref.row(r); }
+		dvector_ref<const T> row(size_t r) const { return ref().row(r); }
+		dvector_ref<T> col(size_t c) { return _ref.col(c); }
+		dvector_ref<const T> col(size_t c) const { return ref().col(c); }
+
+		size_t rows() const { return _ref.rows(); }
+		size_t cols() const { return _ref.cols(); }
+		ptrdiff_t row_stride() const { return _ref.row_stride(); }
+		ptrdiff_t col_stride() const { return _ref.col_stride(); }
+		T* data() { return _ref.data(); }
+		const T* data() const { return _ref.data(); }
+
+		matrix_layout layout() const { return _layout; }
+		///<returns>The distance between two rows (row major) or columns (column major)</returns>
+		size_t leading_dimension() const { return ld; }
+
+	private:
+		dmatrix_ref<T> _ref;
+		matrix_layout _layout = matrix_layout::row_major;
+		size_t ld = 0;
+
+		static constexpr size_t _lanes = simd::batch_alignment / sizeof(T) > 0 ? simd::batch_alignment / sizeof(T) : 1;
+
+		size_t _count() const {
+			return ld * (_layout == matrix_layout::row_major ? rows() : cols());
+		}
+	};
+
+	/// <summary>
+	/// Operations on dmatrix references. The products are cache blocked, vectorized with simd::float_pack (for float) and
+	/// split over the available hardware threads for large inputs.
+	/// </summary>
+	struct dmatrix_math {
+		template<math_type T>
+		///<summary>
+		/// c = alpha * a * b + beta * c, c must not overlap a or b. With beta = 0 the previous content of c is ignored (even nan).
+		///</summary>
+		static void gemm(dmatrix_ref<T> c, dmatrix_ref<const T> a, dmatrix_ref<const T> b, T alpha = T(1), T beta = T(0));
+
+		template<math_type T>
+		///<summary>
+		/// y = alpha * a * x + beta * y, y must not overlap a or x
+		///</summary>
+		static void gemv(dvector_ref<T> y, dmatrix_ref<const T> a, dvector_ref<const T> x, T alpha = T(1), T beta = T(0));
+
+		template<math_type T>
+		///<returns>a * b in the layout of a</returns>
+		static dmatrix<T> multiply(const dmatrix<T>& a, const dmatrix<T>& b);
+
+	private:
+		template<typename T>
+		using pack = typename simd::pack_of<T>::type;
+
+		///<summary>Rows of the register tile</summary>
+		static constexpr size_t MR = 6;
+		///<summary>Depth of the packed panels</summary>
+		static constexpr size_t KC = 256;
+		///<summary>Rows of a packed panel of a, a multiple of MR</summary>
+		static constexpr size_t MC = 96;
+		///<summary>Columns of a packed panel of b</summary>
+		static constexpr size_t NC = 2048;
+		///<summary>Below this amount of multiply adds the products stay on the calling thread (see Util::parallel)</summary>
+		static constexpr size_t PARALLEL_THRESHOLD = 1 << 18;
+
+		template<typename T>
+		///<summary>Columns of the register tile, two packs</summary>
+		static constexpr size_t NR = 2 * pack<T>::width;
+
+		template<typename T>
+		struct _buffer {
+			T* ptr;
+			explicit _buffer(size_t count) : ptr(static_cast<T*>(::operator new(sizeof(T) * count, std::align_val_t(simd::batch_alignment)))) { }
+			~_buffer() { ::operator delete(ptr, std::align_val_t(simd::batch_alignment)); }
+			_buffer(const _buffer&) = delete;
+			_buffer& operator=(const _buffer&) = delete;
+		};
+
+		template<typename T>
+		static void _pack_a(T* dst, const dmatrix_ref<const T>& a, size_t i0, size_t mc, size_t k0, size_t kc);
+		template<typename T>
+		static void _pack_b(T* dst, const dmatrix_ref<const T>& b, size_t k0, size_t kc, size_t j0, size_t nc);
+		template<typename T>
+		static void _kernel(size_t kc, const T* a, const T* b, T* tile);
+	};
+
+//#######################################################################################################################
+
+	template<math_type T>
+	dmatrix<T>::dmatrix(size_t rows, size_t cols, matrix_layout layout) : _ref(nullptr, rows, cols, 0, 1), _layout(layout) {
+		const size_t inner = layout == matrix_layout::row_major ? cols : rows;
+		ld = (inner + _lanes - 1) / _lanes * _lanes;
+		T* ptr = nullptr;
+		if (_count() > 0) {
+			ptr = static_cast<T*>(::operator new(sizeof(T) * _count(), std::align_val_t(simd::batch_alignment)));
+			for (size_t t = 0; t < _count(); ++t) {
+				new (ptr + t) T();
+			}
+		}
+		if (layout == matrix_layout::row_major) {
+			_ref = dmatrix_ref<T>(ptr, rows, cols, ptrdiff_t(ld), 1);
+		}
+		else {
+			_ref = dmatrix_ref<T>(ptr, rows, cols, 1, ptrdiff_t(ld));
+		}
+	}
+
+	template<math_type T>
+	dmatrix<T>::dmatrix(const dmatrix& ref) : dmatrix(ref.rows(), ref.cols(), ref._layout) {
+		for (size_t t = 0; t < _count(); ++t) {
+			data()[t] = ref.data()[t];
+		}
+	}
+
+	template<math_type T>
+	dmatrix<T>::dmatrix(dmatrix&& ref) noexcept : dmatrix() {
+		*this = std::move(ref);
+	}
+
+	template<math_type T>
+	dmatrix<T>::~dmatrix() {
+		if (data()) {
+			//the elements were created with placement new
+			for (size_t t = 0; t < _count(); ++t) {
+				data()[t].~T();
+			}
+			::operator delete(data(), std::align_val_t(simd::batch_alignment));
+		}
+	}
+
+	template<math_type T>
+	dmatrix<T>& dmatrix<T>::operator=(const dmatrix& ref) {
+		if (this != &ref) {
+			dmatrix cpy(ref);
+			*this = std::move(cpy);
+		}
+		return *this;
+	}
+
+	template<math_type T>
+	dmatrix<T>& dmatrix<T>::operator=(dmatrix&& ref) noexcept {
+		std::swap(_ref, ref._ref);
+		std::swap(_layout, ref._layout);
+		std::swap(ld, ref.ld);
+		return *this;
+	}
+
+	template<typename T>
+	void dmatrix_math::_pack_a(T* dst, const dmatrix_ref<const T>& a, size_t i0, size_t mc, size_t k0, size_t kc) {
+		//slivers of MR rows, stored k major, the rows past the end are zero
+		for (size_t ir = 0; ir < mc; ir += MR) {
+			const size_t mr = std::min(MR, mc - ir);
+			for (size_t k = 0; k < kc; ++k) {
+				size_t i = 0;
+				for (; i < mr; ++i) {
+					dst[i] = a(i0 + ir + i, k0 + k);
+				}
+				for (; i < MR; ++i) {
+					dst[i] = T();
+				}
+				dst += MR;
+			}
+		}
+	}
+
+	template<typename T>
+	void dmatrix_math::_pack_b(T* dst, const dmatrix_ref<const T>& b, size_t k0, size_t kc, size_t j0, size_t nc) {
+		//slivers of NR columns, stored k major, the columns past the end are zero
+		constexpr size_t nr = NR<T>;
+		for (size_t jr = 0; jr < nc; jr += nr) {
+			const size_t w = std::min(nr, nc - jr);
+			for (size_t k = 0; k < kc; ++k) {
+				const T* src = b.data() + ptrdiff_t(k0 + k) * b.row_stride() + ptrdiff_t(j0 + jr) * b.col_stride();
+				size_t j = 0;
+				if (b.col_stride() == 1) {
+					std::memcpy(dst, src, sizeof(T) * w);
+					j = w;
+				}
+				for (; j < w; ++j) {
+					dst[j] = src[ptrdiff_t(j) * b.col_stride()];
+				}
+				for (; j < nr; ++j) {
+					dst[j] = T();
+				}
+				dst += nr;
+			}
+		}
+	}
+
+	template<typename T>
+	void dmatrix_math::_kernel(size_t kc, const T* a, const T* b, T* tile) {
+		using P = pack<T>;
+		constexpr size_t W = P::width;
+		P acc[MR][2];
+		for (size_t i = 0; i < MR; ++i) {
+			acc[i][0] = P::set1(T());
+			acc[i][1] = P::set1(T());
+		}
+		for (size_t k = 0; k < kc; ++k) {
+			const P b0 = P::load(b);
+			const P b1 = P::load(b + W);
+			for (size_t i = 0; i < MR; ++i) {
+				const P ai = P::set1(a[i]);
+				acc[i][0] = P::fmadd(ai, b0, acc[i][0]);
+				acc[i][1] = P::fmadd(ai, b1, acc[i][1]);
+			}
+			a += MR;
+			b += 2 * W;
+		}
+		for (size_t i = 0; i < MR; ++i) {
+			acc[i][0].store(tile + i * 2 * W);
+			acc[i][1].store(tile + i * 2 * W + W);
+		}
+	}
+
+	template<math_type T>
+	void dmatrix_math::gemm(dmatrix_ref<T> c, dmatrix_ref<const T> a, dmatrix_ref<const T> b, T alpha, T beta) {
+		ASSERT(a.cols() == b.rows() && c.rows() == a.rows() && c.cols() == b.cols(), "matrix extents do not match", CHANNEL_MATH);
+		const size_t M = c.rows();
+		const size_t N = c.cols();
+		const size_t K = a.cols();
+		if (M == 0 || N == 0) {
+			return;
+		}
+		if (K == 0) {
+			for (size_t i = 0; i < M; ++i) {
+				for (size_t j = 0; j < N; ++j) {
+					c(i, j) = beta == T() ? T() : beta * c(i, j);
+				}
+			}
+			return;
+		}
+		constexpr size_t nr = NR<T>;
+		const size_t ncMax = std::min(NC, (N + nr - 1) / nr * nr);
+		_buffer<T> bpack(ncMax * KC);
+
+		for (size_t j0 = 0; j0 < N; j0 += NC) {
+			const size_t nc = std::min(NC, N - j0);
+			for (size_t k0 = 0; k0 < K; k0 += KC) {
+				const size_t kc = std::min(KC, K - k0);
+				//the first panel applies beta, the following ones accumulate
+				const T bk = k0 == 0 ? beta : T(1);
+				_pack_b(bpack.ptr, b, k0, kc, j0, nc);
+
+				const size_t tasks = (M + MC - 1) / MC;
+				Util::parallel::run(tasks, M * nc * kc, PARALLEL_THRESHOLD, [&](size_t task) {
+					const size_t i0 = task * MC;
+					const size_t mc = std::min(MC, M - i0);
+					_buffer<T> apack(MC * KC);
+					alignas(simd::batch_alignment) T tile[MR * nr];
+					_pack_a(apack.ptr, a, i0, mc, k0, kc);
+					for (size_t jr = 0; jr < nc; jr += nr) {
+						const size_t w = std::min(nr, nc - jr);
+						for (size_t ir = 0; ir < mc; ir += MR) {
+							const size_t h = std::min(MR, mc - ir);
+							_kernel(kc, apack.ptr + ir * kc, bpack.ptr + jr * kc, tile);
+							for (size_t i = 0; i < h; ++i) {
+								T* dst = c.data() + ptrdiff_t(i0 + ir + i) * c.row_stride() + ptrdiff_t(j0 + jr) * c.col_stride();
+								for (size_t j = 0; j < w; ++j) {
+									T& cv = dst[ptrdiff_t(j) * c.col_stride()];
+									cv = (bk == T() ? T() : bk * cv) + alpha * tile[i * nr + j];
+								}
+							}
+						}
+					}
+				});
+			}
+		}
+	}
+
+	template<math_type T>
+	void dmatrix_math::gemv(dvector_ref<T> y, dmatrix_ref<const T> a, dvector_ref<const T> x, T alpha, T beta) {
+		ASSERT(a.cols() == x.size() && a.rows() == y.size(), "matrix extents do not match", CHANNEL_MATH);
+		using P = pack<T>;
+		constexpr size_t W = P::width;
+		const size_t M = a.rows();
+		const size_t K = a.cols();
+		if (a.col_stride() == 1 && x.stride() == 1) {
+			//rows are contiguous, one dot product per row
+			const size_t tasks = (M + MC - 1) / MC;
+			Util::parallel::run(tasks, M * K, PARALLEL_THRESHOLD, [&](size_t task) {
+				const size_t end = std::min(M, (task + 1) * MC);
+				for (size_t i = task * MC; i < end; ++i) {
+					const T* row = a.data() + ptrdiff_t(i) * a.row_stride();
+					P sum = P::set1(T());
+					size_t k = 0;
+					for (; k + W <= K; k += W) {
+						sum = P::fmadd(P::loadu(row + k), P::loadu(x.data() + k), sum);
+					}
+					alignas(simd::batch_alignment) T lanes[W];
+					sum.store(lanes);
+					T dot = T();
+					for (size_t l = 0; l < W; ++l) {
+						dot += lanes[l];
+					}
+					for (; k < K; ++k) {
+						dot += row[k] * x.data()[k];
+					}
+					y[i] = (beta == T() ? T() : beta * y[i]) + alpha * dot;
+				}
+			});
+		}
+		else {
+			//columns are contiguous (or nothing is), accumulate scaled columns
+			for (size_t i = 0; i < M; ++i) {
+				y[i] = beta == T() ? T() : beta * y[i];
+			}
+			for (size_t k = 0; k < K; ++k) {
+				const T s = alpha * x[k];
+				const T* col = a.data() + ptrdiff_t(k) * a.col_stride();
+				if (a.row_stride() == 1 && y.stride() == 1) {
+					const P ps = P::set1(s);
+					size_t i = 0;
+					for (; i + W <= M; i += W) {
+						P::fmadd(ps, P::loadu(col + i), P::loadu(y.data() + i)).storeu(y.data() + i);
+					}
+					for (; i < M; ++i) {
+						y.data()[i] += s * col[i];
+					}
+				}
+				else {
+					for (size_t i = 0; i < M; ++i) {
+						y[i] += s * col[ptrdiff_t(i) * a.row_stride()];
+					}
+				}
+			}
+		}
+	}
+
+	template<math_type T>
+	dmatrix<T> dmatrix_math::multiply(const dmatrix<T>& a, const dmatrix<T>& b) {
+		dmatrix<T> c(a.rows(), b.cols(), a.layout());
+		gemm<T>(c, a, b);
+		return c;
+	}
+}
+
+#endif
@@ -0,0 +1,307 @@
+#ifndef __H_ELEMENTWISE
+#define __H_ELEMENTWISE
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "simd.h"
+#include "parallel.h"
+
+namespace math {
+
+	/// <summary>
+	/// Whole array operations on contiguous elements, either given as pointer and count or as comp (and therefore vector and matrix).
+	/// The inner loops run on simd::pack_of&lt;T&gt;, arrays of at least PARALLEL_THRESHOLD elements are split over the hardware threads.
+	/// Functors taking auto are called with packs (float_pack, scalar_pack) and may only use their operations,
+	/// e.g. [](auto x) { return x * x; } or [](auto a, auto b) { return decltype(a)::max(a, b); }.
+	/// Functors taking T are called per element. dst may be one of the sources.
+	/// </summary>
+	struct array_math {
+		template<typename T, typename F>
+		///<summary>dst[i] = f(src[i])</summary>
+		static void map(T* dst, const T* src, size_t count, F f);
+
+		template<typename T, typename F>
+		///<summary>dst[i] = f(a[i], b[i])</summary>
+		static void zip(T* dst, const T* a, const T* b, size_t count, F f);
+
+		template<typename T>
+		///<summary>dst[i] = a[i] * b[i] + c[i]</summary>
+		static void fmadd(T* dst, const T* a, const T* b, const T* c, size_t count);
+
+		template<typename T>
+		///<summary>dst[i] = a[i] + (b[i] - a[i]) * t</summary>
+		static void lerp(T* dst, const T* a, const T* b, T t, size_t count);
+
+		template<typename T>
+		///<summary>dst[i] = min(max(src[i], lo), hi)</summary>
+		static void clamp(T* dst, const T* src, T lo, T hi, size_t count);
+
+		template<typename T, typename F>
+		///<summary>
+		/// Folds the elements with f, which has to be associative and commutative as the elements are combined in any order.
+		/// identity has to be the neutral element of f (0 for +), it is used to pad partial packs.
+		///</summary>
+		static T reduce(const T* src, size_t count, T identity, F f);
+
+		template<typename T>
+		static T sum(const T* src, size_t count);
+		template<typename T>
+		///<summary>The smallest element, count may not be 0. NaNs are skipped, the result is NaN only if all elements are</summary>
+		static T min(const T* src, size_t count);
+		template<typename T>
+		///<summary>The largest element, count may not be 0. NaNs are skipped, the result is NaN only if all elements are</summary>
+		static T max(const T* src, size_t count);
+		template<typename T>
+		///<returns>The index of the first smallest element, count may not be 0. NaNs are skipped, 0 if all elements are NaN</returns>
+		static size_t argmin(const T* src, size_t count);
+		template<typename T>
+		///<returns>The index of the first largest element, count may not be 0. NaNs are skipped, 0 if all elements are NaN</returns>
+		static size_t argmax(const T* src, size_t count);
+
+		template<typename T, size_t A, size_t... S, typename F>
+		static void map(comp<T, A, S...>& dst, const comp<T, A, S...>& src, F f) {
+			map(dst.data(), src.data(), _size<A, S...>(), f);
+		}
+		template<typename T, size_t A, size_t... S, typename F>
+		static void zip(comp<T, A, S...>& dst, const comp<T, A, S...>& a, const comp<T, A, S...>& b, F f) {
+			zip(dst.data(), a.data(), b.data(), _size<A, S...>(), f);
+		}
+		template<typename T, size_t A, size_t... S>
+		static void fmadd(comp<T, A, S...>& dst, const comp<T, A, S...>& a, const comp<T, A, S...>& b, const comp<T, A, S...>& c) {
+			fmadd(dst.data(), a.data(), b.data(), c.data(), _size<A, S...>());
+		}
+		template<typename T, size_t A, size_t... S>
+		static void lerp(comp<T, A, S...>& dst, const comp<T, A, S...>& a, const comp<T, A, S...>& b, T t) {
+			lerp(dst.data(), a.data(), b.data(), t, _size<A, S...>());
+		}
+		template<typename T, size_t A, size_t... S>
+		static void clamp(comp<T, A, S...>& dst, const comp<T, A, S...>& src, T lo, T hi) {
+			clamp(dst.data(), src.data(), lo, hi, _size<A, S...>());
+		}
+		template<typename T, size_t A, size_t... S, typename F>
+		static T reduce(const comp<T, A, S...>& src, T identity, F f) {
+			return reduce(src.data(), _size<A, S...>(), identity, f);
+		}
+		template<typename T, size_t A, size_t... S>
+		static T sum(const comp<T, A, S...>& src) { return sum(src.data(), _size<A, S...>()); }
+		template<typename T, size_t A, size_t... S>
+		static T min(const comp<T, A, S...>& src) { return min(src.data(), _size<A, S...>()); }
+		template<typename T, size_t A, size_t... S>
+		static T max(const comp<T, A, S...>& src) { return max(src.data(), _size<A, S...>()); }
+		///<returns>The index into the row major storage (data()) of the first smallest element</returns>
+		template<typename T, size_t A, size_t... S>
+		static size_t argmin(const comp<T, A, S...>& src) { return argmin(src.data(), _size<A, S...>()); }
+		template<typename T, size_t A, size_t... S>
+		static size_t argmax(const comp<T, A, S...>& src) { return argmax(src.data(), _size<A, S...>()); }
+
+		///<summary>Below this amount of elements the operations stay on the calling thread (see Util::parallel)</summary>
+		static constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+
+	private:
+		template<typename T>
+		using pack = typename simd::pack_of<T>::type;
+
+		template<size_t A, size_t... S>
+		static constexpr size_t _size() { return descriptor_size<A, S...>::value; }
+
+		template<typename T, typename F, typename... S>
+		static void _each(T* dst, size_t begin, size_t end, F& f, const S*... src);
+
+		template<typename T, typename F>
+		static T _reduce(const T* src, size_t begin, size_t end, T identity, F& f);
+
+		template<typename T, typename F>
+		static T _combine(T a, T b, F& f);
+
+		template<typename T>
+		///<returns>The index of the first element which is not NaN, count if there is none</returns>
+		static size_t _first_number(const T* src, size_t count) {
+			size_t i = 0;
+			while (i < count && src[i] != src[i]) {
+				++i;
+			}
+			return i;
+		}
+
+		///<summary>Calls fn(task, begin, end) for consecutive ranges covering count elements, returns the amount of tasks</summary>
+		template<typename T, typename F>
+		static size_t _parallel(size_t count, F&& fn) {
+			//chunks are whole packs, so only the last task handles a partial pack
+			return Util::parallel::ranges(count, PARALLEL_THRESHOLD, fn, pack<T>::width);
+		}
+	};
+
+//#######################################################################################################################
+
+	template<typename T, typename F, typename... S>
+	void array_math::_each(T* dst, size_t begin, size_t end, F& f, const S*... src) {
+		using P = pack<T>;
+		if constexpr (std::is_invocable_r<P, F&, std::conditional_t<true, P, S>...>::value) {
+			size_t i = begin;
+			for (; i + P::width <= end; i += P::width) {
+				f(P::loadu(src + i)...).storeu(dst + i);
+			}
+			if (i < end) {
+				//the missing lanes repeat the last element, so f only sees valid values
+				auto tail = [i, end](const T* s) {
+					alignas(simd::batch_alignment) T buf[P::width];
+					for (size_t l = 0; l < P::width; ++l) {
+						buf[l] = s[std::min(i + l, end - 1)];
+					}
+					return P::load(buf);
+				};
+				alignas(simd::batch_alignment) T out[P::width];
+				f(tail(src)...).store(out);
+				std::copy(out, out + (end - i), dst + i);
+			}
+		}
+		else {
+			for (size_t i = begin; i < end; ++i) {
+				dst[i] = f(src[i]...);
+			}
+		}
+	}
+
+	template<typename T, typename F>
+	T array_math::_combine(T a, T b, F& f) {
+		if constexpr (std::is_invocable_r<simd::scalar_pack<T>, F&, simd::scalar_pack<T>, simd::scalar_pack<T>>::value) {
+			return f(simd::scalar_pack<T>{ a }, simd::scalar_pack<T>{ b }).v;
+		}
+		else {
+			return f(a, b);
+		}
+	}
+
+	template<typename T, typename F>
+	T array_math::_reduce(const T* src, size_t begin, size_t end, T identity, F& f) {
+		using P = pack<T>;
+		if constexpr (std::is_invocable_r<P, F&, P, P>::value) {
+			P acc = P::set1(identity);
+			size_t i = begin;
+			for (; i + P::width <= end; i += P::width) {
+				acc = f(acc, P::loadu(src + i));
+			}
+			alignas(simd::batch_alignment) T buf[P::width];
+			if (i < end) {
+				for (size_t l = 0; l < P::width; ++l) {
+					buf[l] = i + l < end ? src[i + l] : identity;
+				}
+				acc = f(acc, P::load(buf));
+			}
+			acc.store(buf);
+			T res = buf[0];
+			for (size_t l = 1; l < P::width; ++l) {
+				res = _combine(res, buf[l], f);
+			}
+			return res;
+		}
+		else {
+			T res = identity;
+			for (size_t i = begin; i < end; ++i) {
+				res = f(res, src[i]);
+			}
+			return res;
+		}
+	}
+
+	template<typename T, typename F>
+	void array_math::map(T* dst, const T* src, size_t count, F f) {
+		_parallel<T>(count, [&](size_t, size_t begin, size_t end) {
+			_each(dst, begin, end, f, src);
+		});
+	}
+
+	template<typename T, typename F>
+	void array_math::zip(T* dst, const T* a, const T* b, size_t count, F f) {
+		_parallel<T>(count, [&](size_t, size_t begin, size_t end) {
+			_each(dst, begin, end, f, a, b);
+		});
+	}
+
+	template<typename T>
+	void array_math::fmadd(T* dst, const T* a, const T* b, const T* c, size_t count) {
+		auto f = [](auto x, auto y, auto z) { return decltype(x)::fmadd(x, y, z); };
+		_parallel<T>(count, [&](size_t, size_t begin, size_t end) {
+			_each(dst, begin, end, f, a, b, c);
+		});
+	}
+
+	template<typename T>
+	void array_math::lerp(T* dst, const T* a, const T* b, T t, size_t count) {
+		const pack<T> pt = pack<T>::set1(t);
+		auto f = [pt](pack<T> x, pack<T> y) { return pack<T>::fmadd(y - x, pt, x); };
+		_parallel<T>(count, [&](size_t, size_t begin, size_t end) {
+			_each(dst, begin, end, f, a, b);
+		});
+	}
+
+	template<typename T>
+	void array_math::clamp(T* dst, const T* src, T lo, T hi, size_t count) {
+		const pack<T> plo = pack<T>::set1(lo);
+		const pack<T> phi = pack<T>::set1(hi);
+		auto f = [plo, phi](pack<T> x) { return pack<T>::min(pack<T>::max(x, plo), phi); };
+		_parallel<T>(count, [&](size_t, size_t begin, size_t end) {
+			_each(dst, begin, end, f, src);
+		});
+	}
+
+	template<typename T, typename F>
+	T array_math::reduce(const T* src, size_t count, T identity, F f) {
+		std::vector<T> partial(Util::parallel::range_count(count, PARALLEL_THRESHOLD), identity);
+		const size_t tasks = _parallel<T>(count, [&](size_t task, size_t begin, size_t end) {
+			partial[task] = _reduce(src, begin, end, identity, f);
+		});
+		T res = partial[0];
+		for (size_t t = 1; t < tasks; ++t) {
+			res = _combine(res, partial[t], f);
+		}
+		return res;
+	}
+
+	template<typename T>
+	T array_math::sum(const T* src, size_t count) {
+		return reduce(src, count, T(0), [](auto a, auto b) { return a + b; });
+	}
+
+	template<typename T>
+	T array_math::min(const T* src, size_t count) {
+		ASSERT(count > 0, "the minimum of no elements", CHANNEL_MATH);
+		const size_t first = _first_number(src, count);
+		if (first == count) {
+			return src[0];
+		}
+		//the pack min returns its second operand for NaN lanes, with the element first a NaN never replaces the accumulator
+		return reduce(src, count, src[first], [](auto acc, auto v) { return decltype(acc)::min(v, acc); });
+	}
+
+	template<typename T>
+	T array_math::max(const T* src, size_t count) {
+		ASSERT(count > 0, "the maximum of no elements", CHANNEL_MATH);
+		const size_t first = _first_number(src, count);
+		if (first == count) {
+			return src[0];
+		}
+		return reduce(src, count, src[first], [](auto acc, auto v) { return decltype(acc)::max(v, acc); });
+	}
+
+	template<typename T>
+	size_t array_math::argmin(const T* src, size_t count) {
+		const T m = min(src, count);
+		//m is NaN only if all elements are, nothing compares equal to it then
+		const size_t i = size_t(std::find(src, src + count, m) - src);
+		return i == count ? 0 : i;
+	}
+
+	template<typename T>
+	size_t array_math::argmax(const T* src, size_t count) {
+		const T m = max(src, count);
+		const size_t i = size_t(std::find(src, src + count, m) - src);
+		return i == count ? 0 : i;
+	}
+}
+
+#endif
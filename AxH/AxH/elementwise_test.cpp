@@ -0,0 +1,56 @@
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <iostream>
+#include "elementwise.h"
+
+using namespace math;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		std::cout << "elementwise_test failed: " << what << std::endl;
+		++failures;
+	}
+}
+
+template<typename T>
+static void check_nan(size_t count) {
+	const T nan = std::numeric_limits<T>::quiet_NaN();
+	std::vector<T> v(count);
+	for (size_t i = 0; i < count; ++i) {
+		v[i] = T(i % 97) - T(40);
+	}
+	//NaNs first, in the middle of a pack and last, the extremes are placed after them
+	v[0] = nan;
+	v[count / 2] = nan;
+	v[count - 1] = nan;
+	v[count / 3] = T(-1000);
+	v[2 * count / 3] = T(1000);
+	check(array_math::argmin(v.data(), count) == count / 3, "argmin skips NaN");
+	check(array_math::argmax(v.data(), count) == 2 * count / 3, "argmax skips NaN");
+	check(array_math::min(v.data(), count) == T(-1000), "min skips NaN");
+	check(array_math::max(v.data(), count) == T(1000), "max skips NaN");
+
+	std::vector<T> only(count, nan);
+	check(array_math::argmin(only.data(), count) == 0, "argmin of only NaN is 0");
+	check(array_math::argmax(only.data(), count) == 0, "argmax of only NaN is 0");
+	check(std::isnan(array_math::min(only.data(), count)), "min of only NaN is NaN");
+}
+
+int main() {
+	//below and above array_math::PARALLEL_THRESHOLD, so both the single and the split reduction are covered
+	for (size_t count : { size_t(3), size_t(37), size_t(1000), array_math::PARALLEL_THRESHOLD * 2 + 5 }) {
+		check_nan<float>(count);
+		check_nan<double>(count);
+	}
+
+	const float v[] = { 3.f, -2.f, 5.f, -2.f, 5.f };
+	check(array_math::argmin(v, 5) == 1 && array_math::argmax(v, 5) == 2, "the first extreme is returned");
+
+	matrix<float, 2, 2> m{ { 1.f, std::numeric_limits<float>::quiet_NaN() }, { -4.f, 2.f } };
+	check(array_math::argmin(m) == 2 && array_math::argmax(m) == 3, "argmin and argmax of a matrix with NaN");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -5,11 +5,13 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <type_traits>
 
 #include "env.h"
 #include "dtypes.h"
 #include "res_type.h"
 #include "ptr.h"
+#include "cpu.h"
 
 #define MSTAG_BASE_TYPE_COUNT 13
 #define _MSTAG_ENUM_ARR_FROM_BASE(A) A##_ARR
@@ -498,6 +500,41 @@ namespace IO {
 		///<param name ='out'>reference to the destination data</param>
 		void readDoubleLE(double& out);
 
+		///<summary>
+		///Reads count values of an arithmetic type from the stream (BE). The byte order is converted in bulk.
+		///</summary>
+		///<param name ='out'>pointer to the destination array</param>
+		///<param name ='count'>amount of values to be read</param>
+		template<typename T> void readArray(T* out, uint32 count) {
+			_readArray(out, count, internalFormatLE());
+		}
+
+		///<summary>
+		///Reads count values of an arithmetic type from the stream using little endianess. The byte order is converted in bulk.
+		///</summary>
+		///<param name ='out'>pointer to the destination array</param>
+		///<param name ='count'>amount of values to be read</param>
+		template<typename T> void readArrayLE(T* out, uint32 count) {
+			_readArray(out, count, !internalFormatLE());
+		}
+
+		template<typename T> void _readArray(T* out, uint32 count, bool swap) {
+			static_assert(std::is_arithmetic<T>::value, "readArray requires an arithmetic type");
+			checkBounds();
+			f.read(static_cast<char*>(static_cast<void*>(out)), std::streamsize(sizeof(T)) * count);
+			if (swap) {
+				if constexpr (sizeof(T) == 2) {
+					Util::Cpu::kernels.bswap16(out, out, count);
+				}
+				else if constexpr (sizeof(T) == 4) {
+					Util::Cpu::kernels.bswap32(out, out, count);
+				}
+				else if constexpr (sizeof(T) == 8) {
+					Util::Cpu::kernels.bswap64(out, out, count);
+				}
+			}
+		}
+
 		template<typename T> void _readBE(T& in) {
 			checkBounds();
 			char arr[sizeof(T)];
@@ -0,0 +1,10 @@
+#include "graph.h"
+
+/*
+* graph.h is header only, the instantiations below make every build compile all members of NodeTreeBlank,
+* with the default heap policy and with arena_alloc.
+*/
+namespace Graph {
+	template struct NodeTreeBlank<uint32, std::string, _NOSIGN<uint32, std::string>>;
+	template struct NodeTreeBlank<uint32, std::string, _NOSIGN<uint32, std::string>, false, Util::arena_alloc>;
+}
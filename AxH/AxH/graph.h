@@ -2,9 +2,13 @@
 #define __H_GRAPH
 
 #include <vector>
-#include "Data.h"
-#include "ErrorHandling.h"
+#include <string>
+#include <typeinfo>
 #include "inc_settings.h"
+#include "errhndl.h"
+#include "misc.h"
+#include "alloc.h"
+#include "ptr.h"
 
 namespace Graph {
 
@@ -18,34 +22,45 @@ namespace Graph {
 		typename S,
 		typename D,
 		class Signer,
-		bool forceSigner = false >
+		bool forceSigner = false,
+		class A = Util::heap_alloc >
 		///<summary>
 		///Implements an abstract TreeNode/Tree Template.
 		///The Nodes are identified by a node_signature, which is obtained by a Signer, which must implement:
 		///static S getSignature(const D* const in); and must be able to hndl nullptr values
+		///Nodes and data are created and destroyed through the allocation policy A (see alloc.h), with arena_alloc a whole tree lives in one arena.
 		///</summary>
 		struct NodeTreeBlank {
 		protected:
-			ptr_vector<NodeTreeBlank> ptrs;
-			wrap_ptr<D> ptr = 0;
+			ptr_vector<NodeTreeBlank, A> ptrs;
+			wrap_ptr<D, A> ptr = 0;
 			S signature;
 
 		public:
 
-			NodeTreeBlank(pass_ptr<D>& in) {
+			NodeTreeBlank(pass_ptr<D, A>& in) {
 				this->ptr = in;
 				updateSignature();
 			}
-			NodeTreeBlank(pass_ptr<D>&& in) : NodeTreeBlank(in) { }
+			NodeTreeBlank(pass_ptr<D, A>&& in) : NodeTreeBlank(in) { }
 
-			NodeTreeBlank(pass_ptr<D>& in, const S& sig) {
-				this->ptr = in.get();
-				this->signature = (forceSigner ? Signer::getSignature(ptr) : sig);
+			NodeTreeBlank(pass_ptr<D, A>& in, const S& sig) {
+				this->ptr = in;
+				this->signature = (forceSigner ? Signer::getSignature(ptr._cpy()) : sig);
 			}
-			NodeTreeBlank(pass_ptr<D>&& in, const S& sig) : NodeTreeBlank(in, sig) { }
+			NodeTreeBlank(pass_ptr<D, A>&& in, const S& sig) : NodeTreeBlank(in, sig) { }
 
-			NodeTreeBlank(const NodeTreeBlank& ref) {
-				this->operator=(ref);
+			///<summary>
+			///Deep copies the subtree of ref
+			///</summary>
+			explicit NodeTreeBlank(const NodeTreeBlank& ref) {
+				_copyFrom(ref);
+			}
+			///<summary>
+			///Takes over the data and the children of ref in O(1), ref is left without data and children
+			///</summary>
+			NodeTreeBlank(NodeTreeBlank&& ref) noexcept : ptrs(std::move(ref.ptrs)), ptr(std::move(ref.ptr)), signature(std::move(ref.signature)) {
+				ref.updateSignature();
 			}
 			NodeTreeBlank() {
 				updateSignature();
@@ -64,78 +79,110 @@ namespace Graph {
 				ptrs.eraseAll();
 			}
 
+			///<summary>
+			///Deep copies the subtree of ref, rvalues are moved instead
+			///</summary>
 			void operator=(const NodeTreeBlank& ref) {
-				ptrs.eraseAll();
-
-				for (typename std::vector<NodeTreeBlank*>::const_iterator it = ref.getChildren().begin(); it != ref.getChildren().end(); it++) { // @suppress("Type cannot be resolved")
-					this->ptrs.push_back(new NodeTreeBlank(**it));
+				if (this == &ref) {
+					return;
 				}
+				//copy first, ref may be a descendant of the current node
+				NodeTreeBlank copy(ref);
+				this->operator=(std::move(copy));
+			}
 
-				this->signature = ref.signature;
-
-				ptr.discard();
-				if (ref.ptr.valid()) {
-					this->ptr = pass_ptr<D>(new D(ref.ptr.getReference()));
+			///<summary>
+			///Replaces the subtree by the one of ref in O(1), ref is left without data and children
+			///</summary>
+			void operator=(NodeTreeBlank&& ref) noexcept {
+				if (this == &ref) {
+					return;
 				}
+				//take everything first, ref may be a descendant of the current node and die with its subtree
+				ptr_vector<NodeTreeBlank, A> children(std::move(ref.ptrs));
+				wrap_ptr<D, A> data(std::move(ref.ptr));
+				S sig = std::move(ref.signature);
+				ref.updateSignature();
+
+				this->ptrs = std::move(children);
+				this->ptr = std::move(data);
+				this->signature = std::move(sig);
 			}
 
 			///<summary>
 			///Puts the passed Node at the end of the Child list
 			///</summary>
-			void push_back_node(pass_ptr<NodeTreeBlank>& in) {
+			void push_back_node(pass_ptr<NodeTreeBlank, A>& in) {
 				this->ptrs.push_back(in.get());
 			}
 			///<summary>
 			///Puts the passed Node at the end of the Child list
 			///</summary>
-			void push_back_node(pass_ptr<NodeTreeBlank>&& in) { this->push_back_node(in); }
+			void push_back_node(pass_ptr<NodeTreeBlank, A>&& in) { this->push_back_node(in); }
 
 			///<summary>
 			///Returns a vector containing all nodes in the subtree having this node as its root.
 			///The elements are put into the following order: ROOT, then the rest in the follwing order : for each child c {iterate(c)}.
 			///</summary>
-			std::vector<const NodeTreeBlank<S, D, Signer, forceSigner>*> iterate(bool includeRoot = false) const {
-				std::vector<const NodeTreeBlank<S, D, Signer, forceSigner>*> vec;
+			std::vector<const NodeTreeBlank<S, D, Signer, forceSigner, A>*> iterate(bool includeRoot = false) const {
+				std::vector<const NodeTreeBlank<S, D, Signer, forceSigner, A>*> vec;
 				this->_iterate(vec, includeRoot);
-				return std::move(vec);
+				return vec;
 			}
 
 			///<summary>
 			///Returns a vector containing all nodes in the subtree having this node as its root.
 			///The elements are put into the following order: ROOT, then the rest in the follwing order : for each child c {iterate(c)}.
 			///</summary>
-			std::vector<NodeTreeBlank<S, D, Signer, forceSigner>*> iterate(bool includeRoot = false) {
-				std::vector<NodeTreeBlank<S, D, Signer, forceSigner>*> vec;
+			std::vector<NodeTreeBlank<S, D, Signer, forceSigner, A>*> iterate(bool includeRoot = false) {
+				std::vector<NodeTreeBlank<S, D, Signer, forceSigner, A>*> vec;
 				this->_iterate(vec, includeRoot);
 				return vec;
 			}
 
+			///<summary>
+			///Appends the nodes of the subtree to vec, in the same order as iterate().
+			///With vec in a frame arena, a traversal every frame does not touch the heap.
+			///</summary>
+			void iterate(Util::arena_vector<const NodeTreeBlank<S, D, Signer, forceSigner, A>*>& vec, bool includeRoot = false) const {
+				this->_iterate(vec, includeRoot);
+			}
+
+			///<summary>
+			///Appends the nodes of the subtree to vec, in the same order as iterate().
+			///With vec in a frame arena, a traversal every frame does not touch the heap.
+			///</summary>
+			void iterate(Util::arena_vector<NodeTreeBlank<S, D, Signer, forceSigner, A>*>& vec, bool includeRoot = false) {
+				this->_iterate(vec, includeRoot);
+			}
+
 			///<summary>
 			///Puts the passed Node at the front of the Child list
 			///</summary>
-			void push_front_node(pass_ptr<NodeTreeBlank>& in) {
-				this->ptrs.insert(this->ptrs.begin(), in.get());
+			void push_front_node(pass_ptr<NodeTreeBlank, A>& in) {
+				this->ptrs.insert(0, in);
 			}
 
 			///<summary>
 			///Puts the passed Node at the front of the Child list
 			///</summary>
-			void push_front_node(pass_ptr<NodeTreeBlank>&& in) {
-				this->ptrs.insert(this->ptrs.begin(), in.get());
+			void push_front_node(pass_ptr<NodeTreeBlank, A>&& in) {
+				this->ptrs.insert(0, in);
 			}
 
 			///<summary>
-			///Puts the passed Node after the node with the passed signature
+			///Puts the passed Node after the node with the passed signature, at the end if there is no such node
 			///</summary>
-			void push_after_node(pass_ptr<NodeTreeBlank>& in, S& sign) {
-				this->ptrs.insert(this->ptrs.begin() + getChildIndex(sign), in.get());
+			void push_after_node(pass_ptr<NodeTreeBlank, A>& in, S& sign) {
+				const uint32 ind = getChildIndex(sign);
+				this->ptrs.insert(ind < this->ptrs.size() ? ind + 1 : uint32(this->ptrs.size()), in);
 			}
 
 			///<summary>
-			///Puts the passed Node after the node with the passed signature
+			///Puts the passed Node after the node with the passed signature, at the end if there is no such node
 			///</summary>
-			void push_after_node(pass_ptr<NodeTreeBlank>&& in, S& sign) {
-				this->ptrs.insert(this->ptrs.begin() + getChildIndex(sign), in.get());
+			void push_after_node(pass_ptr<NodeTreeBlank, A>&& in, S& sign) {
+				this->push_after_node(in, sign);
 			}
 
 			///<summary>
@@ -162,7 +209,7 @@ namespace Graph {
 			///Returns a vector the child nodes, 
 			///ownership to the ChildNode Pointers is NOT transmitted!
 			///</summary>
-			const ptr_vector<NodeTreeBlank>& getChildren() const {
+			const ptr_vector<NodeTreeBlank, A>& getChildren() const {
 				return ptrs;
 			}
 
@@ -170,7 +217,7 @@ namespace Graph {
 			///Returns a vector the child nodes, 
 			///ownership to the ChildNode Pointers is NOT transmitted!
 			///</summary>
-			ptr_vector<NodeTreeBlank>& getChildren() {
+			ptr_vector<NodeTreeBlank, A>& getChildren() {
 				return ptrs;
 			}
 
@@ -178,16 +225,11 @@ namespace Graph {
 			///Returns the pointer to the child node with the given signature
 			///nullptr if no such child exists
 			///</summary>
-			pass_null_ptr<NodeTreeBlank> extractFromChildrenBySignature(const S& sig) {
-				typename std::vector<owner<NodeTreeBlank*>>::iterator it = ptrs.begin(); // @suppress("Type cannot be resolved")
-				NodeTreeBlank* match;
-				while (it != ptrs.end()) {
-					if ((**it).signature == sig) { // @suppress("Field cannot be resolved")
-						match = *it;
-						ptrs.erase(it);
-						return match;
+			pass_null_ptr<NodeTreeBlank, A> extractFromChildrenBySignature(const S& sig) {
+				for (uint32 i = 0; i < ptrs.size(); i++) {
+					if (ptrs.access(i)->signature == sig) {
+						return ptrs.release(i);
 					}
-					it++;
 				}
 				return nullptr;
 			}
@@ -196,11 +238,9 @@ namespace Graph {
 			///Returns the pointer to the child node at the given index
 			///nullptr if invalid index
 			///</summary>
-			pass_null_ptr<NodeTreeBlank> extractFromChildrenByIndex(size_t sig) {
+			pass_null_ptr<NodeTreeBlank, A> extractFromChildrenByIndex(size_t sig) {
 				if (sig < ptrs.size()) {
-					NodeTreeBlank* elem = ptrs.at(sig);
-					ptrs.erase(ptrs.begin() + sig);
-					return elem;
+					return ptrs.release(uint32(sig));
 				}
 				return nullptr;
 			}
@@ -208,8 +248,8 @@ namespace Graph {
 			///<summary>
 			///returns a pointer to the data, while TRANSMITTING ownership away from this struct
 			///</summary>
-			pass_ptr<D> extractPointer() {
-				pass_ptr<D> tr = this->ptr.extract();
+			pass_ptr<D, A> extractPointer() {
+				pass_ptr<D, A> tr = this->ptr.extract();
 				updateSignature();
 				return tr;
 			}
@@ -217,14 +257,14 @@ namespace Graph {
 			///<summary>
 			///Sets the data pointer to the passed data.
 			///</summary>
-			void setPointer(pass_ptr<D>&& in) {
+			void setPointer(pass_ptr<D, A>&& in) {
 				setPointer(in);
 			}
 
 			///<summary>
 			///Sets the data pointer to the passed data.
 			///</summary>
-			void setPointer(pass_ptr<D>& in) {
+			void setPointer(pass_ptr<D, A>& in) {
 				this->ptr = in;
 				updateSignature();
 			}
@@ -306,7 +346,23 @@ namespace Graph {
 
 		private:
 
-			void _iterate(std::vector<const NodeTreeBlank<S, D, Signer, forceSigner>*>& vec, bool incdl) const {
+			///<summary>
+			///Deep copies ref into the current node, which has to be empty
+			///</summary>
+			void _copyFrom(const NodeTreeBlank& ref) {
+				for (typename std::vector<NodeTreeBlank*>::const_iterator it = ref.getChildren().begin(); it != ref.getChildren().end(); it++) { // @suppress("Type cannot be resolved")
+					this->ptrs.push_back(A::template create<NodeTreeBlank>(**it));
+				}
+
+				this->signature = ref.signature;
+
+				if (ref.ptr.valid()) {
+					this->ptr = pass_ptr<D, A>(A::template create<D>(ref.ptr.getReference()));
+				}
+			}
+
+			template<typename Al>
+			void _iterate(std::vector<const NodeTreeBlank<S, D, Signer, forceSigner, A>*, Al>& vec, bool incdl) const {
 				if (incdl) {
 					vec.push_back(this);
 				}
@@ -314,7 +370,8 @@ namespace Graph {
 					n->_iterate(vec, true);
 				}
 			}
-			void _iterate(std::vector<NodeTreeBlank<S, D, Signer, forceSigner>*>& vec, bool incdl) {
+			template<typename Al>
+			void _iterate(std::vector<NodeTreeBlank<S, D, Signer, forceSigner, A>*, Al>& vec, bool incdl) {
 				if (incdl) {
 					vec.push_back(this);
 				}
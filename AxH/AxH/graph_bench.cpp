@@ -0,0 +1,48 @@
+#include <chrono>
+#include <iostream>
+#include "graph.h"
+
+/*
+* Times moves of a NodeTreeBlank and of a ptr_vector with 1k, 100k and 1M children.
+* Both only hand over the child pointers, so the time per move must not grow with the amount of children.
+*/
+using Tree = Graph::NodeTreeBlank<uint32, uint32, Graph::_NOSIGN<uint32, uint32>>;
+
+static constexpr size_t MOVES = 1000;
+
+template<typename F>
+static double ns_per_move(F&& fn) {
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < MOVES; ++i) {
+		fn();
+	}
+	const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	//every call moves twice, there and back
+	return elapsed.count() / (2 * MOVES);
+}
+
+int main() {
+	for (size_t children : { size_t(1000), size_t(100000), size_t(1000000) }) {
+		Tree root(make_pass_ptr<uint32>(0u));
+		ptr_vector<uint32> vec;
+		for (size_t c = 0; c < children; ++c) {
+			root.push_back_node(make_pass_ptr<Tree>(make_pass_ptr<uint32>(uint32(c))));
+			vec.push_back(make_pass_ptr<uint32>(uint32(c)));
+		}
+
+		const double tree = ns_per_move([&]() {
+			Tree moved(std::move(root));
+			root = std::move(moved);
+		});
+		const double vector = ns_per_move([&]() {
+			ptr_vector<uint32> moved(std::move(vec));
+			vec = std::move(moved);
+		});
+		if (root.getChildren().size() != children || vec.size() != children) {
+			std::cout << "graph_bench: the moves lost children" << std::endl;
+			return 1;
+		}
+		std::cout << children << " children: NodeTreeBlank move " << tree << " ns, ptr_vector move " << vector << " ns" << std::endl;
+	}
+	return 0;
+}
@@ -13,6 +13,14 @@
 ///Whether Debugging should be enabled
 #define __DEBUG
 
+///Disables the SSE/AVX math kernels and uses the scalar fallback instead
+//#define __NO_SIMD
+
+///Whether the subscript operators of the math module check their bounds (disabled in release builds)
+#ifndef NDEBUG
+#define __MATH_CHECKED
+#endif
+
 #define NAME_AxH_ENGINE "AxH v0.0.0.0.0.-1"
 
 #define V_SYNC_FREQ 60
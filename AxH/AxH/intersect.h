@@ -0,0 +1,296 @@
+#ifndef __H_INTERSECT
+#define __H_INTERSECT
+
+#include <bit>
+#include <limits>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "simd.h"
+#include "batch.h"
+#include "bounds.h"
+
+namespace math {
+
+	/// <summary>
+	/// Closest intersection of a ray. t has to be set to the largest distance of interest before the query,
+	/// prim is the index of the primitive that was hit and u, v are the barycentric coordinates of triangle hits
+	/// (the hit point is (1 - u - v) * v0 + u * v1 + v * v2).
+	/// </summary>
+	struct ray_hit {
+		float t = std::numeric_limits<float>::infinity();
+		uint32 prim = ~uint32(0);
+		float u = 0.f;
+		float v = 0.f;
+
+		bool hit() const { return prim != ~uint32(0); }
+	};
+
+	/// <summary>
+	/// ray_packet::width rays stored as structure of arrays, the width of the widest float pack
+	/// </summary>
+	struct ray_packet {
+		static constexpr size_t width = simd::float_pack::width;
+
+		alignas(simd::batch_alignment) float origin[3][width];
+		alignas(simd::batch_alignment) float direction[3][width];
+		///<summary>1 / direction, maintained by set()</summary>
+		alignas(simd::batch_alignment) float inv_direction[3][width];
+
+		void set(size_t lane, const ray<float>& r);
+		ray<float> get(size_t lane) const;
+	};
+
+	/// <summary>
+	/// Distances and barycentric coordinates of simd::float_pack::width intersections
+	/// </summary>
+	struct hit_pack {
+		alignas(simd::batch_alignment) float t[simd::float_pack::width];
+		alignas(simd::batch_alignment) float u[simd::float_pack::width];
+		alignas(simd::batch_alignment) float v[simd::float_pack::width];
+	};
+
+	/// <summary>
+	/// Ray intersection kernels (Moeller-Trumbore for triangles, slab test for boxes), each in a scalar version,
+	/// one ray against a pack of primitives and a packet of rays against one primitive.
+	/// Triangles are stored as vector_batch&lt;float, 9&gt; (v0 x, y, z, edge v1 - v0 x, y, z, edge v2 - v0 x, y, z),
+	/// boxes as vector_batch&lt;float, 6&gt; (center x, y, z, half extent x, y, z) like in cull_math.
+	/// Hits are reported for distances in [0, tmax), the pack kernels return a mask with bit l set for every lane that was hit.
+	/// </summary>
+	struct intersect_math {
+		static constexpr size_t width = simd::float_pack::width;
+
+		static void push_back(vector_batch<float, 9>& triangles, const vector<float, 3>& v0, const vector<float, 3>& v1, const vector<float, 3>& v2);
+
+		///<summary>Updates t, u and v of hit if the triangle is hit closer than hit.t</summary>
+		static bool ray_triangle(const ray<float>& r, const vector<float, 3>& v0, const vector<float, 3>& v1, const vector<float, 3>& v2, ray_hit& hit);
+		///<returns>The entry distance into the box (0 if the origin is inside), infinity if it is missed or entered beyond tmax</returns>
+		static float ray_box(const float* origin, const float* invDirection, const float* lo, const float* hi, float tmax);
+		static float ray_box(const ray<float>& r, const aabb<float, 3>& box, float tmax);
+
+		///<summary>Intersects r with the triangles first ... first + width - 1, lanes beyond the batch size are never hit</summary>
+		static uint32 ray_triangles(const ray<float>& r, const vector_batch<float, 9>& triangles, size_t first, float tmax, hit_pack& out);
+		///<summary>Intersects r with the boxes first ... first + width - 1, writes the entry distances of the hit lanes to tnear</summary>
+		static uint32 ray_boxes(const ray<float>& r, const vector_batch<float, 6>& boxes, size_t first, float tmax, float* tnear);
+
+		///<summary>Intersects all rays with one triangle, hits.t holds the largest distance per ray and is updated with hits.u and hits.v for the hit lanes</summary>
+		static uint32 rays_triangle(const ray_packet& rays, const vector<float, 3>& v0, const vector<float, 3>& v1, const vector<float, 3>& v2, hit_pack& hits);
+		///<summary>Intersects all rays with one box, tmax holds the largest distance per ray (batch aligned)</summary>
+		static uint32 rays_box(const ray_packet& rays, const float* lo, const float* hi, const float* tmax);
+
+		///<summary>Finds the closest triangle of the batch closer than hit.t</summary>
+		///<returns>Whether hit was updated</returns>
+		static bool intersect(const ray<float>& r, const vector_batch<float, 9>& triangles, ray_hit& hit);
+
+	private:
+		using pack = simd::float_pack;
+
+		static uint32 _valid(size_t size, size_t first);
+		///<summary>The Moeller-Trumbore test on packs, d and o are the ray, v0, e1 and e2 the triangle</summary>
+		static uint32 _triangle(const pack* o, const pack* d, const pack* v0, const pack* e1, const pack* e2, pack tmax, pack& t, pack& u, pack& v);
+	};
+
+//#######################################################################################################################
+
+	inline void ray_packet::set(size_t lane, const ray<float>& r) {
+		for (size_t c = 0; c < 3; ++c) {
+			origin[c][lane] = r.origin[c];
+			direction[c][lane] = r.direction[c];
+			inv_direction[c][lane] = 1.f / direction[c][lane];
+		}
+	}
+
+	inline ray<float> ray_packet::get(size_t lane) const {
+		ray<float> r;
+		for (size_t c = 0; c < 3; ++c) {
+			r.origin[c] = origin[c][lane];
+			r.direction[c] = direction[c][lane];
+		}
+		return r;
+	}
+
+	inline void intersect_math::push_back(vector_batch<float, 9>& triangles, const vector<float, 3>& v0, const vector<float, 3>& v1, const vector<float, 3>& v2) {
+		vector<float, 9> tri;
+		for (size_t c = 0; c < 3; ++c) {
+			tri[c] = v0[c];
+			tri[c + 3] = v1[c] - v0[c];
+			tri[c + 6] = v2[c] - v0[c];
+		}
+		triangles.push_back(tri);
+	}
+
+	inline bool intersect_math::ray_triangle(const ray<float>& r, const vector<float, 3>& v0, const vector<float, 3>& v1, const vector<float, 3>& v2, ray_hit& hit) {
+		const vector<float, 3> e1 = v1 - v0;
+		const vector<float, 3> e2 = v2 - v0;
+		const vector<float, 3> p = vector_math::cross_product(r.direction, e2);
+		const float det = e1 * p;
+		if (det == 0.f) {
+			return false;
+		}
+		const float invDet = 1.f / det;
+		const vector<float, 3> s = r.origin - v0;
+		const float u = (s * p) * invDet;
+		if (!(u >= 0.f && u <= 1.f)) {
+			return false;
+		}
+		const vector<float, 3> q = vector_math::cross_product(s, e1);
+		const float v = (r.direction * q) * invDet;
+		if (!(v >= 0.f && u + v <= 1.f)) {
+			return false;
+		}
+		const float t = (e2 * q) * invDet;
+		if (!(t >= 0.f && t < hit.t)) {
+			return false;
+		}
+		hit.t = t;
+		hit.u = u;
+		hit.v = v;
+		return true;
+	}
+
+	inline float intersect_math::ray_box(const float* origin, const float* invDirection, const float* lo, const float* hi, float tmax) {
+		float tnear = 0.f;
+		float tfar = tmax;
+		for (size_t c = 0; c < 3; ++c) {
+			const float t0 = (lo[c] - origin[c]) * invDirection[c];
+			const float t1 = (hi[c] - origin[c]) * invDirection[c];
+			tnear = std::max(tnear, std::min(t0, t1));
+			tfar = std::min(tfar, std::max(t0, t1));
+		}
+		return tnear <= tfar && tnear < tmax ? tnear : std::numeric_limits<float>::infinity();
+	}
+
+	inline float intersect_math::ray_box(const ray<float>& r, const aabb<float, 3>& box, float tmax) {
+		float origin[3], inv[3], lo[3], hi[3];
+		for (size_t c = 0; c < 3; ++c) {
+			origin[c] = r.origin[c];
+			inv[c] = 1.f / r.direction[c];
+			lo[c] = box.lo[c];
+			hi[c] = box.hi[c];
+		}
+		return ray_box(origin, inv, lo, hi, tmax);
+	}
+
+	inline uint32 intersect_math::_valid(size_t size, size_t first) {
+		return size - first >= width ? (width == 32 ? ~0u : (1u << width) - 1) : (1u << (size - first)) - 1;
+	}
+
+	inline uint32 intersect_math::_triangle(const pack* o, const pack* d, const pack* v0, const pack* e1, const pack* e2, pack tmax, pack& t, pack& u, pack& v) {
+		const pack zero = pack::set1(0.f);
+		const pack one = pack::set1(1.f);
+		//p = d x e2
+		const pack px = d[1] * e2[2] - d[2] * e2[1];
+		const pack py = d[2] * e2[0] - d[0] * e2[2];
+		const pack pz = d[0] * e2[1] - d[1] * e2[0];
+		const pack det = pack::fmadd(e1[0], px, pack::fmadd(e1[1], py, e1[2] * pz));
+		const pack invDet = one / det;
+		const pack sx = o[0] - v0[0];
+		const pack sy = o[1] - v0[1];
+		const pack sz = o[2] - v0[2];
+		u = pack::fmadd(sx, px, pack::fmadd(sy, py, sz * pz)) * invDet;
+		//q = s x e1
+		const pack qx = sy * e1[2] - sz * e1[1];
+		const pack qy = sz * e1[0] - sx * e1[2];
+		const pack qz = sx * e1[1] - sy * e1[0];
+		v = pack::fmadd(d[0], qx, pack::fmadd(d[1], qy, d[2] * qz)) * invDet;
+		t = pack::fmadd(e2[0], qx, pack::fmadd(e2[1], qy, e2[2] * qz)) * invDet;
+		//ordered compares, lanes with det == 0 produce infinities or NaN and fail at least one of them
+		return pack::lt_mask(zero, pack::abs(det)) & pack::le_mask(zero, u) & pack::le_mask(zero, v) &
+			pack::le_mask(u + v, one) & pack::le_mask(zero, t) & pack::lt_mask(t, tmax);
+	}
+
+	inline uint32 intersect_math::ray_triangles(const ray<float>& r, const vector_batch<float, 9>& triangles, size_t first, float tmax, hit_pack& out) {
+		pack o[3], d[3], v0[3], e1[3], e2[3];
+		for (size_t c = 0; c < 3; ++c) {
+			o[c] = pack::set1(r.origin[c]);
+			d[c] = pack::set1(r.direction[c]);
+			v0[c] = pack::load(triangles.component(c) + first);
+			e1[c] = pack::load(triangles.component(c + 3) + first);
+			e2[c] = pack::load(triangles.component(c + 6) + first);
+		}
+		pack t, u, v;
+		const uint32 mask = _triangle(o, d, v0, e1, e2, pack::set1(tmax), t, u, v) & _valid(triangles.size(), first);
+		t.store(out.t);
+		u.store(out.u);
+		v.store(out.v);
+		return mask;
+	}
+
+	inline uint32 intersect_math::ray_boxes(const ray<float>& r, const vector_batch<float, 6>& boxes, size_t first, float tmax, float* tnear) {
+		pack lo = pack::set1(0.f);
+		pack hi = pack::set1(tmax);
+		for (size_t c = 0; c < 3; ++c) {
+			const pack o = pack::set1(r.origin[c]);
+			const pack inv = pack::set1(1.f / r.direction[c]);
+			const pack center = pack::load(boxes.component(c) + first);
+			const pack extent = pack::load(boxes.component(c + 3) + first);
+			const pack t0 = (center - extent - o) * inv;
+			const pack t1 = (center + extent - o) * inv;
+			lo = pack::max(lo, pack::min(t0, t1));
+			hi = pack::min(hi, pack::max(t0, t1));
+		}
+		lo.storeu(tnear);
+		return pack::le_mask(lo, hi) & pack::lt_mask(lo, pack::set1(tmax)) & _valid(boxes.size(), first);
+	}
+
+	inline uint32 intersect_math::rays_triangle(const ray_packet& rays, const vector<float, 3>& v0, const vector<float, 3>& v1, const vector<float, 3>& v2, hit_pack& hits) {
+		pack o[3], d[3], pv0[3], e1[3], e2[3];
+		for (size_t c = 0; c < 3; ++c) {
+			o[c] = pack::load(rays.origin[c]);
+			d[c] = pack::load(rays.direction[c]);
+			pv0[c] = pack::set1(v0[c]);
+			e1[c] = pack::set1(v1[c] - v0[c]);
+			e2[c] = pack::set1(v2[c] - v0[c]);
+		}
+		pack t, u, v;
+		const uint32 mask = _triangle(o, d, pv0, e1, e2, pack::load(hits.t), t, u, v);
+		if (mask != 0) {
+			hit_pack tmp;
+			t.store(tmp.t);
+			u.store(tmp.u);
+			v.store(tmp.v);
+			for (uint32 m = mask; m; m &= m - 1) {
+				const size_t l = size_t(std::countr_zero(m));
+				hits.t[l] = tmp.t[l];
+				hits.u[l] = tmp.u[l];
+				hits.v[l] = tmp.v[l];
+			}
+		}
+		return mask;
+	}
+
+	inline uint32 intersect_math::rays_box(const ray_packet& rays, const float* lo, const float* hi, const float* tmax) {
+		pack tnear = pack::set1(0.f);
+		pack tfar = pack::load(tmax);
+		for (size_t c = 0; c < 3; ++c) {
+			const pack o = pack::load(rays.origin[c]);
+			const pack inv = pack::load(rays.inv_direction[c]);
+			const pack t0 = (pack::set1(lo[c]) - o) * inv;
+			const pack t1 = (pack::set1(hi[c]) - o) * inv;
+			tnear = pack::max(tnear, pack::min(t0, t1));
+			tfar = pack::min(tfar, pack::max(t0, t1));
+		}
+		return pack::le_mask(tnear, tfar);
+	}
+
+	inline bool intersect_math::intersect(const ray<float>& r, const vector_batch<float, 9>& triangles, ray_hit& hit) {
+		bool found = false;
+		hit_pack out;
+		for (size_t first = 0; first < triangles.size(); first += width) {
+			uint32 mask = ray_triangles(r, triangles, first, hit.t, out);
+			for (; mask; mask &= mask - 1) {
+				const size_t l = size_t(std::countr_zero(mask));
+				if (out.t[l] < hit.t) {
+					hit.t = out.t[l];
+					hit.u = out.u[l];
+					hit.v = out.v[l];
+					hit.prim = uint32(first + l);
+					found = true;
+				}
+			}
+		}
+		return found;
+	}
+}
+
+#endif
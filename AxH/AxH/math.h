@@ -3,6 +3,8 @@
 #include <array>
 #include <tuple>
 #include <concepts>
+#include <cmath>
+#include <limits>
 
 #include <type_traits>
 #include <utility>
@@ -10,9 +12,43 @@
 #include "errhndl.h"
 #include "dtypes.h"
 #include "utils.h"
+#include "simd.h"
+
+///<summary>
+/// Bounds check of the math subscript operators. Only active with __MATH_CHECKED (see inc_settings.h).
+/// In constant expressions a failed check makes the expression ill-formed.
+///</summary>
+#ifdef __MATH_CHECKED
+#define MATH_BOUNDS_CHECK(X) if (!(X)) { PRINT_ERR("subscript out of bounds", PRIORITY_HALT, CHANNEL_MATH) }
+#else
+#define MATH_BOUNDS_CHECK(X)
+#endif
 
 namespace math {
 
+	template<std::floating_point F>
+	/// <summary>
+	/// Square root usable in constant expressions (Newton iteration), std::sqrt is used at runtime.
+	/// </summary>
+	constexpr F sqrt(F val) {
+		if (std::is_constant_evaluated()) {
+			if (!(val > F(0))) {
+				return val == F(0) ? F(0) : std::numeric_limits<F>::quiet_NaN();
+			}
+			F cur = val >= F(1) ? val : F(1);
+			F prev = F(0);
+			while (cur != prev) {
+				prev = cur;
+				cur = F(0.5) * (cur + val / cur);
+				if (cur >= prev) {
+					break;
+				}
+			}
+			return prev < cur ? prev : cur;
+		}
+		return std::sqrt(val);
+	}
+
 	template <bool...> struct bool_pack;
 	template <bool... v>
 	using all_true = std::is_same<bool_pack<true, v...>, bool_pack<v..., true>>;
@@ -31,73 +67,62 @@ namespace math {
 	template<size_t A, size_t... S>
 	/// <summary>
 	/// Class for accessing elements from multidimensional arrays saved in a on dimensional array.
+	/// The layout is row major and completely determined by the template arguments, therefore the descriptor carries no state.
 	/// </summary>
-	class descriptor {
+	struct descriptor {
 		static constexpr size_t dim = sizeof...(S) + 1;
-		size_t offset = 0;
-	public:
-		std::array<size_t, dim> extends;
-		std::array<size_t, dim> strides;
-	
 
-		descriptor(size_t offset, std::array<size_t, dim>&& strides){
-			this->offset = offset;
-			this->extends = { A, size_t(S)... };
-			this->strides = std::forward<std::array<size_t, dim>>(strides);
-		}
+		static constexpr std::array<size_t, dim> extends = { A, S... };
+		static constexpr std::array<size_t, dim> strides = []() {
+			std::array<size_t, dim> str{};
+			size_t carry = 1;
+			for (size_t t = 0; t < dim; t++) {
+				str[dim - 1 - t] = carry;
+				carry *= extends[dim - 1 - t];
+			}
+			return str;
+		}();
 
-		template<typename... S>
-			requires all_true<std::is_convertible<S,size_t>...>::value
-		size_t operator()(S... t)  const {
+		template<typename... I>
+			requires all_true<std::is_convertible<I, size_t>::value...>::value
+		static constexpr size_t index(I... t) {
 			static_assert(sizeof...(t) == dim);
 
 			size_t ind[dim]{ size_t(t)... };
-			size_t index = offset;
+			size_t index = 0;
 			for (size_t i = 0; i < dim; ++i) {
-				if (ind[i] >= extends[i]) {
-					PRINT_ERR("subscript out of bounds", PRIORITY_HALT, CHANNEL_GENERAL_DEBUG)
-				}
+				MATH_BOUNDS_CHECK(ind[i] < extends[i])
 				index += strides[i] * ind[i];
 			}
 			return index;
 		}
 
-		descriptor<S...> sub(size_t ind) const {
-			if(ind < this->extends[0]){
-				std::array<size_t, dim - 1> str;
-				Util::ArrayUtils::arr_copy(this->strides, str, 1, dim - 1);
-				return descriptor<S...>(this->offset + ind * this->strides[0], std::move(str));
-			}
-			else {
-				PRINT_ERR("subscript out of bounds", PRIORITY_HALT, CHANNEL_GENERAL_DEBUG)
-			}
+		/// <summary>
+		/// Returns the offset of the sub array at the given index of the first dimension
+		/// </summary>
+		static constexpr size_t sub(size_t ind) {
+			MATH_BOUNDS_CHECK(ind < A)
+			return ind * strides[0];
 		}
 	};
 
 	template<size_t A>
 	/// <summary>
 	/// Class for accessing elements from multidimensional arrays saved in a on dimensional array.
+	/// The layout is row major and completely determined by the template arguments, therefore the descriptor carries no state.
 	/// </summary>
-	class descriptor<A> {
+	struct descriptor<A> {
 		static constexpr size_t dim = 1;
-		size_t offset = 0;
-	public:
-
-		std::array<size_t, dim> extends;
-		std::array<size_t, dim> strides;
 
-		descriptor(size_t offset, std::array<size_t, dim>&& strides) {
-			this->offset = offset;
-			this->extends = { A };
-			this->strides = std::forward<std::array<size_t, dim>>(strides);
-		}
+		static constexpr std::array<size_t, dim> extends = { A };
+		static constexpr std::array<size_t, dim> strides = { 1 };
 
-		template<typename S>
-			requires std::is_convertible<S, size_t>::value
-		size_t operator()(S t) const {
-			return this->offset + this->strides[0] * t;
+		template<typename I>
+			requires std::is_convertible<I, size_t>::value
+		static constexpr size_t index(I t) {
+			MATH_BOUNDS_CHECK(size_t(t) < A)
+			return size_t(t);
 		}
-
 	};
 
 	template<typename T, size_t N>
@@ -115,28 +140,28 @@ namespace math {
 
 	template<typename T, size_t A, size_t... S>
 		requires std::is_default_constructible<T>::value
-	struct comp;
+	class comp;
 
 	template<typename T, size_t A, size_t... S>
 	/// <summary>
 	/// This class represents a reference to a multi dimensional array with elements of type T.
-	/// The dimensional extends are given via template arguments
+	/// The dimensional extends are given via template arguments, the reference itself only holds a pointer to the first element.
 	/// </summary>
 	class comp_ref {
 		using value_type = T;
+		using layout = descriptor<A, S...>;
 		static constexpr size_t dim = sizeof...(S) + 1;
 
 	private:
-		value_type* data;
-		descriptor<A, S...> descr;
+		value_type* ptr;
 
 	public:
 
-		comp_ref(value_type* base, descriptor<A, S...>&& mv) : descr{ mv } {
-			this->data = base;
+		constexpr comp_ref(value_type* base) {
+			this->ptr = base;
 		}
 
-		comp_ref& operator=(const comp_initializer<T, 1>& ref) {
+		constexpr comp_ref& operator=(const comp_initializer<T, 1>& ref) {
 			auto it = ref.begin();
 			size_t ind = 0;
 			while (it != ref.end() && ind < A) {
@@ -144,45 +169,53 @@ namespace math {
 				++ind;
 				++it;
 			}
+			return *this;
 		}
 		
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp_ref& operator=(const comp<F, A, S...>& ref);
+		constexpr comp_ref& operator=(const comp<F, A, S...>& ref);
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp_ref& operator=(const comp_ref<F, A, S...>& ref);
+		constexpr comp_ref& operator=(const comp_ref<F, A, S...>& ref);
 
 
-		comp_ref<T, S...> operator[](size_t ind) {
-			return comp_ref<T, S...>(this->data, this->descr.sub(ind));
+		constexpr comp_ref<T, S...> operator[](size_t ind) {
+			return comp_ref<T, S...>(this->ptr + layout::sub(ind));
 		}
 
-		const comp_ref<T, S...> operator[](size_t ind) const {
-			return comp_ref<T, S...>(this->data, this->descr.sub(ind));
+		constexpr const comp_ref<T, S...> operator[](size_t ind) const {
+			return comp_ref<T, S...>(this->ptr + layout::sub(ind));
+		}
+
+		/// <summary>
+		/// Returns a pointer to the contiguous (row major) storage of the referenced elements
+		/// </summary>
+		constexpr T* data() const {
+			return this->ptr;
 		}
 	};
 
 	template<typename T, size_t A>
 	/// <summary>
 	/// This class represents a reference to a multi dimensional array with elements of type T.
-	/// The dimensional extends are given via template arguments
+	/// The dimensional extends are given via template arguments, the reference itself only holds a pointer to the first element.
 	/// </summary>
 	class comp_ref<T, A> {
 		using value_type = T;
+		using layout = descriptor<A>;
 
 	private:
-		value_type* data;
-		descriptor<A> descr;
+		value_type* ptr;
 
 	public:
 
-		comp_ref(value_type* base, descriptor<A>&& mv) : descr{ mv } {
-			this->data = base;
+		constexpr comp_ref(value_type* base) {
+			this->ptr = base;
 		}
 
-		comp_ref& operator=(const comp_initializer<T, 1>& ref) {
+		constexpr comp_ref& operator=(const comp_initializer<T, 1>& ref) {
 			auto it = ref.begin();
 			size_t ind = 0;
 			while (it != ref.end() && ind < A) {
@@ -195,9 +228,9 @@ namespace math {
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp_ref& operator=(const comp<F, A>& ref) {
+		constexpr comp_ref& operator=(const comp<F, A>& ref) {
 			for (size_t i = 0; i < A; i++) {
-				this->data[this->descr(i)] = ref[i];
+				this->ptr[layout::index(i)] = ref[i];
 			}
 
 			return *this;
@@ -205,20 +238,27 @@ namespace math {
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp_ref& operator=(const comp_ref<F, A>& ref) {
+		constexpr comp_ref& operator=(const comp_ref<F, A>& ref) {
 			for (size_t i = 0; i < A; i++) {
-				this->data[this->descr(i)] = ref[i];
+				this->ptr[layout::index(i)] = ref[i];
 			}
 			return *this;
 		}
 
 
-		T& operator[](size_t ind) {
-			return this->data[this->descr(ind)];
+		constexpr T& operator[](size_t ind) {
+			return this->ptr[layout::index(ind)];
 		}
 
-		const T& operator[](size_t ind) const {
-			return this->data[this->descr(ind)];
+		constexpr const T& operator[](size_t ind) const {
+			return this->ptr[layout::index(ind)];
+		}
+
+		/// <summary>
+		/// Returns a pointer to the contiguous storage of the referenced elements
+		/// </summary>
+		constexpr T* data() const {
+			return this->ptr;
 		}
 
 	};
@@ -227,21 +267,22 @@ namespace math {
 		requires std::is_default_constructible<T>::value
 	/// <summary>
 	/// This class represents a multi dimensional array with elements of type T.
-	/// The dimensional extends are given via template arguments
+	/// The dimensional extends are given via template arguments.
+	/// The object only consists of the elements, the layout is given by descriptor&lt;A, S...&gt;
 	/// </summary>
 	class comp {
 		using value_type = T;
+		using layout = descriptor<A, S...>;
 		static constexpr size_t dim = sizeof...(S) + 1;
 
 	private:
-		std::array<T, descriptor_size<A, S...>::value> data = { T() };
-		descriptor<A, S...> descr;
+		alignas(simd::storage_alignment<T, descriptor_size<A, S...>::value>::value) std::array<T, descriptor_size<A, S...>::value> cnt = { T() };
 
 	public:
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp(const comp<F, A, S...>& ref) {
+		constexpr comp(const comp<F, A, S...>& ref) {
 			for (uint32 t = 0; t < A; ++t) {
 				this->operator[](t) = ref[t];
 			}
@@ -249,22 +290,15 @@ namespace math {
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp(const comp_ref<F, A, S...>& ref) {
+		constexpr comp(const comp_ref<F, A, S...>& ref) {
 			for (uint32 t = 0; t < A; ++t) {
 				this->operator[](t) = ref[t];
 			}
 		}
 
-		comp() : descr{ descriptor<A, S...>(0, std::array<size_t, dim>()) } {
-			size_t extends[dim] = { A, S... };
-			size_t carry = 1;
-			for (size_t t = 0; t < dim; t++) {
-				this->descr.strides[dim - 1 - t] = carry;
-				carry *= extends[dim - 1 - t];
-			}
-		}
+		constexpr comp() { }
 
-		comp(comp_initializer<T, dim>&& ref) : comp() {
+		constexpr comp(comp_initializer<T, dim>&& ref) {
 			auto it = ref.begin();
 			size_t ind = 0;
 			while (it != ref.end() && ind < A) {
@@ -274,7 +308,7 @@ namespace math {
 			}
 		}
 
-		comp& operator=(comp_initializer<T, dim>&& ref) {
+		constexpr comp& operator=(comp_initializer<T, dim>&& ref) {
 			auto it = ref.begin();
 			size_t ind = 0;
 			while (it != ref.end() && ind < A) {
@@ -282,18 +316,33 @@ namespace math {
 				++ind;
 				++it;
 			}
+			return *this;
 		}
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp& operator=(const comp_ref<F, A, S...>&);
+		constexpr comp& operator=(const comp_ref<F, A, S...>&);
+
+		constexpr comp_ref<T, S...> operator[](size_t ind) {
+			return comp_ref<T, S...>(cnt.data() + layout::sub(ind));
+		}
 
-		comp_ref<T, S...> operator[](size_t ind) {
-			return comp_ref<T, S...>(data.data(), this->descr.sub(ind));
+		constexpr const comp_ref<T, S...> operator[](size_t ind) const {
+			return comp_ref<T, S...>(const_cast<T*>(cnt.data()) + layout::sub(ind));
 		}
 
-		const comp_ref<T, S...> operator[](size_t ind) const {
-			return comp_ref<T, S...>(const_cast<T*>(data.data()), this->descr.sub(ind));
+		/// <summary>
+		/// Returns a pointer to the contiguous (row major) storage of the elements
+		/// </summary>
+		constexpr T* data() {
+			return cnt.data();
+		}
+
+		/// <summary>
+		/// Returns a pointer to the contiguous (row major) storage of the elements
+		/// </summary>
+		constexpr const T* data() const {
+			return cnt.data();
 		}
 	};
 
@@ -307,66 +356,86 @@ namespace math {
 		static constexpr size_t dim = 1;
 
 	private:
-		std::array<T, A> data = { T()};
+		alignas(simd::storage_alignment<T, A>::value) std::array<T, A> cnt = { T()};
 
 	public:
 
-		comp() { }
+		constexpr comp() { }
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp(const comp<F, A>& ref) {
+		constexpr comp(const comp<F, A>& ref) {
 			for (uint32 t = 0; t < A; ++t) {
-				this->data[t] = ref[t];
+				this->cnt[t] = ref[t];
 			}
 		}
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp(const comp_ref<F, A>& ref) {
+		constexpr comp(const comp_ref<F, A>& ref) {
 			for (uint32 t = 0; t < A; ++t) {
-				this->data[t] = ref[t];
+				this->cnt[t] = ref[t];
 			}
 		}
 
-		comp(comp_initializer<T,1>&& ref) {
+		constexpr comp(comp_initializer<T,1>&& ref) {
 			auto it = ref.begin();
 			size_t ind = 0;
 			while (it != ref.end() && ind < A) {
-				this->data[ind] = std::move( * it);
+				this->cnt[ind] = std::move( * it);
 				++ind;
 				++it;
 			}
 		}
 
-		comp& operator=(comp_initializer<T, 1>&& ref) {
+		constexpr comp& operator=(comp_initializer<T, 1>&& ref) {
 			auto it = ref.begin();
 			size_t ind = 0;
 			while (it != ref.end() && ind < A) {
-				this->data[ind] = std::move( * it);
+				this->cnt[ind] = std::move( * it);
 				++ind;
 				++it;
 			}
+			return *this;
 		}
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		comp& operator=(const comp_ref<F, A>&) {
+		constexpr comp& operator=(const comp_ref<F, A>& ref) {
 			for (size_t i = 0; i < A; i++) {
-				this->data[i] = ref[i];
+				this->cnt[i] = ref[i];
 			}
 			return *this;
 		}
 
-		T& operator[](size_t ind) {
-			return data[ind];
+		constexpr T& operator[](size_t ind) {
+			MATH_BOUNDS_CHECK(ind < A)
+			return cnt[ind];
 		}
 
-		const T& operator[](size_t ind) const {
-			return data[ind];
+		constexpr const T& operator[](size_t ind) const {
+			MATH_BOUNDS_CHECK(ind < A)
+			return cnt[ind];
+		}
+
+		/// <summary>
+		/// Returns a pointer to the contiguous storage of the elements
+		/// </summary>
+		constexpr T* data() {
+			return cnt.data();
+		}
+
+		/// <summary>
+		/// Returns a pointer to the contiguous storage of the elements
+		/// </summary>
+		constexpr const T* data() const {
+			return cnt.data();
 		}
 
 	};
+
+	static_assert(sizeof(comp<float, 4, 4>) == sizeof(float) * 16, "comp must not carry any state besides its elements");
+	static_assert(sizeof(comp_ref<float, 4, 4>) == sizeof(float*), "comp_ref must only carry a pointer");
 	
 
 	//###########################################################################################################################
@@ -384,39 +453,236 @@ namespace math {
 	template<math_type T, size_t A, size_t B >
 	class matrix;
 
+	template<typename E>
+	/// <summary>
+	/// Satisfied by vectors and by lazily evaluated vector expressions.
+	/// Each provides value_type, its extent and element access through operator[].
+	/// </summary>
+	concept vector_expression = requires (const E& e, size_t i) {
+		typename E::value_type;
+		{ E::extent } -> std::convertible_to<size_t>;
+		e[i];
+	} && E::is_vector_expression;
+
 	template<math_type T, size_t A>
 	/// <summary>
 	/// This class represent a vector the size is given by the template argument
+	/// The arithmetic operators return expressions (see vector_binary_expr), which are evaluated in a single loop once they are assigned to a vector.
 	/// </summary>
 	class vector : public comp<T, A> {
 	public:
+		using value_type = T;
+		static constexpr size_t extent = A;
+		static constexpr bool is_vector_expression = true;
+
 		using comp<T, A>::comp;
 
-		operator matrix<T, A, 1>();
+		constexpr vector() { }
 
-		template<typename F>
-			requires std::is_convertible<F, T>::value
-		vector operator*(F scale) const;
+		///<summary>
+		/// Evaluates the expression into the new vector
+		///</summary>
+		template<vector_expression E>
+			requires (E::extent == A) && std::is_convertible<typename E::value_type, T>::value
+		constexpr vector(const E& expr);
 
-		template<typename F,
-			typename G>
-			requires std::is_convertible<F, T>::value
-				  && std::is_convertible<T, G>::value
-		G operator*(const vector<F, A>& scale);
+		///<summary>
+		/// Evaluates the expression into this vector
+		///</summary>
+		template<vector_expression E>
+			requires (E::extent == A) && std::is_convertible<typename E::value_type, T>::value
+		constexpr vector& operator=(const E& expr);
 
-		template<typename F>
-			requires std::is_convertible<F, T>::value
-		vector operator+(const vector<F, A>& scale) const;
+		template<vector_expression E>
+			requires (E::extent == A) && std::is_convertible<typename E::value_type, T>::value
+		constexpr vector& operator+=(const E& expr);
+
+		template<vector_expression E>
+			requires (E::extent == A) && std::is_convertible<typename E::value_type, T>::value
+		constexpr vector& operator-=(const E& expr);
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		vector operator-(const vector<F, A>& scale) const;
+		constexpr vector& operator*=(F scale);
+
+		constexpr operator matrix<T, A, 1>() const;
 
 		template<std::floating_point F>
-		F length() const;
+		constexpr F length() const;
 
+	private:
+		template<vector_expression E>
+		constexpr void _assign(const E& expr);
+	};
+
+	template<typename E>
+	/// <summary>
+	/// Expressions hold their operands by value, vectors are held by reference.
+	/// </summary>
+	struct expr_storage {
+		using type = const E;
+	};
+
+	template<math_type T, size_t A>
+	struct expr_storage<vector<T, A>> {
+		using type = const vector<T, A>&;
+	};
+
+	struct expr_add {
+		static constexpr bool has_kernel = true;
+
+		template<typename X, typename Y>
+		static constexpr auto apply(const X& a, const Y& b) {
+			return a + b;
+		}
+		template<typename T, size_t A>
+		static constexpr void kernel(T* dst, const T* a, const T* b) {
+			simd::vector_kernel<T, A>::add(dst, a, b);
+		}
+	};
+
+	struct expr_sub {
+		static constexpr bool has_kernel = true;
+
+		template<typename X, typename Y>
+		static constexpr auto apply(const X& a, const Y& b) {
+			return a - b;
+		}
+		template<typename T, size_t A>
+		static constexpr void kernel(T* dst, const T* a, const T* b) {
+			simd::vector_kernel<T, A>::sub(dst, a, b);
+		}
+	};
+
+	struct expr_mul {
+		static constexpr bool has_kernel = true;
+
+		template<typename X, typename Y>
+		static constexpr auto apply(const X& a, const Y& b) {
+			return a * b;
+		}
+		template<typename T, size_t A>
+		static constexpr void kernel(T* dst, const T* a, T s) {
+			simd::vector_kernel<T, A>::scale(dst, a, s);
+		}
+	};
+
+	struct expr_div {
+		static constexpr bool has_kernel = false;
+
+		template<typename X, typename Y>
+		static constexpr auto apply(const X& a, const Y& b) {
+			return a / b;
+		}
+	};
+
+	template<vector_expression L, vector_expression R, typename Op>
+	/// <summary>
+	/// Lazily evaluated element wise operation of two vector expressions.
+	/// The expression refers to the vectors it was built from, it must not outlive them.
+	/// </summary>
+	struct vector_binary_expr {
+		using value_type = typename L::value_type;
+		static constexpr size_t extent = L::extent;
+		static constexpr bool is_vector_expression = true;
+
+		typename expr_storage<L>::type l;
+		typename expr_storage<R>::type r;
+
+		constexpr vector_binary_expr(const L& l, const R& r) : l(l), r(r) { }
+
+		constexpr value_type operator[](size_t ind) const {
+			return value_type(Op::apply(l[ind], r[ind]));
+		}
+
+		///<summary>
+		/// Writes the expression into dst. A single operation on two vectors is forwarded to the simd kernels
+		///</summary>
+		constexpr void evaluate(value_type* dst) const {
+			if constexpr (Op::has_kernel
+				&& std::is_same<L, vector<value_type, extent>>::value
+				&& std::is_same<R, vector<value_type, extent>>::value) {
+				Op::template kernel<value_type, extent>(dst, l.data(), r.data());
+			}
+			else {
+				for (size_t t = 0; t < extent; ++t) {
+					dst[t] = (*this)[t];
+				}
+			}
+		}
 	};
 
+	template<vector_expression E, typename Op>
+	/// <summary>
+	/// Lazily evaluated element wise operation of a vector expression and a scalar.
+	/// The expression refers to the vectors it was built from, it must not outlive them.
+	/// </summary>
+	struct vector_scalar_expr {
+		using value_type = typename E::value_type;
+		static constexpr size_t extent = E::extent;
+		static constexpr bool is_vector_expression = true;
+
+		typename expr_storage<E>::type e;
+		value_type s;
+
+		constexpr vector_scalar_expr(const E& e, value_type s) : e(e), s(s) { }
+
+		constexpr value_type operator[](size_t ind) const {
+			return value_type(Op::apply(e[ind], s));
+		}
+
+		///<summary>
+		/// Writes the expression into dst. A single operation on a vector is forwarded to the simd kernels
+		///</summary>
+		constexpr void evaluate(value_type* dst) const {
+			if constexpr (Op::has_kernel && std::is_same<E, vector<value_type, extent>>::value) {
+				Op::template kernel<value_type, extent>(dst, e.data(), s);
+			}
+			else {
+				for (size_t t = 0; t < extent; ++t) {
+					dst[t] = (*this)[t];
+				}
+			}
+		}
+	};
+
+	template<vector_expression L, vector_expression R>
+		requires (L::extent == R::extent) && std::is_convertible<typename R::value_type, typename L::value_type>::value
+	constexpr vector_binary_expr<L, R, expr_add> operator+(const L& l, const R& r) {
+		return vector_binary_expr<L, R, expr_add>(l, r);
+	}
+
+	template<vector_expression L, vector_expression R>
+		requires (L::extent == R::extent) && std::is_convertible<typename R::value_type, typename L::value_type>::value
+	constexpr vector_binary_expr<L, R, expr_sub> operator-(const L& l, const R& r) {
+		return vector_binary_expr<L, R, expr_sub>(l, r);
+	}
+
+	template<vector_expression E, typename F>
+		requires (!vector_expression<F>) && std::is_convertible<F, typename E::value_type>::value
+	constexpr vector_scalar_expr<E, expr_mul> operator*(const E& e, F scale) {
+		return vector_scalar_expr<E, expr_mul>(e, typename E::value_type(scale));
+	}
+
+	template<vector_expression E, typename F>
+		requires (!vector_expression<F>) && std::is_convertible<F, typename E::value_type>::value
+	constexpr vector_scalar_expr<E, expr_mul> operator*(F scale, const E& e) {
+		return vector_scalar_expr<E, expr_mul>(e, typename E::value_type(scale));
+	}
+
+	template<vector_expression E, typename F>
+		requires (!vector_expression<F>) && std::is_convertible<F, typename E::value_type>::value
+	constexpr vector_scalar_expr<E, expr_div> operator/(const E& e, F scale) {
+		return vector_scalar_expr<E, expr_div>(e, typename E::value_type(scale));
+	}
+
+	template<vector_expression L, vector_expression R>
+		requires (L::extent == R::extent) && std::is_convertible<typename R::value_type, typename L::value_type>::value
+	/// <summary>
+	/// Calculates the dot product
+	/// </summary>
+	constexpr typename L::value_type operator*(const L& l, const R& r);
+
 	template<math_type T, size_t A, size_t B >
 	/// <summary>
 	/// This class represent a matrix the size is given by the template argument
@@ -427,31 +693,31 @@ namespace math {
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		matrix<T, A, B> operator+(const matrix<F, A, B>& ref);
+		constexpr matrix<T, A, B> operator+(const matrix<F, A, B>& ref) const;
 
 		template<typename F,
 			size_t C>
 			requires std::is_convertible<F, T>::value
-		matrix<T, A, C> operator*(const matrix<F, B, C>& ref);
+		constexpr matrix<T, A, C> operator*(const matrix<F, B, C>& ref) const;
 
 		template<typename F>
 			requires std::is_convertible<F, T>::value
-		vector<T, A> operator*(const vector<F, B>& ref);
+		constexpr vector<T, A> operator*(const vector<F, B>& ref) const;
 
-		matrix<T, B, A> transpose();
+		constexpr matrix<T, B, A> transpose() const;
 
 	};
 
 
 //#######################################################################################################################
 	
-	class vector_math {
+	struct vector_math {
 		template<math_type T>
 		/// <summary>
 		/// Calculates the cross product of the given vectors
 		/// </summary>
 		/// <returns>The cross product</returns>
-		vector<T, 3> cross_product(const vector<T, 3>&, const vector<T, 3>&);
+		static constexpr vector<T, 3> cross_product(const vector<T, 3>&, const vector<T, 3>&);
 
 		template< 
 			std::floating_point T,
@@ -460,13 +726,109 @@ namespace math {
 		/// project the first vector onto the second. That is it returns a multiple of the second vector.
 		/// </summary>
 		/// <returns>A projection of the first vector onto the second</returns>
-		vector<T, A> project(const vector<T, A>&, const vector<T, A>&);
+		static constexpr vector<T, A> project(const vector<T, A>&, const vector<T, A>&);
 
 		template<
 			std::floating_point T,
 			size_t A >
 		/// <returns> A normalized version of the given vector </returns>
-		vector<T, A> normalize(const vector<T, A>&);
+		static constexpr vector<T, A> normalize(const vector<T, A>&);
+	};
+
+	template<std::floating_point T, size_t N>
+	/// <summary>
+	/// LU decomposition with partial pivoting, P * M = L * U.
+	/// L (with unit diagonal) and U are stored packed into one matrix, row t of P * M is row permutation()[t] of M.
+	/// </summary>
+	class lu_decomposition {
+	public:
+		constexpr lu_decomposition(const matrix<T, N, N>& m);
+
+		///<returns>Whether a pivot was zero, solve() and inverse() are undefined in that case</returns>
+		constexpr bool singular() const { return sing; }
+		constexpr T determinant() const;
+
+		///<returns>x with M * x = b</returns>
+		constexpr vector<T, N> solve(const vector<T, N>& b) const;
+		constexpr matrix<T, N, N> inverse() const;
+
+		constexpr matrix<T, N, N> lower() const;
+		constexpr matrix<T, N, N> upper() const;
+		constexpr const matrix<T, N, N>& packed() const { return lu; }
+		constexpr const std::array<size_t, N>& permutation() const { return perm; }
+
+	private:
+		matrix<T, N, N> lu;
+		std::array<size_t, N> perm = {};
+		T sign = T(1);
+		bool sing = false;
+	};
+
+	template<std::floating_point T, size_t A, size_t B>
+		requires (A >= B)
+	/// <summary>
+	/// QR decomposition by householder reflections, M = Q * R with Q (AxA) orthogonal and R (AxB) upper triangular.
+	/// </summary>
+	class qr_decomposition {
+	public:
+		constexpr qr_decomposition(const matrix<T, A, B>& m);
+
+		constexpr const matrix<T, A, A>& q() const { return _q; }
+		constexpr const matrix<T, A, B>& r() const { return _r; }
+
+	private:
+		matrix<T, A, A> _q;
+		matrix<T, A, B> _r;
+	};
+
+	template<std::floating_point T, size_t N>
+	/// <summary>
+	/// Polar decomposition M = U * P with U orthogonal and P symmetric positive semi definite, M has to be invertible.
+	/// U is the closest rotation (or reflection) to M, which is useful to orthonormalize drifting transforms or to split off scale and shear.
+	/// It is computed by the newton iteration U = (U + U^-T) / 2.
+	/// </summary>
+	class polar_decomposition {
+	public:
+		constexpr polar_decomposition(const matrix<T, N, N>& m, size_t maxIterations = 32);
+
+		constexpr const matrix<T, N, N>& orthogonal() const { return u; }
+		constexpr const matrix<T, N, N>& positive() const { return p; }
+
+	private:
+		matrix<T, N, N> u;
+		matrix<T, N, N> p;
+	};
+
+	struct matrix_math {
+		template<math_type T, size_t N>
+		/// <returns>The NxN identity matrix</returns>
+		static constexpr matrix<T, N, N> identity();
+
+		template<math_type T, size_t N>
+		/// <summary>
+		/// Calculates the determinant, unrolled up to 4x4 and by the LU decomposition above
+		/// </summary>
+		static constexpr T determinant(const matrix<T, N, N>&);
+
+		template<std::floating_point T, size_t N>
+		/// <summary>
+		/// Calculates the inverse, unrolled and branch free up to 4x4 (SIMD for float 4x4) and by the LU decomposition above.
+		/// Singular matrices give non finite results.
+		/// </summary>
+		/// <param name="det">Receives the determinant if not null</param>
+		static constexpr matrix<T, N, N> inverse(const matrix<T, N, N>&, T* det = nullptr);
+
+		template<std::floating_point T>
+		/// <summary>
+		/// Inverse of an affine transform (the last row is 0 0 0 1), only the upper 3x3 block is inverted
+		/// </summary>
+		static constexpr matrix<T, 4, 4> affine_inverse(const matrix<T, 4, 4>&);
+
+		template<std::floating_point T>
+		/// <summary>
+		/// Inverse of a rigid transform (rotation and translation only), the rotation is transposed
+		/// </summary>
+		static constexpr matrix<T, 4, 4> rigid_inverse(const matrix<T, 4, 4>&);
 	};
 
 //########################################################################################################################
@@ -478,7 +840,7 @@ namespace math {
 		size_t... S >
 		template<typename F>
 		requires std::is_convertible<F, T>::value
-	comp_ref<T, A, S...>& comp_ref<T, A, S...>::operator=(const comp<F, A, S...>& ref) {
+	constexpr comp_ref<T, A, S...>& comp_ref<T, A, S...>::operator=(const comp<F, A, S...>& ref) {
 		for (size_t i = 0; i < A; i++) {
 			this->operator[](i) = ref[i];
 		}
@@ -491,7 +853,7 @@ namespace math {
 		size_t... S >
 		template<typename F>
 		requires std::is_convertible<F, T>::value
-	comp_ref<T, A, S...>& comp_ref<T, A, S...>::operator=(const comp_ref<F, A, S...>& ref) {
+	constexpr comp_ref<T, A, S...>& comp_ref<T, A, S...>::operator=(const comp_ref<F, A, S...>& ref) {
 		for (size_t i = 0; i < A; i++) {
 			this->operator[](i) = ref[i];
 		}
@@ -505,7 +867,7 @@ namespace math {
 		size_t... S>
 		template<typename F>
 		requires std::is_convertible<F, T>::value
-	comp<T, A, S...>& comp<T, A, S...>::operator=(const comp_ref<F, A, S...>& ref) {
+	constexpr comp<T, A, S...>& comp<T, A, S...>::operator=(const comp_ref<F, A, S...>& ref) {
 		for (size_t i = 0; i < A; i++) {
 			this->operator[](i) = ref[i];
 		}
@@ -519,7 +881,7 @@ namespace math {
 		size_t B>
 	template<typename F>
 		requires std::is_convertible<F, T>::value
-	matrix<T, A, B> matrix<T, A, B>::operator+(const matrix<F, A, B>& ref) {
+	constexpr matrix<T, A, B> matrix<T, A, B>::operator+(const matrix<F, A, B>& ref) const {
 		matrix<T, A, B> cpy = *this;
 		for (size_t a = 0; a < A; ++a) {
 			for (size_t b = 0; b < B; ++b) {
@@ -536,8 +898,12 @@ namespace math {
 	template<typename F,
 		size_t C>
 		requires std::is_convertible<F, T>::value
-	matrix<T, A, C> matrix<T, A, B>::operator*(const matrix<F, B, C>& ref) {
+	constexpr matrix<T, A, C> matrix<T, A, B>::operator*(const matrix<F, B, C>& ref) const {
 		matrix<T, A, C> val;
+		if constexpr (std::is_same<T, F>::value) {
+			simd::matrix_kernel<T, A, B, C>::mul(val.data(), this->data(), ref.data());
+			return val;
+		}
 		for (size_t a = 0; a < A; ++a) {
 			for (size_t c = 0; c < C; ++c) {
 				for (size_t b = 0; b < B; ++b) {
@@ -554,8 +920,12 @@ namespace math {
 		size_t B>
 	template<typename F>
 		requires std::is_convertible<F, T>::value
-	vector<T, A> matrix<T, A, B>::operator*(const vector<F, B>& ref) {
+	constexpr vector<T, A> matrix<T, A, B>::operator*(const vector<F, B>& ref) const {
 		vector<T, A> val;
+		if constexpr (std::is_same<T, F>::value) {
+			simd::matrix_kernel<T, A, B, 1>::mul_vec(val.data(), this->data(), ref.data());
+			return val;
+		}
 		for (size_t a = 0; a < A; ++a) {
 			for (size_t b = 0; b < B; ++b) {
 				val[a] += (*this)[a][b] * ref[b];
@@ -568,19 +938,20 @@ namespace math {
 		math_type T,
 		size_t A,
 		size_t B>
-	matrix<T, B, A> matrix<T, A, B>::transpose() {
-		matrix<T, A, B> trans;
+	constexpr matrix<T, B, A> matrix<T, A, B>::transpose() const {
+		matrix<T, B, A> trans;
 		for (size_t a = 0; a < A; ++a) {
 			for (size_t b = 0; b < B; ++b) {
 				trans[b][a] = (*this)[a][b];
 			}
 		}
+		return trans;
 	}
 
 
 	template<math_type T,
 		size_t A >
-	inline vector<T, A>::operator matrix<T, A, 1>() {
+	constexpr vector<T, A>::operator matrix<T, A, 1>() const {
 		matrix<T, A, 1> ref;
 		for (size_t i = 0; i < A; ++i) {
 			ref[i][0] = (*this)[i];
@@ -589,79 +960,91 @@ namespace math {
 	}
 
 
-	template<math_type T, size_t A>
-	template<typename F,
-		typename G>
-		requires std::is_convertible<F, T>::value
-			  && std::is_convertible<T, G>::value
-	G vector<T, A>::operator*(const vector<F, A>& scale) {
-		G val;
-		for (size_t t = 0; t < A; ++t) {
-			val += this->operator[](t) * scale[t];
+	template<vector_expression L, vector_expression R>
+		requires (L::extent == R::extent) && std::is_convertible<typename R::value_type, typename L::value_type>::value
+	constexpr typename L::value_type operator*(const L& l, const R& r) {
+		using T = typename L::value_type;
+		if constexpr (std::is_same<L, vector<T, L::extent>>::value && std::is_same<R, vector<T, L::extent>>::value) {
+			return simd::vector_kernel<T, L::extent>::dot(l.data(), r.data());
+		}
+		else {
+			T val = T();
+			for (size_t t = 0; t < L::extent; ++t) {
+				val += l[t] * r[t];
+			}
+			return val;
 		}
-		return val;
 	}
 
+	template<math_type T,
+		size_t A >
+	template<vector_expression E>
+		requires (E::extent == A) && std::is_convertible<typename E::value_type, T>::value
+	constexpr vector<T, A>::vector(const E& expr) {
+		this->_assign(expr);
+	}
 
 	template<math_type T,
 		size_t A >
-	template<typename F>
-		requires std::is_convertible<F, T>::value
-	vector<T,A> vector<T,A>::operator*(F scale) const {
-		vector<T, A> cpy = *this;
-		for (size_t t = 0; t < A; t++) {
-			cpy[t] *= scale;
-		}
-		return cpy;
+	template<vector_expression E>
+		requires (E::extent == A) && std::is_convertible<typename E::value_type, T>::value
+	constexpr vector<T, A>& vector<T, A>::operator=(const E& expr) {
+		this->_assign(expr);
+		return *this;
 	}
 
 	template<math_type T,
 		size_t A >
-	template<typename F>
-		requires std::is_convertible<F, T>::value
-	vector<T,A> vector<T, A>::operator+(const vector<F, A>& scale) const {
-		vector cpy = *this;
-		for (size_t t = 0; t < A; ++t) {
-			cpy[t] += scale[t];
-		}
-		return cpy;
+	template<vector_expression E>
+		requires (E::extent == A) && std::is_convertible<typename E::value_type, T>::value
+	constexpr vector<T, A>& vector<T, A>::operator+=(const E& expr) {
+		this->_assign(*this + expr);
+		return *this;
+	}
+
+	template<math_type T,
+		size_t A >
+	template<vector_expression E>
+		requires (E::extent == A) && std::is_convertible<typename E::value_type, T>::value
+	constexpr vector<T, A>& vector<T, A>::operator-=(const E& expr) {
+		this->_assign(*this - expr);
+		return *this;
 	}
 
 	template<math_type T,
 		size_t A >
 	template<typename F>
 		requires std::is_convertible<F, T>::value
-	vector<T,A> vector<T,A>::operator-(const vector<F, A>& scale) const {
-		vector cpy = *this;
-		for (size_t t = 0; t < A; ++t) {
-			cpy[t] -= scale[t];
-		}
-		return cpy;
+	constexpr vector<T, A>& vector<T, A>::operator*=(F scale) {
+		this->_assign(*this * scale);
+		return *this;
 	}
 
 	template<math_type T,
 		size_t A >
-	template<std::floating_point F>
-	F vector<T,A>::length() const {
-		F sum = 0;
-		for (size_t t = 0; t < A; ++t) {
-			sum += (*this)[t] * (*this)[t];
-		}
-
-		//ew
-		if constexpr (std::is_same<F, double>) {
-			return std::sqrt(sum);
-		}
-		else if constexpr (std::is_same<F, long double>) {
-			return std::sqrtl(sum);
+	template<vector_expression E>
+	constexpr void vector<T, A>::_assign(const E& expr) {
+		//the operations are element wise, therefore the expression may refer to this vector
+		if constexpr (std::is_same<typename E::value_type, T>::value && requires { expr.evaluate(this->data()); }) {
+			expr.evaluate(this->data());
 		}
 		else {
-			return std::sqrtf(sum);
+			for (size_t t = 0; t < A; ++t) {
+				(*this)[t] = T(expr[t]);
+			}
 		}
 	}
 
+	template<math_type T,
+		size_t A >
+	template<std::floating_point F>
+	constexpr F vector<T,A>::length() const {
+		F sum = F((*this) * (*this));
+		return math::sqrt(sum);
+	}
+
 	template<math_type T>
-	vector<T, 3> vector_math::cross_product(const vector<T, 3>& a, const vector<T, 3>& b) {
+	constexpr vector<T, 3> vector_math::cross_product(const vector<T, 3>& a, const vector<T, 3>& b) {
 		vector<T, 3> c;
 		c[0] = (a[1] * b[2] - a[2] * b[1]);
 		c[1] = -(a[0] * b[2] - a[2] * b[0]);
@@ -672,7 +1055,7 @@ namespace math {
 	template<
 		std::floating_point T,
 		size_t A >
-	vector<T, A> vector_math::project(const vector<T, A>& a, const vector<T, A>& b) {
+	constexpr vector<T, A> vector_math::project(const vector<T, A>& a, const vector<T, A>& b) {
 		vector<T, A> bN = normalize<T, A>(b);
 		return bN * (bN * a);
 	}
@@ -680,9 +1063,274 @@ namespace math {
 	template<
 		std::floating_point T,
 		size_t A >
-	vector<T, A> vector_math::normalize(const vector<T, A>& a) {
+	constexpr vector<T, A> vector_math::normalize(const vector<T, A>& a) {
 		T one = 1;
-		return a * (one / a.length<T>());
+		return a * (one / a.template length<T>());
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr lu_decomposition<T, N>::lu_decomposition(const matrix<T, N, N>& m) : lu(m) {
+		T* a = lu.data();
+		for (size_t t = 0; t < N; ++t) {
+			perm[t] = t;
+		}
+		for (size_t k = 0; k < N; ++k) {
+			size_t piv = k;
+			T max = a[k * N + k] < T(0) ? -a[k * N + k] : a[k * N + k];
+			for (size_t i = k + 1; i < N; ++i) {
+				const T v = a[i * N + k] < T(0) ? -a[i * N + k] : a[i * N + k];
+				if (v > max) {
+					max = v;
+					piv = i;
+				}
+			}
+			if (max == T(0)) {
+				sing = true;
+				continue;
+			}
+			if (piv != k) {
+				for (size_t j = 0; j < N; ++j) {
+					T tmp = a[k * N + j];
+					a[k * N + j] = a[piv * N + j];
+					a[piv * N + j] = tmp;
+				}
+				size_t tmp = perm[k];
+				perm[k] = perm[piv];
+				perm[piv] = tmp;
+				sign = -sign;
+			}
+			const T inv = T(1) / a[k * N + k];
+			for (size_t i = k + 1; i < N; ++i) {
+				const T f = a[i * N + k] * inv;
+				a[i * N + k] = f;
+				for (size_t j = k + 1; j < N; ++j) {
+					a[i * N + j] -= f * a[k * N + j];
+				}
+			}
+		}
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr T lu_decomposition<T, N>::determinant() const {
+		T det = sign;
+		for (size_t t = 0; t < N; ++t) {
+			det *= lu.data()[t * N + t];
+		}
+		return det;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr vector<T, N> lu_decomposition<T, N>::solve(const vector<T, N>& b) const {
+		const T* a = lu.data();
+		vector<T, N> x;
+		//forward substitution with L
+		for (size_t i = 0; i < N; ++i) {
+			T sum = b[perm[i]];
+			for (size_t j = 0; j < i; ++j) {
+				sum -= a[i * N + j] * x[j];
+			}
+			x[i] = sum;
+		}
+		//backward substitution with U
+		for (size_t i = N; i-- > 0;) {
+			T sum = x[i];
+			for (size_t j = i + 1; j < N; ++j) {
+				sum -= a[i * N + j] * x[j];
+			}
+			x[i] = sum / a[i * N + i];
+		}
+		return x;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr matrix<T, N, N> lu_decomposition<T, N>::inverse() const {
+		matrix<T, N, N> inv;
+		vector<T, N> e;
+		for (size_t c = 0; c < N; ++c) {
+			for (size_t t = 0; t < N; ++t) {
+				e[t] = T(t == c);
+			}
+			vector<T, N> col = solve(e);
+			for (size_t r = 0; r < N; ++r) {
+				inv.data()[r * N + c] = col[r];
+			}
+		}
+		return inv;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr matrix<T, N, N> lu_decomposition<T, N>::lower() const {
+		matrix<T, N, N> l;
+		for (size_t i = 0; i < N; ++i) {
+			for (size_t j = 0; j < i; ++j) {
+				l.data()[i * N + j] = lu.data()[i * N + j];
+			}
+			l.data()[i * N + i] = T(1);
+		}
+		return l;
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr matrix<T, N, N> lu_decomposition<T, N>::upper() const {
+		matrix<T, N, N> u;
+		for (size_t i = 0; i < N; ++i) {
+			for (size_t j = i; j < N; ++j) {
+				u.data()[i * N + j] = lu.data()[i * N + j];
+			}
+		}
+		return u;
+	}
+
+	template<std::floating_point T, size_t A, size_t B>
+		requires (A >= B)
+	constexpr qr_decomposition<T, A, B>::qr_decomposition(const matrix<T, A, B>& m) : _q(matrix_math::identity<T, A>()), _r(m) {
+		T* r = _r.data();
+		T* q = _q.data();
+		const size_t steps = A - 1 < B ? A - 1 : B;
+		for (size_t k = 0; k < steps; ++k) {
+			T v[A] = {};
+			T norm = T(0);
+			for (size_t i = k; i < A; ++i) {
+				v[i] = r[i * B + k];
+				norm += v[i] * v[i];
+			}
+			norm = math::sqrt(norm);
+			//reflect onto -sign(r_kk) * |x| to avoid cancellation
+			v[k] += v[k] < T(0) ? -norm : norm;
+			T vv = T(0);
+			for (size_t i = k; i < A; ++i) {
+				vv += v[i] * v[i];
+			}
+			if (vv == T(0)) {
+				continue;
+			}
+			const T f = T(2) / vv;
+			//R = H * R
+			for (size_t j = 0; j < B; ++j) {
+				T sum = T(0);
+				for (size_t i = k; i < A; ++i) {
+					sum += v[i] * r[i * B + j];
+				}
+				sum *= f;
+				for (size_t i = k; i < A; ++i) {
+					r[i * B + j] -= sum * v[i];
+				}
+			}
+			//Q = Q * H
+			for (size_t i = 0; i < A; ++i) {
+				T sum = T(0);
+				for (size_t j = k; j < A; ++j) {
+					sum += q[i * A + j] * v[j];
+				}
+				sum *= f;
+				for (size_t j = k; j < A; ++j) {
+					q[i * A + j] -= sum * v[j];
+				}
+			}
+			for (size_t i = k + 1; i < A; ++i) {
+				r[i * B + k] = T(0);
+			}
+		}
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr polar_decomposition<T, N>::polar_decomposition(const matrix<T, N, N>& m, size_t maxIterations) : u(m) {
+		const T eps = std::numeric_limits<T>::epsilon() * T(N * N * 4);
+		for (size_t it = 0; it < maxIterations; ++it) {
+			matrix<T, N, N> next = matrix_math::inverse(u).transpose();
+			T diff = T(0);
+			for (size_t t = 0; t < N * N; ++t) {
+				const T val = (u.data()[t] + next.data()[t]) * T(0.5);
+				const T d = val - u.data()[t];
+				diff += d < T(0) ? -d : d;
+				next.data()[t] = val;
+			}
+			u = next;
+			if (diff <= eps) {
+				break;
+			}
+		}
+		p = u.transpose() * m;
+	}
+
+	template<math_type T, size_t N>
+	constexpr matrix<T, N, N> matrix_math::identity() {
+		matrix<T, N, N> id;
+		for (size_t t = 0; t < N; ++t) {
+			id.data()[t * N + t] = T(1);
+		}
+		return id;
+	}
+
+	template<math_type T, size_t N>
+	constexpr T matrix_math::determinant(const matrix<T, N, N>& m) {
+		if constexpr (N == 1) {
+			return m.data()[0];
+		}
+		else if constexpr (N <= 4) {
+			return simd::inverse_kernel<T, N>::determinant(m.data());
+		}
+		else {
+			static_assert(std::is_floating_point<T>::value, "the determinant of matrices larger than 4x4 requires a floating point type");
+			return lu_decomposition<T, N>(m).determinant();
+		}
+	}
+
+	template<std::floating_point T, size_t N>
+	constexpr matrix<T, N, N> matrix_math::inverse(const matrix<T, N, N>& m, T* det) {
+		matrix<T, N, N> inv;
+		if constexpr (N == 1) {
+			inv.data()[0] = T(1) / m.data()[0];
+			if (det) {
+				*det = m.data()[0];
+			}
+		}
+		else if constexpr (N <= 4) {
+			T d = simd::inverse_kernel<T, N>::inverse(inv.data(), m.data());
+			if (det) {
+				*det = d;
+			}
+		}
+		else {
+			lu_decomposition<T, N> lu(m);
+			inv = lu.inverse();
+			if (det) {
+				*det = lu.determinant();
+			}
+		}
+		return inv;
+	}
+
+	template<std::floating_point T>
+	constexpr matrix<T, 4, 4> matrix_math::affine_inverse(const matrix<T, 4, 4>& m) {
+		const T* a = m.data();
+		T rot[9] = { a[0], a[1], a[2], a[4], a[5], a[6], a[8], a[9], a[10] };
+		simd::inverse_kernel<T, 3>::inverse(rot, rot);
+		matrix<T, 4, 4> inv;
+		T* d = inv.data();
+		for (size_t r = 0; r < 3; ++r) {
+			d[r * 4] = rot[r * 3];
+			d[r * 4 + 1] = rot[r * 3 + 1];
+			d[r * 4 + 2] = rot[r * 3 + 2];
+			d[r * 4 + 3] = -(rot[r * 3] * a[3] + rot[r * 3 + 1] * a[7] + rot[r * 3 + 2] * a[11]);
+		}
+		d[15] = T(1);
+		return inv;
+	}
+
+	template<std::floating_point T>
+	constexpr matrix<T, 4, 4> matrix_math::rigid_inverse(const matrix<T, 4, 4>& m) {
+		const T* a = m.data();
+		matrix<T, 4, 4> inv;
+		T* d = inv.data();
+		for (size_t r = 0; r < 3; ++r) {
+			d[r * 4] = a[r];
+			d[r * 4 + 1] = a[4 + r];
+			d[r * 4 + 2] = a[8 + r];
+			d[r * 4 + 3] = -(a[r] * a[3] + a[4 + r] * a[7] + a[8 + r] * a[11]);
+		}
+		d[15] = T(1);
+		return inv;
 	}
 
 }
\ No newline at end of file
@@ -0,0 +1,526 @@
+#ifndef __H_NOISE
+#define __H_NOISE
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "simd.h"
+#include "batch.h"
+#include "parallel.h"
+
+namespace math {
+
+	enum class noise_type {
+		///<summary>Interpolated random lattice values</summary>
+		VALUE,
+		///<summary>Gradient noise on the hypercube lattice</summary>
+		PERLIN,
+		///<summary>Gradient noise on the simplex lattice, cheaper than PERLIN in 3 and 4 dimensions</summary>
+		SIMPLEX,
+		///<summary>Distance to the closest of one random feature point per cell (F1), mapped from [0, largest F1] to [-1, 1]</summary>
+		WORLEY
+	};
+
+	enum class fractal_type {
+		///<summary>Sum of octaves with decreasing amplitude</summary>
+		FBM,
+		///<summary>Sum of octaves of (1 - |noise|)^2, sharp ridges along the zero crossings</summary>
+		RIDGED
+	};
+
+	/// <summary>
+	/// Parameters of a noise evaluation. The result is in [-1, 1] for every type.
+	/// </summary>
+	struct noise_params {
+		noise_type type = noise_type::SIMPLEX;
+		fractal_type fractal = fractal_type::FBM;
+		uint32 seed = 0;
+		///<summary>Scale applied to the coordinates of the first octave</summary>
+		float frequency = 1.f;
+		uint32 octaves = 1;
+		///<summary>Frequency factor between octaves</summary>
+		float lacunarity = 2.f;
+		///<summary>Amplitude factor between octaves</summary>
+		float gain = 0.5f;
+		///<summary>Domain warp: the coordinates are displaced by warp times a fractal of the same parameters, 0 disables it</summary>
+		float warp = 0.f;
+	};
+
+	/// <summary>
+	/// Noise in 2, 3 and 4 dimensions evaluated simd::float_pack::width samples at once.
+	/// The sample functions take coordinates as structure of arrays or generate them for regular grids,
+	/// grids with at least PARALLEL_THRESHOLD samples are split into tiles of rows over the hardware threads.
+	/// On the same build results only depend on the parameters and the coordinates, not on the amount of threads or on which
+	/// samples share a pack. The evaluation uses pack::fmadd, which is fused on AVX2 and AVX-512 builds only, so other
+	/// instruction sets reproduce the results within rounding, not bit for bit.
+	/// </summary>
+	struct noise_math {
+		template<size_t N>
+		///<returns>The noise at p</returns>
+		static float sample(const noise_params& params, const vector<float, N>& p);
+
+		template<size_t N>
+		///<summary>out[i] = noise at (coords[0][i], ..., coords[N - 1][i])</summary>
+		static void sample(const noise_params& params, const float* const* coords, float* out, size_t count);
+
+		template<size_t N>
+		///<summary>out has to hold points.size() elements</summary>
+		static void sample(const noise_params& params, const vector_batch<float, N>& points, float* out);
+
+		///<summary>out[y * width + x] = noise at origin + step * (x, y)</summary>
+		static void grid(const noise_params& params, float* out, size_t width, size_t height, const vector<float, 2>& origin, float step);
+
+		///<summary>out[(z * height + y) * width + x] = noise at origin + step * (x, y, z)</summary>
+		static void grid(const noise_params& params, float* out, size_t width, size_t height, size_t depth, const vector<float, 3>& origin, float step);
+
+		template<size_t A, size_t B>
+		///<summary>out[y][x] = noise at origin + step * (x, y)</summary>
+		static void grid(const noise_params& params, comp<float, A, B>& out, const vector<float, 2>& origin, float step);
+
+		template<size_t A, size_t B, size_t C>
+		///<summary>out[z][y][x] = noise at origin + step * (x, y, z)</summary>
+		static void grid(const noise_params& params, comp<float, A, B, C>& out, const vector<float, 3>& origin, float step);
+
+		///<summary>Below this amount of samples the grids stay on the calling thread (see Util::parallel)</summary>
+		static constexpr size_t PARALLEL_THRESHOLD = 1 << 14;
+
+	private:
+		using pack = simd::float_pack;
+		using ipack = simd::int_pack;
+		static constexpr size_t W = pack::width;
+
+		static ipack _hash(ipack h);
+		template<size_t N>
+		static ipack _hash(ipack seed, const ipack* cell);
+		template<size_t N>
+		///<returns>The dot product of the gradient selected by h with d</returns>
+		static pack _gradient(ipack h, const pack* d);
+		///<returns>h mapped to [0, 1)</returns>
+		static pack _unit(ipack h);
+		static pack _fade(pack t);
+		static pack _clamp(pack a);
+
+		template<size_t N>
+		static pack _value(ipack seed, const pack* p);
+		template<size_t N>
+		static pack _perlin(ipack seed, const pack* p);
+		template<size_t N>
+		static pack _simplex(ipack seed, const pack* p);
+		template<size_t N>
+		static pack _worley(ipack seed, const pack* p);
+
+		template<size_t N>
+		static pack _fractal(const noise_params& params, uint32 seed, const pack* p);
+		template<size_t N>
+		///<summary>Frequency, domain warp and fractal of one pack of coordinates</summary>
+		static pack _evaluate(const noise_params& params, const pack* p);
+
+		///<summary>Calls fn(begin, end) for consecutive tiles of rows</summary>
+		template<typename F>
+		static void _rows(size_t rows, size_t rowSize, F&& fn);
+	};
+
+//#######################################################################################################################
+
+	inline noise_math::ipack noise_math::_hash(ipack h) {
+		//lowbias32 finalizer
+		h = h ^ ipack::shr<16>(h);
+		h = h * ipack::set1(0x7feb352du);
+		h = h ^ ipack::shr<15>(h);
+		h = h * ipack::set1(0x846ca68bu);
+		return h ^ ipack::shr<16>(h);
+	}
+
+	template<size_t N>
+	noise_math::ipack noise_math::_hash(ipack seed, const ipack* cell) {
+		constexpr uint32 primes[4] = { 0x8da6b343u, 0xd8163841u, 0xcb1ab31fu, 0x165667b1u };
+		ipack h = seed;
+		for (size_t d = 0; d < N; ++d) {
+			h = h ^ (cell[d] * ipack::set1(primes[d]));
+		}
+		return _hash(h);
+	}
+
+	template<size_t N>
+	noise_math::pack noise_math::_gradient(ipack h, const pack* d) {
+		//bit k of h is the sign of component k, bits 24 and 25 select a component to drop (none for 2 dimensions and index 3)
+		const ipack drop = ipack::shr<24>(h) & ipack::set1(3u);
+		pack res = pack::set1(0.f);
+		for (size_t k = 0; k < N; ++k) {
+			//multiplying by 2^(31 - k) moves bit k into the sign bit
+			const ipack bit = (h * ipack::set1(1u << (31 - k))) & ipack::set1(0x80000000u);
+			const pack sign = ipack::as_float(bit | ipack::set1(0x3f800000u));
+			const pack keep = pack::min(ipack::to_float(drop ^ ipack::set1(uint32(k))), pack::set1(1.f));
+			res = pack::fmadd(sign * keep, d[k], res);
+		}
+		return res;
+	}
+
+	inline noise_math::pack noise_math::_unit(ipack h) {
+		return ipack::to_float(ipack::shr<8>(h)) * pack::set1(1.f / 16777216.f);
+	}
+
+	inline noise_math::pack noise_math::_fade(pack t) {
+		//6t^5 - 15t^4 + 10t^3
+		return t * t * t * pack::fmadd(t, pack::fmadd(t, pack::set1(6.f), pack::set1(-15.f)), pack::set1(10.f));
+	}
+
+	inline noise_math::pack noise_math::_clamp(pack a) {
+		return pack::min(pack::max(a, pack::set1(-1.f)), pack::set1(1.f));
+	}
+
+	template<size_t N>
+	noise_math::pack noise_math::_value(ipack seed, const pack* p) {
+		ipack cell[N];
+		pack f[N], u[N];
+		for (size_t d = 0; d < N; ++d) {
+			const pack fl = pack::floor(p[d]);
+			cell[d] = ipack::floor(p[d]);
+			f[d] = p[d] - fl;
+			u[d] = _fade(f[d]);
+		}
+		pack corner[1 << N];
+		for (size_t c = 0; c < (size_t(1) << N); ++c) {
+			ipack at[N];
+			for (size_t d = 0; d < N; ++d) {
+				at[d] = cell[d] + ipack::set1(uint32((c >> d) & 1));
+			}
+			corner[c] = pack::fmadd(_unit(_hash<N>(seed, at)), pack::set1(2.f), pack::set1(-1.f));
+		}
+		//interpolate along one dimension after the other
+		for (size_t d = 0; d < N; ++d) {
+			const size_t half = size_t(1) << (N - 1 - d);
+			for (size_t c = 0; c < half; ++c) {
+				corner[c] = pack::fmadd(corner[2 * c + 1] - corner[2 * c], u[d], corner[2 * c]);
+			}
+		}
+		return corner[0];
+	}
+
+	template<size_t N>
+	noise_math::pack noise_math::_perlin(ipack seed, const pack* p) {
+		ipack cell[N];
+		pack f[N], u[N];
+		for (size_t d = 0; d < N; ++d) {
+			const pack fl = pack::floor(p[d]);
+			cell[d] = ipack::floor(p[d]);
+			f[d] = p[d] - fl;
+			u[d] = _fade(f[d]);
+		}
+		pack corner[1 << N];
+		for (size_t c = 0; c < (size_t(1) << N); ++c) {
+			ipack at[N];
+			pack rel[N];
+			for (size_t d = 0; d < N; ++d) {
+				const uint32 bit = uint32((c >> d) & 1);
+				at[d] = cell[d] + ipack::set1(bit);
+				rel[d] = f[d] - pack::set1(float(bit));
+			}
+			corner[c] = _gradient<N>(_hash<N>(seed, at), rel);
+		}
+		for (size_t d = 0; d < N; ++d) {
+			const size_t half = size_t(1) << (N - 1 - d);
+			for (size_t c = 0; c < half; ++c) {
+				corner[c] = pack::fmadd(corner[2 * c + 1] - corner[2 * c], u[d], corner[2 * c]);
+			}
+		}
+		//measured extrema of the sums, the rare values beyond are clamped
+		constexpr float scale = N == 2 ? 1.f : (N == 3 ? 0.84f : 0.85f);
+		return _clamp(corner[0] * pack::set1(scale));
+	}
+
+	template<size_t N>
+	noise_math::pack noise_math::_simplex(ipack seed, const pack* p) {
+		constexpr float sqrtN1 = N == 2 ? 1.7320508f : (N == 3 ? 2.f : 2.2360680f);
+		constexpr float F = (sqrtN1 - 1.f) / float(N);
+		constexpr float G = (1.f - 1.f / sqrtN1) / float(N);
+		constexpr float R2 = N == 2 ? 0.5f : 0.6f;
+		constexpr float scale = N == 2 ? 70.f : (N == 3 ? 23.f : 27.f);
+
+		//skew into the lattice of hypercubes, find the cube and the position inside of it
+		pack sum = p[0];
+		for (size_t d = 1; d < N; ++d) {
+			sum = sum + p[d];
+		}
+		const pack s = sum * pack::set1(F);
+		ipack cell[N];
+		pack cellf[N];
+		pack cellSum = pack::set1(0.f);
+		for (size_t d = 0; d < N; ++d) {
+			cellf[d] = pack::floor(p[d] + s);
+			cell[d] = ipack::floor(p[d] + s);
+			cellSum = cellSum + cellf[d];
+		}
+		const pack t = cellSum * pack::set1(G);
+		pack x0[N];
+		for (size_t d = 0; d < N; ++d) {
+			x0[d] = p[d] - (cellf[d] - t);
+		}
+		//the rank of each coordinate orders the traversal of the simplex
+		pack rank[N];
+		for (size_t d = 0; d < N; ++d) {
+			rank[d] = pack::set1(0.f);
+		}
+		for (size_t d = 0; d < N; ++d) {
+			for (size_t e = d + 1; e < N; ++e) {
+				const pack larger = pack::select_lt(x0[d], x0[e], pack::set1(1.f), pack::set1(0.f));
+				rank[e] = rank[e] + larger;
+				rank[d] = rank[d] + (pack::set1(1.f) - larger);
+			}
+		}
+		pack res = pack::set1(0.f);
+		for (size_t k = 0; k <= N; ++k) {
+			ipack at[N];
+			pack rel[N];
+			pack dist = pack::set1(R2);
+			for (size_t d = 0; d < N; ++d) {
+				//vertex k steps along the k highest ranked axes
+				const pack step = pack::select_lt(rank[d], pack::set1(float(N - k) - 0.5f), pack::set1(0.f), pack::set1(1.f));
+				at[d] = cell[d] + ipack::floor(step);
+				rel[d] = x0[d] - step + pack::set1(float(k) * G);
+				dist = dist - rel[d] * rel[d];
+			}
+			dist = pack::max(dist, pack::set1(0.f));
+			dist = dist * dist;
+			res = pack::fmadd(dist * dist, _gradient<N>(_hash<N>(seed, at), rel), res);
+		}
+		return _clamp(res * pack::set1(scale));
+	}
+
+	template<size_t N>
+	noise_math::pack noise_math::_worley(ipack seed, const pack* p) {
+		ipack cell[N];
+		pack f[N];
+		for (size_t d = 0; d < N; ++d) {
+			cell[d] = ipack::floor(p[d]);
+			f[d] = p[d] - pack::floor(p[d]);
+		}
+		constexpr size_t neighbours = N == 2 ? 9 : (N == 3 ? 27 : 81);
+		pack closest = pack::set1(std::numeric_limits<float>::infinity());
+		for (size_t n = 0; n < neighbours; ++n) {
+			ipack at[N];
+			int32 offset[N];
+			size_t rest = n;
+			for (size_t d = 0; d < N; ++d) {
+				offset[d] = int32(rest % 3) - 1;
+				rest /= 3;
+				at[d] = cell[d] + ipack::set1(uint32(offset[d]));
+			}
+			ipack h = _hash<N>(seed, at);
+			pack dist = pack::set1(0.f);
+			for (size_t d = 0; d < N; ++d) {
+				//one feature point per cell, each coordinate from its own hash
+				const pack delta = pack::set1(float(offset[d])) + _unit(h) - f[d];
+				dist = pack::fmadd(delta, delta, dist);
+				h = _hash(h + ipack::set1(0x9e3779b9u));
+			}
+			closest = pack::min(closest, dist);
+		}
+		//F1 scaled by its measured maximum
+		constexpr float scale = N == 2 ? 2.f / 1.28f : (N == 3 ? 2.f / 1.22f : 2.f / 1.19f);
+		return _clamp(pack::fmadd(pack::sqrt(closest), pack::set1(scale), pack::set1(-1.f)));
+	}
+
+	template<size_t N>
+	noise_math::pack noise_math::_fractal(const noise_params& params, uint32 seed, const pack* p) {
+		pack q[N];
+		for (size_t d = 0; d < N; ++d) {
+			q[d] = p[d];
+		}
+		pack res = pack::set1(0.f);
+		float amplitude = 1.f;
+		float total = 0.f;
+		const uint32 octaves = std::max<uint32>(1, params.octaves);
+		for (uint32 o = 0; o < octaves; ++o) {
+			//every octave gets its own seed, so the octaves do not line up at the origin
+			const ipack s = ipack::set1(seed + o * 0x9e3779b9u);
+			pack n;
+			switch (params.type) {
+			case noise_type::VALUE:
+				n = _value<N>(s, q);
+				break;
+			case noise_type::PERLIN:
+				n = _perlin<N>(s, q);
+				break;
+			case noise_type::WORLEY:
+				n = _worley<N>(s, q);
+				break;
+			default:
+				n = _simplex<N>(s, q);
+				break;
+			}
+			if (params.fractal == fractal_type::RIDGED) {
+				n = pack::set1(1.f) - pack::abs(n);
+				n = n * n;
+			}
+			res = pack::fmadd(n, pack::set1(amplitude), res);
+			total += amplitude;
+			amplitude *= params.gain;
+			for (size_t d = 0; d < N; ++d) {
+				q[d] = q[d] * pack::set1(params.lacunarity);
+			}
+		}
+		res = res * pack::set1(1.f / total);
+		if (params.fractal == fractal_type::RIDGED) {
+			res = pack::fmadd(res, pack::set1(2.f), pack::set1(-1.f));
+		}
+		return res;
+	}
+
+	template<size_t N>
+	noise_math::pack noise_math::_evaluate(const noise_params& params, const pack* p) {
+		pack q[N];
+		for (size_t d = 0; d < N; ++d) {
+			q[d] = p[d] * pack::set1(params.frequency);
+		}
+		if (params.warp != 0.f) {
+			//each axis is displaced by a fractal with a seed and an offset of its own
+			pack warped[N];
+			for (size_t d = 0; d < N; ++d) {
+				pack shifted[N];
+				for (size_t e = 0; e < N; ++e) {
+					shifted[e] = q[e] + pack::set1(float(d + 1) * 19.19f);
+				}
+				warped[d] = pack::fmadd(_fractal<N>(params, params.seed ^ (0x68e31da4u * uint32(d + 1)), shifted), pack::set1(params.warp), q[d]);
+			}
+			return _fractal<N>(params, params.seed, warped);
+		}
+		return _fractal<N>(params, params.seed, q);
+	}
+
+	template<size_t N>
+	float noise_math::sample(const noise_params& params, const vector<float, N>& p) {
+		pack q[N];
+		for (size_t d = 0; d < N; ++d) {
+			q[d] = pack::set1(p[d]);
+		}
+		alignas(simd::batch_alignment) float res[W];
+		_evaluate<N>(params, q).store(res);
+		return res[0];
+	}
+
+	template<size_t N>
+	void noise_math::sample(const noise_params& params, const float* const* coords, float* out, size_t count) {
+		static_assert(N >= 2 && N <= 4, "noise is available in 2, 3 and 4 dimensions");
+		size_t i = 0;
+		for (; i + W <= count; i += W) {
+			pack q[N];
+			for (size_t d = 0; d < N; ++d) {
+				q[d] = pack::loadu(coords[d] + i);
+			}
+			_evaluate<N>(params, q).storeu(out + i);
+		}
+		if (i < count) {
+			alignas(simd::batch_alignment) float tail[N][W] = {};
+			alignas(simd::batch_alignment) float res[W];
+			for (size_t d = 0; d < N; ++d) {
+				std::copy(coords[d] + i, coords[d] + count, tail[d]);
+			}
+			pack q[N];
+			for (size_t d = 0; d < N; ++d) {
+				q[d] = pack::load(tail[d]);
+			}
+			_evaluate<N>(params, q).store(res);
+			std::copy(res, res + (count - i), out + i);
+		}
+	}
+
+	template<size_t N>
+	void noise_math::sample(const noise_params& params, const vector_batch<float, N>& points, float* out) {
+		const float* coords[N];
+		for (size_t d = 0; d < N; ++d) {
+			coords[d] = points.component(d);
+		}
+		sample<N>(params, coords, out, points.size());
+	}
+
+	template<typename F>
+	void noise_math::_rows(size_t rows, size_t rowSize, F&& fn) {
+		//more tiles than threads, so rows of differing cost even out
+		const size_t tiles = std::max<size_t>(1, std::min(rows, Util::parallel::concurrency() * 4));
+		const size_t chunk = (rows + tiles - 1) / tiles;
+		Util::parallel::run(tiles, rows * rowSize, PARALLEL_THRESHOLD, [&](size_t t) {
+			const size_t begin = std::min(rows, t * chunk);
+			const size_t end = std::min(rows, begin + chunk);
+			if (begin != end) {
+				fn(begin, end);
+			}
+		});
+	}
+
+	inline void noise_math::grid(const noise_params& params, float* out, size_t width, size_t height, const vector<float, 2>& origin, float step) {
+		const float ox = origin[0];
+		const float oy = origin[1];
+		_rows(height, width, [&](size_t begin, size_t end) {
+			alignas(simd::batch_alignment) float lanes[W];
+			alignas(simd::batch_alignment) float res[W];
+			for (size_t l = 0; l < W; ++l) {
+				lanes[l] = float(l);
+			}
+			const pack lane = pack::load(lanes);
+			for (size_t y = begin; y < end; ++y) {
+				float* row = out + y * width;
+				pack q[2];
+				q[1] = pack::set1(oy + step * float(y));
+				for (size_t x = 0; x < width; x += W) {
+					q[0] = pack::fmadd(lane + pack::set1(float(x)), pack::set1(step), pack::set1(ox));
+					const pack n = _evaluate<2>(params, q);
+					if (x + W <= width) {
+						n.storeu(row + x);
+					}
+					else {
+						n.store(res);
+						std::copy(res, res + (width - x), row + x);
+					}
+				}
+			}
+		});
+	}
+
+	inline void noise_math::grid(const noise_params& params, float* out, size_t width, size_t height, size_t depth, const vector<float, 3>& origin, float step) {
+		const float ox = origin[0];
+		const float oy = origin[1];
+		const float oz = origin[2];
+		//the rows of all slices are distributed at once
+		_rows(height * depth, width, [&](size_t begin, size_t end) {
+			alignas(simd::batch_alignment) float lanes[W];
+			alignas(simd::batch_alignment) float res[W];
+			for (size_t l = 0; l < W; ++l) {
+				lanes[l] = float(l);
+			}
+			const pack lane = pack::load(lanes);
+			for (size_t r = begin; r < end; ++r) {
+				float* row = out + r * width;
+				pack q[3];
+				q[1] = pack::set1(oy + step * float(r % height));
+				q[2] = pack::set1(oz + step * float(r / height));
+				for (size_t x = 0; x < width; x += W) {
+					q[0] = pack::fmadd(lane + pack::set1(float(x)), pack::set1(step), pack::set1(ox));
+					const pack n = _evaluate<3>(params, q);
+					if (x + W <= width) {
+						n.storeu(row + x);
+					}
+					else {
+						n.store(res);
+						std::copy(res, res + (width - x), row + x);
+					}
+				}
+			}
+		});
+	}
+
+	template<size_t A, size_t B>
+	void noise_math::grid(const noise_params& params, comp<float, A, B>& out, const vector<float, 2>& origin, float step) {
+		grid(params, out.data(), B, A, origin, step);
+	}
+
+	template<size_t A, size_t B, size_t C>
+	void noise_math::grid(const noise_params& params, comp<float, A, B, C>& out, const vector<float, 3>& origin, float step) {
+		grid(params, out.data(), C, B, A, origin, step);
+	}
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef __H_PALETTE
+#define __H_PALETTE
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "cpu.h"
+#include "parallel.h"
+
+namespace math {
+
+	/// <summary>
+	/// Products of arrays of 4x4 matrices as needed for skinning palettes and node hierarchies.
+	/// The results are written into caller provided arrays, the float versions run on the dispatched SIMD kernels (Util::Cpu)
+	/// and split batches of at least PARALLEL_THRESHOLD matrices over the hardware threads.
+	/// </summary>
+	struct palette_math {
+		template<math_type T>
+		///<summary>dst[i] = a[i] * b[i], dst may be a or b</summary>
+		static void multiply(matrix<T, 4, 4>* dst, const matrix<T, 4, 4>* a, const matrix<T, 4, 4>* b, size_t count);
+
+		template<math_type T>
+		///<summary>dst[i] = a * b[i], e.g. the model matrix applied to a palette. dst may be b</summary>
+		static void multiply(matrix<T, 4, 4>* dst, const matrix<T, 4, 4>& a, const matrix<T, 4, 4>* b, size_t count);
+
+		template<math_type T>
+		///<summary>
+		/// Accumulates the world transforms of a hierarchy: world[i] = world[parent[i]] * local[i], roots (parent[i] &lt; 0) copy local[i].
+		/// The nodes have to be sorted topologically (parent[i] &lt; i), world may be local.
+		/// The chain of dependencies keeps this on the calling thread.
+		///</summary>
+		static void hierarchy(matrix<T, 4, 4>* world, const matrix<T, 4, 4>* local, const int32* parent, size_t count);
+
+		///<summary>Below this amount of matrices the products stay on the calling thread (see Util::parallel)</summary>
+		static constexpr size_t PARALLEL_THRESHOLD = 1 << 14;
+	};
+
+//#######################################################################################################################
+
+	static_assert(sizeof(matrix<float, 4, 4>) == 16 * sizeof(float), "the kernels require arrays of matrices to be packed");
+
+	template<math_type T>
+	void palette_math::multiply(matrix<T, 4, 4>* dst, const matrix<T, 4, 4>* a, const matrix<T, 4, 4>* b, size_t count) {
+		Util::parallel::ranges(count, PARALLEL_THRESHOLD, [&](size_t, size_t begin, size_t end) {
+			if (begin == end) {
+				return;
+			}
+			if constexpr (std::is_same<T, float>::value) {
+				Util::Cpu::kernels.mat4_mul_array(dst[begin].data(), a[begin].data(), b[begin].data(), end - begin);
+			}
+			else {
+				for (size_t i = begin; i < end; ++i) {
+					dst[i] = a[i] * b[i];
+				}
+			}
+		});
+	}
+
+	template<math_type T>
+	void palette_math::multiply(matrix<T, 4, 4>* dst, const matrix<T, 4, 4>& a, const matrix<T, 4, 4>* b, size_t count) {
+		Util::parallel::ranges(count, PARALLEL_THRESHOLD, [&](size_t, size_t begin, size_t end) {
+			if (begin == end) {
+				return;
+			}
+			if constexpr (std::is_same<T, float>::value) {
+				Util::Cpu::kernels.mat4_mul_left(dst[begin].data(), a.data(), b[begin].data(), end - begin);
+			}
+			else {
+				for (size_t i = begin; i < end; ++i) {
+					dst[i] = a * b[i];
+				}
+			}
+		});
+	}
+
+	template<math_type T>
+	void palette_math::hierarchy(matrix<T, 4, 4>* world, const matrix<T, 4, 4>* local, const int32* parent, size_t count) {
+#ifdef __ROBUST
+		for (size_t i = 0; i < count; ++i) {
+			ASSERT(parent[i] < int32(i), "the hierarchy is not sorted topologically", CHANNEL_MATH);
+		}
+#endif
+		if (count == 0) {
+			return;
+		}
+		if constexpr (std::is_same<T, float>::value) {
+			Util::Cpu::kernels.mat4_hierarchy(world[0].data(), local[0].data(), parent, count);
+		}
+		else {
+			for (size_t i = 0; i < count; ++i) {
+				world[i] = parent[i] < 0 ? local[i] : world[parent[i]] * local[i];
+			}
+		}
+	}
+}
+
+#endif
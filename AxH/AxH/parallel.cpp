@@ -0,0 +1,33 @@
+#include "parallel.h"
+
+using namespace Util;
+
+size_t parallel::concurrency() {
+	const size_t count = threads != 0 ? threads : std::thread::hardware_concurrency();
+	return std::max<size_t>(1, count);
+}
+
+size_t parallel::range_count(size_t count, size_t threshold) {
+	if (count < threshold) {
+		return 1;
+	}
+	//every range gets at least a quarter of the threshold
+	return std::max<size_t>(1, std::min(concurrency(), count / std::max<size_t>(1, threshold / 4)));
+}
+
+size_t parallel::_acquire(size_t count) {
+	const size_t limit = concurrency() - 1;
+	size_t busy = _busy.load(std::memory_order_relaxed);
+	size_t take;
+	do {
+		take = std::min(count, limit > busy ? limit - busy : 0);
+		if (take == 0) {
+			return 0;
+		}
+	} while (!_busy.compare_exchange_weak(busy, busy + take, std::memory_order_relaxed));
+	return take;
+}
+
+void parallel::_release(size_t count) {
+	_busy.fetch_sub(count, std::memory_order_relaxed);
+}
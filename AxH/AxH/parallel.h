@@ -0,0 +1,116 @@
+#ifndef __H_PARALLEL
+#define __H_PARALLEL
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "inc_settings.h"
+#include "errhndl.h"
+
+namespace Util {
+
+	/// <summary>
+	/// Fork join loops shared by the data parallel algorithms (array_math, dmatrix_math, palette_math, noise_math, bvh, spatial_hash).
+	/// Work runs on the calling thread and on short lived helper threads. All loops draw their helpers from one budget of
+	/// threads - 1, so nested or concurrent loops do not oversubscribe the cpu; a loop without free helpers runs on the calling thread.
+	/// </summary>
+	struct parallel {
+		///<summary>
+		/// Amount of threads the parallel algorithms may use together, 0 selects std::thread::hardware_concurrency()
+		///</summary>
+		static inline size_t threads = 0;
+
+		///<returns>The amount of threads the loops may use, at least 1</returns>
+		static size_t concurrency();
+
+		template<typename F>
+		///<summary>
+		/// Calls fn(task) for every task in [0, tasks), the tasks are handed out one at a time to the participating threads.
+		/// Below threshold units of work (of all tasks together) everything stays on the calling thread.
+		///</summary>
+		static void run(size_t tasks, size_t work, size_t threshold, F&& fn);
+
+		template<typename F>
+		///<summary>
+		/// Calls fn(task, begin, end) for consecutive ranges covering count items, at most one range per thread.
+		/// Below threshold items everything stays on the calling thread, above it every range gets at least a quarter of threshold.
+		/// The ranges are multiples of step long except for the last one.
+		///</summary>
+		///<returns>The amount of ranges, range_count(count, threshold)</returns>
+		static size_t ranges(size_t count, size_t threshold, F&& fn, size_t step = 1);
+
+		///<returns>The amount of ranges ranges() splits count items into</returns>
+		static size_t range_count(size_t count, size_t threshold);
+
+		template<typename F, typename G>
+		///<summary>Calls a on a helper thread if one is free and b on the calling thread, returns when both are done</summary>
+		static void invoke(F&& a, G&& b);
+
+	private:
+		///<summary>Helper threads running for any loop</summary>
+		static inline std::atomic<size_t> _busy = 0;
+
+		///<returns>The amount of helpers taken from the budget, at most count</returns>
+		static size_t _acquire(size_t count);
+		static void _release(size_t count);
+	};
+
+//#######################################################################################################################
+
+	template<typename F>
+	void parallel::run(size_t tasks, size_t work, size_t threshold, F&& fn) {
+		const size_t helpers = work < threshold || tasks <= 1 ? 0 : _acquire(tasks - 1);
+		if (helpers == 0) {
+			for (size_t t = 0; t < tasks; ++t) {
+				fn(t);
+			}
+			return;
+		}
+		std::atomic<size_t> next = 0;
+		const auto worker = [&]() {
+			for (size_t t = next++; t < tasks; t = next++) {
+				fn(t);
+			}
+		};
+		std::vector<std::thread> pool;
+		pool.reserve(helpers);
+		for (size_t h = 0; h < helpers; ++h) {
+			pool.emplace_back(worker);
+		}
+		worker();
+		for (std::thread& th : pool) {
+			th.join();
+		}
+		_release(helpers);
+	}
+
+	template<typename F>
+	size_t parallel::ranges(size_t count, size_t threshold, F&& fn, size_t step) {
+		const size_t tasks = range_count(count, threshold);
+		//the ranges only depend on count, not on the free helpers, so reductions over them are reproducible
+		const size_t chunk = ((count + tasks - 1) / tasks + step - 1) / step * step;
+		run(tasks, count, threshold, [&](size_t t) {
+			const size_t begin = std::min(count, t * chunk);
+			fn(t, begin, std::min(count, begin + chunk));
+		});
+		return tasks;
+	}
+
+	template<typename F, typename G>
+	void parallel::invoke(F&& a, G&& b) {
+		if (_acquire(1) == 0) {
+			a();
+			b();
+			return;
+		}
+		std::thread worker([&a]() {
+			a();
+		});
+		b();
+		worker.join();
+		_release(1);
+	}
+}
+
+#endif
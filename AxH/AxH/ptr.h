@@ -5,7 +5,11 @@
 #include <string>
 #include <sstream>
 
+#include <vector>
+#include <utility>
+
 #include "dtypes.h"
+#include "alloc.h"
 
 #include "errhndl.h"
 
@@ -19,8 +23,9 @@ template<typename T> using nullable = T; //non_null assumed otherwise !!
 /// The pass_ptr, pass_null_ptr and pass_arr_ptr are designed for passing pointers of which there should only be one occurance.
 /// If nothing extracts the pointer from the object by calling get(), the object is automatically deleted when the deconstructor is called.
 /// The copyFrom constructor and the copyFrom assignment operator both move the pointer from the incoming object to the recieving.
+/// The object is destroyed through the allocation policy A (see alloc.h), it has to be created through the same policy, e.g. by make_pass_ptr.
 ///</summary>
-template<typename T> struct pass_ptr {
+template<typename T, class A = Util::heap_alloc> struct pass_ptr {
 protected:
 	owner<T*> ptr = nullptr;
 
@@ -40,8 +45,8 @@ public:
 	///<summary>
 	///Creates a managed pointer object
 	///</summary>
-	pass_ptr(pass_ptr<T>& ref);
-	pass_ptr(pass_ptr<T>&& ref) noexcept;
+	pass_ptr(pass_ptr<T, A>& ref);
+	pass_ptr(pass_ptr<T, A>&& ref) noexcept;
 	virtual ~pass_ptr();
 
 	///<summary>
@@ -50,7 +55,7 @@ public:
 	virtual owner<T*> get();
 
 	T* operator->();
-	virtual void operator=(pass_ptr<T>& ref);
+	virtual void operator=(pass_ptr<T, A>& ref);
 
 	///<summary>
 	///deletes the encapsuled object and invalidates the pointer
@@ -88,21 +93,21 @@ protected:
 /// If nothing extracts the pointer from the object by calling get(), the object is automatically deleted when the deconstructor is called.
 /// The copyFrom constructor and the copyFrom assignment operator both move the pointer from the incoming object to the recieving.
 ///</summary>
-template<typename T> struct pass_null_ptr : pass_ptr<T> {
+template<typename T, class A = Util::heap_alloc> struct pass_null_ptr : pass_ptr<T, A> {
 	pass_null_ptr(owner<T*>& ptra);
 	pass_null_ptr(owner<T*>&& ptra);
-	pass_null_ptr(pass_ptr<T>& ref);
-	pass_null_ptr(pass_null_ptr<T>& ref);
-	pass_null_ptr(pass_null_ptr<T>&& ref);
+	pass_null_ptr(pass_ptr<T, A>& ref);
+	pass_null_ptr(pass_null_ptr<T, A>& ref);
+	pass_null_ptr(pass_null_ptr<T, A>&& ref);
 	pass_null_ptr();
 	virtual ~pass_null_ptr() {}
 
 	///<summary>
 	///returns the object as a man_ptr
 	///</summary>
-	pass_ptr<T> getDataPointer();
+	pass_ptr<T, A> getDataPointer();
 
-	virtual void operator=(pass_ptr<T>& ref) override;
+	virtual void operator=(pass_ptr<T, A>& ref) override;
 	virtual owner<T*> get() override;
 	virtual void discard() override;
 };
@@ -111,20 +116,21 @@ template<typename T> struct pass_null_ptr : pass_ptr<T> {
 /// If nothing extracts the pointer from the object by calling get(), the object is automatically deleted when the deconstructor is called.
 /// The copyFrom constructor and the copyFrom assignment operator both move the pointer from the incoming object to the recieving.
 ///</summary>
-template<typename T> struct pass_arr_ptr : pass_null_ptr<T> {
+template<typename T, class A = Util::heap_alloc> struct pass_arr_ptr : pass_null_ptr<T, A> {
 private:
 	uint32 sze = 0;
 
 public:
 	pass_arr_ptr(owner<T*>& ptra, int size);
 	pass_arr_ptr(owner<T*>&& ptra, int size);
-	pass_arr_ptr(pass_arr_ptr<T>& ref);
-	pass_arr_ptr(pass_ptr<T>& ref, int size = 1);
+	pass_arr_ptr(pass_arr_ptr<T, A>& ref);
+	pass_arr_ptr(pass_arr_ptr<T, A>&& ref) noexcept;
+	pass_arr_ptr(pass_ptr<T, A>& ref, int size = 1);
 	pass_arr_ptr(int size);
 	pass_arr_ptr();
 	virtual ~pass_arr_ptr() override;
 
-	virtual void operator=(pass_arr_ptr<T>& ref);
+	virtual void operator=(pass_arr_ptr<T, A>& ref);
 
 	///<summary>
 	///Returns the object at the index of the array
@@ -142,8 +148,9 @@ public:
 /// The wrap_ptr object are designed to wrap pointers to dynamically allocated data objects in a way that allows them to be treated like statically allocated data.
 /// This means, that the deconstructor of the wrap_ptr deletes the object, the copyFrom constructor deep copies the object, the assignment operator automatically copies the data from the passed object into the current (deep copyFrom).
 /// Move assignement operator and move (copyFrom) constructor are defined as well.
+/// Copies and deletes go through the allocation policy A (see alloc.h), a passed pointer has to be created through the same policy.
 ///</summary>
-template<typename T> struct wrap_ptr {
+template<typename T, class A = Util::heap_alloc> struct wrap_ptr {
 protected:
 	owner<T*> ptr = 0;
 
@@ -161,14 +168,14 @@ public:
 	///<summary>
 	///Creates a managed pointer object by copying the passed object (deep copyFrom)
 	///</summary>
-	wrap_ptr(const wrap_ptr<T>& ref);
+	wrap_ptr(const wrap_ptr<T, A>& ref);
 
 	///<summary>
 	///Creates a managed pointer object by copying the passed object (moves the pointer from the passed object into the current)
 	///</summary>
-	wrap_ptr(wrap_ptr<T>&& ref);
-	wrap_ptr(pass_ptr<T>& ref);
-	wrap_ptr(pass_ptr<T>&& ref);
+	wrap_ptr(wrap_ptr<T, A>&& ref) noexcept;
+	wrap_ptr(pass_ptr<T, A>& ref);
+	wrap_ptr(pass_ptr<T, A>&& ref);
 
 	///<summary>
 	/// Deletes the object
@@ -181,22 +188,22 @@ public:
 	///<summary>
 	///Sets the wrap pointer by copying the passed object (deep copyFrom)
 	///</summary>
-	void operator=(const wrap_ptr<T>& ref);
+	void operator=(const wrap_ptr<T, A>& ref);
 
 	///<summary>
 	///Sets the wrap pointer by copying the passed object (moves the pointer from the passed object into the current)
 	///</summary>
-	void operator=(wrap_ptr<T>&& ref) noexcept;
+	void operator=(wrap_ptr<T, A>&& ref) noexcept;
 
 	///<summary>
 	///Sets the wrap pointer by copying the passed object (deep copyFrom)
 	///</summary>
-	void operator=(pass_ptr<T>& ref);
+	void operator=(pass_ptr<T, A>& ref);
 
 	///<summary>
 	///Sets the wrap pointer by copying the passed object (moves the pointer from the passed object into the current)
 	///</summary>
-	void operator=(pass_ptr<T>&& ref);
+	void operator=(pass_ptr<T, A>&& ref);
 
 	///<summary>
 	///Returns whether the pointer object is currently holding a valid pointer
@@ -213,7 +220,7 @@ public:
 	///<summary>
 	///Extracts the pointer and marks the object as invalid
 	///</summary>
-	pass_null_ptr<T> extract();
+	pass_null_ptr<T, A> extract();
 
 	T* _cpy() const {
 		return this->ptr;
@@ -224,7 +231,7 @@ public:
 /// This means, that the deconstructor of the wrap_ptr deletes the object, the copyFrom constructor deep copies the object, the assignment operator automatically copies the data from the passed object into the current (deep copyFrom).
 /// Move assignement operator and move (copyFrom) constructor are defined as well.
 ///</summary>
-template<typename T> struct wrap_arr_ptr {
+template<typename T, class A = Util::heap_alloc> struct wrap_arr_ptr {
 protected:
 	owner<T*> ptr = 0;
 	size_t _size;
@@ -249,12 +256,12 @@ public:
 	///<summary>
 	///Creates a managed pointer object by copying the passed object (deep copyFrom)
 	///</summary>
-	wrap_arr_ptr(const wrap_arr_ptr<T>& ref);
+	wrap_arr_ptr(const wrap_arr_ptr<T, A>& ref);
 
 	///<summary>
 	///Creates a managed pointer object by copying the passed object (moves the pointer from the passed object into the current)
 	///</summary>
-	wrap_arr_ptr(wrap_arr_ptr<T>&& ref);
+	wrap_arr_ptr(wrap_arr_ptr<T, A>&& ref) noexcept;
 
 	///<summary>
 	/// Deletes the object
@@ -264,16 +271,22 @@ public:
 	///<summary>
 	///Sets the wrap pointer by copying the passed object (deep copyFrom)
 	///</summary>
-	void operator=(pass_arr_ptr<T>& ref);
+	void operator=(pass_arr_ptr<T, A>& ref);
 
 	///<summary>
 	///Sets the wrap pointer by copying the passed object (moves the pointer from the passed object into the current)
 	///</summary>
-	void operator=(pass_arr_ptr<T>&& ref);
+	void operator=(pass_arr_ptr<T, A>&& ref);
 
-	void operator=(const wrap_arr_ptr<T>& ref);
+	///<summary>
+	///Sets the wrap pointer by copying the elements of the passed object (deep copyFrom)
+	///</summary>
+	void operator=(const wrap_arr_ptr<T, A>& ref);
 
-	void operator=(wrap_arr_ptr<T>&& ref);
+	///<summary>
+	///Sets the wrap pointer by moving the array from the passed object into the current
+	///</summary>
+	void operator=(wrap_arr_ptr<T, A>&& ref) noexcept;
 
 	T& operator[](size_t ind);
 	const T& operator[](size_t ind) const;
@@ -281,12 +294,12 @@ public:
 	///<summary>
 	///Returns whether the pointer object is currently holding a valid pointer
 	///</summary>
-	bool valid();
+	bool valid() const;
 
 	///<summary>
 	/// Returns the size of the array
 	///</summary>
-	size_t size();
+	size_t size() const;
 
 	///<summary>
 	///deletes the encapsuled object and invalidates the pointer
@@ -297,7 +310,7 @@ public:
 	///Extracts the pointer and marks the object as invalid
 	///Transmits ownership
 	///</summary>
-	pass_ptr<T> extract();
+	pass_ptr<T, A> extract();
 
 	///<summary>
 	///This method returns a const ptr to the array
@@ -313,12 +326,21 @@ public:
 
 };
 
-template<typename T> struct DefaultDuplicator {
+template<typename T, class A = Util::heap_alloc, typename... Args>
+///<returns>A pass_ptr owning a T created through the allocation policy A</returns>
+pass_ptr<T, A> make_pass_ptr(Args&&... args) {
+	return pass_ptr<T, A>(A::template create<T>(std::forward<Args>(args)...));
+}
+
+template<typename T, class A = Util::heap_alloc> struct DefaultDuplicator {
 	T* operator()(const T& in) {
-		return new T(in);
+		return A::template create<T>(in);
 	}
 };
-template<typename T, class D = DefaultDuplicator<T>> 
+///<summary>
+/// Vector of owned pointers. The elements are created and destroyed through the allocation policy A, copies through D.
+///</summary>
+template<typename T, class A = Util::heap_alloc, class D = DefaultDuplicator<T, A>>
 struct ptr_vector {
 private:
 	std::vector<owner<T*>> cnt;
@@ -326,14 +348,14 @@ private:
 	void _delPtr() {
 		auto it = cnt.begin();
 		while (it != cnt.end()) {
-			delete* it;
+			A::destroy(*it);
 			*it = 0;
 			it++;
 		}
 	}
 public:
 
-	ptr_vector(std::initializer_list<pass_ptr<T>>&& init) {
+	ptr_vector(std::initializer_list<pass_ptr<T, A>>&& init) {
 		auto it = init.begin();
 		while (it != init.end()) {
 			this->push_back(*it);
@@ -341,9 +363,18 @@ public:
 		}
 	}
 	ptr_vector() {}
-	ptr_vector(const ptr_vector& in) {
+	///<summary>
+	///Deep copies the elements of in through D
+	///</summary>
+	explicit ptr_vector(const ptr_vector& in) {
 		this->operator=(in);
 	}
+	///<summary>
+	///Takes over the elements of in, in is empty afterwards
+	///</summary>
+	ptr_vector(ptr_vector&& in) noexcept : cnt(std::move(in.cnt)) {
+		in.cnt.clear();
+	}
 	~ptr_vector() {
 #ifdef __DEBUG
 		PRINT(std::string(typeid(T).name()) + " " + PTRSTR(this), CHANNEL_DECONST_DEBUG);
@@ -352,16 +383,26 @@ public:
 	}
 
 	void operator=(const ptr_vector& in) {
-		_delPtr();
+		if (this == &in) {
+			return;
+		}
+		//copy first, in may be owned by one of the current elements
+		std::vector<owner<T*>> copy;
+		copy.reserve(in.cnt.size());
 		D d;
 		for (uint32 i = 0; i < in.cnt.size(); i++) {
-			cnt.push_back(d(*in.cnt.at(i)));
+			copy.push_back(d(*in.cnt.at(i)));
 		}
+		_delPtr();
+		this->cnt = std::move(copy);
 	}
 
-	void operator=(ptr_vector&& in) {
+	void operator=(ptr_vector&& in) noexcept {
+		//take the elements first, in may be owned by one of the current elements
+		std::vector<owner<T*>> taken = std::move(in.cnt);
+		in.cnt.clear();
 		_delPtr();
-		this->cnt = in.cnt;
+		this->cnt = std::move(taken);
 	}
 
 	T& operator[](uint32 ind) {
@@ -372,10 +413,10 @@ public:
 		return cnt[ind];
 	}
 
-	void push_back(pass_ptr<T>& ptr) {
+	void push_back(pass_ptr<T, A>& ptr) {
 		this->cnt.push_back(ptr.get());
 	}
-	void push_back(pass_ptr<T>&& ptr) {
+	void push_back(pass_ptr<T, A>&& ptr) {
 		this->cnt.push_back(ptr.get());
 	}
 
@@ -394,8 +435,25 @@ public:
 	}
 	void erase(uint32 ind) {
 		T* ptr = this->cnt.at(ind);
-		delete ptr;
+		A::destroy(ptr);
+		cnt.erase(begin() + ind);
+	}
+	///<summary>
+	///Removes the element at ind without destroying it, ownership is transmitted to the caller
+	///</summary>
+	owner<T*> release(uint32 ind) {
+		T* ptr = this->cnt.at(ind);
 		cnt.erase(begin() + ind);
+		return ptr;
+	}
+	///<summary>
+	///Inserts ptr before the element at ind, ind may be size()
+	///</summary>
+	void insert(uint32 ind, pass_ptr<T, A>& ptr) {
+		this->cnt.insert(begin() + ind, ptr.get());
+	}
+	void insert(uint32 ind, pass_ptr<T, A>&& ptr) {
+		this->insert(ind, ptr);
 	}
 
 	void resize(uint32 size) {
@@ -419,43 +477,43 @@ public:
 	}
 };
 
-template<typename T> void pass_ptr<T>::_inv() {
+template<typename T, class A> void pass_ptr<T, A>::_inv() {
 	this->ptr = 0;
 }
-template<typename T> const T* pass_ptr<T>::getPtrCopy() {
+template<typename T, class A> const T* pass_ptr<T, A>::getPtrCopy() {
 	return ptr;
 }
-template<typename T> const T& pass_ptr<T>::getReference() const {
+template<typename T, class A> const T& pass_ptr<T, A>::getReference() const {
 	if (ptr) {
 		return *ptr;
 	}
 	PRINT_ERR("(NullPointer)", PRIORITY_HALT, CHANNEL_GENERAL_DEBUG);
 }
-template<typename T> T& pass_ptr<T>::getReference() {
+template<typename T, class A> T& pass_ptr<T, A>::getReference() {
 	if (ptr) {
 		return *ptr;
 	}
 	PRINT_ERR("(NullPointer)", PRIORITY_HALT, CHANNEL_GENERAL_DEBUG);
 }
-template<typename T> bool pass_ptr<T>::valid() const {
+template<typename T, class A> bool pass_ptr<T, A>::valid() const {
 	return ptr;
 }
-template<typename T> void pass_ptr<T>::discard() {
+template<typename T, class A> void pass_ptr<T, A>::discard() {
 	if (ptr) {
-		delete ptr;
+		A::destroy(ptr);
 		_inv();
 	}
 }
-template<typename T> void pass_ptr<T>::operator=(pass_ptr<T>& ref) {
+template<typename T, class A> void pass_ptr<T, A>::operator=(pass_ptr<T, A>& ref) {
 	if (ptr) {
-		delete ptr;
+		A::destroy(ptr);
 	}
 	ptr = ref.get();
 }
-template<typename T> T* pass_ptr<T>::operator->() {
+template<typename T, class A> T* pass_ptr<T, A>::operator->() {
 	return ptr;
 }
-template<typename T> T* pass_ptr<T>::get() {
+template<typename T, class A> T* pass_ptr<T, A>::get() {
 	if (ptr) {
 		T* temp = ptr;
 		this->_inv();
@@ -466,18 +524,18 @@ template<typename T> T* pass_ptr<T>::get() {
 	}
 	return NULL;
 }
-template<typename T> pass_ptr<T>::~pass_ptr() {
+template<typename T, class A> pass_ptr<T, A>::~pass_ptr() {
 	if (ptr) {
-		delete ptr;
+		A::destroy(ptr);
 	}
 }
-template<typename T> pass_ptr<T>::pass_ptr(pass_ptr<T>& ref) {
+template<typename T, class A> pass_ptr<T, A>::pass_ptr(pass_ptr<T, A>& ref) {
 	ptr = ref.get();
 }
-template<typename T> pass_ptr<T>::pass_ptr(pass_ptr<T>&& ref) noexcept {
+template<typename T, class A> pass_ptr<T, A>::pass_ptr(pass_ptr<T, A>&& ref) noexcept {
 	ptr = ref.get();
 }
-template<typename T> pass_ptr<T>::pass_ptr(owner<T*>&& ptra) {
+template<typename T, class A> pass_ptr<T, A>::pass_ptr(owner<T*>&& ptra) {
 	if (ptra) {
 		this->ptr = ptra;
 	}
@@ -485,7 +543,7 @@ template<typename T> pass_ptr<T>::pass_ptr(owner<T*>&& ptra) {
 		PRINT_ERR("Nullpointers are not allowd!", PRIORITY_HALT, CHANNEL_GENERAL_DEBUG);
 	}
 }
-template<typename T> pass_ptr<T>::pass_ptr(owner<T*>& ptra) {
+template<typename T, class A> pass_ptr<T, A>::pass_ptr(owner<T*>& ptra) {
 	if (ptra) {
 		this->ptr = ptra;
 		ptra = 0;
@@ -494,65 +552,71 @@ template<typename T> pass_ptr<T>::pass_ptr(owner<T*>& ptra) {
 		PRINT_ERR("Nullpointers are not allowd!", PRIORITY_HALT, CHANNEL_GENERAL_DEBUG);
 	}
 }
-template<typename T> pass_null_ptr<T>::pass_null_ptr(owner<T*>& ptra) {
+template<typename T, class A> pass_null_ptr<T, A>::pass_null_ptr(owner<T*>& ptra) {
 	this->ptr = ptra;
 	ptra = nullptr;
 }
-template<typename T> pass_null_ptr<T>::pass_null_ptr(owner<T*>&& ptra) {
+template<typename T, class A> pass_null_ptr<T, A>::pass_null_ptr(owner<T*>&& ptra) {
 	this->ptr = ptra;
 }
-template<typename T> pass_null_ptr<T>::pass_null_ptr(pass_ptr<T>& ref) {
+template<typename T, class A> pass_null_ptr<T, A>::pass_null_ptr(pass_ptr<T, A>& ref) {
 	this->ptr = ref.get();
 }
-template<typename T> pass_null_ptr<T>::pass_null_ptr(pass_null_ptr<T>& ref) {
+template<typename T, class A> pass_null_ptr<T, A>::pass_null_ptr(pass_null_ptr<T, A>& ref) {
 	this->ptr = ref.get();
 }
-template<typename T> pass_null_ptr<T>::pass_null_ptr(pass_null_ptr<T>&& ref) {
+template<typename T, class A> pass_null_ptr<T, A>::pass_null_ptr(pass_null_ptr<T, A>&& ref) {
 	this->ptr = ref.get();
 }
-template<typename T> pass_null_ptr<T>::pass_null_ptr() {
+template<typename T, class A> pass_null_ptr<T, A>::pass_null_ptr() {
 	this->ptr = nullptr;
 }
 
-template<typename T> pass_ptr<T> pass_null_ptr<T>::getDataPointer() {
-	return pass_ptr<T>(get());
+template<typename T, class A> pass_ptr<T, A> pass_null_ptr<T, A>::getDataPointer() {
+	return pass_ptr<T, A>(get());
 }
-template<typename T> void pass_null_ptr<T>::operator=(pass_ptr<T>& ref) {
+template<typename T, class A> void pass_null_ptr<T, A>::operator=(pass_ptr<T, A>& ref) {
 	discard();
 	this->ptr = ref.get();
 }
-template<typename T> T* pass_null_ptr<T>::get() {
+template<typename T, class A> T* pass_null_ptr<T, A>::get() {
 	T* temp = this->ptr;
 	this->_inv();
 	return temp;
 }
-template<typename T> void pass_null_ptr<T>::discard() {
+template<typename T, class A> void pass_null_ptr<T, A>::discard() {
 	if (this->ptr) {
-		delete this->ptr;
+		A::destroy(this->ptr);
 		this->_inv();
 	}
 }
-template<typename T> pass_arr_ptr<T>::pass_arr_ptr() : pass_ptr<T>(0) {}
-template<typename T> pass_arr_ptr<T>::pass_arr_ptr(owner<T*>& ptra, int size) : pass_ptr<T>(ptra) {
+template<typename T, class A> pass_arr_ptr<T, A>::pass_arr_ptr() : pass_null_ptr<T, A>() {}
+template<typename T, class A> pass_arr_ptr<T, A>::pass_arr_ptr(owner<T*>& ptra, int size) : pass_null_ptr<T, A>(ptra) {
 	this->sze = size;
 }
-template<typename T> pass_arr_ptr<T>::pass_arr_ptr(owner<T*>&& ptra, int size) : pass_ptr<T>(ptra) {
+template<typename T, class A> pass_arr_ptr<T, A>::pass_arr_ptr(owner<T*>&& ptra, int size) : pass_null_ptr<T, A>(ptra) {
 	this->sze = size;
 }
-template<typename T> pass_arr_ptr<T>::pass_arr_ptr(pass_arr_ptr<T>& ref) {
+template<typename T, class A> pass_arr_ptr<T, A>::pass_arr_ptr(pass_arr_ptr<T, A>& ref) {
 	this->operator=(ref);
 }
-template<typename T> pass_arr_ptr<T>::pass_arr_ptr(pass_ptr<T>& ref, int size) : pass_ptr<T>(ref) {
+template<typename T, class A> pass_arr_ptr<T, A>::pass_arr_ptr(pass_arr_ptr<T, A>&& ref) noexcept {
+	this->operator=(ref);
+}
+template<typename T, class A> pass_arr_ptr<T, A>::pass_arr_ptr(pass_ptr<T, A>& ref, int size) : pass_null_ptr<T, A>(ref) {
 	this->sze = size;
 }
-template<typename T> pass_arr_ptr<T>::pass_arr_ptr(int size) : pass_arr_ptr<T>(new T[size], size) { }
-template<typename T> void pass_arr_ptr<T>::operator=(pass_arr_ptr<T>& ref) {
+template<typename T, class A> pass_arr_ptr<T, A>::pass_arr_ptr(int size) : pass_arr_ptr<T, A>(A::template create_array<T>(size), size) { }
+template<typename T, class A> void pass_arr_ptr<T, A>::operator=(pass_arr_ptr<T, A>& ref) {
+	if (this == &ref) {
+		return;
+	}
 	discard();
+	this->sze = ref.sze;
 	this->ptr = ref.get();
-
-	this->sze = ref.size();
+	ref.sze = 0;
 }
-template<typename T> T& pass_arr_ptr<T>::operator[](int index) {
+template<typename T, class A> T& pass_arr_ptr<T, A>::operator[](int index) {
 	if (this->ptr && index < this->sze) {
 		return this->ptr[index];
 	}
@@ -560,7 +624,7 @@ template<typename T> T& pass_arr_ptr<T>::operator[](int index) {
 		PRINT_ERR(std::string("Invalid Access through operator[]: Invalid Size [param:") + std::to_string(index) + std::string(",size:") + std::to_string(size) + std::string("] or nonexisting Pointer"), PRIORITY_HALT, CHANNEL_GENERAL_DEBUG);
 	}
 }
-template<typename T> const T& pass_arr_ptr<T>::operator[](int index) const {
+template<typename T, class A> const T& pass_arr_ptr<T, A>::operator[](int index) const {
 	if (this->ptr && index < this->sze) {
 		return this->ptr[index];
 	}
@@ -568,155 +632,157 @@ template<typename T> const T& pass_arr_ptr<T>::operator[](int index) const {
 		PRINT_ERR(std::string("Invalid Access through operator[]: Invalid Size [param:") + std::to_string(index) + std::string(",size:") + std::to_string(size) + std::string("] or nonexisting Pointer"), PRIORITY_HALT, CHANNEL_GENERAL_DEBUG);
 	}
 }
-template<typename T> pass_arr_ptr<T>::~pass_arr_ptr() {
+template<typename T, class A> pass_arr_ptr<T, A>::~pass_arr_ptr() {
+	discard();
+}
+template<typename T, class A> void pass_arr_ptr<T, A>::discard() {
 	if (this->ptr) {
-		delete[] this->ptr;
+		A::destroy_array(this->ptr, this->sze);
+		this->_inv();
 	}
-}
-template<typename T> void pass_arr_ptr<T>::discard() {
-	pass_null_ptr<T>::discard();
 	this->sze = 0;
 }
-template<typename T>
-uint32 pass_arr_ptr<T>::size() {
+template<typename T, class A>
+uint32 pass_arr_ptr<T, A>::size() {
 	return this->sze;
 }
-template<typename T> wrap_ptr<T>::wrap_ptr(owner<T*>&& ptra) {
+template<typename T, class A> wrap_ptr<T, A>::wrap_ptr(owner<T*>&& ptra) {
 	this->ptr = ptra;
 }
-template<typename T> wrap_ptr<T>::wrap_ptr() {
+template<typename T, class A> wrap_ptr<T, A>::wrap_ptr() {
 	this->ptr = 0;
 }
-template<typename T> wrap_ptr<T>::wrap_ptr(const wrap_ptr<T>& ref) {
-	if (valid()) {
-		this->ptr->operator=(*ref.ptr);
-	}
-	else {
-		this->ptr = new T(*ref.ptr);
+template<typename T, class A> wrap_ptr<T, A>::wrap_ptr(const wrap_ptr<T, A>& ref) {
+	if (ref.valid()) {
+		this->ptr = A::template create<T>(*ref.ptr);
 	}
 }
-template<typename T> wrap_ptr<T>::wrap_ptr(wrap_ptr<T>&& ref) {
-	discard();
-	this->ptr = ref.extract().get();
+template<typename T, class A> wrap_ptr<T, A>::wrap_ptr(wrap_ptr<T, A>&& ref) noexcept {
+	this->ptr = std::exchange(ref.ptr, nullptr);
 }
-template<typename T> wrap_ptr<T>::wrap_ptr(pass_ptr<T>& ref) {
+template<typename T, class A> wrap_ptr<T, A>::wrap_ptr(pass_ptr<T, A>& ref) {
 	this->operator=(ref);
 }
-template<typename T> wrap_ptr<T>::wrap_ptr(pass_ptr<T>&& ref) {
+template<typename T, class A> wrap_ptr<T, A>::wrap_ptr(pass_ptr<T, A>&& ref) {
 	this->operator=(ref);
 }
-template<typename T> wrap_ptr<T>::~wrap_ptr() {
+template<typename T, class A> wrap_ptr<T, A>::~wrap_ptr() {
 	if (valid()) {
-		delete ptr;
+		A::destroy(ptr);
 	}
 }
-template<typename T> T* wrap_ptr<T>::operator->() {
+template<typename T, class A> T* wrap_ptr<T, A>::operator->() {
 	return ptr;
 }
-template<typename T> void wrap_ptr<T>::operator=(const wrap_ptr<T>& ref) {
-	discard();
-	if (ref.valid()) {
-		this->ptr = new T(*ref.ptr);
-	}
-	else {
-		this->ptr = nullptr;
+template<typename T, class A> void wrap_ptr<T, A>::operator=(const wrap_ptr<T, A>& ref) {
+	if (this == &ref) {
+		return;
 	}
+	//copy first, ref may be owned by the current object
+	T* copy = ref.valid() ? A::template create<T>(*ref.ptr) : nullptr;
+	discard();
+	this->ptr = copy;
 }
-template<typename T> void wrap_ptr<T>::operator=(wrap_ptr<T>&& ref) noexcept {
+template<typename T, class A> void wrap_ptr<T, A>::operator=(wrap_ptr<T, A>&& ref) noexcept {
+	//take the pointer first, ref may be owned by the current object
+	T* taken = std::exchange(ref.ptr, nullptr);
 	discard();
-	if (ref.valid()) {
-		this->ptr = ref.extract().get();
-	}
-	else {
-		this->ptr = nullptr;
-	}
+	this->ptr = taken;
 }
-template<typename T> bool wrap_ptr<T>::valid() const {
+template<typename T, class A> bool wrap_ptr<T, A>::valid() const {
 	return ptr;
 }
-template<typename T> void wrap_ptr<T>::discard() {
+template<typename T, class A> void wrap_ptr<T, A>::discard() {
 	if (ptr) {
-		delete ptr;
+		A::destroy(ptr);
 		ptr = 0;
 	}
 }
-template<typename T> pass_null_ptr<T> wrap_ptr<T>::extract() {
+template<typename T, class A> pass_null_ptr<T, A> wrap_ptr<T, A>::extract() {
 	T* copy = ptr;
 	ptr = nullptr;
-	return pass_null_ptr<T>(copy);
+	return pass_null_ptr<T, A>(copy);
 }
-template<typename T> void wrap_ptr<T>::operator=(pass_ptr<T>& ref) {
+template<typename T, class A> void wrap_ptr<T, A>::operator=(pass_ptr<T, A>& ref) {
 	discard();
 	this->ptr = ref.get();
 }
-template<typename T> void wrap_ptr<T>::operator=(pass_ptr<T>&& ref) {
+template<typename T, class A> void wrap_ptr<T, A>::operator=(pass_ptr<T, A>&& ref) {
 	discard();
 	this->ptr = ref.get();
 }
-template<typename T> const T& wrap_ptr<T>::getReference() const {
+template<typename T, class A> const T& wrap_ptr<T, A>::getReference() const {
 	return *ptr;
 }
-template<typename T> T& wrap_ptr<T>::getReference() {
+template<typename T, class A> T& wrap_ptr<T, A>::getReference() {
 	return *ptr;
 }
 
-template<typename T> wrap_arr_ptr<T>::wrap_arr_ptr(owner<T*>&& ptra, size_t size) {
+template<typename T, class A> wrap_arr_ptr<T, A>::wrap_arr_ptr(owner<T*>&& ptra, size_t size) {
 	this->ptr = ptra;
 	this->_size = size;
 }
-template<typename T> wrap_arr_ptr<T>::wrap_arr_ptr(size_t size) {
-	this->ptr = new T[size];
+template<typename T, class A> wrap_arr_ptr<T, A>::wrap_arr_ptr(size_t size) {
+	this->ptr = A::template create_array<T>(size);
 	this->_size = size;
 }
-template<typename T> wrap_arr_ptr<T>::wrap_arr_ptr() {
+template<typename T, class A> wrap_arr_ptr<T, A>::wrap_arr_ptr() {
 	this->ptr = nullptr;
 	this->_size = 0;
 }
-template<typename T> wrap_arr_ptr<T>::wrap_arr_ptr(const wrap_arr_ptr<T>& ref) {
-	this->_size = ref._size;
-	this->ptr = new T[this->_size];
-	for (size_t i = 0; i < _size; i++) {
-		this->ptr[i] = ref[i];
-	}
+template<typename T, class A> wrap_arr_ptr<T, A>::wrap_arr_ptr(const wrap_arr_ptr<T, A>& ref) {
+	this->_size = 0;
+	this->operator=(ref);
 }
-template<typename T> wrap_arr_ptr<T>::wrap_arr_ptr(wrap_arr_ptr<T>&& ref) {
-	this->ptr = ref.extract().get();
-	this->_size = ref._size;
+template<typename T, class A> wrap_arr_ptr<T, A>::wrap_arr_ptr(wrap_arr_ptr<T, A>&& ref) noexcept {
+	this->ptr = std::exchange(ref.ptr, nullptr);
+	this->_size = std::exchange(ref._size, 0);
 }
-template<typename T> wrap_arr_ptr<T>::~wrap_arr_ptr() {
+template<typename T, class A> wrap_arr_ptr<T, A>::~wrap_arr_ptr() {
 	discard();
 }
-template<typename T> void wrap_arr_ptr<T>::operator=(pass_arr_ptr<T>& ref) {
+template<typename T, class A> void wrap_arr_ptr<T, A>::operator=(pass_arr_ptr<T, A>& ref) {
 	discard();
-	this->_size = ref._size;
+	this->_size = ref.size();
 	this->ptr = ref.get();
 }
-template<typename T> void wrap_arr_ptr<T>::operator=(pass_arr_ptr<T>&& ref) {
-	discard();
-	this->_size = ref._size;
-	this->ptr = ref.get();
+template<typename T, class A> void wrap_arr_ptr<T, A>::operator=(pass_arr_ptr<T, A>&& ref) {
+	this->operator=(ref);
 }
-template<typename T> void wrap_arr_ptr<T>::operator=(const wrap_arr_ptr<T>& ref) {
+template<typename T, class A> void wrap_arr_ptr<T, A>::operator=(const wrap_arr_ptr<T, A>& ref) {
+	if (this == &ref) {
+		return;
+	}
+	T* copy = nullptr;
+	if (ref.valid()) {
+		copy = A::template create_array<T>(ref._size);
+		for (size_t i = 0; i < ref._size; i++) {
+			copy[i] = ref.ptr[i];
+		}
+	}
 	discard();
-	this->_size = ref._size;
-	this->ptr = ref.extract().get(); // @suppress("Invalid arguments")
+	this->ptr = copy;
+	this->_size = copy ? ref._size : 0;
 }
-template<typename T> void wrap_arr_ptr<T>::operator=(wrap_arr_ptr<T>&& ref) {
+template<typename T, class A> void wrap_arr_ptr<T, A>::operator=(wrap_arr_ptr<T, A>&& ref) noexcept {
+	//take the array first, ref may be owned by an element of the current one
+	T* taken = std::exchange(ref.ptr, nullptr);
+	const size_t size = std::exchange(ref._size, 0);
 	discard();
-	this->_size = ref._size;
-	this->ptr = ref.extract().get();
+	this->ptr = taken;
+	this->_size = size;
 }
 
-template<typename T> bool wrap_arr_ptr<T>::valid() {
+template<typename T, class A> bool wrap_arr_ptr<T, A>::valid() const {
 	return ptr;
 }
-template<typename T> T* wrap_arr_ptr<T>::data() {
+template<typename T, class A> T* wrap_arr_ptr<T, A>::data() {
 	return this->ptr;
 }
-template<typename T> const T* wrap_arr_ptr<T>::data() const {
+template<typename T, class A> const T* wrap_arr_ptr<T, A>::data() const {
 	return this->ptr;
 }
-template<typename T> T& wrap_arr_ptr<T>::operator[](size_t ind) {
+template<typename T, class A> T& wrap_arr_ptr<T, A>::operator[](size_t ind) {
 	if (valid() && ind < _size) {
 		return ptr[ind];
 	}
@@ -724,7 +790,7 @@ template<typename T> T& wrap_arr_ptr<T>::operator[](size_t ind) {
 		PRINT_ERR("Invalid Array Access!", PRIORITY_HALT, CHANNEL_GENERAL_DEBUG);
 	}
 }
-template<typename T> const T& wrap_arr_ptr<T>::operator[](size_t ind) const {
+template<typename T, class A> const T& wrap_arr_ptr<T, A>::operator[](size_t ind) const {
 	if (this->valid() && ind < _size) {
 		return ptr[ind];
 	}
@@ -732,19 +798,20 @@ template<typename T> const T& wrap_arr_ptr<T>::operator[](size_t ind) const {
 		PRINT_ERR("Invalid Array Access!", PRIORITY_HALT, CHANNEL_GENERAL_DEBUG);
 	}
 }
-template<typename T> size_t wrap_arr_ptr<T>::size() {
+template<typename T, class A> size_t wrap_arr_ptr<T, A>::size() const {
 	return _size;
 }
-template<typename T> void wrap_arr_ptr<T>::discard() {
+template<typename T, class A> void wrap_arr_ptr<T, A>::discard() {
 	if (valid()) {
-		delete[] ptr;
+		A::destroy_array(ptr, _size);
+		ptr = nullptr;
 		_size = 0;
 	}
 }
-template<typename T> pass_ptr<T> wrap_arr_ptr<T>::extract() {
+template<typename T, class A> pass_ptr<T, A> wrap_arr_ptr<T, A>::extract() {
 	this->_size = 0;
 	T* copy = ptr;
 	ptr = nullptr;
-	return pass_ptr<T>(copy);
+	return pass_ptr<T, A>(copy);
 }
 #endif
@@ -0,0 +1,300 @@
+#ifndef __H_QUANTIZED
+#define __H_QUANTIZED
+
+#include <bit>
+#include <compare>
+#include <limits>
+#include <type_traits>
+#include "dtypes.h"
+#include "math.h"
+#include "cpu.h"
+
+namespace math {
+
+	template<typename D>
+	/// <summary>
+	/// Arithmetic of the compact storage types, the operands are expanded to float and the result is stored as D again.
+	/// Mixing with float yields float.
+	/// </summary>
+	struct quantized_arithmetic {
+		friend constexpr D operator+(D a, D b) { return D(float(a) + float(b)); }
+		friend constexpr D operator-(D a, D b) { return D(float(a) - float(b)); }
+		friend constexpr D operator*(D a, D b) { return D(float(a) * float(b)); }
+		friend constexpr D operator/(D a, D b) { return D(float(a) / float(b)); }
+		friend constexpr D operator-(D a) { return D(-float(a)); }
+
+		friend constexpr float operator+(D a, float b) { return float(a) + b; }
+		friend constexpr float operator-(D a, float b) { return float(a) - b; }
+		friend constexpr float operator*(D a, float b) { return float(a) * b; }
+		friend constexpr float operator/(D a, float b) { return float(a) / b; }
+		friend constexpr float operator+(float a, D b) { return a + float(b); }
+		friend constexpr float operator-(float a, D b) { return a - float(b); }
+		friend constexpr float operator*(float a, D b) { return a * float(b); }
+		friend constexpr float operator/(float a, D b) { return a / float(b); }
+
+		friend constexpr D& operator+=(D& a, D b) { return a = a + b; }
+		friend constexpr D& operator-=(D& a, D b) { return a = a - b; }
+		friend constexpr D& operator*=(D& a, D b) { return a = a * b; }
+		friend constexpr D& operator/=(D& a, D b) { return a = a / b; }
+
+		friend constexpr bool operator==(D a, D b) { return float(a) == float(b); }
+		friend constexpr auto operator<=>(D a, D b) { return float(a) <=> float(b); }
+	};
+
+	///<returns>v rounded to the nearest integer, ties to even (the rounding of the SIMD conversions)</returns>
+	constexpr int64 round_even(float v) {
+		const int64 t = int64(v);
+		const float diff = v - float(t);
+		if (diff > 0.5f || (diff == 0.5f && (t & 1))) {
+			return t + 1;
+		}
+		if (diff < -0.5f || (diff == -0.5f && (t & 1))) {
+			return t - 1;
+		}
+		return t;
+	}
+
+	/// <summary>
+	/// IEEE 754 binary16 floating point number (1 sign, 5 exponent, 10 mantissa bits), the range is +-65504.
+	/// Meant for storage, the arithmetic is done in float.
+	/// </summary>
+	class half : public quantized_arithmetic<half> {
+	public:
+		constexpr half() { }
+		constexpr half(float v) : bits(encode(v)) { }
+		constexpr operator float() const { return decode(bits); }
+
+		static constexpr half from_bits(uint16 bits) {
+			half res;
+			res.bits = bits;
+			return res;
+		}
+		constexpr uint16 to_bits() const { return bits; }
+
+		///<summary>Rounds to the nearest half (ties to even), overflows to infinity and keeps NaNs quiet</summary>
+		static constexpr uint16 encode(float v);
+		static constexpr float decode(uint16 bits);
+
+	private:
+		uint16 bits = 0;
+	};
+
+	template<typename I>
+	/// <summary>
+	/// Fixed point number in [0, 1] (unsigned I) or [-1, 1] (signed I), stored as round(v * max(I)).
+	/// Values outside of the range saturate, for signed types both -max and min decode to -1.
+	/// </summary>
+	class normalized : public quantized_arithmetic<normalized<I>> {
+		static_assert(std::is_integral<I>::value && sizeof(I) <= 2, "normalized types are stored in 8 or 16 bit");
+	public:
+		static constexpr float scale = float(std::numeric_limits<I>::max());
+		static constexpr float lowest = std::is_signed<I>::value ? -1.f : 0.f;
+
+		constexpr normalized() { }
+		constexpr normalized(float v) : bits(encode(v)) { }
+		constexpr operator float() const { return decode(bits); }
+
+		static constexpr normalized from_bits(I bits) {
+			normalized res;
+			res.bits = bits;
+			return res;
+		}
+		constexpr I to_bits() const { return bits; }
+
+		static constexpr I encode(float v) {
+			//written such that NaN maps to the lower bound, like the SIMD min/max
+			v = v > lowest ? v : lowest;
+			v = v < 1.f ? v : 1.f;
+			return I(round_even(v * scale));
+		}
+		static constexpr float decode(I bits) {
+			const float v = float(bits) / scale;
+			return v > lowest ? v : lowest;
+		}
+
+	private:
+		I bits = 0;
+	};
+
+	using unorm8 = normalized<uint8>;
+	using unorm16 = normalized<uint16>;
+	using snorm16 = normalized<int16>;
+
+	/// <summary>
+	/// Signed 16.16 fixed point number. Addition and subtraction are exact, the product and quotient are truncated to 1/65536.
+	/// Results outside of [-32768, 32768) wrap around.
+	/// </summary>
+	class fixed16_16 {
+	public:
+		static constexpr float scale = 65536.f;
+
+		constexpr fixed16_16() { }
+		constexpr fixed16_16(float v) : bits(encode(v)) { }
+		constexpr operator float() const { return decode(bits); }
+
+		static constexpr fixed16_16 from_bits(int32 bits) {
+			fixed16_16 res;
+			res.bits = bits;
+			return res;
+		}
+		constexpr int32 to_bits() const { return bits; }
+
+		///<summary>Rounds to the nearest representable value and saturates at the range</summary>
+		static constexpr int32 encode(float v) {
+			v *= scale;
+			v = v > -2147483648.f ? v : -2147483648.f;
+			//the largest float below 2^31
+			v = v < 2147483520.f ? v : 2147483520.f;
+			return int32(round_even(v));
+		}
+		static constexpr float decode(int32 bits) {
+			return float(bits) * (1.f / scale);
+		}
+
+		friend constexpr fixed16_16 operator+(fixed16_16 a, fixed16_16 b) { return from_bits(int32(uint32(a.bits) + uint32(b.bits))); }
+		friend constexpr fixed16_16 operator-(fixed16_16 a, fixed16_16 b) { return from_bits(int32(uint32(a.bits) - uint32(b.bits))); }
+		friend constexpr fixed16_16 operator*(fixed16_16 a, fixed16_16 b) { return from_bits(int32((int64(a.bits) * b.bits) >> 16)); }
+		///<summary>b may not be 0</summary>
+		friend constexpr fixed16_16 operator/(fixed16_16 a, fixed16_16 b) { return from_bits(int32(int64(uint64(int64(a.bits)) << 16) / b.bits)); }
+		friend constexpr fixed16_16 operator-(fixed16_16 a) { return from_bits(int32(0u - uint32(a.bits))); }
+
+		friend constexpr float operator+(fixed16_16 a, float b) { return float(a) + b; }
+		friend constexpr float operator-(fixed16_16 a, float b) { return float(a) - b; }
+		friend constexpr float operator*(fixed16_16 a, float b) { return float(a) * b; }
+		friend constexpr float operator/(fixed16_16 a, float b) { return float(a) / b; }
+		friend constexpr float operator+(float a, fixed16_16 b) { return a + float(b); }
+		friend constexpr float operator-(float a, fixed16_16 b) { return a - float(b); }
+		friend constexpr float operator*(float a, fixed16_16 b) { return a * float(b); }
+		friend constexpr float operator/(float a, fixed16_16 b) { return a / float(b); }
+
+		constexpr fixed16_16& operator+=(fixed16_16 b) { return *this = *this + b; }
+		constexpr fixed16_16& operator-=(fixed16_16 b) { return *this = *this - b; }
+		constexpr fixed16_16& operator*=(fixed16_16 b) { return *this = *this * b; }
+		constexpr fixed16_16& operator/=(fixed16_16 b) { return *this = *this / b; }
+
+		friend constexpr bool operator==(fixed16_16 a, fixed16_16 b) { return a.bits == b.bits; }
+		friend constexpr auto operator<=>(fixed16_16 a, fixed16_16 b) { return a.bits <=> b.bits; }
+
+	private:
+		int32 bits = 0;
+	};
+
+	static_assert(math_type<half> && math_type<unorm8> && math_type<unorm16> && math_type<snorm16> && math_type<fixed16_16>);
+	static_assert(sizeof(half) == 2 && sizeof(unorm8) == 1 && sizeof(unorm16) == 2 && sizeof(snorm16) == 2 && sizeof(fixed16_16) == 4,
+		"the compact types may only consist of their bits");
+
+	/// <summary>
+	/// Bulk conversions between the compact types and float, dispatched to the best instruction set (F16C for half, see Util::Cpu).
+	/// The rounding equals the one of the single value conversions.
+	/// </summary>
+	struct quantized_math {
+		static void to_float(float* dst, const half* src, size_t count) {
+			Util::Cpu::kernels.half_to_float(dst, reinterpret_cast<const uint16*>(src), count);
+		}
+		static void from_float(half* dst, const float* src, size_t count) {
+			Util::Cpu::kernels.float_to_half(reinterpret_cast<uint16*>(dst), src, count);
+		}
+		static void to_float(float* dst, const unorm8* src, size_t count) {
+			Util::Cpu::kernels.unorm8_to_float(dst, reinterpret_cast<const uint8*>(src), count);
+		}
+		static void from_float(unorm8* dst, const float* src, size_t count) {
+			Util::Cpu::kernels.float_to_unorm8(reinterpret_cast<uint8*>(dst), src, count);
+		}
+		static void to_float(float* dst, const unorm16* src, size_t count) {
+			Util::Cpu::kernels.unorm16_to_float(dst, reinterpret_cast<const uint16*>(src), count);
+		}
+		static void from_float(unorm16* dst, const float* src, size_t count) {
+			Util::Cpu::kernels.float_to_unorm16(reinterpret_cast<uint16*>(dst), src, count);
+		}
+		static void to_float(float* dst, const snorm16* src, size_t count) {
+			Util::Cpu::kernels.snorm16_to_float(dst, reinterpret_cast<const int16*>(src), count);
+		}
+		static void from_float(snorm16* dst, const float* src, size_t count) {
+			Util::Cpu::kernels.float_to_snorm16(reinterpret_cast<int16*>(dst), src, count);
+		}
+		static void to_float(float* dst, const fixed16_16* src, size_t count) {
+			Util::Cpu::kernels.fixed_to_float(dst, reinterpret_cast<const int32*>(src), count);
+		}
+		static void from_float(fixed16_16* dst, const float* src, size_t count) {
+			Util::Cpu::kernels.float_to_fixed(reinterpret_cast<int32*>(dst), src, count);
+		}
+
+		template<typename Q, size_t A, size_t... S>
+		///<returns>The elements of src expanded to float</returns>
+		static comp<float, A, S...> to_float(const comp<Q, A, S...>& src) {
+			comp<float, A, S...> res;
+			to_float(res.data(), src.data(), descriptor_size<A, S...>::value);
+			return res;
+		}
+
+		template<typename Q, size_t A>
+		static vector<float, A> to_float(const vector<Q, A>& src) {
+			vector<float, A> res;
+			to_float(res.data(), src.data(), A);
+			return res;
+		}
+	};
+
+//#######################################################################################################################
+
+	constexpr uint16 half::encode(float v) {
+		const uint32 x = std::bit_cast<uint32>(v);
+		const uint16 sign = uint16((x >> 16) & 0x8000);
+		const uint32 abs = x & 0x7FFFFFFF;
+		if (abs >= 0x7F800000) {
+			//infinity, NaNs stay NaNs with the upper payload bits
+			return sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 | uint16((abs >> 13) & 0x3FF) : 0);
+		}
+		if (abs >= 0x477FF000) {
+			//rounds to 65520 or above
+			return sign | 0x7C00;
+		}
+		const uint32 exp = abs >> 23;
+		if (exp < 113) {
+			//below 2^-14 the result is subnormal, counted in units of 2^-24
+			if (exp < 102) {
+				return sign;
+			}
+			const uint32 mant = (abs & 0x7FFFFF) | 0x800000;
+			const uint32 shift = 126 - exp;
+			uint32 res = mant >> shift;
+			const uint32 rem = mant & ((1u << shift) - 1);
+			const uint32 mid = 1u << (shift - 1);
+			if (rem > mid || (rem == mid && (res & 1))) {
+				++res;
+			}
+			return sign | uint16(res);
+		}
+		uint32 res = ((exp - 112) << 10) | ((abs >> 13) & 0x3FF);
+		const uint32 rem = abs & 0x1FFF;
+		//a carry out of the mantissa correctly increments the exponent
+		if (rem > 0x1000 || (rem == 0x1000 && (res & 1))) {
+			++res;
+		}
+		return sign | uint16(res);
+	}
+
+	constexpr float half::decode(uint16 bits) {
+		const uint32 sign = uint32(bits & 0x8000) << 16;
+		const uint32 exp = (bits >> 10) & 0x1F;
+		uint32 mant = bits & 0x3FF;
+		if (exp == 0x1F) {
+			return std::bit_cast<float>(sign | 0x7F800000 | (mant != 0 ? 0x400000 : 0) | (mant << 13));
+		}
+		if (exp == 0) {
+			if (mant == 0) {
+				return std::bit_cast<float>(sign);
+			}
+			//subnormal, normalize the mantissa
+			uint32 e = 113;
+			while (!(mant & 0x400)) {
+				mant <<= 1;
+				--e;
+			}
+			return std::bit_cast<float>(sign | (e << 23) | ((mant & 0x3FF) << 13));
+		}
+		return std::bit_cast<float>(sign | ((exp + 112) << 23) | (mant << 13));
+	}
+}
+
+#endif
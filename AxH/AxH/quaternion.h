@@ -0,0 +1,408 @@
+#ifndef __H_QUATERNION
+#define __H_QUATERNION
+
+#include <cmath>
+#include "math.h"
+#include "batch.h"
+
+namespace math {
+
+	template<std::floating_point T>
+	/// <summary>
+	/// Rotation quaternion x*i + y*j + z*k + w. The rotations follow the matrix convention of the math module (v' = M * v),
+	/// therefore a * b rotates by b first and by a afterwards.
+	/// </summary>
+	class quaternion {
+	public:
+		using value_type = T;
+
+		T x = T(0);
+		T y = T(0);
+		T z = T(0);
+		T w = T(1);
+
+		///<summary>The identity rotation</summary>
+		constexpr quaternion() { }
+		constexpr quaternion(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) { }
+		///<summary>Takes the components in the order x, y, z, w</summary>
+		constexpr explicit quaternion(const vector<T, 4>& v) : x(v[0]), y(v[1]), z(v[2]), w(v[3]) { }
+
+		///<summary>
+		/// Rotation by angle (radians) around the normalized axis
+		///</summary>
+		static quaternion from_axis_angle(const vector<T, 3>& axis, T angle);
+		///<summary>
+		/// Converts a rotation matrix, the matrix has to be orthonormal (see polar_decomposition)
+		///</summary>
+		static constexpr quaternion from_matrix(const matrix<T, 3, 3>& m);
+		///<summary>
+		/// Converts the rotation part (upper 3x3 block) of the matrix
+		///</summary>
+		static constexpr quaternion from_matrix(const matrix<T, 4, 4>& m);
+
+		constexpr matrix<T, 3, 3> to_matrix3() const;
+		///<returns>The rotation matrix without translation</returns>
+		constexpr matrix<T, 4, 4> to_matrix4() const;
+		constexpr vector<T, 4> as_vector() const;
+
+		///<returns>The composed rotation, rhs is applied first</returns>
+		constexpr quaternion operator*(const quaternion& rhs) const;
+		constexpr quaternion& operator*=(const quaternion& rhs);
+
+		constexpr quaternion conjugate() const { return quaternion(-x, -y, -z, w); }
+		///<returns>The inverse, for unit quaternions this equals the conjugate</returns>
+		constexpr quaternion inverse() const;
+		constexpr T dot(const quaternion& q) const { return x * q.x + y * q.y + z * q.z + w * q.w; }
+		constexpr T length() const { return math::sqrt(dot(*this)); }
+		constexpr quaternion normalized() const;
+
+		///<returns>v rotated by this unit quaternion</returns>
+		constexpr vector<T, 3> rotate(const vector<T, 3>& v) const;
+	};
+
+	/// <summary>
+	/// Interpolation of rotations. The batch versions work on quaternion_batch (planes x, y, z, w) and interpolate
+	/// simd::float_pack::width rotations per step, which is what sampling the keyframes of many bones needs.
+	/// All interpolations take the shorter arc.
+	/// </summary>
+	struct quaternion_math {
+		template<std::floating_point T>
+		///<summary>Normalized linear interpolation, cheap and good enough for close keyframes</summary>
+		static constexpr quaternion<T> nlerp(const quaternion<T>& a, const quaternion<T>& b, T t);
+
+		template<std::floating_point T>
+		///<summary>Spherical linear interpolation with constant angular velocity</summary>
+		static quaternion<T> slerp(const quaternion<T>& a, const quaternion<T>& b, T t);
+
+		template<std::floating_point T>
+		///<summary>dst[i] = nlerp(a[i], b[i], t[i]), t has to hold a.size() elements</summary>
+		static void nlerp(vector_batch<T, 4>& dst, const vector_batch<T, 4>& a, const vector_batch<T, 4>& b, const T* t);
+
+		template<std::floating_point T>
+		///<summary>
+		/// dst[i] = slerp(a[i], b[i], t[i]), t has to hold a.size() elements.
+		/// Uses the polynomial approximation of Eberly ("A Fast and Accurate Algorithm for Computing SLERP"), which needs no trigonometric functions.
+		/// The error of the weights is below 3e-5 and below 1e-6 for rotations less than 120 degrees apart, as between keyframes.
+		///</summary>
+		static void slerp(vector_batch<T, 4>& dst, const vector_batch<T, 4>& a, const vector_batch<T, 4>& b, const T* t);
+
+		template<std::floating_point T>
+		///<summary>Converts the unit quaternions to rotation matrices</summary>
+		static void to_matrix(matrix_batch<T, 3, 3>& dst, const vector_batch<T, 4>& q);
+
+		template<std::floating_point T>
+		///<summary>dst[i] = q[i] applied to v[i]</summary>
+		static void rotate(vector_batch<T, 3>& dst, const vector_batch<T, 4>& q, const vector_batch<T, 3>& v);
+
+	private:
+		template<typename T>
+		using pack = typename simd::pack_of<T>::type;
+
+		template<std::floating_point T>
+		static void _load_t(pack<T>& dst, const T* t, size_t i, size_t size);
+	};
+
+	template<std::floating_point T>
+	/// <summary>
+	/// Structure of arrays storage of quaternions, the planes hold x, y, z and w
+	/// </summary>
+	using quaternion_batch = vector_batch<T, 4>;
+
+//#######################################################################################################################
+
+	template<std::floating_point T>
+	quaternion<T> quaternion<T>::from_axis_angle(const vector<T, 3>& axis, T angle) {
+		const T s = std::sin(angle * T(0.5));
+		return quaternion(axis[0] * s, axis[1] * s, axis[2] * s, std::cos(angle * T(0.5)));
+	}
+
+	template<std::floating_point T>
+	constexpr quaternion<T> quaternion<T>::from_matrix(const matrix<T, 3, 3>& m) {
+		const T* a = m.data();
+		const T trace = a[0] + a[4] + a[8];
+		//pick the largest of w, x, y, z to divide by (Shepperd)
+		if (trace > T(0)) {
+			const T s = math::sqrt(trace + T(1)) * T(2);
+			return quaternion((a[7] - a[5]) / s, (a[2] - a[6]) / s, (a[3] - a[1]) / s, T(0.25) * s);
+		}
+		if (a[0] > a[4] && a[0] > a[8]) {
+			const T s = math::sqrt(T(1) + a[0] - a[4] - a[8]) * T(2);
+			return quaternion(T(0.25) * s, (a[1] + a[3]) / s, (a[2] + a[6]) / s, (a[7] - a[5]) / s);
+		}
+		if (a[4] > a[8]) {
+			const T s = math::sqrt(T(1) + a[4] - a[0] - a[8]) * T(2);
+			return quaternion((a[1] + a[3]) / s, T(0.25) * s, (a[5] + a[7]) / s, (a[2] - a[6]) / s);
+		}
+		const T s = math::sqrt(T(1) + a[8] - a[0] - a[4]) * T(2);
+		return quaternion((a[2] + a[6]) / s, (a[5] + a[7]) / s, T(0.25) * s, (a[3] - a[1]) / s);
+	}
+
+	template<std::floating_point T>
+	constexpr quaternion<T> quaternion<T>::from_matrix(const matrix<T, 4, 4>& m) {
+		const T* a = m.data();
+		matrix<T, 3, 3> rot;
+		for (size_t r = 0; r < 3; ++r) {
+			for (size_t c = 0; c < 3; ++c) {
+				rot.data()[r * 3 + c] = a[r * 4 + c];
+			}
+		}
+		return from_matrix(rot);
+	}
+
+	template<std::floating_point T>
+	constexpr matrix<T, 3, 3> quaternion<T>::to_matrix3() const {
+		const T xx = x * x, yy = y * y, zz = z * z;
+		const T xy = x * y, xz = x * z, yz = y * z;
+		const T wx = w * x, wy = w * y, wz = w * z;
+		matrix<T, 3, 3> m;
+		T* a = m.data();
+		a[0] = T(1) - T(2) * (yy + zz);
+		a[1] = T(2) * (xy - wz);
+		a[2] = T(2) * (xz + wy);
+		a[3] = T(2) * (xy + wz);
+		a[4] = T(1) - T(2) * (xx + zz);
+		a[5] = T(2) * (yz - wx);
+		a[6] = T(2) * (xz - wy);
+		a[7] = T(2) * (yz + wx);
+		a[8] = T(1) - T(2) * (xx + yy);
+		return m;
+	}
+
+	template<std::floating_point T>
+	constexpr matrix<T, 4, 4> quaternion<T>::to_matrix4() const {
+		const matrix<T, 3, 3> rot = to_matrix3();
+		matrix<T, 4, 4> m;
+		for (size_t r = 0; r < 3; ++r) {
+			for (size_t c = 0; c < 3; ++c) {
+				m.data()[r * 4 + c] = rot.data()[r * 3 + c];
+			}
+		}
+		m.data()[15] = T(1);
+		return m;
+	}
+
+	template<std::floating_point T>
+	constexpr vector<T, 4> quaternion<T>::as_vector() const {
+		vector<T, 4> v;
+		v[0] = x;
+		v[1] = y;
+		v[2] = z;
+		v[3] = w;
+		return v;
+	}
+
+	template<std::floating_point T>
+	constexpr quaternion<T> quaternion<T>::operator*(const quaternion& r) const {
+		return quaternion(
+			w * r.x + x * r.w + y * r.z - z * r.y,
+			w * r.y - x * r.z + y * r.w + z * r.x,
+			w * r.z + x * r.y - y * r.x + z * r.w,
+			w * r.w - x * r.x - y * r.y - z * r.z);
+	}
+
+	template<std::floating_point T>
+	constexpr quaternion<T>& quaternion<T>::operator*=(const quaternion& rhs) {
+		*this = *this * rhs;
+		return *this;
+	}
+
+	template<std::floating_point T>
+	constexpr quaternion<T> quaternion<T>::inverse() const {
+		const T inv = T(1) / dot(*this);
+		return quaternion(-x * inv, -y * inv, -z * inv, w * inv);
+	}
+
+	template<std::floating_point T>
+	constexpr quaternion<T> quaternion<T>::normalized() const {
+		const T inv = T(1) / length();
+		return quaternion(x * inv, y * inv, z * inv, w * inv);
+	}
+
+	template<std::floating_point T>
+	constexpr vector<T, 3> quaternion<T>::rotate(const vector<T, 3>& v) const {
+		//v' = v + 2w (u x v) + 2 u x (u x v) with u = (x, y, z)
+		const T tx = T(2) * (y * v[2] - z * v[1]);
+		const T ty = T(2) * (z * v[0] - x * v[2]);
+		const T tz = T(2) * (x * v[1] - y * v[0]);
+		vector<T, 3> res;
+		res[0] = v[0] + w * tx + (y * tz - z * ty);
+		res[1] = v[1] + w * ty + (z * tx - x * tz);
+		res[2] = v[2] + w * tz + (x * ty - y * tx);
+		return res;
+	}
+
+	template<std::floating_point T>
+	constexpr quaternion<T> quaternion_math::nlerp(const quaternion<T>& a, const quaternion<T>& b, T t) {
+		const T tb = a.dot(b) < T(0) ? -t : t;
+		const T ta = T(1) - t;
+		return quaternion<T>(ta * a.x + tb * b.x, ta * a.y + tb * b.y, ta * a.z + tb * b.z, ta * a.w + tb * b.w).normalized();
+	}
+
+	template<std::floating_point T>
+	quaternion<T> quaternion_math::slerp(const quaternion<T>& a, const quaternion<T>& b, T t) {
+		T cosTheta = a.dot(b);
+		T sign = T(1);
+		if (cosTheta < T(0)) {
+			cosTheta = -cosTheta;
+			sign = T(-1);
+		}
+		T ta = T(1) - t;
+		T tb = t;
+		//for close rotations the weights of nlerp are exact enough and sin(theta) would vanish
+		if (cosTheta < T(1) - std::numeric_limits<T>::epsilon() * T(16)) {
+			const T theta = std::acos(cosTheta);
+			const T inv = T(1) / std::sin(theta);
+			ta = std::sin(ta * theta) * inv;
+			tb = std::sin(tb * theta) * inv;
+		}
+		tb *= sign;
+		return quaternion<T>(ta * a.x + tb * b.x, ta * a.y + tb * b.y, ta * a.z + tb * b.z, ta * a.w + tb * b.w);
+	}
+
+	template<std::floating_point T>
+	void quaternion_math::_load_t(pack<T>& dst, const T* t, size_t i, size_t size) {
+		using P = pack<T>;
+		if (i + P::width <= size) {
+			dst = P::loadu(t + i);
+		}
+		else {
+			alignas(simd::batch_alignment) T tail[P::width] = {};
+			for (size_t l = 0; i + l < size; ++l) {
+				tail[l] = t[i + l];
+			}
+			dst = P::load(tail);
+		}
+	}
+
+	template<std::floating_point T>
+	void quaternion_math::nlerp(vector_batch<T, 4>& dst, const vector_batch<T, 4>& a, const vector_batch<T, 4>& b, const T* t) {
+		ROBUST_ASSERT(a.size() == b.size(), "batch sizes do not match", CHANNEL_MATH);
+		using P = pack<T>;
+		const size_t n = a.size();
+		dst.resize(n);
+		const P one = P::set1(T(1));
+		const P tiny = P::set1(std::numeric_limits<T>::min());
+		for (size_t i = 0; i < n; i += P::width) {
+			P pa[4], pb[4];
+			for (size_t c = 0; c < 4; ++c) {
+				pa[c] = P::load(a.plane(c) + i);
+				pb[c] = P::load(b.plane(c) + i);
+			}
+			P pt;
+			_load_t(pt, t, i, n);
+			P d = pa[0] * pb[0];
+			for (size_t c = 1; c < 4; ++c) {
+				d = P::fmadd(pa[c], pb[c], d);
+			}
+			const P tb = P::copysign(pt, d);
+			const P ta = one - pt;
+			P r[4];
+			P len = P::set1(T(0));
+			for (size_t c = 0; c < 4; ++c) {
+				r[c] = P::fmadd(tb, pb[c], ta * pa[c]);
+				len = P::fmadd(r[c], r[c], len);
+			}
+			const P inv = one / P::max(P::sqrt(len), tiny);
+			for (size_t c = 0; c < 4; ++c) {
+				(r[c] * inv).store(dst.plane(c) + i);
+			}
+		}
+	}
+
+	template<std::floating_point T>
+	void quaternion_math::slerp(vector_batch<T, 4>& dst, const vector_batch<T, 4>& a, const vector_batch<T, 4>& b, const T* t) {
+		ROBUST_ASSERT(a.size() == b.size(), "batch sizes do not match", CHANNEL_MATH);
+		using P = pack<T>;
+		constexpr T mu = T(1.90110745351730037);
+		//u_i = 1 / (i (2i + 1)), v_i = i / (2i + 1), the last term is corrected by mu
+		constexpr T u[8] = { T(1) / (1 * 3), T(1) / (2 * 5), T(1) / (3 * 7), T(1) / (4 * 9), T(1) / (5 * 11), T(1) / (6 * 13), T(1) / (7 * 15), mu / (8 * 17) };
+		constexpr T v[8] = { T(1) / 3, T(2) / 5, T(3) / 7, T(4) / 9, T(5) / 11, T(6) / 13, T(7) / 15, mu * 8 / 17 };
+		const size_t n = a.size();
+		dst.resize(n);
+		const P one = P::set1(T(1));
+		for (size_t i = 0; i < n; i += P::width) {
+			P pa[4], pb[4];
+			for (size_t c = 0; c < 4; ++c) {
+				pa[c] = P::load(a.plane(c) + i);
+				pb[c] = P::load(b.plane(c) + i);
+			}
+			P pt;
+			_load_t(pt, t, i, n);
+			P d = pa[0] * pb[0];
+			for (size_t c = 1; c < 4; ++c) {
+				d = P::fmadd(pa[c], pb[c], d);
+			}
+			const P xm1 = P::abs(d) - one;
+			const P pd = one - pt;
+			const P sqrT = pt * pt;
+			const P sqrD = pd * pd;
+			P ct = one;
+			P cd = one;
+			for (size_t k = 8; k-- > 0;) {
+				const P pu = P::set1(u[k]);
+				const P pv = P::set1(v[k]);
+				ct = P::fmadd((pu * sqrT - pv) * xm1, ct, one);
+				cd = P::fmadd((pu * sqrD - pv) * xm1, cd, one);
+			}
+			//weights t (1 + b0 (1 + b1 (...))), the sign of the dot product selects the shorter arc
+			ct = P::copysign(pt * ct, d);
+			cd = pd * cd;
+			for (size_t c = 0; c < 4; ++c) {
+				P::fmadd(ct, pb[c], cd * pa[c]).store(dst.plane(c) + i);
+			}
+		}
+	}
+
+	template<std::floating_point T>
+	void quaternion_math::to_matrix(matrix_batch<T, 3, 3>& dst, const vector_batch<T, 4>& q) {
+		using P = pack<T>;
+		const size_t n = q.size();
+		dst.resize(n);
+		const P one = P::set1(T(1));
+		const P two = P::set1(T(2));
+		for (size_t i = 0; i < n; i += P::width) {
+			const P x = P::load(q.plane(0) + i);
+			const P y = P::load(q.plane(1) + i);
+			const P z = P::load(q.plane(2) + i);
+			const P w = P::load(q.plane(3) + i);
+			const P xx = x * x, yy = y * y, zz = z * z;
+			const P xy = x * y, xz = x * z, yz = y * z;
+			const P wx = w * x, wy = w * y, wz = w * z;
+			(one - two * (yy + zz)).store(dst.element(0, 0) + i);
+			(two * (xy - wz)).store(dst.element(0, 1) + i);
+			(two * (xz + wy)).store(dst.element(0, 2) + i);
+			(two * (xy + wz)).store(dst.element(1, 0) + i);
+			(one - two * (xx + zz)).store(dst.element(1, 1) + i);
+			(two * (yz - wx)).store(dst.element(1, 2) + i);
+			(two * (xz - wy)).store(dst.element(2, 0) + i);
+			(two * (yz + wx)).store(dst.element(2, 1) + i);
+			(one - two * (xx + yy)).store(dst.element(2, 2) + i);
+		}
+	}
+
+	template<std::floating_point T>
+	void quaternion_math::rotate(vector_batch<T, 3>& dst, const vector_batch<T, 4>& q, const vector_batch<T, 3>& v) {
+		ROBUST_ASSERT(q.size() == v.size(), "batch sizes do not match", CHANNEL_MATH);
+		using P = pack<T>;
+		const size_t n = v.size();
+		dst.resize(n);
+		const P two = P::set1(T(2));
+		for (size_t i = 0; i < n; i += P::width) {
+			const P x = P::load(q.plane(0) + i);
+			const P y = P::load(q.plane(1) + i);
+			const P z = P::load(q.plane(2) + i);
+			const P w = P::load(q.plane(3) + i);
+			const P vx = P::load(v.plane(0) + i);
+			const P vy = P::load(v.plane(1) + i);
+			const P vz = P::load(v.plane(2) + i);
+			const P tx = two * (y * vz - z * vy);
+			const P ty = two * (z * vx - x * vz);
+			const P tz = two * (x * vy - y * vx);
+			P::fmadd(w, tx, vx + (y * tz - z * ty)).store(dst.plane(0) + i);
+			P::fmadd(w, ty, vy + (z * tx - x * tz)).store(dst.plane(1) + i);
+			P::fmadd(w, tz, vz + (x * ty - y * tx)).store(dst.plane(2) + i);
+		}
+	}
+}
+
+#endif
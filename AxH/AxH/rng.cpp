@@ -0,0 +1,131 @@
+#include "rng.h"
+#include "approx.h"
+
+using namespace math;
+
+static uint64 _splitmix64(uint64& x) {
+	uint64 z = (x += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+xoshiro128::xoshiro128(uint64 seed) {
+	const uint64 a = _splitmix64(seed);
+	const uint64 b = _splitmix64(seed);
+	_s[0] = uint32(a);
+	_s[1] = uint32(a >> 32);
+	_s[2] = uint32(b);
+	_s[3] = uint32(b >> 32);
+	if ((_s[0] | _s[1] | _s[2] | _s[3]) == 0) {
+		//the all zero state is a fixed point
+		_s[0] = 1;
+	}
+}
+
+void xoshiro128::_jump(const uint32* poly) {
+	uint32 s[4] = {};
+	for (size_t k = 0; k < 4; ++k) {
+		for (size_t b = 0; b < 32; ++b) {
+			if (poly[k] & (1u << b)) {
+				for (size_t w = 0; w < 4; ++w) {
+					s[w] ^= _s[w];
+				}
+			}
+			next();
+		}
+	}
+	for (size_t w = 0; w < 4; ++w) {
+		_s[w] = s[w];
+	}
+}
+
+void xoshiro128::jump() {
+	static constexpr uint32 poly[4] = { 0x8764000bu, 0xf542d2d3u, 0x6fa035c3u, 0x77f2db5bu };
+	_jump(poly);
+}
+
+void xoshiro128::long_jump() {
+	static constexpr uint32 poly[4] = { 0xb523952eu, 0x0b6f099fu, 0xccf5a0efu, 0x1c580662u };
+	_jump(poly);
+}
+
+random_generator::random_generator(uint64 seed, uint32 stream) {
+	this->seed(seed, stream);
+}
+
+void random_generator::seed(uint64 seed, uint32 stream) {
+	xoshiro128 gen(seed);
+	for (uint32 s = 0; s < stream; ++s) {
+		gen.long_jump();
+	}
+	for (size_t l = 0; l < LANES; ++l) {
+		for (size_t w = 0; w < 4; ++w) {
+			_state[w][l] = gen.state()[w];
+		}
+		gen.jump();
+	}
+}
+
+void random_generator::_load(ipack (&s)[PACKS][4]) const {
+	for (size_t p = 0; p < PACKS; ++p) {
+		for (size_t w = 0; w < 4; ++w) {
+			s[p][w] = ipack::load(_state[w] + p * W);
+		}
+	}
+}
+
+void random_generator::_store(const ipack (&s)[PACKS][4]) {
+	for (size_t p = 0; p < PACKS; ++p) {
+		for (size_t w = 0; w < 4; ++w) {
+			s[p][w].store(_state[w] + p * W);
+		}
+	}
+}
+
+void random_generator::bits(uint32* out, size_t count) {
+	_steps(count, LANES, [&](ipack* s, size_t step, size_t lane) {
+		_put(out, step * LANES + lane, count, _next(s));
+	});
+}
+
+void random_generator::uniform(float* out, size_t count, float lo, float hi) {
+	const pack offset = pack::set1(lo);
+	const pack scale = pack::set1(hi - lo);
+	_steps(count, LANES, [&](ipack* s, size_t step, size_t lane) {
+		_put(out, step * LANES + lane, count, pack::fmadd(_unit(_next(s)), scale, offset));
+	});
+}
+
+void random_generator::normal(float* out, size_t count, float mean, float sigma) {
+	const pack m = pack::set1(mean);
+	const pack sd = pack::set1(sigma);
+	//one step of two draws gives LANES cosine values followed by LANES sine values
+	_steps(count, 2 * LANES, [&](ipack* s, size_t step, size_t lane) {
+		//u in (0, 1], the logarithm stays finite
+		const pack u = _unit(_next(s)) + pack::set1(1.f / 16777216.f);
+		const pack angle = pack::fmadd(_unit(_next(s)), pack::set1(6.28318531f), pack::set1(-3.14159265f));
+		const pack r = approx_math::sqrt(approx_math::log(u) * pack::set1(-2.f)) * sd;
+		const size_t i = step * 2 * LANES + lane;
+		_put(out, i, count, pack::fmadd(r, approx_math::cos(angle), m));
+		_put(out, i + LANES, count, pack::fmadd(r, approx_math::sin(angle), m));
+	});
+}
+
+void random_generator::unit_sphere(float* x, float* y, float* z, size_t count) {
+	//z uniform in [-1, 1] and a uniform angle around it (Archimedes)
+	_steps(count, LANES, [&](ipack* s, size_t step, size_t lane) {
+		const pack h = pack::fmadd(_unit(_next(s)), pack::set1(2.f), pack::set1(-1.f));
+		const pack angle = pack::fmadd(_unit(_next(s)), pack::set1(6.28318531f), pack::set1(-3.14159265f));
+		const pack r = approx_math::sqrt(pack::max(pack::set1(1.f) - h * h, pack::set1(0.f)));
+		const size_t i = step * LANES + lane;
+		_put(x, i, count, r * approx_math::cos(angle));
+		_put(y, i, count, r * approx_math::sin(angle));
+		_put(z, i, count, h);
+	});
+}
+
+void random_generator::unit_sphere(vector_batch<float, 3>& out, size_t count) {
+	out.resize(count);
+	unit_sphere(out.component(0), out.component(1), out.component(2), count);
+}
@@ -0,0 +1,164 @@
+#ifndef __H_RNG
+#define __H_RNG
+
+#include <bit>
+#include <algorithm>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "simd.h"
+#include "batch.h"
+
+namespace math {
+
+	/// <summary>
+	/// xoshiro128++ pseudo random number generator, period 2^128 - 1.
+	/// Equal seeds produce equal sequences on every platform, jump() and long_jump() split the period into non overlapping streams.
+	/// </summary>
+	class xoshiro128 {
+	public:
+		///<summary>The state is expanded from the seed with splitmix64</summary>
+		explicit xoshiro128(uint64 seed = 0);
+
+		uint32 next();
+		///<returns>A uniform float in [0, 1), multiples of 2^-24</returns>
+		float uniform();
+		///<returns>A uniform integer in [0, bound), bound has to be positive</returns>
+		uint32 below(uint32 bound);
+
+		///<summary>Advances the generator by 2^64 steps</summary>
+		void jump();
+		///<summary>Advances the generator by 2^96 steps</summary>
+		void long_jump();
+
+		const uint32* state() const { return _s; }
+
+	private:
+		uint32 _s[4];
+
+		void _jump(const uint32* poly);
+	};
+
+	/// <summary>
+	/// LANES interleaved xoshiro128++ generators filling whole buffers, the kernels run on simd::int_pack.
+	/// Value i of a fill comes from lane i % LANES, independent of the pack width, so a seed and stream reproduce the same
+	/// integers and uniform floats on every build. Derived distributions (uniform ranges, normal, sphere) use fmadd and approx_math,
+	/// they reproduce exactly on the same build and within the rounding of the instruction set elsewhere.
+	/// Fills always consume whole steps of LANES values, the values of a partial step beyond count are discarded.
+	///
+	/// A generator must not be shared between threads. Every thread gets its own stream instead:
+	/// stream s starts 2^96 * s steps into the sequence of the seed and lane l of it 2^64 * l steps further,
+	/// so streams never overlap for s &lt; 2^32. Constructing stream s takes O(s) time.
+	/// </summary>
+	class random_generator {
+	public:
+		static constexpr size_t LANES = 16;
+
+		explicit random_generator(uint64 seed = 0, uint32 stream = 0);
+		void seed(uint64 seed, uint32 stream = 0);
+
+		///<summary>Fills out with uniformly distributed 32 bit integers</summary>
+		void bits(uint32* out, size_t count);
+		///<summary>Fills out with floats uniform in [lo, hi), for lo = 0 and hi = 1 the values are multiples of 2^-24</summary>
+		void uniform(float* out, size_t count, float lo = 0.f, float hi = 1.f);
+		///<summary>Fills out with normally distributed floats (Box-Muller), the tails end at about 5.8 sigma</summary>
+		void normal(float* out, size_t count, float mean = 0.f, float sigma = 1.f);
+		///<summary>Fills x, y and z with points uniformly distributed on the unit sphere, |p| = 1 within 2^-20</summary>
+		void unit_sphere(float* x, float* y, float* z, size_t count);
+		///<summary>Resizes out to count and fills it with points uniformly distributed on the unit sphere</summary>
+		void unit_sphere(vector_batch<float, 3>& out, size_t count);
+
+	private:
+		using pack = simd::float_pack;
+		using ipack = simd::int_pack;
+		static constexpr size_t W = ipack::width;
+		static constexpr size_t PACKS = LANES / W;
+		static_assert(LANES % W == 0, "the lanes have to fill whole packs");
+
+		///<summary>Word k of all lanes is stored contiguously</summary>
+		alignas(simd::batch_alignment) uint32 _state[4][LANES];
+
+		///<summary>Copies the state into registers, fills operate on the copy and write it back once</summary>
+		void _load(ipack (&s)[PACKS][4]) const;
+		void _store(const ipack (&s)[PACKS][4]);
+		static ipack _next(ipack* s);
+		///<returns>(bits >> 8) * 2^-24 in [0, 1)</returns>
+		static pack _unit(ipack bits);
+
+		template<typename T, typename P>
+		///<summary>Stores the lanes of v to out[i] ..., clipped at count</summary>
+		static void _put(T* out, size_t i, size_t count, P v);
+
+		template<typename F>
+		///<summary>
+		/// Calls fn(s, step, lane) for every pack of the steps needed for count values, when one step produces perStep values.
+		/// s is the state of the pack and lane the index of its first lane.
+		///</summary>
+		void _steps(size_t count, size_t perStep, F&& fn);
+	};
+
+//#######################################################################################################################
+
+	inline uint32 xoshiro128::next() {
+		const uint32 res = std::rotl(_s[0] + _s[3], 7) + _s[0];
+		const uint32 t = _s[1] << 9;
+		_s[2] ^= _s[0];
+		_s[3] ^= _s[1];
+		_s[1] ^= _s[2];
+		_s[0] ^= _s[3];
+		_s[2] ^= t;
+		_s[3] = std::rotl(_s[3], 11);
+		return res;
+	}
+
+	inline float xoshiro128::uniform() {
+		return float(next() >> 8) * (1.f / 16777216.f);
+	}
+
+	inline uint32 xoshiro128::below(uint32 bound) {
+		//multiply shift range reduction, the bias is below bound / 2^32
+		return uint32((uint64(next()) * bound) >> 32);
+	}
+
+	inline random_generator::ipack random_generator::_next(ipack* s) {
+		const ipack res = ipack::rotl<7>(s[0] + s[3]) + s[0];
+		const ipack t = ipack::shl<9>(s[1]);
+		s[2] = s[2] ^ s[0];
+		s[3] = s[3] ^ s[1];
+		s[1] = s[1] ^ s[2];
+		s[0] = s[0] ^ s[3];
+		s[2] = s[2] ^ t;
+		s[3] = ipack::rotl<11>(s[3]);
+		return res;
+	}
+
+	inline random_generator::pack random_generator::_unit(ipack bits) {
+		return ipack::to_float(ipack::shr<8>(bits)) * pack::set1(1.f / 16777216.f);
+	}
+
+	template<typename T, typename P>
+	void random_generator::_put(T* out, size_t i, size_t count, P v) {
+		if (i + W <= count) {
+			v.storeu(out + i);
+		}
+		else if (i < count) {
+			alignas(simd::batch_alignment) T tail[W];
+			v.store(tail);
+			std::copy(tail, tail + (count - i), out + i);
+		}
+	}
+
+	template<typename F>
+	void random_generator::_steps(size_t count, size_t perStep, F&& fn) {
+		ipack s[PACKS][4];
+		_load(s);
+		for (size_t step = 0; step * perStep < count; ++step) {
+			for (size_t p = 0; p < PACKS; ++p) {
+				fn(s[p], step, p * W);
+			}
+		}
+		_store(s);
+	}
+}
+
+#endif
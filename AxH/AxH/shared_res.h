@@ -0,0 +1,239 @@
+#ifndef __H_SHARED_RES
+#define __H_SHARED_RES
+
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "dtypes.h"
+#include "alloc.h"
+
+template<typename T, class A> struct shared_res;
+template<typename T, class A> struct weak_res;
+
+///<summary>
+/// Object and reference counts of a shared_res, allocated as one block through the allocation policy.
+/// weak counts the weak_res plus one for all shared_res together, the block is freed when it drops to zero.
+///</summary>
+template<typename T> struct _shared_block {
+	std::atomic<uint32> strong{ 1 };
+	std::atomic<uint32> weak{ 1 };
+	alignas(T) unsigned char storage[sizeof(T)];
+
+	T* object() {
+		return std::launder(reinterpret_cast<T*>(storage));
+	}
+};
+
+///<summary>
+/// The shared_res is designed for objects used by several owners, possibly on different threads (textures, models, decoded assets).
+/// The object lives until the last shared_res to it is gone, weak_res observe it without keeping it alive.
+/// Object and counts share one allocation, a shared_res is one pointer wide and copying it is one atomic increment.
+/// Copies of the same shared_res may be used on different threads, a single shared_res object must not be modified concurrently.
+/// The object itself is not synchronized by the shared_res.
+/// The last release, and with it the destruction, may happen on any thread, so Util::thread_pool_alloc is rejected as policy.
+///</summary>
+template<typename T, class A = Util::heap_alloc> struct shared_res {
+	static_assert(!std::is_same<A, Util::thread_pool_alloc>::value, "shared_res may be released on any thread, thread_pool_alloc requires the creating thread");
+
+private:
+	_shared_block<T>* block = nullptr;
+
+	explicit shared_res(_shared_block<T>* b) : block(b) {}
+
+	template<typename U, class B, typename... Args> friend shared_res<U, B> make_shared_res(Args&&... args);
+	friend struct weak_res<T, A>;
+
+public:
+	///<summary>
+	///Creates a null shared_res
+	///</summary>
+	shared_res() {}
+	shared_res(const shared_res<T, A>& ref);
+	shared_res(shared_res<T, A>&& ref) noexcept;
+	~shared_res();
+
+	void operator=(const shared_res<T, A>& ref);
+	void operator=(shared_res<T, A>&& ref) noexcept;
+
+	T* operator->() const;
+	T& getReference() const;
+
+	///<summary>
+	///Returns whether the object holds a reference
+	///</summary>
+	bool valid() const {
+		return block;
+	}
+	///<summary>
+	///Returns the number of shared_res to the object, only a hint while other threads copy or release it
+	///</summary>
+	uint32 useCount() const {
+		return block ? block->strong.load(std::memory_order_relaxed) : 0;
+	}
+	///<summary>
+	///Drops the reference, destroys the object if it was the last one
+	///</summary>
+	void discard();
+
+	bool operator==(const shared_res<T, A>& ref) const {
+		return block == ref.block;
+	}
+	bool operator!=(const shared_res<T, A>& ref) const {
+		return block != ref.block;
+	}
+};
+
+///<summary>
+/// Non owning reference to the object of a shared_res, lock() returns a shared_res while the object is alive.
+///</summary>
+template<typename T, class A = Util::heap_alloc> struct weak_res {
+	static_assert(!std::is_same<A, Util::thread_pool_alloc>::value, "weak_res may free the block on any thread, thread_pool_alloc requires the creating thread");
+
+private:
+	_shared_block<T>* block = nullptr;
+
+public:
+	weak_res() {}
+	weak_res(const shared_res<T, A>& ref);
+	weak_res(const weak_res<T, A>& ref);
+	weak_res(weak_res<T, A>&& ref) noexcept;
+	~weak_res();
+
+	void operator=(const weak_res<T, A>& ref);
+	void operator=(weak_res<T, A>&& ref) noexcept;
+
+	///<summary>
+	///Returns a shared_res to the object, a null shared_res if it is already destroyed
+	///</summary>
+	shared_res<T, A> lock() const;
+	///<summary>
+	///Returns whether the object is destroyed, only a hint while other threads release it
+	///</summary>
+	bool expired() const {
+		return !block || block->strong.load(std::memory_order_relaxed) == 0;
+	}
+	void discard();
+};
+
+template<typename T, class A = Util::heap_alloc, typename... Args>
+///<returns>A shared_res owning a T constructed from args, object and counts are one allocation through A</returns>
+shared_res<T, A> make_shared_res(Args&&... args) {
+	_shared_block<T>* b = A::template create<_shared_block<T>>();
+	try {
+		new (b->storage) T(std::forward<Args>(args)...);
+	}
+	catch (...) {
+		A::destroy(b);
+		throw;
+	}
+	return shared_res<T, A>(b);
+}
+
+template<typename T, class A> void _releaseWeak(_shared_block<T>* b) {
+	if (b->weak.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		A::destroy(b);
+	}
+}
+
+template<typename T, class A> shared_res<T, A>::shared_res(const shared_res<T, A>& ref) : block(ref.block) {
+	if (block) {
+		block->strong.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+template<typename T, class A> shared_res<T, A>::shared_res(shared_res<T, A>&& ref) noexcept : block(std::exchange(ref.block, nullptr)) {}
+template<typename T, class A> shared_res<T, A>::~shared_res() {
+	discard();
+}
+template<typename T, class A> void shared_res<T, A>::operator=(const shared_res<T, A>& ref) {
+	if (block == ref.block) {
+		return;
+	}
+	_shared_block<T>* b = ref.block;
+	if (b) {
+		b->strong.fetch_add(1, std::memory_order_relaxed);
+	}
+	discard();
+	block = b;
+}
+template<typename T, class A> void shared_res<T, A>::operator=(shared_res<T, A>&& ref) noexcept {
+	//take the new block first, ref may live inside the object released by discard()
+	_shared_block<T>* b = std::exchange(ref.block, nullptr);
+	discard();
+	block = b;
+}
+template<typename T, class A> T* shared_res<T, A>::operator->() const {
+	ROBUST_ASSERT(block, "Invalid Pointer Operation! (NullPointer)", CHANNEL_GENERAL_DEBUG);
+	return block->object();
+}
+template<typename T, class A> T& shared_res<T, A>::getReference() const {
+	ROBUST_ASSERT(block, "Invalid Pointer Operation! (NullPointer)", CHANNEL_GENERAL_DEBUG);
+	return *block->object();
+}
+template<typename T, class A> void shared_res<T, A>::discard() {
+	_shared_block<T>* b = std::exchange(block, nullptr);
+	if (b && b->strong.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		b->object()->~T();
+		//without weak_res nobody else can reach the block, the second atomic operation is skipped
+		if (b->weak.load(std::memory_order_acquire) == 1) {
+			A::destroy(b);
+		}
+		else {
+			_releaseWeak<T, A>(b);
+		}
+	}
+}
+
+template<typename T, class A> weak_res<T, A>::weak_res(const shared_res<T, A>& ref) : block(ref.block) {
+	if (block) {
+		block->weak.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+template<typename T, class A> weak_res<T, A>::weak_res(const weak_res<T, A>& ref) : block(ref.block) {
+	if (block) {
+		block->weak.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+template<typename T, class A> weak_res<T, A>::weak_res(weak_res<T, A>&& ref) noexcept : block(std::exchange(ref.block, nullptr)) {}
+template<typename T, class A> weak_res<T, A>::~weak_res() {
+	discard();
+}
+template<typename T, class A> void weak_res<T, A>::operator=(const weak_res<T, A>& ref) {
+	if (block == ref.block) {
+		return;
+	}
+	_shared_block<T>* b = ref.block;
+	if (b) {
+		b->weak.fetch_add(1, std::memory_order_relaxed);
+	}
+	discard();
+	block = b;
+}
+template<typename T, class A> void weak_res<T, A>::operator=(weak_res<T, A>&& ref) noexcept {
+	//take the new block first, ref may live inside the object released by discard()
+	_shared_block<T>* b = std::exchange(ref.block, nullptr);
+	discard();
+	block = b;
+}
+template<typename T, class A> shared_res<T, A> weak_res<T, A>::lock() const {
+	if (!block) {
+		return shared_res<T, A>();
+	}
+	uint32 count = block->strong.load(std::memory_order_relaxed);
+	while (count != 0) {
+		if (block->strong.compare_exchange_weak(count, count + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+			return shared_res<T, A>(block);
+		}
+	}
+	return shared_res<T, A>();
+}
+template<typename T, class A> void weak_res<T, A>::discard() {
+	_shared_block<T>* b = std::exchange(block, nullptr);
+	if (b) {
+		_releaseWeak<T, A>(b);
+	}
+}
+
+#endif
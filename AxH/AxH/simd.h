@@ -0,0 +1,900 @@
+#ifndef __H_SIMD
+#define __H_SIMD
+
+#include <bit>
+#include <cstddef>
+#include <cmath>
+#include <type_traits>
+
+#include "inc_settings.h"
+#include "dtypes.h"
+
+//SSE is part of every x64 target, AVX has to be enabled by the compiler flags (/arch:AVX, -mavx)
+#ifndef __NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define __SIMD_SSE
+#endif
+#if defined(__SIMD_SSE) && defined(__AVX__)
+#define __SIMD_AVX
+#endif
+#if defined(__SIMD_AVX) && defined(__AVX512F__)
+#define __SIMD_AVX512
+#endif
+#endif
+
+#ifdef __SIMD_SSE
+#include <immintrin.h>
+#endif
+
+namespace math {
+	namespace simd {
+
+		template<typename T, size_t N>
+		/// <summary>
+		/// The alignment used for the storage of N elements of type T.
+		/// Float storage with a multiple of four elements is aligned to 16 bytes, so that it can be loaded into a single SSE register per four elements.
+		/// </summary>
+		struct storage_alignment {
+			static constexpr size_t value = (std::is_same<T, float>::value && N % 4 == 0) ? 16 : alignof(T);
+		};
+
+		template<typename T, size_t A>
+		/// <summary>
+		/// Element wise kernels for vectors with A components. This is the scalar fallback, which is also used in constant expressions.
+		/// All pointers point to contiguous storage of A elements, dst may alias the inputs.
+		/// </summary>
+		struct scalar_vector_kernel {
+			static constexpr void add(T* dst, const T* a, const T* b) {
+				for (size_t t = 0; t < A; ++t) {
+					dst[t] = a[t] + b[t];
+				}
+			}
+			static constexpr void sub(T* dst, const T* a, const T* b) {
+				for (size_t t = 0; t < A; ++t) {
+					dst[t] = a[t] - b[t];
+				}
+			}
+			static constexpr void scale(T* dst, const T* a, T s) {
+				for (size_t t = 0; t < A; ++t) {
+					dst[t] = a[t] * s;
+				}
+			}
+			static constexpr T dot(const T* a, const T* b) {
+				T val = T();
+				for (size_t t = 0; t < A; ++t) {
+					val += a[t] * b[t];
+				}
+				return val;
+			}
+		};
+
+		template<typename T, size_t A, size_t B, size_t C>
+		/// <summary>
+		/// Kernels for row major matrices. This is the scalar fallback, which is also used in constant expressions.
+		/// dst must not alias the inputs.
+		/// </summary>
+		struct scalar_matrix_kernel {
+			/// <summary>
+			/// dst(AxC) = a(AxB) * b(BxC)
+			/// </summary>
+			static constexpr void mul(T* dst, const T* a, const T* b) {
+				for (size_t i = 0; i < A; ++i) {
+					for (size_t j = 0; j < C; ++j) {
+						T val = T();
+						for (size_t k = 0; k < B; ++k) {
+							val += a[i * B + k] * b[k * C + j];
+						}
+						dst[i * C + j] = val;
+					}
+				}
+			}
+			/// <summary>
+			/// dst(A) = a(AxB) * v(B)
+			/// </summary>
+			static constexpr void mul_vec(T* dst, const T* a, const T* v) {
+				for (size_t i = 0; i < A; ++i) {
+					T val = T();
+					for (size_t k = 0; k < B; ++k) {
+						val += a[i * B + k] * v[k];
+					}
+					dst[i] = val;
+				}
+			}
+		};
+
+		template<typename T, size_t A>
+		/// <summary>
+		/// Element wise kernels for vectors with A components, the specializations below use SIMD instructions.
+		/// </summary>
+		struct vector_kernel : scalar_vector_kernel<T, A> { };
+
+		template<typename T, size_t A, size_t B, size_t C>
+		/// <summary>
+		/// Kernels for row major matrices, the specializations below use SIMD instructions.
+		/// </summary>
+		struct matrix_kernel : scalar_matrix_kernel<T, A, B, C> { };
+
+		template<typename T, size_t N>
+		/// <summary>
+		/// Unrolled inverse and determinant of row major NxN matrices, only defined for N = 2, 3, 4.
+		/// The kernels do not branch on the determinant, singular matrices give non finite results.
+		/// </summary>
+		struct scalar_inverse_kernel;
+
+		template<typename T>
+		struct scalar_inverse_kernel<T, 2> {
+			static constexpr T determinant(const T* m) {
+				return m[0] * m[3] - m[1] * m[2];
+			}
+			/// <summary>
+			/// dst = m^-1, dst may alias m
+			/// </summary>
+			/// <returns>The determinant of m</returns>
+			static constexpr T inverse(T* dst, const T* m) {
+				const T det = determinant(m);
+				const T inv = T(1) / det;
+				const T a = m[0], b = m[1], c = m[2], d = m[3];
+				dst[0] = d * inv;
+				dst[1] = -b * inv;
+				dst[2] = -c * inv;
+				dst[3] = a * inv;
+				return det;
+			}
+		};
+
+		template<typename T>
+		struct scalar_inverse_kernel<T, 3> {
+			static constexpr T determinant(const T* m) {
+				return m[0] * (m[4] * m[8] - m[5] * m[7])
+					- m[1] * (m[3] * m[8] - m[5] * m[6])
+					+ m[2] * (m[3] * m[7] - m[4] * m[6]);
+			}
+			static constexpr T inverse(T* dst, const T* m) {
+				//cofactors of the first row
+				const T c0 = m[4] * m[8] - m[5] * m[7];
+				const T c1 = m[5] * m[6] - m[3] * m[8];
+				const T c2 = m[3] * m[7] - m[4] * m[6];
+				const T det = m[0] * c0 + m[1] * c1 + m[2] * c2;
+				const T inv = T(1) / det;
+				T res[9] = {
+					c0 * inv, (m[2] * m[7] - m[1] * m[8]) * inv, (m[1] * m[5] - m[2] * m[4]) * inv,
+					c1 * inv, (m[0] * m[8] - m[2] * m[6]) * inv, (m[2] * m[3] - m[0] * m[5]) * inv,
+					c2 * inv, (m[1] * m[6] - m[0] * m[7]) * inv, (m[0] * m[4] - m[1] * m[3]) * inv
+				};
+				for (size_t t = 0; t < 9; ++t) {
+					dst[t] = res[t];
+				}
+				return det;
+			}
+		};
+
+		template<typename T>
+		struct scalar_inverse_kernel<T, 4> {
+			static constexpr T determinant(const T* m) {
+				const T s0 = m[0] * m[5] - m[4] * m[1];
+				const T s1 = m[0] * m[6] - m[4] * m[2];
+				const T s2 = m[0] * m[7] - m[4] * m[3];
+				const T s3 = m[1] * m[6] - m[5] * m[2];
+				const T s4 = m[1] * m[7] - m[5] * m[3];
+				const T s5 = m[2] * m[7] - m[6] * m[3];
+				const T c5 = m[10] * m[15] - m[14] * m[11];
+				const T c4 = m[9] * m[15] - m[13] * m[11];
+				const T c3 = m[9] * m[14] - m[13] * m[10];
+				const T c2 = m[8] * m[15] - m[12] * m[11];
+				const T c1 = m[8] * m[14] - m[12] * m[10];
+				const T c0 = m[8] * m[13] - m[12] * m[9];
+				return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+			}
+			static constexpr T inverse(T* dst, const T* m) {
+				//2x2 sub determinants of the upper (s) and lower (c) two rows
+				const T s0 = m[0] * m[5] - m[4] * m[1];
+				const T s1 = m[0] * m[6] - m[4] * m[2];
+				const T s2 = m[0] * m[7] - m[4] * m[3];
+				const T s3 = m[1] * m[6] - m[5] * m[2];
+				const T s4 = m[1] * m[7] - m[5] * m[3];
+				const T s5 = m[2] * m[7] - m[6] * m[3];
+				const T c5 = m[10] * m[15] - m[14] * m[11];
+				const T c4 = m[9] * m[15] - m[13] * m[11];
+				const T c3 = m[9] * m[14] - m[13] * m[10];
+				const T c2 = m[8] * m[15] - m[12] * m[11];
+				const T c1 = m[8] * m[14] - m[12] * m[10];
+				const T c0 = m[8] * m[13] - m[12] * m[9];
+				const T det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+				const T inv = T(1) / det;
+				T res[16] = {
+					(m[5] * c5 - m[6] * c4 + m[7] * c3) * inv,
+					(-m[1] * c5 + m[2] * c4 - m[3] * c3) * inv,
+					(m[13] * s5 - m[14] * s4 + m[15] * s3) * inv,
+					(-m[9] * s5 + m[10] * s4 - m[11] * s3) * inv,
+
+					(-m[4] * c5 + m[6] * c2 - m[7] * c1) * inv,
+					(m[0] * c5 - m[2] * c2 + m[3] * c1) * inv,
+					(-m[12] * s5 + m[14] * s2 - m[15] * s1) * inv,
+					(m[8] * s5 - m[10] * s2 + m[11] * s1) * inv,
+
+					(m[4] * c4 - m[5] * c2 + m[7] * c0) * inv,
+					(-m[0] * c4 + m[1] * c2 - m[3] * c0) * inv,
+					(m[12] * s4 - m[13] * s2 + m[15] * s0) * inv,
+					(-m[8] * s4 + m[9] * s2 - m[11] * s0) * inv,
+
+					(-m[4] * c3 + m[5] * c1 - m[6] * c0) * inv,
+					(m[0] * c3 - m[1] * c1 + m[2] * c0) * inv,
+					(-m[12] * s3 + m[13] * s1 - m[14] * s0) * inv,
+					(m[8] * s3 - m[9] * s1 + m[10] * s0) * inv
+				};
+				for (size_t t = 0; t < 16; ++t) {
+					dst[t] = res[t];
+				}
+				return det;
+			}
+		};
+
+		template<typename T, size_t N>
+		/// <summary>
+		/// Inverse and determinant kernels, the specializations below use SIMD instructions.
+		/// </summary>
+		struct inverse_kernel : scalar_inverse_kernel<T, N> { };
+
+#ifdef __SIMD_SSE
+		/// <summary>
+		/// Loads two floats into the lower lanes, the upper lanes are zero
+		/// </summary>
+		inline __m128 load2(const float* p) {
+			//__m64 may alias any type, loading through double* would not
+			return _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p));
+		}
+		/// <summary>
+		/// Loads three floats into the lower lanes, the upper lane is zero
+		/// </summary>
+		inline __m128 load3(const float* p) {
+			return _mm_movelh_ps(load2(p), _mm_load_ss(p + 2));
+		}
+		inline void store2(float* p, __m128 v) {
+			_mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+		}
+		inline void store3(float* p, __m128 v) {
+			store2(p, v);
+			_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+		}
+		/// <summary>
+		/// Returns the sum of all four lanes
+		/// </summary>
+		inline float hsum(__m128 v) {
+			__m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+			__m128 sums = _mm_add_ps(v, shuf);
+			shuf = _mm_movehl_ps(shuf, sums);
+			return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+		}
+
+		template<>
+		struct vector_kernel<float, 4> {
+			static constexpr void add(float* dst, const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					scalar_vector_kernel<float, 4>::add(dst, a, b);
+					return;
+				}
+				_mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+			}
+			static constexpr void sub(float* dst, const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					scalar_vector_kernel<float, 4>::sub(dst, a, b);
+					return;
+				}
+				_mm_storeu_ps(dst, _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+			}
+			static constexpr void scale(float* dst, const float* a, float s) {
+				if (std::is_constant_evaluated()) {
+					scalar_vector_kernel<float, 4>::scale(dst, a, s);
+					return;
+				}
+				_mm_storeu_ps(dst, _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(s)));
+			}
+			static constexpr float dot(const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					return scalar_vector_kernel<float, 4>::dot(a, b);
+				}
+				return hsum(_mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+			}
+		};
+
+		template<>
+		struct vector_kernel<float, 3> {
+			static constexpr void add(float* dst, const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					scalar_vector_kernel<float, 3>::add(dst, a, b);
+					return;
+				}
+				store3(dst, _mm_add_ps(load3(a), load3(b)));
+			}
+			static constexpr void sub(float* dst, const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					scalar_vector_kernel<float, 3>::sub(dst, a, b);
+					return;
+				}
+				store3(dst, _mm_sub_ps(load3(a), load3(b)));
+			}
+			static constexpr void scale(float* dst, const float* a, float s) {
+				if (std::is_constant_evaluated()) {
+					scalar_vector_kernel<float, 3>::scale(dst, a, s);
+					return;
+				}
+				store3(dst, _mm_mul_ps(load3(a), _mm_set1_ps(s)));
+			}
+			static constexpr float dot(const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					return scalar_vector_kernel<float, 3>::dot(a, b);
+				}
+				return hsum(_mm_mul_ps(load3(a), load3(b)));
+			}
+		};
+
+		template<>
+		struct vector_kernel<float, 2> {
+			static constexpr void add(float* dst, const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					scalar_vector_kernel<float, 2>::add(dst, a, b);
+					return;
+				}
+				store2(dst, _mm_add_ps(load2(a), load2(b)));
+			}
+			static constexpr void sub(float* dst, const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					scalar_vector_kernel<float, 2>::sub(dst, a, b);
+					return;
+				}
+				store2(dst, _mm_sub_ps(load2(a), load2(b)));
+			}
+			static constexpr void scale(float* dst, const float* a, float s) {
+				if (std::is_constant_evaluated()) {
+					scalar_vector_kernel<float, 2>::scale(dst, a, s);
+					return;
+				}
+				store2(dst, _mm_mul_ps(load2(a), _mm_set1_ps(s)));
+			}
+			static constexpr float dot(const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					return scalar_vector_kernel<float, 2>::dot(a, b);
+				}
+				__m128 p = _mm_mul_ps(load2(a), load2(b));
+				return _mm_cvtss_f32(_mm_add_ss(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1))));
+			}
+		};
+
+		template<>
+		struct matrix_kernel<float, 4, 4, 4> {
+			static constexpr void mul(float* dst, const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					scalar_matrix_kernel<float, 4, 4, 4>::mul(dst, a, b);
+					return;
+				}
+				__m128 b0 = _mm_loadu_ps(b);
+				__m128 b1 = _mm_loadu_ps(b + 4);
+				__m128 b2 = _mm_loadu_ps(b + 8);
+				__m128 b3 = _mm_loadu_ps(b + 12);
+#ifdef __SIMD_AVX
+				//two result rows per iteration, the rows of b are duplicated into both halves
+				__m256 bb0 = _mm256_insertf128_ps(_mm256_castps128_ps256(b0), b0, 1);
+				__m256 bb1 = _mm256_insertf128_ps(_mm256_castps128_ps256(b1), b1, 1);
+				__m256 bb2 = _mm256_insertf128_ps(_mm256_castps128_ps256(b2), b2, 1);
+				__m256 bb3 = _mm256_insertf128_ps(_mm256_castps128_ps256(b3), b3, 1);
+				for (size_t i = 0; i < 4; i += 2) {
+					__m256 rows = _mm256_loadu_ps(a + i * 4);
+					__m256 r = _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(0, 0, 0, 0)), bb0);
+					r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(1, 1, 1, 1)), bb1));
+					r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(2, 2, 2, 2)), bb2));
+					r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(3, 3, 3, 3)), bb3));
+					_mm256_storeu_ps(dst + i * 4, r);
+				}
+#else
+				for (size_t i = 0; i < 4; ++i) {
+					__m128 row = _mm_loadu_ps(a + i * 4);
+					__m128 r = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+					r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+					r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+					r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+					_mm_storeu_ps(dst + i * 4, r);
+				}
+#endif
+			}
+			static constexpr void mul_vec(float* dst, const float* a, const float* v) {
+				if (std::is_constant_evaluated()) {
+					scalar_matrix_kernel<float, 4, 4, 4>::mul_vec(dst, a, v);
+					return;
+				}
+				__m128 x = _mm_loadu_ps(v);
+				__m128 p0 = _mm_mul_ps(_mm_loadu_ps(a), x);
+				__m128 p1 = _mm_mul_ps(_mm_loadu_ps(a + 4), x);
+				__m128 p2 = _mm_mul_ps(_mm_loadu_ps(a + 8), x);
+				__m128 p3 = _mm_mul_ps(_mm_loadu_ps(a + 12), x);
+				_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+				_mm_storeu_ps(dst, _mm_add_ps(_mm_add_ps(p0, p1), _mm_add_ps(p2, p3)));
+			}
+		};
+
+		template<>
+		struct matrix_kernel<float, 4, 4, 1> {
+			static constexpr void mul(float* dst, const float* a, const float* b) {
+				if (std::is_constant_evaluated()) {
+					scalar_matrix_kernel<float, 4, 4, 1>::mul(dst, a, b);
+					return;
+				}
+				matrix_kernel<float, 4, 4, 4>::mul_vec(dst, a, b);
+			}
+			static constexpr void mul_vec(float* dst, const float* a, const float* v) {
+				if (std::is_constant_evaluated()) {
+					scalar_matrix_kernel<float, 4, 4, 1>::mul_vec(dst, a, v);
+					return;
+				}
+				matrix_kernel<float, 4, 4, 4>::mul_vec(dst, a, v);
+			}
+		};
+
+		/// <summary>
+		/// 2x2 matrices held in one register (a0 a1 / a2 a3), helpers of the blockwise 4x4 inverse
+		/// </summary>
+		struct mat2 {
+			///<returns>a * b</returns>
+			static inline __m128 mul(__m128 a, __m128 b) {
+				return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+					_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+			}
+			///<returns>adj(a) * b</returns>
+			static inline __m128 adj_mul(__m128 a, __m128 b) {
+				return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+					_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+			}
+			///<returns>a * adj(b)</returns>
+			static inline __m128 mul_adj(__m128 a, __m128 b) {
+				return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+					_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+			}
+		};
+
+		template<>
+		struct inverse_kernel<float, 4> {
+			static constexpr float determinant(const float* m) {
+				return scalar_inverse_kernel<float, 4>::determinant(m);
+			}
+			/// <summary>
+			/// Blockwise inverse, the matrix is split into the 2x2 blocks A B / C D
+			/// </summary>
+			static constexpr float inverse(float* dst, const float* m) {
+				if (std::is_constant_evaluated()) {
+					return scalar_inverse_kernel<float, 4>::inverse(dst, m);
+				}
+				const __m128 r0 = _mm_loadu_ps(m);
+				const __m128 r1 = _mm_loadu_ps(m + 4);
+				const __m128 r2 = _mm_loadu_ps(m + 8);
+				const __m128 r3 = _mm_loadu_ps(m + 12);
+
+				const __m128 a = _mm_movelh_ps(r0, r1);
+				const __m128 b = _mm_movehl_ps(r1, r0);
+				const __m128 c = _mm_movelh_ps(r2, r3);
+				const __m128 d = _mm_movehl_ps(r3, r2);
+
+				//(|A| |B| |C| |D|)
+				const __m128 detSub = _mm_sub_ps(
+					_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1))),
+					_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0))));
+				const __m128 detA = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0, 0, 0, 0));
+				const __m128 detB = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(1, 1, 1, 1));
+				const __m128 detC = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(2, 2, 2, 2));
+				const __m128 detD = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(3, 3, 3, 3));
+
+				const __m128 dc = mat2::adj_mul(d, c);
+				const __m128 ab = mat2::adj_mul(a, b);
+				__m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), mat2::mul(b, dc));
+				__m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), mat2::mul(c, ab));
+				__m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), mat2::mul_adj(d, ab));
+				__m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), mat2::mul_adj(a, dc));
+
+				//|M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+				__m128 tr = _mm_mul_ps(ab, _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(3, 1, 2, 0)));
+				tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+				tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+				const __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+				const __m128 rDet = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), detM);
+				x = _mm_mul_ps(x, rDet);
+				y = _mm_mul_ps(y, rDet);
+				z = _mm_mul_ps(z, rDet);
+				w = _mm_mul_ps(w, rDet);
+
+				//the adjugates of the blocks are applied by the final shuffle
+				_mm_storeu_ps(dst, _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+				_mm_storeu_ps(dst + 4, _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+				_mm_storeu_ps(dst + 8, _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+				_mm_storeu_ps(dst + 12, _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+				return _mm_cvtss_f32(detM);
+			}
+		};
+#endif
+
+		template<typename T>
+		/// <summary>
+		/// Single lane stand-in for float_pack, used for element types without a SIMD implementation.
+		/// </summary>
+		struct scalar_pack {
+			static constexpr size_t width = 1;
+			T v;
+
+			static scalar_pack load(const T* p) { return { *p }; }
+			static scalar_pack loadu(const T* p) { return { *p }; }
+			static scalar_pack set1(T s) { return { s }; }
+			void store(T* p) const { *p = v; }
+			void storeu(T* p) const { *p = v; }
+
+			friend scalar_pack operator+(scalar_pack a, scalar_pack b) { return { a.v + b.v }; }
+			friend scalar_pack operator-(scalar_pack a, scalar_pack b) { return { a.v - b.v }; }
+			friend scalar_pack operator*(scalar_pack a, scalar_pack b) { return { a.v * b.v }; }
+			friend scalar_pack operator/(scalar_pack a, scalar_pack b) { return { a.v / b.v }; }
+
+			static scalar_pack fmadd(scalar_pack a, scalar_pack b, scalar_pack c) { return { a.v * b.v + c.v }; }
+			static scalar_pack sqrt(scalar_pack a) { return { T(std::sqrt(a.v)) }; }
+			///<returns>The smaller value, b if either is NaN like float_pack::min</returns>
+			static scalar_pack min(scalar_pack a, scalar_pack b) { return { a.v < b.v ? a.v : b.v }; }
+			///<returns>The larger value, b if either is NaN</returns>
+			static scalar_pack max(scalar_pack a, scalar_pack b) { return { a.v > b.v ? a.v : b.v }; }
+			static scalar_pack abs(scalar_pack a) { return { a.v < T(0) ? -a.v : a.v }; }
+			///<returns>The magnitude of mag with the sign of sgn</returns>
+			static scalar_pack copysign(scalar_pack mag, scalar_pack sgn) { return { T(std::copysign(mag.v, sgn.v)) }; }
+			///<returns>Bit l is the sign of lane l</returns>
+			static uint32 sign_mask(scalar_pack a) { return std::signbit(a.v) ? 1u : 0u; }
+			///<returns>Bit l is set if a &lt; b in lane l, false for NaN</returns>
+			static uint32 lt_mask(scalar_pack a, scalar_pack b) { return a.v < b.v ? 1u : 0u; }
+			///<returns>Bit l is set if a &lt;= b in lane l, false for NaN</returns>
+			static uint32 le_mask(scalar_pack a, scalar_pack b) { return a.v <= b.v ? 1u : 0u; }
+		};
+
+		///<summary>
+		/// The alignment (in bytes) of the planes of the batch containers, this covers the widest register (AVX-512) and a cache line
+		///</summary>
+		constexpr size_t batch_alignment = 64;
+
+		/// <summary>
+		/// A register of floats, the width depends on the widest instruction set enabled at compile time (16 AVX-512, 8 AVX, 4 SSE, 1 scalar).
+		/// load and store require batch aligned pointers, loadu and storeu do not.
+		/// </summary>
+		struct float_pack {
+#if defined(__SIMD_AVX512)
+			using reg = __m512;
+			static constexpr size_t width = 16;
+#elif defined(__SIMD_AVX)
+			using reg = __m256;
+			static constexpr size_t width = 8;
+#elif defined(__SIMD_SSE)
+			using reg = __m128;
+			static constexpr size_t width = 4;
+#else
+			using reg = float;
+			static constexpr size_t width = 1;
+#endif
+			reg v;
+
+			static float_pack load(const float* p);
+			static float_pack loadu(const float* p);
+			static float_pack set1(float s);
+			void store(float* p) const;
+			void storeu(float* p) const;
+
+			friend float_pack operator+(float_pack a, float_pack b);
+			friend float_pack operator-(float_pack a, float_pack b);
+			friend float_pack operator*(float_pack a, float_pack b);
+			friend float_pack operator/(float_pack a, float_pack b);
+
+			///<returns>a * b + c</returns>
+			static float_pack fmadd(float_pack a, float_pack b, float_pack c);
+			static float_pack sqrt(float_pack a);
+			///<returns>Per lane the smaller value, b where either is NaN (minps semantics on every backend)</returns>
+			static float_pack min(float_pack a, float_pack b);
+			///<returns>Per lane the larger value, b where either is NaN</returns>
+			static float_pack max(float_pack a, float_pack b);
+			static float_pack abs(float_pack a);
+			///<returns>The magnitude of mag with the sign of sgn</returns>
+			static float_pack copysign(float_pack mag, float_pack sgn);
+			///<returns>Bit l is the sign of lane l</returns>
+			static uint32 sign_mask(float_pack a);
+			///<returns>Bit l is set if a &lt; b in lane l, false for NaN</returns>
+			static uint32 lt_mask(float_pack a, float_pack b);
+			///<returns>Bit l is set if a &lt;= b in lane l, false for NaN</returns>
+			static uint32 le_mask(float_pack a, float_pack b);
+			///<returns>Per lane a &lt; b ? x : y</returns>
+			static float_pack select_lt(float_pack a, float_pack b, float_pack x, float_pack y);
+			static float_pack floor(float_pack a);
+			///<returns>Estimate of 1 / sqrt(a), relative error below 2^-14 on AVX-512 and 1.5 * 2^-12 on SSE and AVX, exact without SIMD</returns>
+			static float_pack rsqrt_estimate(float_pack a);
+		};
+
+#if defined(__SIMD_AVX512)
+		inline float_pack float_pack::load(const float* p) { return { _mm512_load_ps(p) }; }
+		inline float_pack float_pack::loadu(const float* p) { return { _mm512_loadu_ps(p) }; }
+		inline float_pack float_pack::set1(float s) { return { _mm512_set1_ps(s) }; }
+		inline void float_pack::store(float* p) const { _mm512_store_ps(p, v); }
+		inline void float_pack::storeu(float* p) const { _mm512_storeu_ps(p, v); }
+		inline float_pack operator+(float_pack a, float_pack b) { return { _mm512_add_ps(a.v, b.v) }; }
+		inline float_pack operator-(float_pack a, float_pack b) { return { _mm512_sub_ps(a.v, b.v) }; }
+		inline float_pack operator*(float_pack a, float_pack b) { return { _mm512_mul_ps(a.v, b.v) }; }
+		inline float_pack operator/(float_pack a, float_pack b) { return { _mm512_div_ps(a.v, b.v) }; }
+		inline float_pack float_pack::fmadd(float_pack a, float_pack b, float_pack c) { return { _mm512_fmadd_ps(a.v, b.v, c.v) }; }
+		inline float_pack float_pack::sqrt(float_pack a) { return { _mm512_sqrt_ps(a.v) }; }
+		inline float_pack float_pack::rsqrt_estimate(float_pack a) { return { _mm512_rsqrt14_ps(a.v) }; }
+		inline float_pack float_pack::min(float_pack a, float_pack b) { return { _mm512_min_ps(a.v, b.v) }; }
+		inline float_pack float_pack::max(float_pack a, float_pack b) { return { _mm512_max_ps(a.v, b.v) }; }
+		inline float_pack float_pack::abs(float_pack a) { return { _mm512_castsi512_ps(_mm512_and_epi32(_mm512_castps_si512(a.v), _mm512_set1_epi32(0x7FFFFFFF))) }; }
+		inline float_pack float_pack::copysign(float_pack mag, float_pack sgn) {
+			const __m512i m = _mm512_set1_epi32(0x7FFFFFFF);
+			return { _mm512_castsi512_ps(_mm512_ternarylogic_epi32(m, _mm512_castps_si512(mag.v), _mm512_castps_si512(sgn.v), 0xCA)) };
+		}
+		inline uint32 float_pack::sign_mask(float_pack a) { return _mm512_cmplt_epi32_mask(_mm512_castps_si512(a.v), _mm512_setzero_si512()); }
+		inline uint32 float_pack::lt_mask(float_pack a, float_pack b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ); }
+		inline uint32 float_pack::le_mask(float_pack a, float_pack b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ); }
+		inline float_pack float_pack::select_lt(float_pack a, float_pack b, float_pack x, float_pack y) { return { _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ), y.v, x.v) }; }
+		inline float_pack float_pack::floor(float_pack a) { return { _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC) }; }
+#elif defined(__SIMD_AVX)
+		inline float_pack float_pack::load(const float* p) { return { _mm256_load_ps(p) }; }
+		inline float_pack float_pack::loadu(const float* p) { return { _mm256_loadu_ps(p) }; }
+		inline float_pack float_pack::set1(float s) { return { _mm256_set1_ps(s) }; }
+		inline void float_pack::store(float* p) const { _mm256_store_ps(p, v); }
+		inline void float_pack::storeu(float* p) const { _mm256_storeu_ps(p, v); }
+		inline float_pack operator+(float_pack a, float_pack b) { return { _mm256_add_ps(a.v, b.v) }; }
+		inline float_pack operator-(float_pack a, float_pack b) { return { _mm256_sub_ps(a.v, b.v) }; }
+		inline float_pack operator*(float_pack a, float_pack b) { return { _mm256_mul_ps(a.v, b.v) }; }
+		inline float_pack operator/(float_pack a, float_pack b) { return { _mm256_div_ps(a.v, b.v) }; }
+#ifdef __FMA__
+		inline float_pack float_pack::fmadd(float_pack a, float_pack b, float_pack c) { return { _mm256_fmadd_ps(a.v, b.v, c.v) }; }
+#else
+		inline float_pack float_pack::fmadd(float_pack a, float_pack b, float_pack c) { return { _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v) }; }
+#endif
+		inline float_pack float_pack::sqrt(float_pack a) { return { _mm256_sqrt_ps(a.v) }; }
+		inline float_pack float_pack::rsqrt_estimate(float_pack a) { return { _mm256_rsqrt_ps(a.v) }; }
+		inline float_pack float_pack::min(float_pack a, float_pack b) { return { _mm256_min_ps(a.v, b.v) }; }
+		inline float_pack float_pack::max(float_pack a, float_pack b) { return { _mm256_max_ps(a.v, b.v) }; }
+		inline float_pack float_pack::abs(float_pack a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v) }; }
+		inline float_pack float_pack::copysign(float_pack mag, float_pack sgn) {
+			const __m256 m = _mm256_set1_ps(-0.f);
+			return { _mm256_or_ps(_mm256_andnot_ps(m, mag.v), _mm256_and_ps(m, sgn.v)) };
+		}
+		inline uint32 float_pack::sign_mask(float_pack a) { return uint32(_mm256_movemask_ps(a.v)); }
+		inline uint32 float_pack::lt_mask(float_pack a, float_pack b) { return uint32(_mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ))); }
+		inline uint32 float_pack::le_mask(float_pack a, float_pack b) { return uint32(_mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ))); }
+		inline float_pack float_pack::select_lt(float_pack a, float_pack b, float_pack x, float_pack y) { return { _mm256_blendv_ps(y.v, x.v, _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)) }; }
+		inline float_pack float_pack::floor(float_pack a) { return { _mm256_floor_ps(a.v) }; }
+#elif defined(__SIMD_SSE)
+		inline float_pack float_pack::load(const float* p) { return { _mm_load_ps(p) }; }
+		inline float_pack float_pack::loadu(const float* p) { return { _mm_loadu_ps(p) }; }
+		inline float_pack float_pack::set1(float s) { return { _mm_set1_ps(s) }; }
+		inline void float_pack::store(float* p) const { _mm_store_ps(p, v); }
+		inline void float_pack::storeu(float* p) const { _mm_storeu_ps(p, v); }
+		inline float_pack operator+(float_pack a, float_pack b) { return { _mm_add_ps(a.v, b.v) }; }
+		inline float_pack operator-(float_pack a, float_pack b) { return { _mm_sub_ps(a.v, b.v) }; }
+		inline float_pack operator*(float_pack a, float_pack b) { return { _mm_mul_ps(a.v, b.v) }; }
+		inline float_pack operator/(float_pack a, float_pack b) { return { _mm_div_ps(a.v, b.v) }; }
+		inline float_pack float_pack::fmadd(float_pack a, float_pack b, float_pack c) { return { _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v) }; }
+		inline float_pack float_pack::sqrt(float_pack a) { return { _mm_sqrt_ps(a.v) }; }
+		inline float_pack float_pack::rsqrt_estimate(float_pack a) { return { _mm_rsqrt_ps(a.v) }; }
+		inline float_pack float_pack::min(float_pack a, float_pack b) { return { _mm_min_ps(a.v, b.v) }; }
+		inline float_pack float_pack::max(float_pack a, float_pack b) { return { _mm_max_ps(a.v, b.v) }; }
+		inline float_pack float_pack::abs(float_pack a) { return { _mm_andnot_ps(_mm_set1_ps(-0.f), a.v) }; }
+		inline float_pack float_pack::copysign(float_pack mag, float_pack sgn) {
+			const __m128 m = _mm_set1_ps(-0.f);
+			return { _mm_or_ps(_mm_andnot_ps(m, mag.v), _mm_and_ps(m, sgn.v)) };
+		}
+		inline uint32 float_pack::sign_mask(float_pack a) { return uint32(_mm_movemask_ps(a.v)); }
+		inline uint32 float_pack::lt_mask(float_pack a, float_pack b) { return uint32(_mm_movemask_ps(_mm_cmplt_ps(a.v, b.v))); }
+		inline uint32 float_pack::le_mask(float_pack a, float_pack b) { return uint32(_mm_movemask_ps(_mm_cmple_ps(a.v, b.v))); }
+		inline float_pack float_pack::select_lt(float_pack a, float_pack b, float_pack x, float_pack y) {
+			const __m128 m = _mm_cmplt_ps(a.v, b.v);
+			return { _mm_or_ps(_mm_and_ps(m, x.v), _mm_andnot_ps(m, y.v)) };
+		}
+#ifdef __SSE4_1__
+		inline float_pack float_pack::floor(float_pack a) { return { _mm_floor_ps(a.v) }; }
+#else
+		inline float_pack float_pack::floor(float_pack a) {
+			//truncation rounds negative values up, valid within the int32 range
+			const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+			return { _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.f))) };
+		}
+#endif
+#else
+		inline float_pack float_pack::load(const float* p) { return { *p }; }
+		inline float_pack float_pack::loadu(const float* p) { return { *p }; }
+		inline float_pack float_pack::set1(float s) { return { s }; }
+		inline void float_pack::store(float* p) const { *p = v; }
+		inline void float_pack::storeu(float* p) const { *p = v; }
+		inline float_pack operator+(float_pack a, float_pack b) { return { a.v + b.v }; }
+		inline float_pack operator-(float_pack a, float_pack b) { return { a.v - b.v }; }
+		inline float_pack operator*(float_pack a, float_pack b) { return { a.v * b.v }; }
+		inline float_pack operator/(float_pack a, float_pack b) { return { a.v / b.v }; }
+		inline float_pack float_pack::fmadd(float_pack a, float_pack b, float_pack c) { return { a.v * b.v + c.v }; }
+		inline float_pack float_pack::sqrt(float_pack a) { return { std::sqrt(a.v) }; }
+		inline float_pack float_pack::rsqrt_estimate(float_pack a) { return { 1.f / std::sqrt(a.v) }; }
+		inline float_pack float_pack::min(float_pack a, float_pack b) { return { a.v < b.v ? a.v : b.v }; }
+		inline float_pack float_pack::max(float_pack a, float_pack b) { return { a.v > b.v ? a.v : b.v }; }
+		inline float_pack float_pack::abs(float_pack a) { return { std::fabs(a.v) }; }
+		inline float_pack float_pack::copysign(float_pack mag, float_pack sgn) { return { std::copysign(mag.v, sgn.v) }; }
+		inline uint32 float_pack::sign_mask(float_pack a) { return std::signbit(a.v) ? 1u : 0u; }
+		inline uint32 float_pack::lt_mask(float_pack a, float_pack b) { return a.v < b.v ? 1u : 0u; }
+		inline uint32 float_pack::le_mask(float_pack a, float_pack b) { return a.v <= b.v ? 1u : 0u; }
+		inline float_pack float_pack::select_lt(float_pack a, float_pack b, float_pack x, float_pack y) { return { a.v < b.v ? x.v : y.v }; }
+		inline float_pack float_pack::floor(float_pack a) { return { std::floor(a.v) }; }
+#endif
+
+		/// <summary>
+		/// A register of 32 bit unsigned integers with the lane count of float_pack, for hashing and random number generation.
+		/// Arithmetic wraps around. AVX without AVX2 has no 256 bit integer instructions, there the lanes are processed one by one.
+		/// </summary>
+		struct int_pack {
+			static constexpr size_t width = float_pack::width;
+#if defined(__SIMD_AVX512)
+			using reg = __m512i;
+#elif defined(__SIMD_AVX) && defined(__AVX2__)
+			using reg = __m256i;
+#elif defined(__SIMD_SSE) && !defined(__SIMD_AVX)
+			using reg = __m128i;
+#else
+			struct reg {
+				uint32 l[width];
+			};
+#endif
+			reg v;
+
+			static int_pack load(const uint32* p);
+			static int_pack loadu(const uint32* p);
+			static int_pack set1(uint32 s);
+			void store(uint32* p) const;
+			void storeu(uint32* p) const;
+
+			friend int_pack operator+(int_pack a, int_pack b);
+			friend int_pack operator-(int_pack a, int_pack b);
+			///<returns>The low 32 bits of the products</returns>
+			friend int_pack operator*(int_pack a, int_pack b);
+			friend int_pack operator^(int_pack a, int_pack b);
+			friend int_pack operator&(int_pack a, int_pack b);
+			friend int_pack operator|(int_pack a, int_pack b);
+
+			template<int S>
+			static int_pack shl(int_pack a);
+			template<int S>
+			///<summary>Logical shift, zeros are shifted in</summary>
+			static int_pack shr(int_pack a);
+			template<int S>
+			static int_pack rotl(int_pack a) { return shl<S>(a) | shr<32 - S>(a); }
+
+			///<returns>The lanes rounded towards negative infinity, valid within the int32 range</returns>
+			static int_pack floor(float_pack a);
+			///<returns>The lanes converted as signed integers</returns>
+			static float_pack to_float(int_pack a);
+			///<returns>The bits of the float lanes</returns>
+			static int_pack bits(float_pack a);
+			///<returns>The lanes reinterpreted as floats</returns>
+			static float_pack as_float(int_pack a);
+		};
+
+#if defined(__SIMD_AVX512)
+		inline int_pack int_pack::load(const uint32* p) { return { _mm512_load_si512(p) }; }
+		inline int_pack int_pack::loadu(const uint32* p) { return { _mm512_loadu_si512(p) }; }
+		inline int_pack int_pack::set1(uint32 s) { return { _mm512_set1_epi32(int32(s)) }; }
+		inline void int_pack::store(uint32* p) const { _mm512_store_si512(p, v); }
+		inline void int_pack::storeu(uint32* p) const { _mm512_storeu_si512(p, v); }
+		inline int_pack operator+(int_pack a, int_pack b) { return { _mm512_add_epi32(a.v, b.v) }; }
+		inline int_pack operator-(int_pack a, int_pack b) { return { _mm512_sub_epi32(a.v, b.v) }; }
+		inline int_pack operator*(int_pack a, int_pack b) { return { _mm512_mullo_epi32(a.v, b.v) }; }
+		inline int_pack operator^(int_pack a, int_pack b) { return { _mm512_xor_si512(a.v, b.v) }; }
+		inline int_pack operator&(int_pack a, int_pack b) { return { _mm512_and_si512(a.v, b.v) }; }
+		inline int_pack operator|(int_pack a, int_pack b) { return { _mm512_or_si512(a.v, b.v) }; }
+		template<int S>
+		inline int_pack int_pack::shl(int_pack a) { return { _mm512_slli_epi32(a.v, S) }; }
+		template<int S>
+		inline int_pack int_pack::shr(int_pack a) { return { _mm512_srli_epi32(a.v, S) }; }
+		inline int_pack int_pack::floor(float_pack a) { return { _mm512_cvttps_epi32(float_pack::floor(a).v) }; }
+		inline float_pack int_pack::to_float(int_pack a) { return { _mm512_cvtepi32_ps(a.v) }; }
+		inline int_pack int_pack::bits(float_pack a) { return { _mm512_castps_si512(a.v) }; }
+		inline float_pack int_pack::as_float(int_pack a) { return { _mm512_castsi512_ps(a.v) }; }
+#elif defined(__SIMD_AVX) && defined(__AVX2__)
+		inline int_pack int_pack::load(const uint32* p) { return { _mm256_load_si256(reinterpret_cast<const __m256i*>(p)) }; }
+		inline int_pack int_pack::loadu(const uint32* p) { return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) }; }
+		inline int_pack int_pack::set1(uint32 s) { return { _mm256_set1_epi32(int32(s)) }; }
+		inline void int_pack::store(uint32* p) const { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+		inline void int_pack::storeu(uint32* p) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+		inline int_pack operator+(int_pack a, int_pack b) { return { _mm256_add_epi32(a.v, b.v) }; }
+		inline int_pack operator-(int_pack a, int_pack b) { return { _mm256_sub_epi32(a.v, b.v) }; }
+		inline int_pack operator*(int_pack a, int_pack b) { return { _mm256_mullo_epi32(a.v, b.v) }; }
+		inline int_pack operator^(int_pack a, int_pack b) { return { _mm256_xor_si256(a.v, b.v) }; }
+		inline int_pack operator&(int_pack a, int_pack b) { return { _mm256_and_si256(a.v, b.v) }; }
+		inline int_pack operator|(int_pack a, int_pack b) { return { _mm256_or_si256(a.v, b.v) }; }
+		template<int S>
+		inline int_pack int_pack::shl(int_pack a) { return { _mm256_slli_epi32(a.v, S) }; }
+		template<int S>
+		inline int_pack int_pack::shr(int_pack a) { return { _mm256_srli_epi32(a.v, S) }; }
+		inline int_pack int_pack::floor(float_pack a) { return { _mm256_cvttps_epi32(_mm256_floor_ps(a.v)) }; }
+		inline float_pack int_pack::to_float(int_pack a) { return { _mm256_cvtepi32_ps(a.v) }; }
+		inline int_pack int_pack::bits(float_pack a) { return { _mm256_castps_si256(a.v) }; }
+		inline float_pack int_pack::as_float(int_pack a) { return { _mm256_castsi256_ps(a.v) }; }
+#elif defined(__SIMD_SSE) && !defined(__SIMD_AVX)
+		inline int_pack int_pack::load(const uint32* p) { return { _mm_load_si128(reinterpret_cast<const __m128i*>(p)) }; }
+		inline int_pack int_pack::loadu(const uint32* p) { return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) }; }
+		inline int_pack int_pack::set1(uint32 s) { return { _mm_set1_epi32(int32(s)) }; }
+		inline void int_pack::store(uint32* p) const { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+		inline void int_pack::storeu(uint32* p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+		inline int_pack operator+(int_pack a, int_pack b) { return { _mm_add_epi32(a.v, b.v) }; }
+		inline int_pack operator-(int_pack a, int_pack b) { return { _mm_sub_epi32(a.v, b.v) }; }
+#ifdef __SSE4_1__
+		inline int_pack operator*(int_pack a, int_pack b) { return { _mm_mullo_epi32(a.v, b.v) }; }
+#else
+		inline int_pack operator*(int_pack a, int_pack b) {
+			//SSE2 only multiplies the even lanes to 64 bit
+			const __m128i even = _mm_mul_epu32(a.v, b.v);
+			const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+			return { _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))) };
+		}
+#endif
+		inline int_pack operator^(int_pack a, int_pack b) { return { _mm_xor_si128(a.v, b.v) }; }
+		inline int_pack operator&(int_pack a, int_pack b) { return { _mm_and_si128(a.v, b.v) }; }
+		inline int_pack operator|(int_pack a, int_pack b) { return { _mm_or_si128(a.v, b.v) }; }
+		template<int S>
+		inline int_pack int_pack::shl(int_pack a) { return { _mm_slli_epi32(a.v, S) }; }
+		template<int S>
+		inline int_pack int_pack::shr(int_pack a) { return { _mm_srli_epi32(a.v, S) }; }
+		inline int_pack int_pack::floor(float_pack a) { return { _mm_cvttps_epi32(float_pack::floor(a).v) }; }
+		inline float_pack int_pack::to_float(int_pack a) { return { _mm_cvtepi32_ps(a.v) }; }
+		inline int_pack int_pack::bits(float_pack a) { return { _mm_castps_si128(a.v) }; }
+		inline float_pack int_pack::as_float(int_pack a) { return { _mm_castsi128_ps(a.v) }; }
+#else
+#define __SIMD_INT_LANEWISE(EXPR) int_pack r; for (size_t i = 0; i < width; ++i) { r.v.l[i] = EXPR; } return r;
+		inline int_pack int_pack::load(const uint32* p) { __SIMD_INT_LANEWISE(p[i]) }
+		inline int_pack int_pack::loadu(const uint32* p) { __SIMD_INT_LANEWISE(p[i]) }
+		inline int_pack int_pack::set1(uint32 s) { __SIMD_INT_LANEWISE(s) }
+		inline void int_pack::store(uint32* p) const { for (size_t i = 0; i < width; ++i) { p[i] = v.l[i]; } }
+		inline void int_pack::storeu(uint32* p) const { store(p); }
+		inline int_pack operator+(int_pack a, int_pack b) { constexpr size_t width = int_pack::width; __SIMD_INT_LANEWISE(a.v.l[i] + b.v.l[i]) }
+		inline int_pack operator-(int_pack a, int_pack b) { constexpr size_t width = int_pack::width; __SIMD_INT_LANEWISE(a.v.l[i] - b.v.l[i]) }
+		inline int_pack operator*(int_pack a, int_pack b) { constexpr size_t width = int_pack::width; __SIMD_INT_LANEWISE(a.v.l[i] * b.v.l[i]) }
+		inline int_pack operator^(int_pack a, int_pack b) { constexpr size_t width = int_pack::width; __SIMD_INT_LANEWISE(a.v.l[i] ^ b.v.l[i]) }
+		inline int_pack operator&(int_pack a, int_pack b) { constexpr size_t width = int_pack::width; __SIMD_INT_LANEWISE(a.v.l[i] & b.v.l[i]) }
+		inline int_pack operator|(int_pack a, int_pack b) { constexpr size_t width = int_pack::width; __SIMD_INT_LANEWISE(a.v.l[i] | b.v.l[i]) }
+		template<int S>
+		inline int_pack int_pack::shl(int_pack a) { __SIMD_INT_LANEWISE(a.v.l[i] << S) }
+		template<int S>
+		inline int_pack int_pack::shr(int_pack a) { __SIMD_INT_LANEWISE(a.v.l[i] >> S) }
+		inline int_pack int_pack::floor(float_pack a) {
+			float f[width];
+			a.storeu(f);
+			__SIMD_INT_LANEWISE(uint32(int32(std::floor(f[i]))))
+		}
+		inline float_pack int_pack::to_float(int_pack a) {
+			float f[width];
+			for (size_t i = 0; i < width; ++i) {
+				f[i] = float(int32(a.v.l[i]));
+			}
+			return float_pack::loadu(f);
+		}
+		inline int_pack int_pack::bits(float_pack a) {
+			float f[width];
+			a.storeu(f);
+			__SIMD_INT_LANEWISE(std::bit_cast<uint32>(f[i]))
+		}
+		inline float_pack int_pack::as_float(int_pack a) {
+			float f[width];
+			for (size_t i = 0; i < width; ++i) {
+				f[i] = std::bit_cast<float>(a.v.l[i]);
+			}
+			return float_pack::loadu(f);
+		}
+#undef __SIMD_INT_LANEWISE
+#endif
+
+		template<typename T>
+		/// <summary>
+		/// The widest pack available for T
+		/// </summary>
+		struct pack_of {
+			using type = scalar_pack<T>;
+		};
+
+		template<>
+		struct pack_of<float> {
+			using type = float_pack;
+		};
+	}
+}
+#endif
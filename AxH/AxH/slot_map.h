@@ -0,0 +1,262 @@
+#ifndef __H_SLOT_MAP
+#define __H_SLOT_MAP
+
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "dtypes.h"
+#include "ptr.h"
+
+namespace Util {
+
+	/// <summary>
+	/// Handle of an element of a slot_map, 20 bits of slot index and 12 bits of generation.
+	/// A handle stays valid until its element is erased, afterwards it never refers to another element.
+	/// </summary>
+	struct slot_handle {
+		static constexpr uint32 INDEX_BITS = 20;
+		static constexpr uint32 INDEX_MASK = (1u << INDEX_BITS) - 1;
+		static constexpr uint32 MAX_GENERATION = (1u << (32 - INDEX_BITS)) - 1;
+
+		uint32 bits = 0xFFFFFFFFu;
+
+		slot_handle() = default;
+		slot_handle(uint32 index, uint32 generation) : bits(index | (generation << INDEX_BITS)) {}
+
+		uint32 index() const { return bits & INDEX_MASK; }
+		uint32 generation() const { return bits >> INDEX_BITS; }
+		///<returns>false for default constructed handles, a true handle may still be stale</returns>
+		bool valid() const { return bits != 0xFFFFFFFFu; }
+
+		bool operator==(const slot_handle& o) const { return bits == o.bits; }
+		bool operator!=(const slot_handle& o) const { return bits != o.bits; }
+	};
+
+	template<typename T>
+	/// <summary>
+	/// Container storing its elements densely in one array, addressed by slot_handles.
+	/// insert and erase are O(1): a handle points to a slot, the slot to the element, erase moves the last element into the gap.
+	/// Iteration walks the dense array, the order is the insertion order until the first erase.
+	/// References and pointers to elements are invalidated by insert and erase, handles are not.
+	/// A slot whose generation is exhausted is retired, so at most 2^20 - 1 elements are stored at once and a stale handle never matches.
+	///
+	/// Replaces a ptr_vector where elements are owned but their order does not matter: push_back takes over a pass_ptr,
+	/// extract hands an element back as a pass_ptr, erase destroys it.
+	/// </summary>
+	class slot_map {
+	public:
+		using value_type = T;
+		using handle = slot_handle;
+
+		slot_map() = default;
+
+		template<typename... Args>
+		handle emplace(Args&&... args);
+		handle insert(const T& v) { return emplace(v); }
+		handle insert(T&& v) { return emplace(std::move(v)); }
+
+		template<class A>
+		///<summary>Moves the object of in into the map and destroys it, in is invalid afterwards</summary>
+		handle push_back(pass_ptr<T, A>& in);
+		template<class A>
+		handle push_back(pass_ptr<T, A>&& in) { return push_back(in); }
+
+		///<returns>Whether h referred to an element, which is destroyed</returns>
+		bool erase(handle h);
+		template<class A = heap_alloc>
+		///<returns>The element of h moved into an object created through A, a null pointer for stale handles</returns>
+		pass_null_ptr<T, A> extract(handle h);
+		///<summary>Destroys all elements, all handles become stale</summary>
+		void clear();
+		void reserve(size_t count);
+
+		bool contains(handle h) const;
+		///<returns>The element of h, nullptr for stale handles</returns>
+		T* get(handle h);
+		const T* get(handle h) const;
+		T& operator[](handle h);
+		const T& operator[](handle h) const;
+
+		///<returns>The handle of the element at position i of the dense array</returns>
+		handle handle_at(size_t i) const;
+
+		size_t size() const { return _dense.size(); }
+		bool empty() const { return _dense.empty(); }
+		T* data() { return _dense.data(); }
+		const T* data() const { return _dense.data(); }
+		auto begin() { return _dense.begin(); }
+		auto end() { return _dense.end(); }
+		auto begin() const { return _dense.begin(); }
+		auto end() const { return _dense.end(); }
+
+	private:
+		static constexpr uint32 NONE = slot_handle::INDEX_MASK;
+
+		struct _slot {
+			///<summary>Position in the dense array, for free slots the next free slot</summary>
+			uint32 target;
+			uint32 generation;
+		};
+
+		std::vector<T> _dense;
+		///<summary>Slot of each element of the dense array</summary>
+		std::vector<uint32> _owner;
+		std::vector<_slot> _slots;
+		uint32 _free = NONE;
+
+		uint32 _acquire();
+		void _release(uint32 slot);
+		///<returns>The dense position of h, NONE for stale handles</returns>
+		uint32 _find(handle h) const;
+	};
+
+//#######################################################################################################################
+
+	template<typename T>
+	template<typename... Args>
+	slot_handle slot_map<T>::emplace(Args&&... args) {
+		const uint32 slot = _acquire();
+		_dense.emplace_back(std::forward<Args>(args)...);
+		_owner.push_back(slot);
+		_slots[slot].target = uint32(_dense.size() - 1);
+		return handle(slot, _slots[slot].generation);
+	}
+
+	template<typename T>
+	template<class A>
+	slot_handle slot_map<T>::push_back(pass_ptr<T, A>& in) {
+		T* p = in.get();
+		const handle h = emplace(std::move(*p));
+		A::destroy(p);
+		return h;
+	}
+
+	template<typename T>
+	bool slot_map<T>::erase(handle h) {
+		const uint32 d = _find(h);
+		if (d == NONE) {
+			return false;
+		}
+		const uint32 last = uint32(_dense.size() - 1);
+		if (d != last) {
+			_dense[d] = std::move(_dense[last]);
+			_owner[d] = _owner[last];
+			_slots[_owner[d]].target = d;
+		}
+		_dense.pop_back();
+		_owner.pop_back();
+		_release(h.index());
+		return true;
+	}
+
+	template<typename T>
+	template<class A>
+	pass_null_ptr<T, A> slot_map<T>::extract(handle h) {
+		T* p = get(h);
+		if (!p) {
+			return pass_null_ptr<T, A>();
+		}
+		T* res = A::template create<T>(std::move(*p));
+		erase(h);
+		return pass_null_ptr<T, A>(res);
+	}
+
+	template<typename T>
+	void slot_map<T>::clear() {
+		for (uint32 slot : _owner) {
+			_release(slot);
+		}
+		_dense.clear();
+		_owner.clear();
+	}
+
+	template<typename T>
+	void slot_map<T>::reserve(size_t count) {
+		_dense.reserve(count);
+		_owner.reserve(count);
+		_slots.reserve(count);
+	}
+
+	template<typename T>
+	bool slot_map<T>::contains(handle h) const {
+		return _find(h) != NONE;
+	}
+
+	template<typename T>
+	T* slot_map<T>::get(handle h) {
+		const uint32 d = _find(h);
+		return d == NONE ? nullptr : _dense.data() + d;
+	}
+
+	template<typename T>
+	const T* slot_map<T>::get(handle h) const {
+		const uint32 d = _find(h);
+		return d == NONE ? nullptr : _dense.data() + d;
+	}
+
+	template<typename T>
+	T& slot_map<T>::operator[](handle h) {
+		const uint32 d = _find(h);
+		ROBUST_ASSERT(d != NONE, "slot_map access with a stale handle", CHANNEL_MEMORY);
+		return _dense[d];
+	}
+
+	template<typename T>
+	const T& slot_map<T>::operator[](handle h) const {
+		const uint32 d = _find(h);
+		ROBUST_ASSERT(d != NONE, "slot_map access with a stale handle", CHANNEL_MEMORY);
+		return _dense[d];
+	}
+
+	template<typename T>
+	slot_handle slot_map<T>::handle_at(size_t i) const {
+		const uint32 slot = _owner[i];
+		return handle(slot, _slots[slot].generation);
+	}
+
+	template<typename T>
+	uint32 slot_map<T>::_acquire() {
+		if (_free != NONE) {
+			const uint32 slot = _free;
+			_free = _slots[slot].target;
+			return slot;
+		}
+		if (_slots.size() >= NONE) {
+			PRINT_ERR("slot_map is out of slots", PRIORITY_HALT, CHANNEL_MEMORY);
+			throw std::length_error("slot_map is out of slots");
+		}
+		_slots.push_back({ NONE, 0 });
+		return uint32(_slots.size() - 1);
+	}
+
+	template<typename T>
+	void slot_map<T>::_release(uint32 slot) {
+		_slot& s = _slots[slot];
+		if (s.generation == slot_handle::MAX_GENERATION) {
+			//retired, no handle can ever match the slot again
+			s.target = NONE;
+			return;
+		}
+		++s.generation;
+		s.target = _free;
+		_free = slot;
+	}
+
+	template<typename T>
+	uint32 slot_map<T>::_find(handle h) const {
+		const uint32 slot = h.index();
+		if (slot >= _slots.size()) {
+			return NONE;
+		}
+		const _slot& s = _slots[slot];
+		//free slots have a newer generation than any handle to them
+		if (s.generation != h.generation()) {
+			return NONE;
+		}
+		return s.target;
+	}
+}
+
+#endif
@@ -0,0 +1,249 @@
+#include "spatial_hash.h"
+#include "parallel.h"
+#include <atomic>
+
+using namespace math;
+
+spatial_hash::spatial_hash(float cellSize) : _cellSize(cellSize), _invCellSize(1.f / cellSize) {
+	ASSERT(cellSize > 0.f, "the cell size of a spatial_hash has to be positive", CHANNEL_MATH);
+	rebuild();
+}
+
+uint32 spatial_hash::insert(const aabb<float, 3>& bounds) {
+	uint32 id;
+	if (!_free.empty()) {
+		id = _free.back();
+		_free.pop_back();
+	}
+	else {
+		id = uint32(_objects.size());
+		_objects.emplace_back();
+	}
+	_objects[id].alive = true;
+	_objects[id].slot = INVALID;
+	_objects[id].large = false;
+	_set(id, bounds);
+	return id;
+}
+
+uint32 spatial_hash::insert(const vector<float, 3>& position, float radius) {
+	vector<float, 3> extent;
+	for (size_t c = 0; c < 3; ++c) {
+		extent[c] = radius;
+	}
+	return insert(aabb<float, 3>::from_center_extent(position, extent));
+}
+
+void spatial_hash::move(uint32 id, const aabb<float, 3>& bounds) {
+	ROBUST_ASSERT((id < _objects.size() && _objects[id].alive), "moving an object which is not in the spatial_hash", CHANNEL_MATH);
+	_set(id, bounds);
+}
+
+void spatial_hash::move(uint32 id, const vector<float, 3>& position, float radius) {
+	vector<float, 3> extent;
+	for (size_t c = 0; c < 3; ++c) {
+		extent[c] = radius;
+	}
+	move(id, aabb<float, 3>::from_center_extent(position, extent));
+}
+
+void spatial_hash::remove(uint32 id) {
+	ROBUST_ASSERT((id < _objects.size() && _objects[id].alive), "removing an object which is not in the spatial_hash", CHANNEL_MATH);
+	_object& obj = _objects[id];
+	if (obj.slot != INVALID) {
+		(obj.large ? _large : _entries)[obj.slot].id = INVALID;
+	}
+	obj.alive = false;
+	obj.slot = INVALID;
+	_free.push_back(id);
+}
+
+void spatial_hash::_set(uint32 id, const aabb<float, 3>& bounds) {
+	_object& obj = _objects[id];
+	obj.bounds = bounds;
+	float half = 0.f;
+	bool moved = false;
+	for (size_t c = 0; c < 3; ++c) {
+		const float lo = bounds.lo[c];
+		const float hi = bounds.hi[c];
+		const int32 cell = _cell((lo + hi) * 0.5f);
+		moved |= cell != obj.cell[c];
+		obj.cell[c] = cell;
+		half = std::max(half, (hi - lo) * 0.5f);
+	}
+	const bool large = half > _cellSize;
+	//the cell of a large object does not matter, only changing the list needs a rebuild
+	moved = large != obj.large || (!large && moved);
+	obj.large = large;
+	if (!large) {
+		_reach = std::max(_reach, half);
+	}
+	if (obj.slot == INVALID || moved) {
+		_outdated = true;
+		return;
+	}
+	_entry& e = (large ? _large : _entries)[obj.slot];
+	for (size_t c = 0; c < 3; ++c) {
+		e.lo[c] = bounds.lo[c];
+		e.hi[c] = bounds.hi[c];
+	}
+}
+
+void spatial_hash::update() {
+	if (_outdated) {
+		rebuild();
+	}
+}
+
+void spatial_hash::rebuild() {
+	_large.clear();
+	size_t count = 0;
+	for (const _object& obj : _objects) {
+		count += obj.alive && !obj.large;
+	}
+	size_t buckets = 16;
+	while (buckets < 2 * count) {
+		buckets <<= 1;
+	}
+	_mask = uint32(buckets - 1);
+
+	//counting sort by bucket, the storage only grows
+	_start.assign(buckets + 1, 0);
+	_buckets.resize(_objects.size());
+	_reach = 0.f;
+	for (size_t id = 0; id < _objects.size(); ++id) {
+		_object& obj = _objects[id];
+		if (!obj.alive) {
+			continue;
+		}
+		if (obj.large) {
+			obj.slot = uint32(_large.size());
+			_entry& e = _large.emplace_back();
+			for (size_t c = 0; c < 3; ++c) {
+				e.lo[c] = obj.bounds.lo[c];
+				e.hi[c] = obj.bounds.hi[c];
+				e.cell[c] = obj.cell[c];
+			}
+			e.id = uint32(id);
+			continue;
+		}
+		_buckets[id] = _bucket(obj.cell[0], obj.cell[1], obj.cell[2]);
+		++_start[_buckets[id]];
+		for (size_t c = 0; c < 3; ++c) {
+			_reach = std::max(_reach, (obj.bounds.hi[c] - obj.bounds.lo[c]) * 0.5f);
+		}
+	}
+	for (size_t b = 1; b < buckets; ++b) {
+		_start[b] += _start[b - 1];
+	}
+	//scattering backwards turns the end offsets into start offsets and keeps the ids ascending within a bucket
+	_entries.resize(count);
+	for (size_t id = _objects.size(); id-- > 0;) {
+		_object& obj = _objects[id];
+		if (!obj.alive || obj.large) {
+			continue;
+		}
+		obj.slot = --_start[_buckets[id]];
+		_entry& e = _entries[obj.slot];
+		for (size_t c = 0; c < 3; ++c) {
+			e.lo[c] = obj.bounds.lo[c];
+			e.hi[c] = obj.bounds.hi[c];
+			e.cell[c] = obj.cell[c];
+		}
+		e.id = uint32(id);
+	}
+	_start[buckets] = uint32(count);
+	_outdated = false;
+}
+
+size_t spatial_hash::pairs(pair* out, size_t capacity) const {
+	ROBUST_ASSERT(!_outdated, "spatial_hash queried without update()", CHANNEL_MATH);
+	//overlapping objects in the grid have their centers at most twice the reach apart
+	const int32 range = int32(std::ceil(2.f * _reach * _invCellSize));
+	const size_t buckets = _start.size() - 1;
+	//the work items are the buckets followed by the large objects
+	const size_t items = buckets + _large.size();
+	std::atomic<size_t> total = 0;
+
+	const auto task = [&](size_t begin, size_t end) {
+		//pairs are collected locally and appended in blocks, one atomic per block
+		constexpr size_t BLOCK = 256;
+		pair local[BLOCK];
+		size_t n = 0;
+		const auto flush = [&]() {
+			const size_t base = total.fetch_add(n);
+			for (size_t k = 0; base + k < capacity && k < n; ++k) {
+				out[base + k] = local[k];
+			}
+			n = 0;
+		};
+		const auto test = [&](const _entry& a, const _entry& b) {
+			if (b.id == INVALID ||
+				!(a.lo[0] <= b.hi[0] && a.hi[0] >= b.lo[0] && a.lo[1] <= b.hi[1] && a.hi[1] >= b.lo[1] && a.lo[2] <= b.hi[2] && a.hi[2] >= b.lo[2])) {
+				return;
+			}
+			local[n++] = a.id < b.id ? pair{ a.id, b.id } : pair{ b.id, a.id };
+			if (n == BLOCK) {
+				flush();
+			}
+		};
+		for (size_t item = std::max(begin, buckets); item < end; ++item) {
+			//a large object against the grid cells it covers and the large objects after it
+			const size_t l = item - buckets;
+			const _entry& a = _large[l];
+			if (a.id == INVALID) {
+				continue;
+			}
+			_visitGrid(a.lo, a.hi, [&](const _entry& b) {
+				test(a, b);
+			});
+			for (size_t j = l + 1; j < _large.size(); ++j) {
+				test(a, _large[j]);
+			}
+		}
+		for (size_t bucket = begin; bucket < std::min(end, buckets); ++bucket) {
+			for (uint32 i = _start[bucket]; i < _start[bucket + 1]; ++i) {
+				const _entry& a = _entries[i];
+				if (a.id == INVALID) {
+					continue;
+				}
+				//the own cell against the entries after a, then the half of the neighbourhood after the own cell
+				for (uint32 j = i + 1; j < _start[bucket + 1]; ++j) {
+					const _entry& b = _entries[j];
+					if (b.cell[0] == a.cell[0] && b.cell[1] == a.cell[1] && b.cell[2] == a.cell[2]) {
+						test(a, b);
+					}
+				}
+				for (int32 dz = 0; dz <= range; ++dz) {
+					for (int32 dy = dz == 0 ? 0 : -range; dy <= range; ++dy) {
+						for (int32 dx = dz == 0 && dy == 0 ? 1 : -range; dx <= range; ++dx) {
+							const int32 x = a.cell[0] + dx;
+							const int32 y = a.cell[1] + dy;
+							const int32 z = a.cell[2] + dz;
+							const uint32 nb = _bucket(x, y, z);
+							for (uint32 j = _start[nb]; j < _start[nb + 1]; ++j) {
+								const _entry& b = _entries[j];
+								if (b.cell[0] == x && b.cell[1] == y && b.cell[2] == z) {
+									test(a, b);
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+		if (n != 0) {
+			flush();
+		}
+	};
+
+	//the amount of tasks follows the objects, the items are split evenly between them
+	const size_t objects = _entries.size() + _large.size();
+	const size_t tasks = Util::parallel::range_count(objects, PARALLEL_THRESHOLD);
+	const size_t chunk = (items + tasks - 1) / tasks;
+	Util::parallel::run(tasks, objects, PARALLEL_THRESHOLD, [&](size_t t) {
+		const size_t begin = std::min(items, t * chunk);
+		task(begin, std::min(items, begin + chunk));
+	});
+	return total;
+}
@@ -0,0 +1,221 @@
+#ifndef __H_SPATIAL_HASH
+#define __H_SPATIAL_HASH
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "bounds.h"
+
+namespace math {
+
+	/// <summary>
+	/// Uniform grid over an unbounded space for broad phase and proximity queries.
+	/// Every object lives in the cell of its center, the queries widen their range by the largest object extent.
+	/// Objects with an extent above twice the cell size are kept in a separate list instead, so a few large objects do not widen
+	/// the range of every query; they are tested against the grid cells they cover and against each other.
+	/// The grid is stored as one array of entries sorted by hash bucket (counting sort), rebuilding it is O(n) and
+	/// reuses its storage, so a frame of moving objects does not allocate once the arrays have grown.
+	///
+	/// insert() and moving an object to another cell mark the grid as outdated, update() has to be called before the next query.
+	/// Moves within a cell and remove() take effect immediately.
+	/// </summary>
+	class spatial_hash {
+	public:
+		/// <summary>
+		/// Two objects with overlapping bounds, a &lt; b
+		/// </summary>
+		struct pair {
+			uint32 a;
+			uint32 b;
+		};
+
+		///<param name='cellSize'>Edge length of the cells, about twice the typical object extent works best</param>
+		explicit spatial_hash(float cellSize);
+
+		///<returns>The id of the object, ids of removed objects are reused</returns>
+		uint32 insert(const aabb<float, 3>& bounds);
+		uint32 insert(const vector<float, 3>& position, float radius);
+		void move(uint32 id, const aabb<float, 3>& bounds);
+		void move(uint32 id, const vector<float, 3>& position, float radius);
+		void remove(uint32 id);
+
+		///<summary>Rebuilds the sorted cell storage if objects were inserted or moved to other cells</summary>
+		void update();
+		///<summary>Sorts all objects into their cells, O(n + buckets)</summary>
+		void rebuild();
+		///<returns>Whether update() has to be called before querying</returns>
+		bool outdated() const { return _outdated; }
+
+		template<typename F>
+		///<summary>Calls fn(id) for every object with bounds overlapping box</summary>
+		void query(const aabb<float, 3>& box, F&& fn) const;
+		template<typename F>
+		///<summary>Calls fn(id) for every object with bounds within radius of center</summary>
+		void query(const vector<float, 3>& center, float radius, F&& fn) const;
+
+		///<summary>
+		/// Writes every pair of objects with overlapping bounds to out, in no particular order.
+		/// Pairs beyond capacity are dropped, the return value tells how large out has to be.
+		///</summary>
+		///<returns>The amount of overlapping pairs</returns>
+		size_t pairs(pair* out, size_t capacity) const;
+
+		///<returns>The amount of objects</returns>
+		size_t size() const { return _objects.size() - _free.size(); }
+		float cell_size() const { return _cellSize; }
+		const aabb<float, 3>& bounds(uint32 id) const { return _objects[id].bounds; }
+
+		///<summary>Below this amount of objects the pair generation stays on the calling thread (see Util::parallel)</summary>
+		static constexpr size_t PARALLEL_THRESHOLD = 1 << 12;
+
+	private:
+		static constexpr uint32 INVALID = ~uint32(0);
+
+		struct _object {
+			aabb<float, 3> bounds;
+			int32 cell[3];
+			///<summary>Index of the entry of the object in _entries or _large, INVALID until the next rebuild</summary>
+			uint32 slot;
+			bool alive;
+			///<summary>Extent above twice the cell size, the object is kept in _large</summary>
+			bool large;
+		};
+
+		/// <summary>
+		/// Copy of the object bounds in cell order, id is INVALID for removed objects
+		/// </summary>
+		struct _entry {
+			float lo[3];
+			uint32 id;
+			float hi[3];
+			int32 cell[3];
+		};
+
+		float _cellSize;
+		float _invCellSize;
+		///<summary>Largest half extent of the objects in the grid, the reach of the queries, at most one cell</summary>
+		float _reach = 0.f;
+		bool _outdated = false;
+
+		std::vector<_object> _objects;
+		std::vector<uint32> _free;
+		std::vector<_entry> _entries;
+		///<summary>The objects larger than two cells, in no particular order</summary>
+		std::vector<_entry> _large;
+		///<summary>Entries of bucket b are _entries[_start[b]] ... _entries[_start[b + 1] - 1]</summary>
+		std::vector<uint32> _start;
+		std::vector<uint32> _buckets;
+		uint32 _mask = 0;
+
+		int32 _cell(float v) const;
+		uint32 _bucket(int32 x, int32 y, int32 z) const;
+		void _set(uint32 id, const aabb<float, 3>& bounds);
+
+		template<typename F>
+		///<summary>Calls fn(entry) for the grid entries of all cells the box (widened by the reach) touches</summary>
+		void _visitGrid(const float* lo, const float* hi, F&& fn) const;
+		template<typename F>
+		///<summary>Calls fn(entry) for the grid entries of all cells the box touches and for all large entries</summary>
+		void _visit(const float* lo, const float* hi, F&& fn) const;
+	};
+
+//#######################################################################################################################
+
+	inline int32 spatial_hash::_cell(float v) const {
+		return int32(std::floor(v * _invCellSize));
+	}
+
+	inline uint32 spatial_hash::_bucket(int32 x, int32 y, int32 z) const {
+		return ((uint32(x) * 73856093u) ^ (uint32(y) * 19349663u) ^ (uint32(z) * 83492791u)) & _mask;
+	}
+
+	template<typename F>
+	void spatial_hash::_visit(const float* lo, const float* hi, F&& fn) const {
+		ROBUST_ASSERT(!_outdated, "spatial_hash queried without update()", CHANNEL_MATH);
+		_visitGrid(lo, hi, fn);
+		for (const _entry& e : _large) {
+			fn(e);
+		}
+	}
+
+	template<typename F>
+	void spatial_hash::_visitGrid(const float* lo, const float* hi, F&& fn) const {
+		if (_entries.empty()) {
+			return;
+		}
+		int32 c0[3], c1[3];
+		size_t cells = 1;
+		for (size_t c = 0; c < 3; ++c) {
+			c0[c] = _cell(lo[c] - _reach);
+			c1[c] = _cell(hi[c] + _reach);
+			cells = std::min(cells * size_t(int64(c1[c]) - int64(c0[c]) + 1), _start.size());
+		}
+		if (cells >= _start.size()) {
+			//the range covers more cells than there are buckets, walking the entries is cheaper
+			for (const _entry& e : _entries) {
+				if (e.cell[0] >= c0[0] && e.cell[0] <= c1[0] && e.cell[1] >= c0[1] && e.cell[1] <= c1[1] && e.cell[2] >= c0[2] && e.cell[2] <= c1[2]) {
+					fn(e);
+				}
+			}
+			return;
+		}
+		for (int32 z = c0[2]; z <= c1[2]; ++z) {
+			for (int32 y = c0[1]; y <= c1[1]; ++y) {
+				for (int32 x = c0[0]; x <= c1[0]; ++x) {
+					const uint32 b = _bucket(x, y, z);
+					for (uint32 i = _start[b]; i < _start[b + 1]; ++i) {
+						const _entry& e = _entries[i];
+						if (e.cell[0] == x && e.cell[1] == y && e.cell[2] == z) {
+							fn(e);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	template<typename F>
+	void spatial_hash::query(const aabb<float, 3>& box, F&& fn) const {
+		float lo[3], hi[3];
+		for (size_t c = 0; c < 3; ++c) {
+			lo[c] = box.lo[c];
+			hi[c] = box.hi[c];
+		}
+		_visit(lo, hi, [&](const _entry& e) {
+			if (e.id != INVALID &&
+				e.lo[0] <= hi[0] && e.hi[0] >= lo[0] && e.lo[1] <= hi[1] && e.hi[1] >= lo[1] && e.lo[2] <= hi[2] && e.hi[2] >= lo[2]) {
+				fn(e.id);
+			}
+		});
+	}
+
+	template<typename F>
+	void spatial_hash::query(const vector<float, 3>& center, float radius, F&& fn) const {
+		float p[3], lo[3], hi[3];
+		for (size_t c = 0; c < 3; ++c) {
+			p[c] = center[c];
+			lo[c] = p[c] - radius;
+			hi[c] = p[c] + radius;
+		}
+		const float r2 = radius * radius;
+		_visit(lo, hi, [&](const _entry& e) {
+			if (e.id == INVALID) {
+				return;
+			}
+			float dist = 0.f;
+			for (size_t c = 0; c < 3; ++c) {
+				const float d = p[c] < e.lo[c] ? e.lo[c] - p[c] : (p[c] > e.hi[c] ? p[c] - e.hi[c] : 0.f);
+				dist += d * d;
+			}
+			if (dist <= r2) {
+				fn(e.id);
+			}
+		});
+	}
+}
+
+#endif
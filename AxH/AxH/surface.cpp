@@ -334,6 +334,8 @@ void Win::TimeHandler::start() {
 			it++;
 		}
 
+		this->frameMemory.next_frame();
+
 		this->running = true;
 		this->tstart = std::chrono::high_resolution_clock::now();
 	}
@@ -358,12 +360,13 @@ void Win::TimeHandler::stop() {
 		PRINT_ERR("No measurement running!", 0, CHANNEL_WIN32);
 	}
 }
-void Win::TimeHandler::startMark(const std::string& in) {
+void Win::TimeHandler::startMark(std::string_view in) {
 	if (this->running) {
-		if (!this->marks.count(in)) {
-			this->marks[in] = __TimeMark();
+		auto it = this->marks.find(in);
+		if (it == this->marks.end()) {
+			it = this->marks.emplace(std::string(in), __TimeMark()).first;
 		}
-		this->marks[in].start();
+		it->second.start();
 	}
 	else {
 		PRINT_ERR("No measurement running!", 0, CHANNEL_WIN32);
@@ -381,26 +384,28 @@ std::chrono::duration<double, std::nano> Win::TimeHandler::_cyclicMeasurement()
 		return std::chrono::duration<double, std::nano>(0);
 	}
 }
-void Win::TimeHandler::stopMark(const std::string& in) {
+void Win::TimeHandler::stopMark(std::string_view in) {
 	if (this->running) {
-		if (this->marks.count(in)) {
-			this->marks[in].stop();
+		auto it = this->marks.find(in);
+		if (it != this->marks.end()) {
+			it->second.stop();
 		}
 		else {
-			PRINT_ERR("No such mark! (_MKEY:" + in + ")", 0, CHANNEL_WIN32);
+			PRINT_ERR("No such mark! (_MKEY:" + std::string(in) + ")", 0, CHANNEL_WIN32);
 		}
 	}
 	else {
 		PRINT_ERR("No measurement running!", 0, CHANNEL_WIN32);
 	}
 }
-std::chrono::duration<double, std::nano> Win::TimeHandler::getMarkMeasurement(const std::string& in) {
+std::chrono::duration<double, std::nano> Win::TimeHandler::getMarkMeasurement(std::string_view in) {
 	if (this->running) {
-		if (this->marks.count(in)) {
-			return this->marks[in].giveMeasurement();
+		auto it = this->marks.find(in);
+		if (it != this->marks.end()) {
+			return it->second.giveMeasurement();
 		}
 		else {
-			PRINT_ERR("No such mark! (_MKEY:" + in + ")", 0, CHANNEL_WIN32);
+			PRINT_ERR("No such mark! (_MKEY:" + std::string(in) + ")", 0, CHANNEL_WIN32);
 		}
 	}
 	else {
@@ -437,6 +442,12 @@ Win::TimeHandler::__TimeMark::__TimeMark() {
 	this->elapsedTime = std::chrono::duration<double, std::nano>(0);
 	this->running = false;
 }
+Util::frame_arena& Win::TimeHandler::getFrameArena() {
+	return this->frameMemory;
+}
+size_t Win::TimeHandler::getFrameMemoryHighWater() const {
+	return this->frameMemory.frame_high_water();
+}
 void Win::TimeHandler::setPrintFrequency(uint64 freqRecip) {
 	this->printInterludeMaximum = freqRecip;
 }
@@ -463,6 +474,7 @@ void Win::TimeHandler::printMeasurements(const std::string& key, Stream::print_c
 
 		PRINTP("-----------------------------------------------------------------------", 0, channel);
 		PRINTP("Total: " + std::to_string(total) + "ms (100%)" + "[ActFPS: " + std::to_string(1000000000.0 / cycDiff) + " ; PotFPS: " + std::to_string(1000.0 / (((!key.empty()) ? (total - this->marks[key].giveMeasurement().count() / 1000000) : total))) + "]", 0, channel);
+		PRINTP("Frame memory: " + std::to_string(this->frameMemory.frame_high_water() / 1024.0) + "KiB (peak " + std::to_string(this->frameMemory.high_water() / 1024.0) + "KiB, reserved " + std::to_string(this->frameMemory.capacity() / 1024.0) + "KiB)", 0, channel);
 		PRINTP("#######################################################################", 0, channel);
 
 	}
@@ -6,8 +6,10 @@
 #include "ptr.h"
 #include "math.h"
 #include "errhndl.h"
+#include "alloc.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <chrono>
@@ -49,7 +51,8 @@ namespace Win {
 		double ticksPerSecond = 20;
 		uint64 fps = 60;
 		bool limit = false;
-		std::map<std::string, __TimeMark> marks;
+		std::map<std::string, __TimeMark, std::less<>> marks;
+		Util::frame_arena frameMemory;
 
 		std::chrono::duration<double, std::nano> elapsedTime = std::chrono::duration<double, std::nano>(0);
 		__TimeMark cycMeasure;
@@ -72,23 +75,32 @@ namespace Win {
 		///<summary>blocks, until the elapsed time is at least the required amount of time for the FPS to be 60</summary>
 		void vsync();
 
-		///<summmary>Start taking time measurements. Usually done BEFORE a render pass</summary>
+		///<summmary>Start taking time measurements and a new frame of the frame arena. Usually done BEFORE a render pass</summary>
 		void start();
 
 		///<summary>Stops taking time measurements. Usually done AFTER a render pass</summary>
 		void stop();
 
 		///<summary>Starts the time mark.</summary>
-		///<param name='in'>The mark id</param>
-		void startMark(const std::string& in);
+		///<param name='in'>The mark id, the name is only copied the first time the mark is used</param>
+		void startMark(std::string_view in);
 
 		///<summary>Stops the time mark.</summary>
 		///<param name='in'>The mark id</param>
-		void stopMark(const std::string& in);
+		void stopMark(std::string_view in);
 
 		///<summary>Returns the measurement for the given mark in NANO seconds</summary>
 		///<param name='in'>The mark id</param>
-		std::chrono::duration<double, std::nano> getMarkMeasurement(const std::string& in);
+		std::chrono::duration<double, std::nano> getMarkMeasurement(std::string_view in);
+
+		///<summary>
+		///Returns the arena for memory that lives for the current frame (and the previous one, the arena is double buffered).
+		///It is moved on by start(), use Util::arena_allocator for containers.
+		///</summary>
+		Util::frame_arena& getFrameArena();
+
+		///<summary>Returns the bytes of frame memory used by the last finished frame</summary>
+		size_t getFrameMemoryHighWater() const;
 
 		/// <summary>
 		/// Used to set the frequency of prints for 'printMeasurements'
@@ -0,0 +1,17 @@
+#include "view.h"
+
+/*
+* view.h is header only, the instantiations below make every build compile its templates,
+* including the members only instantiated on use (as_comp, as_dmatrix, transpose).
+*/
+namespace math {
+	template class view<float, dextents<2>>;
+	template class view<const float, dextents<2>>;
+	template class view<float, dextents<1>>;
+	template class view<float, extents<4, 4>>;
+	template class view<float, dextents<2>, layout_stride>;
+
+	template comp_ref<float, 4, 4> view<float, dextents<2>>::as_comp<4, 4>() const;
+	template comp_ref<float, 4, 4> view<float, extents<4, 4>>::as_comp<4, 4>() const;
+	template comp_ref<float, 16> view<float, dextents<1>>::as_comp<16>() const;
+}
@@ -0,0 +1,466 @@
+#ifndef __H_VIEW
+#define __H_VIEW
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <type_traits>
+#include "inc_settings.h"
+#include "errhndl.h"
+#include "math.h"
+#include "ptr.h"
+#include "dmatrix.h"
+
+namespace math {
+
+	///<summary>Marks an extent that is only known at runtime</summary>
+	inline constexpr size_t dynamic_extent = std::numeric_limits<size_t>::max();
+
+	template<size_t... E>
+	/// <summary>
+	/// The extents of a view. Extents given as template argument carry no state, only the dynamic_extent ones are stored in the object.
+	/// </summary>
+	class extents {
+	public:
+		static constexpr size_t rank = sizeof...(E);
+		static constexpr size_t rank_dynamic = ((E == dynamic_extent ? 1 : 0) + ... + 0);
+
+		constexpr extents() { }
+
+		///<summary>Takes the dynamic extents in order</summary>
+		template<typename... I>
+			requires (sizeof...(I) == rank_dynamic && sizeof...(I) > 0 && all_true<std::is_convertible<I, size_t>::value...>::value)
+		constexpr explicit extents(I... dyn) : _dyn{ size_t(dyn)... } { }
+
+		constexpr explicit extents(const std::array<size_t, rank_dynamic>& dyn) : _dyn(dyn) { }
+
+		///<returns>The extent given by the template argument, dynamic_extent for runtime extents</returns>
+		static constexpr size_t static_extent(size_t r) {
+			return _static[r];
+		}
+
+		constexpr size_t extent(size_t r) const {
+			MATH_BOUNDS_CHECK(r < rank)
+			return _static[r] == dynamic_extent ? _dyn[_dyn_index[r]] : _static[r];
+		}
+
+		///<returns>The number of elements</returns>
+		constexpr size_t size() const {
+			size_t res = 1;
+			for (size_t r = 0; r < rank; ++r) {
+				res *= extent(r);
+			}
+			return res;
+		}
+
+		template<size_t... F>
+		constexpr bool operator==(const extents<F...>& ref) const {
+			if constexpr (sizeof...(F) != rank) {
+				return false;
+			}
+			else {
+				for (size_t r = 0; r < rank; ++r) {
+					if (extent(r) != ref.extent(r)) {
+						return false;
+					}
+				}
+				return true;
+			}
+		}
+
+	private:
+		static constexpr std::array<size_t, rank> _static = { E... };
+		static constexpr std::array<size_t, rank> _dyn_index = []() {
+			std::array<size_t, rank> ind{};
+			size_t d = 0;
+			for (size_t r = 0; r < rank; ++r) {
+				ind[r] = d;
+				if (_static[r] == dynamic_extent) {
+					++d;
+				}
+			}
+			return ind;
+		}();
+
+		std::array<size_t, rank_dynamic> _dyn{};
+	};
+
+	template<typename S>
+	struct dynamic_extents_of;
+	template<size_t... I>
+	struct dynamic_extents_of<std::index_sequence<I...>> {
+		using type = extents<((void)I, dynamic_extent)...>;
+	};
+
+	template<size_t R>
+	///<summary>Extents of rank R that are all given at runtime</summary>
+	using dextents = typename dynamic_extents_of<std::make_index_sequence<R>>::type;
+
+	template<typename E>
+	/// <summary>
+	/// Mapping of indices to element offsets by one stride per dimension, the base of the row major, column major and strided layouts.
+	/// Strides are in elements and may be negative.
+	/// </summary>
+	class strided_mapping {
+	public:
+		using extents_type = E;
+		static constexpr bool is_strided = true;
+
+		constexpr strided_mapping() { }
+		constexpr strided_mapping(const E& ext, const std::array<ptrdiff_t, E::rank>& strides) : ext(ext), str(strides) { }
+
+		template<typename... I>
+			requires (sizeof...(I) == E::rank && all_true<std::is_convertible<I, size_t>::value...>::value)
+		constexpr ptrdiff_t operator()(I... ind) const {
+			const std::array<size_t, E::rank> i = { size_t(ind)... };
+			ptrdiff_t off = 0;
+			for (size_t r = 0; r < E::rank; ++r) {
+				MATH_BOUNDS_CHECK(i[r] < ext.extent(r))
+				off += ptrdiff_t(i[r]) * str[r];
+			}
+			return off;
+		}
+
+		constexpr const E& extents() const { return ext; }
+		constexpr ptrdiff_t stride(size_t r) const { return str[r]; }
+		constexpr const std::array<ptrdiff_t, E::rank>& strides() const { return str; }
+
+		///<returns>The number of elements between the first and the last referenced element (inclusive)</returns>
+		constexpr size_t required_span_size() const {
+			size_t span = 1;
+			for (size_t r = 0; r < E::rank; ++r) {
+				if (ext.extent(r) == 0) {
+					return 0;
+				}
+				span += (ext.extent(r) - 1) * size_t(str[r] < 0 ? -str[r] : str[r]);
+			}
+			return span;
+		}
+
+		///<returns>Whether the elements occupy a gapless range</returns>
+		constexpr bool is_contiguous() const {
+			return required_span_size() == ext.size();
+		}
+
+	protected:
+		E ext;
+		std::array<ptrdiff_t, E::rank> str{};
+	};
+
+	/// <summary>
+	/// Row major layout, the last index is contiguous. This is the layout of comp and matrix.
+	/// </summary>
+	struct layout_right {
+		template<typename E>
+		class mapping : public strided_mapping<E> {
+		public:
+			constexpr mapping() { }
+			constexpr explicit mapping(const E& ext) : strided_mapping<E>(ext, _strides(ext)) { }
+
+		private:
+			static constexpr std::array<ptrdiff_t, E::rank> _strides(const E& ext) {
+				std::array<ptrdiff_t, E::rank> str{};
+				ptrdiff_t carry = 1;
+				for (size_t t = E::rank; t-- > 0;) {
+					str[t] = carry;
+					carry *= ptrdiff_t(ext.extent(t));
+				}
+				return str;
+			}
+		};
+	};
+
+	/// <summary>
+	/// Column major layout, the first index is contiguous
+	/// </summary>
+	struct layout_left {
+		template<typename E>
+		class mapping : public strided_mapping<E> {
+		public:
+			constexpr mapping() { }
+			constexpr explicit mapping(const E& ext) : strided_mapping<E>(ext, _strides(ext)) { }
+
+		private:
+			static constexpr std::array<ptrdiff_t, E::rank> _strides(const E& ext) {
+				std::array<ptrdiff_t, E::rank> str{};
+				ptrdiff_t carry = 1;
+				for (size_t t = 0; t < E::rank; ++t) {
+					str[t] = carry;
+					carry *= ptrdiff_t(ext.extent(t));
+				}
+				return str;
+			}
+		};
+	};
+
+	/// <summary>
+	/// Layout with arbitrary strides, e.g. interleaved vertex attributes or slices of other views
+	/// </summary>
+	struct layout_stride {
+		template<typename E>
+		class mapping : public strided_mapping<E> {
+		public:
+			using strided_mapping<E>::strided_mapping;
+
+			///<summary>Takes the strides of any other strided mapping</summary>
+			template<typename M>
+				requires (M::is_strided && M::extents_type::rank == E::rank)
+			constexpr mapping(const M& ref) : strided_mapping<E>(E(_dynamic(ref.extents())), ref.strides()) { }
+
+		private:
+			template<typename F>
+			static constexpr std::array<size_t, E::rank_dynamic> _dynamic(const F& ext) {
+				std::array<size_t, E::rank_dynamic> dyn{};
+				size_t d = 0;
+				for (size_t r = 0; r < E::rank; ++r) {
+					if (E::static_extent(r) == dynamic_extent) {
+						dyn[d++] = ext.extent(r);
+					}
+				}
+				return dyn;
+			}
+		};
+	};
+
+	template<size_t TR, size_t TC>
+	/// <summary>
+	/// Two dimensional layout of TR x TC tiles. The tiles are stored row major and so are the elements inside of each tile,
+	/// which keeps two dimensional neighbourhoods in few cache lines (textures, blocked kernels).
+	/// Partial tiles at the right and bottom border are padded.
+	/// </summary>
+	struct layout_tiled {
+		static constexpr size_t tile_rows = TR;
+		static constexpr size_t tile_cols = TC;
+		static constexpr size_t tile_size = TR * TC;
+
+		template<typename E>
+		class mapping {
+			static_assert(E::rank == 2, "tiled layouts are two dimensional");
+			static_assert(TR > 0 && TC > 0, "tiles may not be empty");
+		public:
+			using extents_type = E;
+			static constexpr bool is_strided = false;
+
+			constexpr mapping() { }
+			constexpr explicit mapping(const E& ext) : ext(ext), pitch(((ext.extent(1) + TC - 1) / TC) * tile_size) { }
+			///<param name='tilePitch'>Distance of two rows of tiles in elements, at least ceil(cols / TC) * TR * TC</param>
+			constexpr mapping(const E& ext, size_t tilePitch) : ext(ext), pitch(tilePitch) { }
+
+			template<typename R, typename C>
+				requires (std::is_convertible<R, size_t>::value && std::is_convertible<C, size_t>::value)
+			constexpr ptrdiff_t operator()(R row, C col) const {
+				const size_t r = size_t(row);
+				const size_t c = size_t(col);
+				MATH_BOUNDS_CHECK(r < ext.extent(0) && c < ext.extent(1))
+				return ptrdiff_t((r / TR) * pitch + (c / TC) * tile_size + (r % TR) * TC + c % TC);
+			}
+
+			constexpr const E& extents() const { return ext; }
+			constexpr size_t tile_pitch() const { return pitch; }
+
+			constexpr size_t required_span_size() const {
+				if (ext.extent(0) == 0 || ext.extent(1) == 0) {
+					return 0;
+				}
+				return ((ext.extent(0) - 1) / TR) * pitch + ((ext.extent(1) + TC - 1) / TC) * tile_size;
+			}
+
+			constexpr bool is_contiguous() const {
+				return ext.extent(0) % TR == 0 && ext.extent(1) % TC == 0 && pitch == (ext.extent(1) / TC) * tile_size;
+			}
+
+		private:
+			E ext;
+			size_t pitch = 0;
+		};
+	};
+
+	template<typename T, typename E, typename L = layout_right>
+	/// <summary>
+	/// Non owning view of a multidimensional array in an external buffer (a loaded vertex buffer, the pixels of a wrap_arr_ptr, a comp).
+	/// The extents E and the layout L define how indices map to elements, copying a view never copies elements.
+	/// Use view&lt;const T, ...&gt; for read only access, sub views are taken by subview().
+	/// </summary>
+	class view {
+	public:
+		using element_type = T;
+		using value_type = std::remove_cv_t<T>;
+		using extents_type = E;
+		using layout_type = L;
+		using mapping_type = typename L::template mapping<E>;
+		static constexpr size_t rank = E::rank;
+
+		constexpr view() { }
+		constexpr view(T* base, const mapping_type& map) : ptr(base), map(map) { }
+
+		///<summary>Views base with the given dynamic extents</summary>
+		template<typename... I>
+			requires (sizeof...(I) == E::rank_dynamic && all_true<std::is_convertible<I, size_t>::value...>::value)
+		constexpr explicit view(T* base, I... dyn) : ptr(base), map(E(dyn...)) { }
+
+		///<summary>Views the elements of arr, the view may not exceed the array</summary>
+		template<typename... I>
+			requires (sizeof...(I) == E::rank_dynamic && all_true<std::is_convertible<I, size_t>::value...>::value)
+		explicit view(wrap_arr_ptr<value_type>& arr, I... dyn) : ptr(arr.data()), map(E(dyn...)) {
+			ROBUST_ASSERT(map.required_span_size() <= arr.size(), "the view exceeds the array", CHANNEL_MATH);
+		}
+
+		template<typename U>
+			requires (!std::is_same<U, T>::value && std::is_same<const U, T>::value)
+		constexpr view(const view<U, E, L>& ref) : ptr(ref.data()), map(ref.mapping()) { }
+
+		template<typename... I>
+			requires (sizeof...(I) == rank)
+		constexpr T& operator()(I... ind) const {
+			return ptr[map(ind...)];
+		}
+
+		constexpr T& operator[](size_t ind) const requires (rank == 1) {
+			return ptr[map(ind)];
+		}
+
+		constexpr size_t extent(size_t r) const { return map.extents().extent(r); }
+		constexpr const E& extents() const { return map.extents(); }
+		constexpr const mapping_type& mapping() const { return map; }
+		constexpr T* data() const { return ptr; }
+		///<returns>The number of elements</returns>
+		constexpr size_t size() const { return map.extents().size(); }
+		constexpr bool empty() const { return size() == 0; }
+		constexpr bool is_contiguous() const { return map.is_contiguous(); }
+		constexpr ptrdiff_t stride(size_t r) const requires (mapping_type::is_strided) { return map.stride(r); }
+
+		///<returns>A view of the rows x cols block starting at (r, c), see subview()</returns>
+		auto submatrix(size_t r, size_t c, size_t rows, size_t cols) const requires (rank == 2);
+
+		///<returns>A transposed view of the same elements</returns>
+		constexpr view<T, dextents<2>, layout_stride> transpose() const requires (rank == 2 && mapping_type::is_strided) {
+			using M = layout_stride::mapping<dextents<2>>;
+			return view<T, dextents<2>, layout_stride>(ptr, M(dextents<2>(extent(1), extent(0)), { map.stride(1), map.stride(0) }));
+		}
+
+		///<summary>Lets the dmatrix kernels (gemm, gemv) work on the viewed elements</summary>
+		dmatrix_ref<T> as_dmatrix() const requires (rank == 2 && mapping_type::is_strided) {
+			return dmatrix_ref<T>(ptr, extent(0), extent(1), map.stride(0), map.stride(1));
+		}
+
+		dvector_ref<T> as_dvector() const requires (rank == 1 && mapping_type::is_strided) {
+			return dvector_ref<T>(ptr, extent(0), map.stride(0));
+		}
+
+		template<size_t A, size_t... S>
+		///<summary>
+		/// Returns a comp_ref over the viewed elements, the view has to be contiguous row major with the extents A, S...
+		///</summary>
+		comp_ref<T, A, S...> as_comp() const requires (std::is_same<L, layout_right>::value && sizeof...(S) + 1 == rank) {
+			ROBUST_ASSERT((math::extents<A, S...>() == extents()), "the extents do not match the comp", CHANNEL_MATH);
+			return comp_ref<T, A, S...>(ptr);
+		}
+
+	private:
+		T* ptr = nullptr;
+		mapping_type map;
+	};
+
+	///<summary>Selects the elements [begin, end) of a dimension</summary>
+	struct slice_range {
+		size_t begin;
+		size_t end;
+	};
+
+	///<summary>Selects all elements of a dimension</summary>
+	struct full_extent_t { };
+	inline constexpr full_extent_t full_extent{};
+
+	template<typename S>
+	///<summary>Whether the slice selects a single index and thereby removes the dimension</summary>
+	inline constexpr bool is_index_slice = !std::is_same<S, slice_range>::value && !std::is_same<S, full_extent_t>::value;
+
+	template<typename... S>
+	inline constexpr size_t slice_rank = ((is_index_slice<S> ? 0 : 1) + ... + 0);
+
+	template<typename T, size_t... E>
+	///<returns>A view of the elements of c</returns>
+	constexpr view<T, extents<E...>> make_view(comp<T, E...>& c) {
+		return view<T, extents<E...>>(c.data());
+	}
+
+	template<typename T, size_t... E>
+	constexpr view<const T, extents<E...>> make_view(const comp<T, E...>& c) {
+		return view<const T, extents<E...>>(c.data());
+	}
+
+	template<typename T>
+	///<returns>A view of the elements referenced by m</returns>
+	view<T, dextents<2>, layout_stride> make_view(const dmatrix_ref<T>& m) {
+		using M = layout_stride::mapping<dextents<2>>;
+		return view<T, dextents<2>, layout_stride>(m.data(), M(dextents<2>(m.rows(), m.cols()), { m.row_stride(), m.col_stride() }));
+	}
+
+	template<typename T, typename E, typename L, typename... S>
+	/// <summary>
+	/// Zero copy slicing, takes one slice per dimension: an index removes the dimension, a slice_range or full_extent keeps (part of) it.
+	/// Strided layouts result in a layout_stride view, tiled views can only be cut into blocks starting at a tile boundary.
+	/// </summary>
+	auto subview(const view<T, E, L>& v, S... slices) {
+		static_assert(sizeof...(S) == E::rank, "subview takes one slice per dimension");
+		constexpr size_t R = slice_rank<S...>;
+
+		std::array<size_t, E::rank> first{};
+		std::array<size_t, E::rank> count{};
+		size_t r = 0;
+		auto select = [&](auto s) {
+			using X = decltype(s);
+			if constexpr (std::is_same<X, full_extent_t>::value) {
+				first[r] = 0;
+				count[r] = v.extent(r);
+			}
+			else if constexpr (std::is_same<X, slice_range>::value) {
+				MATH_BOUNDS_CHECK(s.begin <= s.end && s.end <= v.extent(r))
+				first[r] = s.begin;
+				count[r] = s.end - s.begin;
+			}
+			else {
+				MATH_BOUNDS_CHECK(size_t(s) < v.extent(r))
+				first[r] = size_t(s);
+				count[r] = 1;
+			}
+			++r;
+		};
+		(select(slices), ...);
+
+		std::array<size_t, R> ext{};
+		if constexpr (view<T, E, L>::mapping_type::is_strided) {
+			std::array<ptrdiff_t, R> str{};
+			constexpr std::array<bool, E::rank> keep = { !is_index_slice<S>... };
+			ptrdiff_t off = 0;
+			size_t k = 0;
+			for (size_t d = 0; d < E::rank; ++d) {
+				off += ptrdiff_t(first[d]) * v.stride(d);
+				if (keep[d]) {
+					ext[k] = count[d];
+					str[k] = v.stride(d);
+					++k;
+				}
+			}
+			using M = layout_stride::mapping<dextents<R>>;
+			return view<T, dextents<R>, layout_stride>(v.data() + off, M(dextents<R>(ext), str));
+		}
+		else {
+			static_assert(R == 2, "tiled views can only be sliced into blocks");
+			ASSERT(first[0] % L::tile_rows == 0 && first[1] % L::tile_cols == 0, "the block does not start at a tile boundary", CHANNEL_MATH);
+			const size_t pitch = v.mapping().tile_pitch();
+			const size_t off = (first[0] / L::tile_rows) * pitch + (first[1] / L::tile_cols) * L::tile_size;
+			ext = { count[0], count[1] };
+			using M = typename L::template mapping<dextents<2>>;
+			return view<T, dextents<2>, L>(v.data() + off, M(dextents<2>(ext), pitch));
+		}
+	}
+
+	template<typename T, typename E, typename L>
+	auto view<T, E, L>::submatrix(size_t r, size_t c, size_t rows, size_t cols) const requires (rank == 2) {
+		return subview(*this, slice_range{ r, r + rows }, slice_range{ c, c + cols });
+	}
+}
+
+#endif